@@ -0,0 +1,97 @@
+/*
+ * Measures the throughput of the assembler emitter with lines shaped like
+ * x86 instructions and labels, written to a temporary file. Numbers are
+ * emitted once with be_emit_int() and once with be_emit_irprintf().
+ *
+ * usage: benchmarks.emitter [lines]
+ */
+#include "firm.h"
+#include "beemitter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int n_lines = 1000000;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void emit_number(int64_t const value, bool const use_printf)
+{
+	if (use_printf)
+		be_emit_irprintf("%d", (int)value);
+	else
+		be_emit_int(value);
+}
+
+static void emit_lines(bool const use_printf)
+{
+	for (int i = 0; i < n_lines; ++i) {
+		switch (i % 4) {
+		case 0:
+			be_emit_cstring(".L");
+			emit_number(i, use_printf);
+			be_emit_char(':');
+			break;
+		case 1:
+			be_emit_cstring("\tmovl $");
+			emit_number(i * 31 - 1000000, use_printf);
+			be_emit_cstring(", ");
+			emit_number(i % 4096, use_printf);
+			be_emit_cstring("(%rax,%rcx,");
+			emit_number(1 << (i % 4), use_printf);
+			be_emit_char(')');
+			break;
+		case 2:
+			be_emit_cstring("\taddl ");
+			emit_number(-8 * (i % 64), use_printf);
+			be_emit_cstring("(%rsp), %edx");
+			break;
+		default:
+			be_emit_cstring("\tjne .L");
+			emit_number(i - 3, use_printf);
+			break;
+		}
+		be_emit_char('\n');
+		be_emit_write_line();
+	}
+}
+
+/** Returns the best throughput in MB/s of 5 runs. */
+static double measure(bool const use_printf)
+{
+	double best = 0;
+	for (int run = 0; run < 5; ++run) {
+		FILE *const file = tmpfile();
+		if (file == NULL)
+			exit(1);
+		double const t0 = now();
+		be_emit_init(file);
+		emit_lines(use_printf);
+		be_emit_exit();
+		fflush(file);
+		double const t1   = now();
+		double const mb   = ftell(file) / 1e6;
+		double const rate = mb / (t1 - t0);
+		if (rate > best)
+			best = rate;
+		fclose(file);
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1)
+		n_lines = atoi(argv[1]);
+
+	ir_init();
+	printf("be_emit_int       %8.1f MB/s\n", measure(false));
+	printf("be_emit_irprintf  %8.1f MB/s\n", measure(true));
+	ir_finish();
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Measures ir_estimate_execfreq() on randomly generated structured control
+ * flow with nested loops and ifs of increasing size.
+ *
+ * usage: benchmarks.execfreq [statements...]
+ */
+#include "firm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static ir_node  *arg;
+static int       n_blocks;
+static int       budget;
+static unsigned  rnd_state;
+
+static unsigned rnd(void)
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return (rnd_state >> 16) & 0x7fff;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Ends the current block with a Cond, returns the true and false Proj. */
+static ir_node *new_cond(ir_node **const false_proj)
+{
+	ir_node *const cmp  = new_Cmp(arg, new_Const_long(mode_Is, rnd() % 100),
+	                              ir_relation_less);
+	ir_node *const cond = new_Cond(cmp);
+	*false_proj = new_Proj(cond, mode_X, pn_Cond_false);
+	return new_Proj(cond, mode_X, pn_Cond_true);
+}
+
+static void new_block_from(ir_node *const pred)
+{
+	ir_node *const block = new_immBlock();
+	add_immBlock_pred(block, pred);
+	mature_immBlock(block);
+	set_cur_block(block);
+	++n_blocks;
+}
+
+/** Generates statements into the current block until the budget is used. */
+static void generate(int const depth)
+{
+	while (budget > 0) {
+		--budget;
+		unsigned const r = rnd() % 10;
+		if (r < 3 && depth < 6) {
+			/* loop */
+			ir_node *const entry  = new_Jmp();
+			ir_node *const header = new_immBlock();
+			add_immBlock_pred(header, entry);
+			set_cur_block(header);
+			++n_blocks;
+			ir_node *exit;
+			new_block_from(new_cond(&exit));
+			generate(depth + 1);
+			add_immBlock_pred(header, new_Jmp());
+			mature_immBlock(header);
+			new_block_from(exit);
+		} else if (r < 6) {
+			/* if with optional else */
+			ir_node *false_proj;
+			new_block_from(new_cond(&false_proj));
+			generate(depth + 1);
+			ir_node *const jmp_true = new_Jmp();
+			new_block_from(false_proj);
+			if (rnd() % 2)
+				generate(depth + 1);
+			ir_node *const jmp_false = new_Jmp();
+			ir_node *const join      = new_immBlock();
+			add_immBlock_pred(join, jmp_true);
+			add_immBlock_pred(join, jmp_false);
+			mature_immBlock(join);
+			set_cur_block(join);
+			++n_blocks;
+		} else if (r < 7 && depth > 0) {
+			return;
+		}
+	}
+}
+
+static ir_graph *build_function(int const nr, int const statements)
+{
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const mtp      = new_type_method(1, 1, false, cc_cdecl_set,
+	                                          mtp_no_property);
+	set_method_param_type(mtp, 0, int_type);
+	set_method_res_type(mtp, 0, int_type);
+	char name[32];
+	snprintf(name, sizeof(name), "f%d", nr);
+	ir_entity *const entity = new_global_entity(get_glob_type(),
+		new_id_from_str(name), mtp, ir_visibility_external,
+		IR_LINKAGE_DEFAULT);
+	ir_graph  *const irg    = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+
+	arg       = new_Proj(get_irg_args(irg), mode_Is, 0);
+	rnd_state = 7919 * (nr + 1);
+	n_blocks  = 1;
+	budget    = statements;
+	while (budget > 0)
+		generate(0);
+	ir_node *const ret = new_Return(get_store(), 1, &arg);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+	                         | IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE);
+	return irg;
+}
+
+int main(int argc, char **argv)
+{
+	static int const default_sizes[] = { 1000, 2500, 12500, 25000 };
+	int const n_sizes = argc > 1 ? argc - 1
+	                             : (int)(sizeof(default_sizes)
+	                                     / sizeof(default_sizes[0]));
+
+	ir_init();
+	for (int i = 0; i < n_sizes; ++i) {
+		int       const statements = argc > 1 ? atoi(argv[i + 1])
+		                                      : default_sizes[i];
+		ir_graph *const irg        = build_function(i, statements);
+		double    const t0         = now();
+		ir_estimate_execfreq(irg);
+		double    const t1         = now();
+		printf("%6d blocks  %8.3fs\n", n_blocks, t1 - t0);
+		free_ir_graph(irg);
+	}
+	ir_finish();
+	return 0;
+}
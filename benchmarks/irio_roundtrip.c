@@ -0,0 +1,200 @@
+/*
+ * Measures export and import of a program in the textual and in the binary
+ * IR format and the lazy import of a single graph from the binary file.
+ *
+ * usage: benchmarks.irio_roundtrip [functions] [blocks per function]
+ */
+#include "firm.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static int n_functions = 200;
+static int n_blocks    = 100;
+
+static char text[]   = "/tmp/irio_roundtrip_XXXXXX";
+static char binary[] = "/tmp/irio_roundtrip_XXXXXX";
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* a chain of diamonds, each arm doing some arithmetic and a load */
+static void build_function(int const nr, ir_entity *const global)
+{
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const mtp      = new_type_method(1, 1, false, cc_cdecl_set,
+	                                          mtp_no_property);
+	set_method_param_type(mtp, 0, int_type);
+	set_method_res_type(mtp, 0, int_type);
+	char name[32];
+	snprintf(name, sizeof(name), "f%d", nr);
+	ir_entity *const entity = new_global_entity(get_glob_type(),
+		new_id_from_str(name), mtp, ir_visibility_external,
+		IR_LINKAGE_DEFAULT);
+	ir_graph  *const irg    = new_ir_graph(entity, 2);
+	set_current_ir_graph(irg);
+
+	set_value(0, new_Proj(get_irg_args(irg), mode_Is, 0));
+	set_value(1, new_Const_long(mode_Is, nr));
+	for (int b = 0; b < n_blocks; ++b) {
+		ir_node *const cmp  = new_Cmp(get_value(0, mode_Is),
+		                              new_Const_long(mode_Is, b),
+		                              ir_relation_less);
+		ir_node *const cond = new_Cond(cmp);
+		ir_node *const join = new_immBlock();
+		for (int arm = 0; arm < 2; ++arm) {
+			ir_node *const block = new_immBlock();
+			add_immBlock_pred(block, new_Proj(cond, mode_X, arm));
+			mature_immBlock(block);
+			set_cur_block(block);
+			ir_node *const c   = new_Const_long(mode_Is, b * 2 + arm);
+			ir_node *const mul = new_Mul(get_value(1, mode_Is), c);
+			ir_node *const ld  = new_Load(get_store(), new_Address(global),
+			                              mode_Is, int_type, cons_none);
+			set_store(new_Proj(ld, mode_M, pn_Load_M));
+			ir_node *const val = new_Proj(ld, mode_Is, pn_Load_res);
+			set_value(1, new_Eor(new_Add(mul, val), get_value(0, mode_Is)));
+			add_immBlock_pred(join, new_Jmp());
+		}
+		mature_immBlock(join);
+		set_cur_block(join);
+	}
+	ir_node *const res = get_value(1, mode_Is);
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+}
+
+static void build_program(void)
+{
+	ir_type   *const int_type = get_type_for_mode(mode_Is);
+	ir_entity *const global   = new_global_entity(get_glob_type(),
+		new_id_from_str("global"), int_type, ir_visibility_external,
+		IR_LINKAGE_DEFAULT);
+	for (int i = 0; i < n_functions; ++i)
+		build_function(i, global);
+}
+
+static long file_size(char const *const filename)
+{
+	struct stat st;
+	return stat(filename, &st) == 0 ? (long)st.st_size : -1;
+}
+
+/** Runs @p stage in a child process with a freshly initialized libFirm. */
+static void run_stage(void (*stage)(void))
+{
+	fflush(NULL);
+	pid_t const pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		ir_init();
+		stage();
+		ir_finish();
+		exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "benchmark stage failed\n");
+		exit(1);
+	}
+}
+
+static void export_program(void)
+{
+	build_program();
+	long n_nodes = 0;
+	for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i)
+		n_nodes += get_irg_last_idx(get_irp_irg(i));
+	printf("%d graphs, %ld nodes\n", n_functions, n_nodes);
+
+	double const t0 = now();
+	if (ir_export(text) != 0)
+		exit(1);
+	double const t1 = now();
+	if (ir_export_binary(binary) != 0)
+		exit(1);
+	double const t2 = now();
+	printf("export   text %8.3fs  binary %8.3fs\n", t1 - t0, t2 - t1);
+	printf("size     text %8ldK  binary %8ldK\n", file_size(text) / 1024,
+	       file_size(binary) / 1024);
+}
+
+static void import_text(void)
+{
+	double const t0 = now();
+	if (ir_import(text) != 0)
+		exit(1);
+	printf("import   text %8.3fs", now() - t0);
+}
+
+static void import_binary(void)
+{
+	double const t0 = now();
+	if (ir_import(binary) != 0)
+		exit(1);
+	printf("  binary %8.3fs\n", now() - t0);
+}
+
+static void import_lazy(void)
+{
+	double          const t0     = now();
+	ir_lazy_import *const import = ir_import_lazy(binary);
+	if (import == NULL)
+		exit(1);
+	double const t1 = now();
+
+	ir_type   *const glob   = get_glob_type();
+	ir_entity *      entity = NULL;
+	for (size_t i = 0, n = get_compound_n_members(glob); i < n; ++i) {
+		ir_entity *const member = get_compound_member(glob, i);
+		if (strcmp(get_entity_name(member), "f0") == 0)
+			entity = member;
+	}
+	if (entity == NULL || ir_import_lazy_irg(import, entity) == NULL)
+		exit(1);
+	double const t2 = now();
+	printf("lazy     open %8.3fs  one graph %8.3fs\n", t1 - t0, t2 - t1);
+	ir_import_lazy_free(import);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1)
+		n_functions = atoi(argv[1]);
+	if (argc > 2)
+		n_blocks = atoi(argv[2]);
+	close(mkstemp(text));
+	close(mkstemp(binary));
+
+	run_stage(export_program);
+	run_stage(import_text);
+	run_stage(import_binary);
+	run_stage(import_lazy);
+
+	remove(text);
+	remove(binary);
+	return 0;
+}
+
+#else
+
+int main(void)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Measures compile time, code size and run time of jit compiled code for
+ * the code generation tiers of be_jit_compile_tier().
+ *
+ * usage: benchmarks.jit_tiers [functions] [operations per function]
+ */
+#include "firm.h"
+#include "jit.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static int n_functions  = 300;
+static int n_operations = 200;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* int fN(int a, int b): a chain of arithmetic keeping 16 values live */
+static ir_entity *build_function(int const nr, ir_type *const mtp)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "f%d", nr);
+	ir_entity *const entity = new_global_entity(get_glob_type(),
+		new_id_from_str(name), mtp, ir_visibility_external,
+		IR_LINKAGE_DEFAULT);
+	ir_graph  *const irg    = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *const a = new_Proj(get_irg_args(irg), mode_Is, 0);
+	ir_node *const b = new_Proj(get_irg_args(irg), mode_Is, 1);
+	ir_node *values[16];
+	for (int i = 0; i < 16; ++i)
+		values[i] = i % 2 == 0 ? a : b;
+	ir_node *res = new_Add(new_Add(a, b), new_Const_long(mode_Is, nr));
+	for (int i = 0; i < n_operations; ++i) {
+		ir_node *const x = values[i * 7 % 16];
+		ir_node *const y = values[(i * 5 + 3) % 16];
+		ir_node *const c = new_Const_long(mode_Is, i * 37 + 11);
+		switch (i % 3) {
+		case 0:  res = new_Mul(new_Add(x, c), y);   break;
+		case 1:  res = new_Sub(new_Add(res, c), x); break;
+		default: res = new_Eor(new_Add(y, c), res); break;
+		}
+		values[i % 16] = res;
+	}
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return entity;
+}
+
+static ir_jit_tier_t tier;
+
+static void compile_and_run(void)
+{
+	ir_target_set("x86_64-linux-gnu");
+	ir_target_init();
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const mtp      = new_type_method(2, 1, false, cc_cdecl_set,
+	                                          mtp_no_property);
+	set_method_param_type(mtp, 0, int_type);
+	set_method_param_type(mtp, 1, int_type);
+	set_method_res_type(mtp, 0, int_type);
+
+	ir_entity         **const entities
+		= (ir_entity**)malloc(n_functions * sizeof(*entities));
+	ir_jit_function_t **const functions
+		= (ir_jit_function_t**)malloc(n_functions * sizeof(*functions));
+	void              **const addresses
+		= (void**)malloc(n_functions * sizeof(*addresses));
+	for (int i = 0; i < n_functions; ++i)
+		entities[i] = build_function(i, mtp);
+	be_lower_for_target();
+
+	ir_jit_segment_t *const segment = be_new_jit_segment();
+	double   const t0   = now();
+	unsigned       size = 0;
+	for (int i = 0; i < n_functions; ++i) {
+		functions[i] = be_jit_compile_tier(segment,
+		                                   get_entity_irg(entities[i]), tier);
+		if (functions[i] == NULL)
+			exit(1);
+		size += be_get_function_size(functions[i]);
+	}
+	double const t1 = now();
+	if (be_jit_emit_executable(segment, n_functions, functions, entities,
+	                           addresses) == NULL)
+		exit(1);
+
+	/* the best of 5 rounds, each calling every function 10000 times */
+	double   run = 1e9;
+	unsigned sum = 0;
+	for (int round = 0; round < 5; ++round) {
+		double const t2 = now();
+		for (int r = 0; r < 10000; ++r) {
+			for (int i = 0; i < n_functions; ++i) {
+				int (*const f)(int, int) = (int (*)(int, int))addresses[i];
+				sum += (unsigned)f(r, i);
+			}
+		}
+		double const t3 = now();
+		if (t3 - t2 < run)
+			run = t3 - t2;
+	}
+	printf("%-8s compile %7.3fs  code %8u bytes  run %7.3fs  (%08x)\n",
+	       tier == ir_jit_tier_fast ? "fast" : "default", t1 - t0, size, run,
+	       sum);
+
+	be_destroy_jit_segment(segment);
+	free(addresses);
+	free(functions);
+	free(entities);
+}
+
+/** Runs @p stage in a child process with a freshly initialized libFirm. */
+static void run_stage(void (*stage)(void))
+{
+	fflush(NULL);
+	pid_t const pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		ir_init();
+		stage();
+		ir_finish();
+		exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "benchmark stage failed\n");
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1)
+		n_functions = atoi(argv[1]);
+	if (argc > 2)
+		n_operations = atoi(argv[2]);
+
+	tier = ir_jit_tier_default;
+	run_stage(compile_and_run);
+	tier = ir_jit_tier_fast;
+	run_stage(compile_and_run);
+	return 0;
+}
+
+#else
+
+int main(void)
+{
+	return 0;
+}
+
+#endif
@@ -45,12 +45,19 @@
  */
 #define ENUMBF(type)  __extension__ type
 
+/**
+ * Hint the processor to fetch the cache line containing addr, because it is
+ * accessed soon.
+ */
+#define PREFETCH(addr) __builtin_prefetch(addr)
+
 #else
 #define LIKELY(x)   x
 #define UNLIKELY(x) x
 #define PURE
 #define UNUSED
 #define ENUMBF(type)  unsigned
+#define PREFETCH(addr) ((void)(addr))
 #endif
 
 /**
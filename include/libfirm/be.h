@@ -103,6 +103,23 @@ FIRM_API void be_set_after_transform_func(after_transform_func func);
  */
 FIRM_API void be_main(FILE *output, const char *compilation_unit_name);
 
+/**
+ * Like be_main(), but compiles the functions in @p n_jobs processes.  Once
+ * all graphs are prepared, the calling process forks @p n_jobs - 1 copies of
+ * itself.  They compile a share of the functions and send the code to the
+ * calling process, which writes all output.
+ *
+ * This is the same as be_main() where fork() is not available or the output
+ * cannot be composed from several processes: with debug information,
+ * profile instrumentation, ELF object output or the code cache.
+ *
+ * @returns 0 in the calling process and nonzero in the copies.  A copy must
+ *          terminate with _exit() right away, so it neither flushes streams
+ *          shared with the calling process nor runs its exit handlers.
+ */
+FIRM_API int be_main_jobs(FILE *output, const char *compilation_unit_name,
+                          unsigned n_jobs);
+
 /**
  * parse assembler constraint strings and returns flags (so the frontend knows
  * which operands are inputs/outputs and whether memory is required)
@@ -99,6 +99,7 @@
 #include "iroptimize.h"
 #include "irouts.h"
 #include "irprintf.h"
+#include "irprofile.h"
 #include "irprog.h"
 #include "irverify.h"
 #include "lowering.h"
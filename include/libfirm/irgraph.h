@@ -77,8 +77,8 @@
  * - n_loc           An int giving the number of local variables in this
  *                   procedure.  This is needed for ir construction.
  *
- * - value_table     This hash table (pset) is used for global value numbering
- *                   for optimizing use in iropt.c.
+ * - value_table     This open addressing hash table (ir_valuetable_t) is used
+ *                   for global value numbering for optimizing use in iropt.c.
  *
  * - visited         A int used as flag to traverse the ir_graph.
  *
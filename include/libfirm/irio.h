@@ -38,9 +38,27 @@ FIRM_API int ir_export(const char *filename);
  */
 FIRM_API void ir_export_file(FILE *output);
 
+/**
+ * Exports the whole irp to the given file in a binary form.
+ * Identifiers are stored once in a string table, nodes are referenced by
+ * dense indices and every ir graph is stored in a section of its own, which
+ * can be loaded on demand with ir_import_lazy_irg().
+ *
+ * @param filename  the name of the resulting file
+ * @return  0 if no errors occured, other values in case of errors
+ */
+FIRM_API int ir_export_binary(const char *filename);
+
+/**
+ * same as ir_export_binary but writes to a FILE*
+ * @note As with any FILE* errors are indicated by ferror(output)
+ */
+FIRM_API void ir_export_binary_file(FILE *output);
+
 /**
  * Imports the data stored in the given file.
- * Imports any type graphs and ir graphs contained in the file.
+ * Imports any type graphs and ir graphs contained in the file, which may be
+ * in textual or in binary form.
  *
  * @param filename  the name of the file
  * @returns 0 if no errors occured, other values in case of errors
@@ -52,6 +70,37 @@ FIRM_API int ir_import(const char *filename);
  */
 FIRM_API int ir_import_file(FILE *input, const char *inputname);
 
+/** A binary file opened for lazy import. */
+typedef struct ir_lazy_import ir_lazy_import;
+
+/**
+ * Opens a file written by ir_export_binary() for lazy import.
+ * The file is mapped into memory and its types, entities and the constant
+ * graph are imported immediately, while the ir graphs are only imported by
+ * ir_import_lazy_irg().
+ *
+ * @param filename  the name of the file
+ * @returns the opened file or NULL in case of errors
+ */
+FIRM_API ir_lazy_import *ir_import_lazy(const char *filename);
+
+/**
+ * Imports the ir graph of the method @p entity from a lazily imported file.
+ * Importing the same graph twice returns the graph imported first.
+ *
+ * @param import  the file opened by ir_import_lazy()
+ * @param entity  the method entity, as imported by ir_import_lazy()
+ * @returns the graph or NULL if the file contains no graph for @p entity or
+ *          the graph could not be read
+ */
+FIRM_API ir_graph *ir_import_lazy_irg(ir_lazy_import *import,
+                                      ir_entity *entity);
+
+/**
+ * Closes a lazily imported file. Graphs imported from it remain valid.
+ */
+FIRM_API void ir_import_lazy_free(ir_lazy_import *import);
+
 /** @} */
 
 #include "end.h"
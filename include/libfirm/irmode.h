@@ -99,6 +99,17 @@ FIRM_API ir_mode *new_float_mode(const char *name,
  */
 FIRM_API ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size);
 
+/**
+ * Creates a new vector mode holding @p n_lanes values of mode @p element_mode.
+ *
+ * Vector modes are data modes without arithmetic of their own: Add, Sub, Mul,
+ * And, Or and Eor apply lane-wise, Load and Store transfer all lanes at once.
+ * If a vector mode with the same element mode and lane count already exists,
+ * it is returned.
+ */
+FIRM_API ir_mode *new_vector_mode(const char *name, ir_mode *element_mode,
+                                  unsigned n_lanes);
+
 /** Returns the ident* of the mode */
 FIRM_API ident *get_mode_ident(const ir_mode *mode);
 
@@ -261,6 +272,15 @@ FIRM_API int mode_is_int(const ir_mode *mode);
 /** Returns 1 if @p mode is for references/pointers, 0 otherwise */
 FIRM_API int mode_is_reference(const ir_mode *mode);
 
+/** Returns 1 if @p mode is a vector mode, 0 otherwise */
+FIRM_API int mode_is_vector(const ir_mode *mode);
+
+/** Returns the mode of a single lane of the vector mode @p mode. */
+FIRM_API ir_mode *get_mode_vector_element(const ir_mode *mode);
+
+/** Returns the number of lanes of the vector mode @p mode. */
+FIRM_API unsigned get_mode_vector_lanes(const ir_mode *mode);
+
 /**
  * Returns 1 if @p mode is for numeric values, 0 otherwise.
  *
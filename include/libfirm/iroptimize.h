@@ -183,6 +183,33 @@ FIRM_API void optimize_load_store(ir_graph *irg);
  */
 FIRM_API void combine_memops(ir_graph *irg);
 
+/**
+ * Superword level parallelism vectorization.
+ *
+ * Replaces groups of Stores to adjacent addresses, whose values are computed
+ * by the same operations from Loads of adjacent addresses, by a single
+ * expression in a vector mode. Groups are only found among the predecessors
+ * of Sync nodes, so this should run after opt_parallelize_mem(). Nothing is
+ * done if the target has no vector registers (see ir_target_vector_size()).
+ *
+ * @param irg  the graph
+ */
+FIRM_API void opt_vectorize_slp(ir_graph *irg);
+
+/**
+ * Vectorizes counted innermost loops.
+ *
+ * Handles loops consisting of a header comparing an induction variable,
+ * which is incremented by one, with a loop invariant bound and a single body
+ * block whose Loads and Stores advance by one element per iteration. The
+ * loop is preceded by a vector loop, which is entered if runtime checks show
+ * that the accessed arrays do not overlap. The original loop executes the
+ * remaining iterations. Nothing is done if the target has no vector registers.
+ *
+ * @param irg  the graph
+ */
+FIRM_API void opt_vectorize_loops(ir_graph *irg);
+
 /**
  * New experimental alternative to optimize_load_store.
  * Based on a dataflow analysis, so load/stores are moved out of loops
@@ -404,6 +431,12 @@ typedef void (*opt_ptr)(ir_graph *irg);
  * Heuristic inliner. Calculates a benefice value for every call and inlines
  * those calls with a value higher than the threshold.
  *
+ * If profile data was read with ir_profile_read(), calls in profiled graphs
+ * are chosen by their measured execution counts instead: A growth budget is
+ * assigned to the hottest calls and only those are inlined, while calls
+ * executed rarely are never inlined. Functions marked always_inline are
+ * inlined in any case.
+ *
  * @param maxsize             Do not inline any calls if a method has more than
  *                            maxsize firm nodes.  It may reach this limit by
  *                            inlining.
@@ -414,6 +447,24 @@ typedef void (*opt_ptr)(ir_graph *irg);
 FIRM_API void inline_functions(unsigned maxsize, int inline_threshold,
                                opt_ptr after_inline_opt);
 
+/**
+ * Prepares partial inlining of functions with a cheap early exit.
+ *
+ * A function with more than @p min_size nodes whose start block ends in a
+ * test without side effects, where one branch leads to an early exit of at
+ * most @p max_guard_size nodes including the test, is split: The rest of the
+ * function is outlined into a new local function and the original one is
+ * reduced to the test, the early exit and a call of the outlined function.
+ * Only functions with direct calls are considered.
+ *
+ * Run inline_functions() afterwards to inline the remaining test into the
+ * callers.
+ *
+ * @param min_size        only split functions with more nodes than this
+ * @param max_guard_size  the maximum number of nodes of test and early exit
+ */
+FIRM_API void split_entry_guards(unsigned min_size, unsigned max_guard_size);
+
 /**
  * Combines congruent blocks into one.
  *
@@ -0,0 +1,68 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Code instrumentation and execution count profiling.
+ */
+#ifndef FIRM_IR_IRPROFILE_H
+#define FIRM_IR_IRPROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "firm_types.h"
+
+#include "begin.h"
+
+/**
+ * @ingroup irana
+ * @defgroup irprofile Execution Count Profiling
+ *
+ * A program is instrumented to count how often its control flow edges are
+ * taken. The counts written by a run of the program are read back in a later
+ * compilation and associated with the blocks of the graphs. This only works
+ * for graphs whose control flow is the same as when they were instrumented,
+ * so the profile has to be read at the same point of the optimization
+ * pipeline where the program was instrumented. The backend options
+ * "profilegenerate" and "profileuse" do this right before code generation,
+ * for inline_functions() instrumentation and reading have to happen before
+ * inlining.
+ * @{
+ */
+
+/**
+ * Instruments all irgs in the program with profile code.
+ * The final code counts how often the control flow edges outside a spanning
+ * tree of each function are taken. After the program has run the counters
+ * are written to @p filename.
+ *
+ * @return the graph of the constructor registering the counters
+ */
+FIRM_API ir_graph *ir_profile_instrument(const char *filename);
+
+/**
+ * Reads the profile information from @p filename and associates it with the
+ * blocks of all graphs.
+ *
+ * @return true if the file could be read
+ */
+FIRM_API bool ir_profile_read(const char *filename);
+
+/**
+ * Frees the profile information.
+ */
+FIRM_API void ir_profile_free(void);
+
+/**
+ * Returns the execution count of @p block in the profile, 0 if there is
+ * none.
+ */
+FIRM_API uint64_t ir_profile_get_block_execcount(const ir_node *block);
+
+/** @} */
+
+#include "end.h"
+
+#endif
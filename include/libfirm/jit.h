@@ -10,6 +10,8 @@
 #ifndef FIRM_JIT_H
 #define FIRM_JIT_H
 
+#include <stddef.h>
+
 #include "firm_types.h"
 
 #include "begin.h"
@@ -20,6 +22,11 @@
  *
  * Provides interface to generate code and resolve symbols in memory buffers.
  * This is often called just in time compilation.
+ *
+ * The backend keeps process-global state, including the function currently
+ * being encoded. Calls to be_jit_compile(), be_jit_compile_tier() and
+ * be_jit_emit_executable() must therefore be serialized, even for different
+ * segments.
  * @{
  */
 
@@ -41,7 +48,8 @@ FIRM_API ir_jit_segment_t *be_new_jit_segment(void);
 
 /**
  * Destroy jit segment \p segment. Invalidates references to functions created in
- * the segment.
+ * the segment and frees executable memory allocated by
+ * be_jit_emit_executable().
  */
 FIRM_API void be_destroy_jit_segment(ir_jit_segment_t *segment);
 
@@ -62,6 +70,24 @@ FIRM_API void const *be_jit_get_entity_addr(ir_entity const *entity);
 FIRM_API ir_jit_function_t *be_jit_compile(ir_jit_segment_t *segment,
                                            ir_graph *irg);
 
+/**
+ * Code generation tiers for be_jit_compile_tier().
+ */
+typedef enum ir_jit_tier_t {
+	ir_jit_tier_default, /**< the backend configured by the backend options */
+	ir_jit_tier_fast,    /**< favor compile time over code quality: trivial
+	                          scheduling and single pass register allocation
+	                          without copy minimization */
+} ir_jit_tier_t;
+
+/**
+ * Compile graph \p irg like be_jit_compile() using code generation tier
+ * \p tier.
+ */
+FIRM_API ir_jit_function_t *be_jit_compile_tier(ir_jit_segment_t *segment,
+                                                ir_graph *irg,
+                                                ir_jit_tier_t tier);
+
 /**
  * Return the buffer size necessary to emit \p function with be_emit_function().
  */
@@ -72,6 +98,31 @@ FIRM_API unsigned be_get_function_size(ir_jit_function_t const *function);
  */
 FIRM_API void be_emit_function(char *buffer, ir_jit_function_t *function);
 
+/**
+ * Emit \p n_functions functions into a single block of executable memory
+ * owned by \p segment.
+ *
+ * The memory is writable but not executable while the functions are emitted
+ * and executable but not writable afterwards. The functions are placed in
+ * order, aligned to 16 bytes. Before any relocation is resolved, the address
+ * of each function is stored in \p addresses and, if \p entities is not NULL,
+ * set as address of the corresponding entity, so the functions may call each
+ * other.
+ *
+ * @param segment      the segment owning the memory
+ * @param n_functions  number of functions to emit
+ * @param functions    the functions to emit
+ * @param entities     the entities of the functions or NULL
+ * @param addresses    receives the address of each function
+ * @return the start of the memory block or NULL if no executable memory could
+ *         be allocated
+ */
+FIRM_API void *be_jit_emit_executable(ir_jit_segment_t *segment,
+                                      size_t n_functions,
+                                      ir_jit_function_t *const *functions,
+                                      ir_entity *const *entities,
+                                      void **addresses);
+
 /** @} */
 
 #include "end.h"
@@ -82,6 +82,12 @@ FIRM_API int ir_target_supports_pic(void);
  */
 FIRM_API int ir_target_fast_unaligned_memaccess(void);
 
+/**
+ * Returns the size in bytes of the vector registers the target can use for
+ * values of vector modes, or 0 if vector modes are not supported.
+ */
+FIRM_API unsigned ir_target_vector_size(void);
+
 /**
  * Returns supported float arithmetic mode or NULL if mode_D and mode_F
  * are supported natively.
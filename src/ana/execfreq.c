@@ -28,7 +28,6 @@
 #include "execfreq_t.h"
 
 #include "dfs_t.h"
-#include "gaussjordan.h"
 #include "hashptr.h"
 #include "iredges_t.h"
 #include "irgraph_t.h"
@@ -39,7 +38,9 @@
 #include "irnodehashmap.h"
 #include "irouts.h"
 #include "irprog_t.h"
+#include "obst.h"
 #include "panic.h"
+#include "raw_bitset.h"
 #include "set.h"
 #include "util.h"
 #include "xmalloc.h"
@@ -55,132 +56,34 @@
 
 static hook_entry_t hook;
 
-typedef struct {
-	unsigned size;
-	double   entries[];
-} square_matrix;
-
-static square_matrix *mat_create(int n)
-{
-	square_matrix *result = xmalloc(sizeof(square_matrix) + n * n * sizeof(double));
-	result->size = n;
-	return result;
-}
-
-/*
- * Algorithm for QR decomposition taken from JAMA/C++ Linear Algebra
- * Library.
- * See http://math.nist.gov/tnt/jama_doxygen/jama_qr_h-source.html.
- * License: Public domain (U.S. government work).
- */
-static inline void setm(square_matrix *a, unsigned row, unsigned col, double val)
-{
-	a->entries[row * a->size + col] = val;
-}
-
-static inline double getm(const square_matrix *a, unsigned row, unsigned col)
+double get_block_execfreq(const ir_node *block)
 {
-	return a->entries[row * a->size + col];
+	return block->attr.block.execfreq;
 }
 
-/**
- * Use QR decomposition to find the nullspace of a (size n * n). This
- * function assumes that rank(a) = n-1.
- */
-static void nullspace(square_matrix *a, double *result)
+void set_block_execfreq(ir_node *block, double newfreq)
 {
-	// The nullspace of a is the n-th column of q, where q * r is
-	// the QR decomposition of transpose(a).
-
-	unsigned       n  = a->size;
-	square_matrix *qr = mat_create(n);
-
-	// Transpose a
-	for (unsigned x = 0; x < n; x++) {
-		for (unsigned y = 0; y < n; y++) {
-			double val = getm(a, y, x);
-			setm(qr, x, y, val);
-		}
-	}
-
-	// In-place computation of qr.
-	for (unsigned k = 0; k < n; k++) {
-		// Compute 2-norm of k-th column without under/overflow.
-		double nrm = 0;
-		for (unsigned i = k; i < n; i++) {
-			nrm = hypot(nrm, getm(qr, i, k));
-		}
-
-		if (nrm == 0.0)
-			continue;
-		// Form k-th Householder vector.
-		if (getm(qr, k, k) < 0)
-			nrm = -nrm;
-		for (unsigned i = k; i < n; i++) {
-			double val = getm(qr, i, k);
-			val /= nrm;
-			setm(qr, i, k, val);
-		}
-		double val = getm(qr, k, k);
-		val += 1.0;
-		setm(qr, k, k, val);
-
-		// Apply transformation to remaining columns.
-		for (unsigned j = k+1; j < n; j++) {
-			double s = 0.0;
-			for (unsigned i = k; i < n; i++) {
-				s += getm(qr, i, k) * getm(qr, i, j);
-			}
-			s = -s / getm(qr, k, k);
-			for (unsigned i = k; i < n; i++) {
-				double val = getm(qr, i, j);
-				val += s * getm(qr, i, k);
-				setm(qr, i, j, val);
-			}
-		}
-	}
-
-	square_matrix *q = mat_create(n);
-
-	// Computation of Q from QR.
-	for (unsigned k = n; k-- > 0; ) {
-		for (unsigned i = 0; i < n; i++) {
-			setm(q, i, k, 0.0);
-		}
-		setm(q, k, k, 1.0);
-		for (unsigned j = k; j < n; j++) {
-			if (getm(qr, k, k) == 0)
-				continue;
-			double s = 0.0;
-			for (unsigned i = k; i < n; i++) {
-				s += getm(qr, i, k) * getm(q, i, j);
-			}
-			s = -s / getm(qr, k, k);
-			for (unsigned i = k; i < n; i++) {
-				double val = getm(q, i, j);
-				val += s * getm(qr, i, k);
-				setm(q, i, j, val);
-			}
-		}
-	}
-
-	// Fill nullspace with required information
-	for (unsigned i = 0; i < n; i++) {
-		result[i] = getm(q, i, n-1);
-	}
-	free(qr);
-	free(q);
+	assert(!isinf(newfreq) && newfreq >= 0);
+	block->attr.block.execfreq = newfreq;
 }
 
-double get_block_execfreq(const ir_node *block)
+void set_block_cfgpred_execfreqs(ir_node *block, double const *freqs)
 {
-	return block->attr.block.execfreq;
+	unsigned const n_preds = get_Block_n_cfgpreds(block);
+	double   *const copy   = OALLOCN(get_irg_obstack(get_irn_irg(block)), double, n_preds);
+	MEMCPY(copy, freqs, n_preds);
+	block->attr.block.cfgpred_execfreqs   = copy;
+	block->attr.block.n_cfgpred_execfreqs = n_preds;
 }
 
-void set_block_execfreq(ir_node *block, double newfreq)
+double get_block_cfgpred_execfreq(const ir_node *block, int pos)
 {
-	assert(!isinf(newfreq) && newfreq >= 0);
-	block->attr.block.execfreq = newfreq;
+	/* the data is stale if the number of predecessors changed */
+	block_attr const *const attr = &block->attr.block;
+	if (attr->cfgpred_execfreqs == NULL
+	 || attr->n_cfgpred_execfreqs != (unsigned)get_Block_n_cfgpreds(block))
+		return -1.0;
+	return attr->cfgpred_execfreqs[pos];
 }
 
 static void exec_freq_node_info(void *ctx, FILE *f, const ir_node *irn)
@@ -359,35 +262,115 @@ static void block_walk_no_keeps(ir_node *block)
 }
 
 /**
- * Computes (matrix row r_acc) += (matrix row r_x) * weight.
+ * A term of a linear expression: fac * (frequency of block var).
  */
-static void add_weighted(square_matrix *mat, unsigned r_acc, unsigned r_x,
-                         double weight)
+typedef struct freq_term_t {
+	unsigned var; /**< DFS index of the unknown block */
+	double   fac;
+} freq_term_t;
+
+/**
+ * Frequency of a block as a linear combination of the frequencies of blocks
+ * which are still unknown when the block is visited.
+ */
+typedef struct freq_expr_t {
+	unsigned    n_terms;
+	freq_term_t terms[];
+} freq_expr_t;
+
+/**
+ * Solver for the execution frequencies.  The blocks are visited in reverse
+ * postorder, so the frequency of a block is a combination of the (already
+ * known) expressions of its forward predecessors.  The sources of backedges
+ * are unknowns.  As soon as such a source is visited, its own equation is
+ * solved for it and the solution is substituted into all later expressions.
+ * This is Gaussian elimination in reverse postorder: For reducible control
+ * flow an expression only refers to the backedges of the surrounding loops,
+ * so the whole computation is roughly linear in the number of blocks.
+ */
+typedef struct freq_solver_t {
+	struct obstack obst;
+	freq_expr_t  **exprs;    /**< expression of each block, NULL if the
+	                              block was not visited yet */
+	double        *acc;      /**< accumulator, indexed by variable */
+	unsigned      *used;     /**< raw bitset of the variables in acc */
+	unsigned      *touched;  /**< ARR_F of the variables in acc */
+	unsigned      *pending;  /**< ARR_F of solved variables in acc */
+} freq_solver_t;
+
+static void acc_add(freq_solver_t *const s, unsigned const var,
+                    double const fac)
 {
-	for (unsigned c = 0; c < mat->size; c++) {
-		double val = getm(mat, r_acc, c);
-		val += getm(mat, r_x, c) * weight;
-		setm(mat, r_acc, c, val);
+	if (!rbitset_is_set(s->used, var)) {
+		rbitset_set(s->used, var);
+		ARR_APP1(unsigned, s->touched, var);
+		s->acc[var] = 0.0;
 	}
+	s->acc[var] += fac;
+	/* a solved variable must be replaced by its solution */
+	if (s->exprs[var] != NULL)
+		ARR_APP1(unsigned, s->pending, var);
+}
+
+static void acc_add_expr(freq_solver_t *const s, freq_expr_t const *const expr,
+                         double const fac)
+{
+	for (unsigned i = 0; i < expr->n_terms; ++i)
+		acc_add(s, expr->terms[i].var, expr->terms[i].fac * fac);
 }
 
 /**
- * Computes the row-th entry of mat . vec.
- *
- * The elements in vec must be finite unless mat has a 0 at the
- * corresponding position.
+ * Replaces all solved variables in the accumulator by their solutions.
+ * Solutions only refer to variables, which were unsolved at the time, so
+ * this terminates.
  */
-static double mat_dot_vec_entry(square_matrix *mat, double *vec, int row)
+static void acc_substitute(freq_solver_t *const s)
 {
-	double acc = 0.0;
-	for (unsigned i = 0; i < mat->size; i++) {
-		double val = getm(mat, row, i);
-		if (val == 0)
+	while (ARR_LEN(s->pending) > 0) {
+		unsigned const var = s->pending[ARR_LEN(s->pending) - 1];
+		ARR_SHRINKLEN(s->pending, ARR_LEN(s->pending) - 1);
+		double const fac = s->acc[var];
+		if (fac == 0.0)
 			continue;
-		assert(isfinite(vec[i]));
-		acc += val * vec[i];
+		s->acc[var] = 0.0;
+		acc_add_expr(s, s->exprs[var], fac);
 	}
-	return acc;
+}
+
+/**
+ * Moves the accumulator into a new expression scaled by @p scale and clears
+ * the accumulator.
+ */
+static freq_expr_t *acc_finish(freq_solver_t *const s, double const scale)
+{
+	size_t const n_touched = ARR_LEN(s->touched);
+	unsigned     n_terms   = 0;
+	for (size_t i = 0; i < n_touched; ++i) {
+		if (s->acc[s->touched[i]] != 0.0)
+			++n_terms;
+	}
+
+	freq_expr_t *const expr = OALLOCF(&s->obst, freq_expr_t, terms, n_terms);
+	expr->n_terms = n_terms;
+	unsigned n = 0;
+	for (size_t i = 0; i < n_touched; ++i) {
+		unsigned const var = s->touched[i];
+		double   const fac = s->acc[var];
+		rbitset_clear(s->used, var);
+		if (fac != 0.0)
+			expr->terms[n++] = (freq_term_t) { var, fac * scale };
+	}
+	ARR_SHRINKLEN(s->touched, 0);
+	return expr;
+}
+
+static double eval_expr(freq_expr_t const *const expr,
+                        double const *const values)
+{
+	double res = 0.0;
+	for (unsigned i = 0; i < expr->n_terms; ++i)
+		res += expr->terms[i].fac * values[expr->terms[i].var];
+	return res;
 }
 
 /**
@@ -446,31 +429,13 @@ void ir_estimate_execfreq(ir_graph *irg)
 		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE);
 
 	/* compute a DFS.
-	 * using a toposort on the CFG (without back edges) will propagate
-	 * the values better for the gauss/seidel iteration.
-	 * => they can "flow" from start to end. */
+	 * using a toposort on the CFG (without back edges) lets the frequencies
+	 * "flow" from start to end, so only the sources of back edges remain
+	 * unknown. */
 	dfs_t *const dfs = dfs_new(irg);
 
 	unsigned       size   = dfs_get_n_nodes(dfs);
 
-	/* It is undesirable to allocate more than 2GB for the matrix */
-	if (size*size*sizeof(double) > 1 << 30) {
-		if (!fallback_loop_weight(dfs, loop_weight)) {
-			fallback_all_ones(dfs);
-		}
-		dfs_free(dfs);
-		return;
-	}
-
-
-	square_matrix *in_fac = mat_create(size);
-	for (unsigned r = 0; r < size; r++) {
-		for (unsigned c = 0; c < size; c++) {
-			setm(in_fac, r, c, 0.0);
-		}
-	}
-
-
 	ir_node *const start_block = get_irg_start_block(irg);
 	ir_node *const end_block   = get_irg_end_block(irg);
 	const int      end_idx     = size - dfs_get_post_num(dfs, end_block) - 1;
@@ -495,15 +460,24 @@ void ir_estimate_execfreq(ir_graph *irg)
 		}
 	}
 
+	freq_solver_t s;
+	obstack_init(&s.obst);
+	s.exprs   = XMALLOCNZ(freq_expr_t*, size);
+	s.acc     = XMALLOCN(double, size);
+	s.used    = rbitset_malloc(size);
+	s.touched = NEW_ARR_F(unsigned, 0);
+	s.pending = NEW_ARR_F(unsigned, 0);
+	/* is_var[i] is set if block i is an unknown of the equation system */
+	unsigned *const is_var = rbitset_malloc(size);
+	rbitset_set(is_var, end_idx);
+
+	/* The frequency of the end block is the unknown everything is
+	 * normalized to.  The equation of the end block itself is implied by the
+	 * others, so it is never built. */
 	double const inv_loop_weight = 1.0 / loop_weight;
-	/* lgs_to_mat[i] is the index of the block represented by the
-	 * i-th row/column in the LGS matrix. */
-	int *lgs_to_mat = NEW_ARR_F(int, 0);
-
+	bool         valid_freq      = true;
 	for (unsigned idx = 0; idx < size; ++idx) {
 		ir_node const *const bb = dfs_get_post_num_node(dfs, size-idx-1);
-		/* The end block is handled properly later, when all the kept blocks
-		 * are done. */
 		if (bb == end_block)
 			continue;
 
@@ -514,140 +488,68 @@ void ir_estimate_execfreq(ir_graph *irg)
 			bool     const pred_visited   = pred_idx < idx;
 
 			if (pred_visited) {
-				add_weighted(in_fac, idx, pred_idx, cf_probability);
+				acc_add_expr(&s, s.exprs[pred_idx], cf_probability);
 			} else {
-				ARR_APP1(int, lgs_to_mat, pred_idx);
-				setm(in_fac, idx, pred_idx, cf_probability);
+				rbitset_set(is_var, pred_idx);
+				acc_add(&s, pred_idx, cf_probability);
 			}
 		}
 
 		if (bb == start_block)
-			setm(in_fac, idx, end_idx, 1.0);
-	}
-
-	/* handle end block */
-	ARR_APP1(int, lgs_to_mat, end_idx);
-	for (int i = get_Block_n_cfgpreds(end_block) - 1; i >= 0; --i) {
-		ir_node *const pred           = get_Block_cfgpred_block(end_block, i);
-		int      const pred_idx       = size - dfs_get_post_num(dfs, pred) - 1;
-		double   const cf_probability = get_cf_probability(end_block, i, inv_loop_weight);
-		add_weighted(in_fac, end_idx, pred_idx, cf_probability);
-	}
+			acc_add(&s, end_idx, 1.0);
 
-	/* add artifical edges from "kept blocks without a path to end"
-	 * to end */
-	for (unsigned k = n_keepalives; k-- > 0; ) {
-		ir_node *keep = get_End_keepalive(end, k);
-		if (!is_Block(keep) || has_path_to_end(keep))
-			continue;
+		acc_substitute(&s);
 
-		double sum      = get_sum_succ_factors(keep, inv_loop_weight);
-		double fac      = KEEP_FAC/sum;
-		int    keep_idx = size - dfs_get_post_num(dfs, keep)-1;
-		add_weighted(in_fac, end_idx, keep_idx, fac);
-	}
-
-	/* mat_to_lgs[i] is the index of node i in the LGS matrix, or
-	 * -1 if the node can be solved by simple substitution. */
-	int *mat_to_lgs = NEW_ARR_F(int, size);
-	for (unsigned x = 0; x < size; x++) {
-		mat_to_lgs[x] = -1;
-	}
-	for (unsigned b = 0; b < ARR_LEN(lgs_to_mat); b++) {
-		mat_to_lgs[lgs_to_mat[b]] = b;
-	}
-
-#ifdef DEBUG
-	/* Check that all values in in_fac are only given in terms of nodes with backedges */
-	for (int y = 0; y < size; y++) {
-		if (mat_to_lgs[y] == -1)
-			continue;
-		for (int x = 0; x < size; x++) {
-			if (getm(in_fac, x, y) != 0)
-				panic("expect entry at (%d, %d) to be 0", x, y);
-		}
-	}
-#endif
-
-	/* Build the LGS matrix with only the indices in lgs_to_mat. */
-	unsigned lgs_size = ARR_LEN(lgs_to_mat);
-	square_matrix *lgs_matrix = mat_create(lgs_size);
-	double *lgs_x = NEW_ARR_F(double, size);
-
-	for (unsigned x = 0; x < lgs_size; x++) {
-		int bx = lgs_to_mat[x];
-		for (unsigned y = 0; y < lgs_size; y++) {
-			int by = lgs_to_mat[y];
-			double val = getm(in_fac, bx, by);
-			setm(lgs_matrix, x, y, val);
+		double scale = 1.0;
+		if (rbitset_is_set(is_var, idx)) {
+			/* Solve the equation for this block: x = f*x + rest */
+			double const self = rbitset_is_set(s.used, idx) ? s.acc[idx] : 0.0;
+			if (!(1.0 - self > EPSILON)) {
+				valid_freq = false;
+				break;
+			}
+			if (rbitset_is_set(s.used, idx))
+				s.acc[idx] = 0.0;
+			scale = 1.0 / (1.0 - self);
 		}
-		/* RHS of the equation */
-		double val = getm(lgs_matrix, x, x);
-		val -= 1.0;
-		setm(lgs_matrix, x, x, val);
+		s.exprs[idx] = acc_finish(&s, scale);
 	}
 
-	if (lgs_size == 1) {
-		lgs_x[0] = 1.0;
-	} else {
-		nullspace(lgs_matrix, lgs_x);
-	}
-
-	/* compute the normalization factor.
-	 * 1.0 / exec freq of end block.
-	 */
-	double  end_freq   = lgs_x[mat_to_lgs[end_idx]];
-	double  norm       = end_freq != 0.0 ? 1.0 / end_freq : 1.0;
-	double *freqs      = NEW_ARR_F(double, size);
-	bool    valid_freq = true;
-
-	/* First get the frequency for the nodes which were
-	 * explicitly computed. */
-	for (unsigned idx = size; idx-- > 0; ) {
-		ir_node *const bb = dfs_get_post_num_node(dfs, size - idx - 1);
+	if (valid_freq) {
+		/* A solution only refers to unknowns solved later, so evaluate the
+		 * unknowns backwards. */
+		double *const values = XMALLOCN(double, size);
+		values[end_idx] = 1.0;
+		for (unsigned idx = size; idx-- > 0; ) {
+			if (rbitset_is_set(is_var, idx) && (int)idx != end_idx)
+				values[idx] = eval_expr(s.exprs[idx], values);
+		}
 
-		if (mat_to_lgs[idx] != -1) {
-			double freq = lgs_x[mat_to_lgs[idx]] * norm;
+		for (unsigned idx = size; idx-- > 0; ) {
+			ir_node *const bb   = dfs_get_post_num_node(dfs, size - idx - 1);
+			double   const freq = (int)idx == end_idx ? 1.0
+			                    : eval_expr(s.exprs[idx], values);
 			/* Check for inf, nan and negative values. */
 			if (isinf(freq) || !(freq >= 0)) {
 				valid_freq = false;
 				break;
 			}
 			set_block_execfreq(bb, freq);
-			freqs[idx] = freq;
-		} else {
-			freqs[idx] = nan("");
 		}
+		free(values);
 	}
 
-	if (valid_freq) {
-		/* Now get the rest of the frequencies using the factors in in_fac */
-		for (unsigned idx = size; idx-- > 0; ) {
-			ir_node *const bb = dfs_get_post_num_node(dfs, size - idx - 1);
-
-			if (mat_to_lgs[idx] == -1) {
-				double freq = mat_dot_vec_entry(in_fac, freqs, idx);
-				/* Check for inf, nan and negative values. */
-				if (isinf(freq) || freq < 0) {
-					valid_freq = false;
-					break;
-				}
-				set_block_execfreq(bb, freq);
-			}
-		}
-	}
-
-	DEL_ARR_F(freqs);
-
 	/* Fallbacks in case some frequencies were invalid */
 	if (!valid_freq && !fallback_loop_weight(dfs, loop_weight)) {
 		fallback_all_ones(dfs);
 	}
 
 	free_properties_and_dfs(irg, dfs);
-	DEL_ARR_F(lgs_to_mat);
-	DEL_ARR_F(mat_to_lgs);
-	free(in_fac);
-	free(lgs_matrix);
-	DEL_ARR_F(lgs_x);
+	obstack_free(&s.obst, NULL);
+	free(s.exprs);
+	free(s.acc);
+	free(s.used);
+	DEL_ARR_F(s.touched);
+	DEL_ARR_F(s.pending);
+	free(is_var);
 }
@@ -20,6 +20,19 @@ void exit_execfreq(void);
 
 void set_block_execfreq(ir_node *block, double freq);
 
+/**
+ * Sets the execution frequencies of the control flow edges entering
+ * @p block, one entry per cfg predecessor.
+ */
+void set_block_cfgpred_execfreqs(ir_node *block, double const *freqs);
+
+/**
+ * Returns the execution frequency of the control flow edge entering @p block
+ * at predecessor @p pos or a negative value if it is unknown. Edge
+ * frequencies are only available from profile data.
+ */
+double get_block_cfgpred_execfreq(const ir_node *block, int pos);
+
 typedef struct ir_execfreq_int_factors {
 	double min_non_zero;
 	double m;
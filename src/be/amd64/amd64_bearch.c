@@ -16,6 +16,7 @@
 #include "amd64_optimize.h"
 #include "amd64_transform.h"
 #include "amd64_varargs.h"
+#include "beelf.h"
 #include "beflags.h"
 #include "beirg.h"
 #include "bemodule.h"
@@ -600,7 +601,7 @@ int amd64_get_sp_change(ir_node *const node)
 /**
  * Called immediately before emit phase.
  */
-static void amd64_finish_and_emit(ir_graph *irg)
+static void amd64_before_emit(ir_graph *irg)
 {
 	amd64_irg_data_t const *const irg_data = amd64_get_irg_data(irg);
 	bool                    const omit_fp  = irg_data->omit_fp;
@@ -633,11 +634,6 @@ static void amd64_finish_and_emit(ir_graph *irg)
 	amd64_simulate_graph_x87(irg);
 
 	amd64_peephole_optimization(irg);
-
-	/* emit code */
-	be_timer_push(T_EMIT);
-	amd64_emit_function(irg);
-	be_timer_pop(T_EMIT);
 }
 
 static void amd64_finish(void)
@@ -652,39 +648,78 @@ static const regalloc_if_t amd64_regalloc_if = {
 	.new_reload  = amd64_new_reload,
 };
 
+static bool lower_for_emit(ir_graph *const irg, const unsigned *const sp_is_non_ssa,
+                           bool const jit)
+{
+	if (!be_step_first(irg))
+		return false;
+
+	struct obstack   *obst     = be_get_be_obst(irg);
+	amd64_irg_data_t *irg_data = OALLOCZ(obst, amd64_irg_data_t);
+	irg_data->jit = jit;
+	be_birg_from_irg(irg)->isa_link = irg_data;
+
+	be_birg_from_irg(irg)->non_ssa_regs = sp_is_non_ssa;
+	amd64_select_instructions(irg);
+
+	be_step_schedule(irg);
+
+	be_timer_push(T_RA_PREPARATION);
+	be_sched_fix_flags(irg, &amd64_reg_classes[CLASS_amd64_flags], NULL,
+	                   NULL, NULL);
+	be_timer_pop(T_RA_PREPARATION);
+
+	be_step_regalloc(irg, &amd64_regalloc_if);
+
+	amd64_before_emit(irg);
+	return true;
+}
+
 static void amd64_generate_code(FILE *output, const char *cup_name)
 {
 	amd64_constants = pmap_create();
+	if (be_options.elf_object)
+		amd64_elf_begin(output);
 	be_begin(output, cup_name);
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AMD64_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_RSP);
 
 	foreach_irp_irg(i, irg) {
-		if (!be_step_first(irg))
+		if (!lower_for_emit(irg, sp_is_non_ssa, false))
 			continue;
 
-		struct obstack *obst = be_get_be_obst(irg);
-		be_birg_from_irg(irg)->isa_link = OALLOCZ(obst, amd64_irg_data_t);
-
-		be_birg_from_irg(irg)->non_ssa_regs = sp_is_non_ssa;
-		amd64_select_instructions(irg);
+		be_timer_push(T_EMIT);
+		if (be_elf_enabled()) {
+			amd64_emit_elf_function(irg);
+		} else {
+			amd64_emit_function(irg);
+		}
+		be_timer_pop(T_EMIT);
 
-		be_step_schedule(irg);
+		be_step_last(irg);
+	}
 
-		be_timer_push(T_RA_PREPARATION);
-		be_sched_fix_flags(irg, &amd64_reg_classes[CLASS_amd64_flags], NULL,
-		                   NULL, NULL);
-		be_timer_pop(T_RA_PREPARATION);
+	be_finish();
+	pmap_destroy(amd64_constants);
+}
 
-		be_step_regalloc(irg, &amd64_regalloc_if);
+static ir_jit_function_t *amd64_jit_compile(ir_jit_segment_t *const segment,
+                                            ir_graph *const irg)
+{
+	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AMD64_REGISTERS);
+	rbitset_set(sp_is_non_ssa, REG_RSP);
 
-		amd64_finish_and_emit(irg);
+	amd64_constants = pmap_create();
+	ir_jit_function_t *res = NULL;
+	if (lower_for_emit(irg, sp_is_non_ssa, true)) {
+		be_timer_push(T_EMIT);
+		res = amd64_emit_jit(segment, irg);
+		be_timer_pop(T_EMIT);
 
 		be_step_last(irg);
 	}
-
-	be_finish();
 	pmap_destroy(amd64_constants);
+	return res;
 }
 
 static const ir_settings_arch_dep_t amd64_arch_dep = {
@@ -780,6 +815,7 @@ static void amd64_init(void)
 	ir_target.experimental = "the amd64 backend is experimental and unfinished (consider the ia32 backend)";
 	ir_target.fast_unaligned_memaccess = true;
 	ir_target.float_int_overflow       = ir_overflow_indefinite;
+	ir_target.vector_size              = 16;
 }
 
 static unsigned amd64_get_op_estimated_cost(const ir_node *node)
@@ -824,6 +860,8 @@ arch_isa_if_t const amd64_isa_if = {
 	.init                  = amd64_init,
 	.finish                = amd64_finish,
 	.generate_code         = amd64_generate_code,
+	.jit_compile           = amd64_jit_compile,
+	.emit_function         = amd64_emit_jit_function,
 	.lower_for_target      = amd64_lower_for_target,
 	.additional_reg_names  = amd64_additional_reg_names,
 	.handle_intrinsics     = amd64_handle_intrinsics,
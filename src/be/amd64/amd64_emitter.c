@@ -22,6 +22,7 @@
 #include "beirg.h"
 #include "benode.h"
 #include "besched.h"
+#include "execfreq_t.h"
 #include "gen_amd64_emitter.h"
 #include "gen_amd64_regalloc_if.h"
 #include "iredges_t.h"
@@ -72,6 +73,12 @@ static void amd64_emit_xmm_size_suffix(x86_insn_size_t const size)
 	be_emit_char(get_xmm_size_suffix(size));
 }
 
+/** Emits the lane size suffix of a packed integer SSE instruction. */
+static void amd64_emit_packed_int_size_suffix(x86_insn_size_t const size)
+{
+	be_emit_char(size == X86_SIZE_32 ? 'd' : get_gp_size_suffix(size));
+}
+
 static char get_x87_size_suffix(x86_insn_size_t const size)
 {
 	switch (size) {
@@ -225,8 +232,10 @@ static void amd64_emit_immediate64(const amd64_imm64_t *const imm)
 		return;
 	}
 	x86_emit_relocation_no_offset(imm->kind, imm->entity);
+	if (imm->offset > 0)
+		be_emit_char('+');
 	if (imm->offset != 0)
-		be_emit_irprintf("%+" PRId64, imm->offset);
+		be_emit_int(imm->offset);
 }
 
 static void amd64_emit_am(const ir_node *const node, bool indirect_star)
@@ -328,7 +337,9 @@ static void emit_shiftop(const ir_node *const node)
 
 	switch (attr->base.op_mode) {
 	case AMD64_OP_SHIFT_IMM: {
-		be_emit_irprintf("$%u, ", attr->immediate);
+		be_emit_char('$');
+		be_emit_uint(attr->immediate);
+		be_emit_cstring(", ");
 		const arch_register_t *reg = arch_get_irn_register_in(node, 0);
 		emit_register_mode(reg, attr->base.size);
 		return;
@@ -493,6 +504,9 @@ emit_R:
 				if (*fmt == 'X') {
 					++fmt;
 					amd64_emit_xmm_size_suffix(attr->size);
+				} else if (*fmt == 'P') {
+					++fmt;
+					amd64_emit_packed_int_size_suffix(attr->size);
 				} else {
 					amd64_emit_insn_size_suffix(attr->size);
 				}
@@ -638,8 +652,8 @@ static void emit_amd64_jmp_switch(const ir_node *node)
 	be_emit_jump_table(node, &attr->swtch, entry_mode, emit_jumptable_target);
 }
 
-static x86_condition_code_t determine_final_cc(ir_node const *const flags,
-                                               x86_condition_code_t cc)
+x86_condition_code_t amd64_determine_final_cc(ir_node const *const flags,
+                                              x86_condition_code_t cc)
 {
 	if (is_amd64_fucomi(flags)) {
 		amd64_x87_attr_t const *const attr = get_amd64_x87_attr_const(flags);
@@ -656,7 +670,7 @@ static void emit_amd64_jcc(const ir_node *irn)
 {
 	const ir_node         *flags = get_irn_n(irn, n_amd64_jcc_flags);
 	const amd64_cc_attr_t *attr  = get_amd64_cc_attr_const(irn);
-	x86_condition_code_t   cc    = determine_final_cc(flags, attr->cc);
+	x86_condition_code_t   cc    = amd64_determine_final_cc(flags, attr->cc);
 
 	be_cond_branch_projs_t projs = be_get_cond_branch_projs(irn);
 
@@ -821,12 +835,38 @@ static void amd64_register_emitters(void)
 	be_set_emitter(op_be_Perm,          emit_be_Perm);
 }
 
+bool amd64_should_align_block(ir_node const *const block)
+{
+	/* only align blocks executed more often than the function itself */
+	if (get_block_execfreq(block) <= 1.0)
+		return false;
+
+	ir_node const *const prev      = be_emit_get_prev_block(block);
+	double               prev_freq = 0; /**< execfreq of the fallthrough */
+	double               jmp_freq  = 0; /**< execfreq of all jumps */
+	for (int i = 0, n_cfgpreds = get_Block_n_cfgpreds(block); i < n_cfgpreds; ++i) {
+		ir_node const *const pred = get_Block_cfgpred_block(block, i);
+		if (pred == NULL)
+			continue;
+		double freq = get_block_cfgpred_execfreq(block, i);
+		if (freq < 0)
+			freq = get_block_execfreq(pred);
+		if (pred == prev)
+			prev_freq += freq;
+		else
+			jmp_freq += freq;
+	}
+	return jmp_freq > 2 * prev_freq;
+}
+
 /**
  * Walks over the nodes in a block connected by scheduling edges
  * and emits code for each node.
  */
 static void amd64_gen_block(ir_node *block)
 {
+	if (amd64_should_align_block(block))
+		amd64_emitf(NULL, ".p2align 4,,10");
 	be_gas_begin_block(block);
 
 	if (omit_fp) {
@@ -867,6 +907,7 @@ void amd64_emit_function(ir_graph *irg)
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
 
 	be_emit_init_cf_links(blk_sched);
+	be_gas_split_cold_blocks(blk_sched);
 
 	amd64_irg_data_t const *const irg_data = amd64_get_irg_data(irg);
 	omit_fp = irg_data->omit_fp;
@@ -10,6 +10,8 @@
 #ifndef FIRM_BE_AMD64_AMD64_EMITTER_H
 #define FIRM_BE_AMD64_AMD64_EMITTER_H
 
+#include "../ia32/x86_node.h"
+#include "amd64_encode.h"
 #include "firm_types.h"
 
 /**
@@ -28,4 +30,18 @@ void amd64_emitf(ir_node const *node, char const *fmt, ...);
 
 void amd64_emit_function(ir_graph *irg);
 
+/**
+ * Returns the condition code to test for a jcc or setcc whose flags are
+ * produced by @p flags.
+ */
+x86_condition_code_t amd64_determine_final_cc(ir_node const *flags,
+                                              x86_condition_code_t cc);
+
+/**
+ * Test whether a block should be aligned. This is the case for blocks in
+ * loops, which are mostly entered by jumps (typically loop headers), so the
+ * alignment nops before the label are rarely executed.
+ */
+bool amd64_should_align_block(ir_node const *block);
+
 #endif
@@ -0,0 +1,1430 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       amd64 binary encoding/emission
+ */
+#include "amd64_encode.h"
+
+#include "amd64_bearch_t.h"
+#include "amd64_emitter.h"
+#include "amd64_new_nodes.h"
+#include "amd64_nodes_attr.h"
+#include "array.h"
+#include "beblocksched.h"
+#include "beelf.h"
+#include "beemithlp.h"
+#include "begnuas.h"
+#include "bejit.h"
+#include "benode.h"
+#include "besched.h"
+#include "gen_amd64_emitter.h"
+#include "gen_amd64_regalloc_if.h"
+#include "irnodehashmap.h"
+#include "panic.h"
+#include "xmalloc.h"
+#include <string.h>
+
+/** ELF relocation types of x86_64. */
+enum {
+	EM_X86_64      = 62,
+	R_X86_64_64    = 1,
+	R_X86_64_PC32  = 2,
+	R_X86_64_PLT32 = 4,
+	R_X86_64_32    = 10,
+	R_X86_64_32S   = 11,
+};
+
+static ir_nodehashmap_t block_fragmentnum;
+static bool             jit_literals; /**< reach entities through literals */
+static ir_node const  **jit_switches; /**< ARR_F, tables behind the code */
+static unsigned         first_table_fragment;
+
+/** Bits of the REX prefix. */
+enum Rex {
+	REX   = 0x40, /**< REX prefix without any bits set */
+	REX_W = 0x08, /**< 64bit operand size */
+	REX_R = 0x04, /**< extension of the ModR/M reg field */
+	REX_X = 0x02, /**< extension of the SIB index field */
+	REX_B = 0x01, /**< extension of the ModR/M r/m or SIB base field */
+};
+
+/** The mod encoding of the ModR/M */
+enum Mod {
+	MOD_IND          = 0x00, /**< [reg1] */
+	MOD_IND_BYTE_OFS = 0x40, /**< [reg1 + byte ofs] */
+	MOD_IND_WORD_OFS = 0x80, /**< [reg1 + word ofs] */
+	MOD_REG          = 0xC0  /**< reg1 */
+};
+
+enum {
+	ENC_SIB    = 0x04, /**< r/m field value selecting a SIB byte */
+	ENC_DISP32 = 0x05, /**< r/m field value selecting a bare displacement */
+};
+
+/** Prefixes and operand properties of an instruction. */
+typedef enum enc_flags_t {
+	ENC_NONE     = 0,
+	ENC_W        = 1U << 0, /**< REX.W: 64bit operation */
+	ENC_OPSIZE   = 1U << 1, /**< 0x66: 16bit operation */
+	ENC_BYTE_RM  = 1U << 2, /**< the r/m field names an 8bit register */
+	ENC_BYTE_REG = 1U << 3, /**< the reg field names an 8bit register */
+	ENC_P66      = 1U << 4, /**< mandatory 0x66 prefix */
+	ENC_PF2      = 1U << 5, /**< mandatory 0xF2 prefix */
+	ENC_PF3      = 1U << 6, /**< mandatory 0xF3 prefix */
+	ENC_LOCK     = 1U << 7, /**< lock prefix */
+} enc_flags_t;
+ENUM_BITSET(enc_flags_t)
+
+static enc_flags_t size_flags(x86_insn_size_t const size)
+{
+	switch (size) {
+	case X86_SIZE_8:  return ENC_BYTE_RM | ENC_BYTE_REG;
+	case X86_SIZE_16: return ENC_OPSIZE;
+	case X86_SIZE_32: return ENC_NONE;
+	case X86_SIZE_64: return ENC_W;
+	case X86_SIZE_80:
+	case X86_SIZE_128:
+		break;
+	}
+	panic("invalid insn size");
+}
+
+static enc_flags_t xmm_prefix_flags(amd64_xmm_prefix_t const prefix,
+                                    x86_insn_size_t const size)
+{
+	switch (prefix) {
+	case AMD64_XMM_NONE:   return ENC_NONE;
+	case AMD64_XMM_66:     return ENC_P66;
+	case AMD64_XMM_F2:     return ENC_PF2;
+	case AMD64_XMM_F3:     return ENC_PF3;
+	case AMD64_XMM_SCALAR: return size == X86_SIZE_64 ? ENC_PF2 : ENC_PF3;
+	case AMD64_XMM_PACKED: return size == X86_SIZE_64 ? ENC_P66 : ENC_NONE;
+	}
+	panic("invalid xmm prefix");
+}
+
+static unsigned in_enc(ir_node const *const node, int const pos)
+{
+	return arch_get_irn_register_in(node, pos)->encoding;
+}
+
+static unsigned out_enc(ir_node const *const node, unsigned const pos)
+{
+	return arch_get_irn_register_out(node, pos)->encoding;
+}
+
+/**
+ * Returns whether the 8bit register @p enc is only accessible with a REX
+ * prefix (spl, bpl, sil, dil instead of ah, ch, dh, bh).
+ */
+static bool needs_rex_byte(unsigned const enc)
+{
+	return 4 <= enc && enc <= 7;
+}
+
+static bool is_8bit_imm(int32_t const val)
+{
+	return -128 <= val && val < 128;
+}
+
+static void enc_prefixes(enc_flags_t const flags,
+                         x86_segment_selector_t const segment, uint8_t rex)
+{
+	if (flags & ENC_LOCK)
+		be_emit8(0xF0);
+	switch (segment) {
+	case X86_SEGMENT_FS: be_emit8(0x64); break;
+	case X86_SEGMENT_GS: be_emit8(0x65); break;
+	default:                             break;
+	}
+	if (flags & (ENC_OPSIZE | ENC_P66))
+		be_emit8(0x66);
+	if (flags & ENC_PF2)
+		be_emit8(0xF2);
+	if (flags & ENC_PF3)
+		be_emit8(0xF3);
+	if (flags & ENC_W)
+		rex |= REX_W;
+	if (rex != 0)
+		be_emit8(REX | rex);
+}
+
+/** Emits an opcode of up to three bytes, most significant byte first. */
+static void enc_opcode(unsigned const opcode)
+{
+	if (opcode > 0xFFFF)
+		be_emit8(opcode >> 16);
+	if (opcode > 0xFF)
+		be_emit8(opcode >> 8);
+	be_emit8(opcode);
+}
+
+/** Checks whether @p entity is a constant created by the backend. */
+static bool is_lconst(ir_entity const *const entity)
+{
+	if (get_entity_visibility(entity) != ir_visibility_private
+	 || !(get_entity_linkage(entity) & IR_LINKAGE_CONSTANT))
+		return false;
+	ir_initializer_t const *const init = get_entity_initializer(entity);
+	return init != NULL && get_initializer_kind(init) == IR_INITIALIZER_TARVAL;
+}
+
+/**
+ * Returns the fragment number of the jump table @p entity in JIT code or -1
+ * if @p entity is no such table.
+ */
+static int get_jump_table_fragment(ir_entity const *const entity)
+{
+	for (size_t i = 0, n = ARR_LEN(jit_switches); i < n; ++i) {
+		amd64_switch_jmp_attr_t const *const attr
+			= get_amd64_switch_jmp_attr_const(jit_switches[i]);
+		if (attr->swtch.table_entity == entity)
+			return first_table_fragment + i;
+	}
+	return -1;
+}
+
+static void enc_relocation(x86_imm32_t const *const imm)
+{
+	ir_entity *const entity = imm->entity;
+	if (entity == NULL) {
+		be_emit32(imm->offset);
+		return;
+	}
+	if (jit_literals) {
+		int const table_fragment = get_jump_table_fragment(entity);
+		if (table_fragment >= 0) {
+			assert(imm->kind == X86_IMM_PCREL);
+			be_emit_reloc_fragment(4, X86_IMM_PCREL, table_fragment,
+			                       imm->offset);
+			return;
+		}
+		/* JIT code may be far away from everything else, so it reaches
+		 * entities through literals behind the function. */
+		if (imm->kind == X86_IMM_GOTPCREL) {
+			be_emit_reloc_literal(4, X86_IMM_PCREL, entity, false,
+			                      imm->offset);
+			return;
+		} else if (imm->kind == X86_IMM_PCREL && is_lconst(entity)) {
+			be_emit_reloc_literal(4, X86_IMM_PCREL, entity, true,
+			                      imm->offset);
+			return;
+		}
+	}
+	be_emit_reloc_entity(4, imm->kind, entity, imm->offset);
+}
+
+static void enc_imm(x86_imm32_t const *const imm, unsigned const imm_size)
+{
+	switch (imm_size) {
+	case 1: be_emit8(imm->offset);  return;
+	case 2: be_emit16(imm->offset); return;
+	case 4: enc_relocation(imm);    return;
+	}
+	panic("invalid immediate size");
+}
+
+/** Returns the size of an immediate operand for an operation of @p size. */
+static unsigned get_imm_size(x86_insn_size_t const size)
+{
+	switch (size) {
+	case X86_SIZE_8:  return 1;
+	case X86_SIZE_16: return 2;
+	default:          return 4;
+	}
+}
+
+static void enc_jmp_destination(ir_node const *const cfop)
+{
+	assert(get_irn_mode(cfop) == mode_X);
+	ir_node const *const dest_block = be_emit_get_cfop_target(cfop);
+	unsigned const fragment_num
+		= PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, dest_block));
+	be_emit_reloc_fragment(4, AMD64_RELOCATION_RELJUMP, fragment_num, -4);
+}
+
+/**
+ * Emits an instruction with a register or opcode extension @p reg and the
+ * register @p rm as operands.
+ */
+static void enc_rr(enc_flags_t const flags, unsigned const opcode,
+                   unsigned const reg, unsigned const rm)
+{
+	uint8_t rex = 0;
+	if (reg & 8)
+		rex |= REX_R;
+	if (rm & 8)
+		rex |= REX_B;
+	if ((flags & ENC_BYTE_REG) && needs_rex_byte(reg))
+		rex |= REX;
+	if ((flags & ENC_BYTE_RM) && needs_rex_byte(rm))
+		rex |= REX;
+	enc_prefixes(flags, X86_SEGMENT_DEFAULT, rex);
+	enc_opcode(opcode);
+	be_emit8(MOD_REG | (reg & 7) << 3 | (rm & 7));
+}
+
+static uint8_t addr_rex(ir_node const *const node, x86_addr_t const *const addr)
+{
+	uint8_t rex = 0;
+	if (x86_addr_variant_has_base(addr->variant)
+	 && in_enc(node, addr->base_input) & 8)
+		rex |= REX_B;
+	if (x86_addr_variant_has_index(addr->variant)
+	 && in_enc(node, addr->index_input) & 8)
+		rex |= REX_X;
+	return rex;
+}
+
+/**
+ * Emits the ModR/M byte, SIB byte and displacement of a memory operand.
+ *
+ * @param reg       content of the reg field: either a register encoding or
+ *                  an opcode extension
+ * @param imm_size  size of the immediate following the address, which has
+ *                  to be accounted for in rip relative displacements
+ */
+static void enc_mod_am(unsigned const reg, ir_node const *const node,
+                       x86_addr_t const *const addr, unsigned const imm_size)
+{
+	x86_imm32_t const *const imm    = &addr->immediate;
+	int32_t            const offset = imm->offset;
+	uint8_t            const reg3   = (reg & 7) << 3;
+
+	if (addr->variant == X86_ADDR_RIP) {
+		be_emit8(MOD_IND | reg3 | ENC_DISP32);
+		if (imm->entity == NULL) {
+			be_emit32(offset);
+		} else {
+			/* relative to the end of the instruction */
+			x86_imm32_t const rel = {
+				.kind   = imm->kind,
+				.entity = imm->entity,
+				.offset = offset - 4 - (int32_t)imm_size,
+			};
+			enc_relocation(&rel);
+		}
+		return;
+	}
+
+	bool const has_base  = x86_addr_variant_has_base(addr->variant);
+	bool const has_index = x86_addr_variant_has_index(addr->variant);
+	unsigned   base_enc;
+	unsigned   mod;
+	unsigned   emitoffs;
+	if (!has_base) {
+		/* a bare displacement has to be encoded as SIB without base, because
+		 * the short form is rip relative in 64bit mode */
+		base_enc = ENC_DISP32;
+		mod      = MOD_IND;
+		emitoffs = 32;
+	} else {
+		base_enc = in_enc(node, addr->base_input) & 7;
+		if (imm->entity != NULL) {
+			mod      = MOD_IND_WORD_OFS;
+			emitoffs = 32;
+		} else if (offset == 0 && base_enc != 5) {
+			/* rbp/r13 without offset encode a bare displacement */
+			mod      = MOD_IND;
+			emitoffs = 0;
+		} else if (is_8bit_imm(offset)) {
+			mod      = MOD_IND_BYTE_OFS;
+			emitoffs = 8;
+		} else {
+			mod      = MOD_IND_WORD_OFS;
+			emitoffs = 32;
+		}
+	}
+
+	if (has_index || !has_base || base_enc == ENC_SIB) {
+		unsigned const scale = has_index ? addr->log_scale : 0;
+		unsigned const index
+			= has_index ? in_enc(node, addr->index_input) & 7 : ENC_SIB;
+		be_emit8(mod | reg3 | ENC_SIB);
+		be_emit8(scale << 6 | index << 3 | base_enc);
+	} else {
+		be_emit8(mod | reg3 | base_enc);
+	}
+
+	if (emitoffs == 8) {
+		be_emit8(offset);
+	} else if (emitoffs == 32) {
+		enc_relocation(imm);
+	}
+}
+
+/**
+ * Emits an instruction with a register or opcode extension @p reg and the
+ * register or memory operand @p addr.
+ */
+static void enc_am(enc_flags_t const flags, unsigned const opcode,
+                   unsigned const reg, ir_node const *const node,
+                   x86_addr_t const *const addr, unsigned const imm_size)
+{
+	if (addr->variant == X86_ADDR_REG) {
+		enc_rr(flags, opcode, reg, in_enc(node, addr->base_input));
+		return;
+	}
+
+	uint8_t rex = addr_rex(node, addr);
+	if (reg & 8)
+		rex |= REX_R;
+	if ((flags & ENC_BYTE_REG) && needs_rex_byte(reg))
+		rex |= REX;
+	enc_prefixes(flags, addr->segment, rex);
+	enc_opcode(opcode);
+	enc_mod_am(reg, node, addr, imm_size);
+}
+
+void amd64_enc_simple(unsigned const opcode)
+{
+	enc_opcode(opcode);
+}
+
+/**
+ * Emits an arithmetic instruction with an immediate operand: the short form
+ * for the accumulator, a sign extended 8bit immediate or a full immediate.
+ */
+static void enc_alu_imm(enc_flags_t const flags, x86_insn_size_t const size,
+                        uint8_t const ext, ir_node const *const node,
+                        x86_addr_t const *const addr,
+                        x86_imm32_t const *const imm)
+{
+	enc_flags_t const ext_flags = flags & ~ENC_BYTE_REG;
+	bool        const op_size   = size != X86_SIZE_8;
+	bool        const imm8      = imm->entity == NULL && is_8bit_imm(imm->offset);
+	if (addr->variant == X86_ADDR_REG && in_enc(node, addr->base_input) == 0
+	 && (size == X86_SIZE_8 || !imm8)) {
+		enc_prefixes(flags & ~ENC_BYTE_RM, X86_SEGMENT_DEFAULT, 0);
+		be_emit8(ext << 3 | 0x04 | op_size);
+		enc_imm(imm, get_imm_size(size));
+	} else if (size == X86_SIZE_8) {
+		enc_am(ext_flags, 0x80, ext, node, addr, 1);
+		enc_imm(imm, 1);
+	} else if (imm8) {
+		enc_am(ext_flags, 0x83, ext, node, addr, 1);
+		enc_imm(imm, 1);
+	} else {
+		unsigned const imm_size = get_imm_size(size);
+		enc_am(ext_flags, 0x81, ext, node, addr, imm_size);
+		enc_imm(imm, imm_size);
+	}
+}
+
+void amd64_enc_binop(ir_node const *const node, uint8_t const ext)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	x86_addr_t      const *const addr  = &attr->base.addr;
+	x86_insn_size_t        const size  = attr->base.base.size;
+	enc_flags_t            const flags = size_flags(size);
+	unsigned               const code  = ext << 3 | (size != X86_SIZE_8);
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_REG:
+		/* like the assembler emitter: the second operand is input 1, as
+		 * amd64_finish does not update reg_input when turning back AM */
+		enc_rr(flags, code, in_enc(node, 1), in_enc(node, addr->base_input));
+		return;
+	case AMD64_OP_ADDR_REG:
+		enc_am(flags, code, in_enc(node, attr->u.reg_input), node, addr, 0);
+		return;
+	case AMD64_OP_REG_ADDR:
+		enc_am(flags, code | 0x02, in_enc(node, attr->u.reg_input), node,
+		       addr, 0);
+		return;
+	case AMD64_OP_REG_IMM:
+	case AMD64_OP_ADDR_IMM:
+		enc_alu_imm(flags, size, ext, node, addr, &attr->u.immediate);
+		return;
+	default:
+		break;
+	}
+	panic("invalid op_mode for binop %+F", node);
+}
+
+static void enc_test(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	x86_addr_t      const *const addr    = &attr->base.addr;
+	x86_insn_size_t        const size    = attr->base.base.size;
+	enc_flags_t            const flags   = size_flags(size);
+	bool                   const op_size = size != X86_SIZE_8;
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_REG:
+		enc_rr(flags, 0x84 | op_size, in_enc(node, 1),
+		       in_enc(node, addr->base_input));
+		return;
+	case AMD64_OP_ADDR_REG:
+	case AMD64_OP_REG_ADDR:
+		enc_am(flags, 0x84 | op_size, in_enc(node, attr->u.reg_input), node,
+		       addr, 0);
+		return;
+	case AMD64_OP_REG_IMM:
+	case AMD64_OP_ADDR_IMM: {
+		unsigned const imm_size = get_imm_size(size);
+		if (addr->variant == X86_ADDR_REG && in_enc(node, addr->base_input) == 0) {
+			enc_prefixes(flags & ~ENC_BYTE_RM, X86_SEGMENT_DEFAULT, 0);
+			be_emit8(0xA8 | op_size);
+		} else {
+			enc_am(flags & ~ENC_BYTE_REG, 0xF6 | op_size, 0, node, addr,
+			       imm_size);
+		}
+		enc_imm(&attr->u.immediate, imm_size);
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid op_mode for test %+F", node);
+}
+
+static void enc_imul(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	x86_addr_t      const *const addr  = &attr->base.addr;
+	x86_insn_size_t        const size  = attr->base.base.size;
+	enc_flags_t            const flags = size_flags(size);
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_REG: {
+		unsigned const dst = in_enc(node, addr->base_input);
+		enc_rr(flags, 0x0FAF, dst, in_enc(node, 1));
+		return;
+	}
+	case AMD64_OP_REG_ADDR:
+		enc_am(flags, 0x0FAF, in_enc(node, attr->u.reg_input), node, addr, 0);
+		return;
+	case AMD64_OP_REG_IMM: {
+		x86_imm32_t const *const imm = &attr->u.immediate;
+		unsigned           const dst = in_enc(node, addr->base_input);
+		if (imm->entity == NULL && is_8bit_imm(imm->offset)) {
+			enc_rr(flags, 0x6B, dst, dst);
+			enc_imm(imm, 1);
+		} else {
+			enc_rr(flags, 0x69, dst, dst);
+			enc_imm(imm, get_imm_size(size));
+		}
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid op_mode for imul %+F", node);
+}
+
+void amd64_enc_unop(ir_node const *const node, uint8_t const ext)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	x86_insn_size_t    const       size = attr->base.size;
+	enc_flags_t        const      flags = size_flags(size) & ~ENC_BYTE_REG;
+	enc_am(flags, 0xF6 | (size != X86_SIZE_8), ext, node, &attr->addr, 0);
+}
+
+void amd64_enc_shiftop(ir_node const *const node, uint8_t const ext)
+{
+	amd64_shift_attr_t const *const attr    = get_amd64_shift_attr_const(node);
+	x86_insn_size_t     const       size    = attr->base.size;
+	enc_flags_t         const       flags   = size_flags(size) & ~ENC_BYTE_REG;
+	bool                const       op_size = size != X86_SIZE_8;
+	unsigned            const       reg     = in_enc(node, 0);
+	switch ((amd64_op_mode_t)attr->base.op_mode) {
+	case AMD64_OP_SHIFT_IMM:
+		if (attr->immediate == 1) {
+			enc_rr(flags, 0xD0 | op_size, ext, reg);
+		} else {
+			enc_rr(flags, 0xC0 | op_size, ext, reg);
+			be_emit8(attr->immediate);
+		}
+		return;
+	case AMD64_OP_SHIFT_REG:
+		enc_rr(flags, 0xD2 | op_size, ext, reg);
+		return;
+	default:
+		break;
+	}
+	panic("invalid op_mode for shiftop %+F", node);
+}
+
+void amd64_enc_unop_out(ir_node const *const node, unsigned const opcode)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	enc_am(size_flags(attr->base.size), opcode, out_enc(node, 0), node,
+	       &attr->addr, 0);
+}
+
+void amd64_enc_xmm_binop(ir_node const *const node,
+                         amd64_xmm_prefix_t const prefix,
+                         unsigned const opcode)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	x86_addr_t const *const addr  = &attr->base.addr;
+	enc_flags_t       const flags
+		= xmm_prefix_flags(prefix, attr->base.base.size);
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_REG: {
+		unsigned const dst = in_enc(node, addr->base_input);
+		enc_rr(flags, opcode, dst, in_enc(node, 1));
+		return;
+	}
+	case AMD64_OP_REG_ADDR:
+		enc_am(flags, opcode, in_enc(node, attr->u.reg_input), node, addr, 0);
+		return;
+	default:
+		break;
+	}
+	panic("invalid op_mode for xmm binop %+F", node);
+}
+
+void amd64_enc_xmm_int_binop(ir_node const *const node, uint8_t const op8,
+                             uint8_t const op16, uint8_t const op32,
+                             uint8_t const op64)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	uint8_t opcode;
+	switch (attr->base.base.size) {
+	case X86_SIZE_8:  opcode = op8;  break;
+	case X86_SIZE_16: opcode = op16; break;
+	case X86_SIZE_32: opcode = op32; break;
+	case X86_SIZE_64: opcode = op64; break;
+	default: panic("invalid lane size for %+F", node);
+	}
+	amd64_enc_xmm_binop(node, AMD64_XMM_66, 0x0F00 | opcode);
+}
+
+void amd64_enc_xmm_unop(ir_node const *const node,
+                        amd64_xmm_prefix_t const prefix, unsigned const opcode)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	enc_flags_t const flags = xmm_prefix_flags(prefix, attr->base.size);
+	enc_am(flags, opcode, out_enc(node, 0), node, &attr->addr, 0);
+}
+
+void amd64_enc_xmm_cvt(ir_node const *const node,
+                       amd64_xmm_prefix_t const prefix, unsigned const opcode)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	enc_flags_t flags = xmm_prefix_flags(prefix, attr->base.size);
+	if (attr->base.size == X86_SIZE_64)
+		flags |= ENC_W;
+	enc_am(flags, opcode, out_enc(node, 0), node, &attr->addr, 0);
+}
+
+void amd64_enc_xmm_store(ir_node const *const node,
+                         amd64_xmm_prefix_t const prefix,
+                         unsigned const opcode)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	enc_flags_t const flags = xmm_prefix_flags(prefix, attr->base.base.size);
+	enc_am(flags, opcode, in_enc(node, attr->u.reg_input), node,
+	       &attr->base.addr, 0);
+}
+
+static void enc_movd(ir_node const *const node)
+{
+	/* like the assembler: a memory operand is loaded with 32 bits */
+	amd64_addr_attr_t const *const attr  = get_amd64_addr_attr_const(node);
+	x86_addr_t        const *const addr  = &attr->addr;
+	enc_flags_t              const flags
+		= addr->variant == X86_ADDR_REG ? ENC_P66 | ENC_W : ENC_P66;
+	enc_am(flags, 0x0F6E, out_enc(node, 0), node, addr, 0);
+}
+
+static void enc_movd_xmm_gp(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr  = get_amd64_addr_attr_const(node);
+	enc_flags_t              const flags = ENC_P66 | size_flags(attr->base.size);
+	enc_rr(flags, 0x0F7E, in_enc(node, 0), out_enc(node, 0));
+}
+
+static void enc_xorp_0(ir_node const *const node)
+{
+	x86_insn_size_t const size = get_amd64_attr_const(node)->size;
+	unsigned        const out  = out_enc(node, 0);
+	enc_rr(xmm_prefix_flags(AMD64_XMM_PACKED, size), 0x0F57, out, out);
+}
+
+static void enc_pxor_0(ir_node const *const node)
+{
+	unsigned const out = out_enc(node, 0);
+	enc_rr(ENC_P66, 0x0FEF, out, out);
+}
+
+void amd64_enc_fma(ir_node const *const node, uint8_t const opcode)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	x86_addr_t        const *const addr = &attr->addr;
+	unsigned                 const reg  = in_enc(node, 0);
+	unsigned                 const vvvv = in_enc(node, 1);
+	bool const is_reg = attr->base.op_mode == AMD64_OP_REG_REG_REG;
+
+	uint8_t rex = is_reg ? (in_enc(node, 2) & 8 ? REX_B : 0)
+	                     : addr_rex(node, addr);
+	if (reg & 8)
+		rex |= REX_R;
+	/* three byte VEX prefix: inverted R, X, B, map 0F38, W, inverted vvvv,
+	 * 128bit vector length, implied 0x66 prefix */
+	be_emit8(0xC4);
+	be_emit8((~rex & 0x07) << 5 | 0x02);
+	be_emit8((attr->base.size == X86_SIZE_64) << 7 | (~vvvv & 0x0F) << 3 | 0x01);
+	be_emit8(opcode);
+	if (is_reg) {
+		be_emit8(MOD_REG | (reg & 7) << 3 | (in_enc(node, 2) & 7));
+	} else {
+		enc_mod_am(reg, node, addr, 0);
+	}
+}
+
+static void enc_mov_gp(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	x86_addr_t        const *const addr = &attr->addr;
+	unsigned                 const out  = out_enc(node, 0);
+	switch (attr->base.size) {
+	case X86_SIZE_8:  enc_am(ENC_BYTE_RM, 0x0FB6, out, node, addr, 0); return;
+	case X86_SIZE_16: enc_am(ENC_NONE,    0x0FB7, out, node, addr, 0); return;
+	case X86_SIZE_32: enc_am(ENC_NONE,    0x8B,   out, node, addr, 0); return;
+	case X86_SIZE_64: enc_am(ENC_W,       0x8B,   out, node, addr, 0); return;
+	case X86_SIZE_80:
+	case X86_SIZE_128:
+		break;
+	}
+	panic("invalid insn mode");
+}
+
+static void enc_movs(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	x86_addr_t        const *const addr = &attr->addr;
+	unsigned                 const out  = out_enc(node, 0);
+	switch (attr->base.size) {
+	case X86_SIZE_8:  enc_am(ENC_W | ENC_BYTE_RM, 0x0FBE, out, node, addr, 0); return;
+	case X86_SIZE_16: enc_am(ENC_W,               0x0FBF, out, node, addr, 0); return;
+	case X86_SIZE_32: enc_am(ENC_W,               0x63,   out, node, addr, 0); return;
+	case X86_SIZE_64:
+	case X86_SIZE_80:
+	case X86_SIZE_128:
+		break;
+	}
+	panic("invalid insn mode");
+}
+
+static void enc_lea(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	enc_am(size_flags(attr->base.size), 0x8D, out_enc(node, 0), node,
+	       &attr->addr, 0);
+}
+
+static void enc_mov_imm(ir_node const *const node)
+{
+	amd64_movimm_attr_t const *const attr = get_amd64_movimm_attr_const(node);
+	amd64_imm64_t       const *const imm  = &attr->immediate;
+	unsigned                   const out  = out_enc(node, 0);
+	uint8_t                    const rex  = out & 8 ? REX_B : 0;
+	if (imm->entity != NULL) {
+		/* use a full 64bit address, so the code does not depend on the code
+		 * model */
+		enc_prefixes(ENC_W, X86_SEGMENT_DEFAULT, rex);
+		be_emit8(0xB8 | (out & 7));
+		be_emit_reloc_entity(8, AMD64_RELOCATION_ADDR64, imm->entity,
+		                     (int32_t)imm->offset);
+	} else if (attr->base.size == X86_SIZE_64) {
+		int64_t const val = imm->offset;
+		if (val == (int32_t)val) {
+			enc_rr(ENC_W, 0xC7, 0, out);
+			be_emit32(val);
+		} else {
+			enc_prefixes(ENC_W, X86_SEGMENT_DEFAULT, rex);
+			be_emit8(0xB8 | (out & 7));
+			be_emit32(val);
+			be_emit32((uint64_t)val >> 32);
+		}
+	} else {
+		enc_prefixes(ENC_NONE, X86_SEGMENT_DEFAULT, rex);
+		be_emit8(0xB8 | (out & 7));
+		be_emit32(imm->offset);
+	}
+}
+
+static void enc_mov_store(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	x86_addr_t      const *const addr  = &attr->base.addr;
+	x86_insn_size_t        const size  = attr->base.base.size;
+	enc_flags_t            const flags = size_flags(size);
+	bool                   const op_size = size != X86_SIZE_8;
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_ADDR_REG:
+		enc_am(flags, 0x88 | op_size, in_enc(node, attr->u.reg_input), node,
+		       addr, 0);
+		return;
+	case AMD64_OP_ADDR_IMM: {
+		unsigned const imm_size = get_imm_size(size);
+		enc_am(flags & ~ENC_BYTE_REG, 0xC6 | op_size, 0, node, addr, imm_size);
+		enc_imm(&attr->u.immediate, imm_size);
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid op_mode for mov_store %+F", node);
+}
+
+static void enc_cmpxchg(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr
+		= get_amd64_binop_addr_attr_const(node);
+	x86_insn_size_t const size  = attr->base.base.size;
+	enc_flags_t     const flags = size_flags(size) | ENC_LOCK;
+	enc_am(flags, 0x0FB0 | (size != X86_SIZE_8),
+	       in_enc(node, attr->u.reg_input), node, &attr->base.addr, 0);
+}
+
+static void enc_xor_0(ir_node const *const node)
+{
+	unsigned const out = out_enc(node, pn_amd64_xor_0_res);
+	enc_rr(ENC_NONE, 0x31, out, out);
+}
+
+static void enc_setcc(ir_node const *const node)
+{
+	x86_condition_code_t const cc = get_amd64_cc_attr_const(node)->cc;
+	enc_rr(ENC_BYTE_RM, 0x0F90 | (cc & 0x0F), 0, out_enc(node, 0));
+}
+
+static void enc_push_reg(ir_node const *const node)
+{
+	x86_insn_size_t const size = get_amd64_attr_const(node)->size;
+	unsigned        const reg  = in_enc(node, n_amd64_push_reg_val);
+	enc_prefixes(size == X86_SIZE_16 ? ENC_OPSIZE : ENC_NONE,
+	             X86_SEGMENT_DEFAULT, reg & 8 ? REX_B : 0);
+	be_emit8(0x50 | (reg & 7));
+}
+
+static void enc_push_am(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	enc_flags_t const flags
+		= attr->base.size == X86_SIZE_16 ? ENC_OPSIZE : ENC_NONE;
+	enc_am(flags, 0xFF, 6, node, &attr->addr, 0);
+}
+
+static void enc_pop_am(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	enc_flags_t const flags
+		= attr->base.size == X86_SIZE_16 ? ENC_OPSIZE : ENC_NONE;
+	enc_am(flags, 0x8F, 0, node, &attr->addr, 0);
+}
+
+static void enc_sub_sp(ir_node const *const node)
+{
+	/* sub %in, %rsp */
+	amd64_enc_binop(node, 5);
+	/* mov %rsp, %out */
+	arch_register_t const *const rsp = &amd64_registers[REG_RSP];
+	enc_rr(ENC_W, 0x89, rsp->encoding, out_enc(node, pn_amd64_sub_sp_addr));
+}
+
+/**
+ * Emits movsb/w/l instructions to make the copy size divisible by 8.
+ */
+static void enc_copyB_prolog(unsigned const size)
+{
+	if (size & 1)
+		be_emit8(0xA4); // movsb
+	if (size & 2) {
+		be_emit8(0x66);
+		be_emit8(0xA5); // movsw
+	}
+	if (size & 4)
+		be_emit8(0xA5); // movsl
+}
+
+static void enc_copyB(ir_node const *const node)
+{
+	unsigned const size = get_amd64_copyb_attr_const(node)->size;
+	enc_copyB_prolog(size);
+	be_emit8(0xF3);
+	be_emit8(0xA5); // rep movsl
+}
+
+static void enc_copyB_i(ir_node const *const node)
+{
+	unsigned size = get_amd64_copyb_attr_const(node)->size;
+	enc_copyB_prolog(size);
+	size >>= 3;
+	while (size--) {
+		be_emit8(REX | REX_W);
+		be_emit8(0xA5); // movsq
+	}
+}
+
+static void enc_call(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	if (attr->base.op_mode == AMD64_OP_IMM32) {
+		x86_imm32_t const *const imm = &attr->addr.immediate;
+		be_emit8(0xE8);
+		x86_imm32_t const call_imm = {
+			.kind   = imm->kind,
+			.entity = imm->entity,
+			.offset = imm->offset - 4,
+		};
+		enc_relocation(&call_imm);
+	} else {
+		enc_am(ENC_NONE, 0xFF, 2, node, &attr->addr, 0);
+	}
+}
+
+static void enc_ijmp(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	if (attr->base.op_mode == AMD64_OP_IMM32) {
+		x86_imm32_t const *const imm = &attr->addr.immediate;
+		be_emit8(0xE9);
+		x86_imm32_t const jmp_imm = {
+			.kind   = imm->kind,
+			.entity = imm->entity,
+			.offset = imm->offset - 4,
+		};
+		enc_relocation(&jmp_imm);
+	} else {
+		enc_am(ENC_NONE, 0xFF, 4, node, &attr->addr, 0);
+	}
+}
+
+static void enc_jmp(ir_node const *const cfop)
+{
+	be_emit8(0xE9);
+	enc_jmp_destination(cfop);
+}
+
+static void enc_amd64_jmp(ir_node const *const node)
+{
+	if (!be_is_fallthrough(node))
+		enc_jmp(node);
+}
+
+static void enc_jcc(x86_condition_code_t const cc, ir_node const *const cfop)
+{
+	be_emit8(0x0F);
+	be_emit8(0x80 | (cc & 0x0F));
+	enc_jmp_destination(cfop);
+}
+
+static void enc_jp(ir_node const *const cfop)
+{
+	be_emit8(0x0F);
+	be_emit8(0x8A);
+	enc_jmp_destination(cfop);
+}
+
+static void enc_amd64_jcc(ir_node const *const node)
+{
+	ir_node         const *const flags = get_irn_n(node, n_amd64_jcc_flags);
+	amd64_cc_attr_t const *const attr  = get_amd64_cc_attr_const(node);
+	x86_condition_code_t cc = amd64_determine_final_cc(flags, attr->cc);
+
+	be_cond_branch_projs_t projs = be_get_cond_branch_projs(node);
+
+	if (be_is_fallthrough(projs.t)) {
+		/* exchange both proj's so the second one can be omitted */
+		ir_node *const t = projs.t;
+		projs.t = projs.f;
+		projs.f = t;
+		cc      = x86_negate_condition_code(cc);
+	}
+
+	if (cc & x86_cc_float_parity_cases) {
+		/* Some floating point comparisons require a test of the parity flag,
+		 * which indicates that the result is unordered */
+		if (cc & x86_cc_negated) {
+			enc_jp(projs.t);
+		} else {
+			enc_jp(projs.f);
+		}
+	}
+	enc_jcc(cc, projs.t);
+
+	if (!be_is_fallthrough(projs.f))
+		enc_jmp(projs.f);
+}
+
+static void enc_jmp_switch(ir_node const *const node)
+{
+	amd64_switch_jmp_attr_t const *const attr
+		= get_amd64_switch_jmp_attr_const(node);
+	enc_am(ENC_NONE, 0xFF, 4, node, &attr->base.addr, 0);
+
+	/* JIT code gets its tables behind the code, see gen_jump_table() */
+	if (jit_literals)
+		return;
+	assert(be_elf_enabled());
+
+	unsigned long         length;
+	ir_node const **const targets
+		= be_get_jump_table_targets(node, &attr->swtch, &length);
+	unsigned *const fragment_nums = XMALLOCN(unsigned, length);
+	for (unsigned long i = 0; i < length; ++i) {
+		ir_node const *const block = be_emit_get_cfop_target(targets[i]);
+		fragment_nums[i]
+			= PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, block));
+	}
+	be_elf_jump_table(attr->swtch.table_entity, length, fragment_nums);
+	free(fragment_nums);
+	free(targets);
+}
+
+static void enc_be_Copy(ir_node const *const node)
+{
+	arch_register_t const *const in  = arch_get_irn_register_in(node, 0);
+	arch_register_t const *const out = arch_get_irn_register_out(node, 0);
+	if (in == out)
+		return;
+
+	arch_register_class_t const *const cls = out->cls;
+	if (cls == &amd64_reg_classes[CLASS_amd64_gp]) {
+		enc_rr(ENC_W, 0x89, in->encoding, out->encoding);
+	} else if (cls == &amd64_reg_classes[CLASS_amd64_xmm]) {
+		enc_rr(ENC_P66, 0x0F28, out->encoding, in->encoding);
+	} else if (cls == &amd64_reg_classes[CLASS_amd64_x87]) {
+		/* nothing to do */
+	} else {
+		panic("move not supported for this register class");
+	}
+}
+
+static void enc_be_Perm(ir_node const *const node)
+{
+	arch_register_t const *const reg0 = arch_get_irn_register_out(node, 0);
+	arch_register_t const *const reg1 = arch_get_irn_register_out(node, 1);
+
+	arch_register_class_t const* const cls = reg0->cls;
+	assert(cls == reg1->cls && "Register class mismatch at Perm");
+
+	unsigned const enc0 = reg0->encoding;
+	unsigned const enc1 = reg1->encoding;
+	if (cls == &amd64_reg_classes[CLASS_amd64_gp]) {
+		if (enc0 == 0 || enc1 == 0) {
+			unsigned const other = enc0 == 0 ? enc1 : enc0;
+			enc_prefixes(ENC_W, X86_SEGMENT_DEFAULT, other & 8 ? REX_B : 0);
+			be_emit8(0x90 | (other & 7)); // xchg %rax, %other
+		} else {
+			enc_rr(ENC_W, 0x87, enc0, enc1);
+		}
+	} else if (cls == &amd64_reg_classes[CLASS_amd64_xmm]) {
+		enc_rr(ENC_P66, 0x0FEF, enc1, enc0);
+		enc_rr(ENC_P66, 0x0FEF, enc0, enc1);
+		enc_rr(ENC_P66, 0x0FEF, enc1, enc0);
+	} else {
+		panic("unexpected register class in be_Perm (%+F)", node);
+	}
+}
+
+static void enc_be_IncSP(ir_node const *const node)
+{
+	int offs = be_get_IncSP_offset(node);
+	if (offs == 0)
+		return;
+
+	uint8_t ext;
+	if (offs > 0) {
+		ext = 5; /* sub */
+	} else {
+		ext = 0; /* add */
+		offs = -offs;
+	}
+
+	unsigned const reg = out_enc(node, 0);
+	if (is_8bit_imm(offs)) {
+		enc_rr(ENC_W, 0x83, ext, reg);
+		be_emit8(offs);
+	} else {
+		enc_rr(ENC_W, 0x81, ext, reg);
+		be_emit32(offs);
+	}
+}
+
+void amd64_enc_fbinop(ir_node const *const node, uint8_t const op_fwd,
+                      uint8_t const op_rev)
+{
+	x87_attr_t const *const attr = amd64_get_x87_attr_const(node);
+	uint8_t const op = attr->reverse ? op_rev : op_fwd;
+
+	uint8_t op0 = 0xD8;
+	if (attr->res_in_reg)
+		op0 |= 0x04;
+	if (attr->pop)
+		op0 |= 0x02;
+	be_emit8(op0);
+	be_emit8(MOD_REG | op << 3 | attr->reg->encoding);
+}
+
+void amd64_enc_fop_reg(ir_node const *const node, uint8_t const op0,
+                       uint8_t const op1)
+{
+	x87_attr_t const *const attr = amd64_get_x87_attr_const(node);
+	be_emit8(op0);
+	be_emit8(op1 + attr->reg->encoding);
+}
+
+static void enc_fucomi(ir_node const *const node)
+{
+	x87_attr_t const *const attr = amd64_get_x87_attr_const(node);
+	be_emit8(attr->pop ? 0xDF : 0xDB); // fucom[p]i
+	be_emit8(0xE8 + attr->reg->encoding);
+}
+
+static void enc_fld(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	switch (attr->base.size) {
+	case X86_SIZE_32: enc_am(ENC_NONE, 0xD9, 0, node, &attr->addr, 0); return;
+	case X86_SIZE_64: enc_am(ENC_NONE, 0xDD, 0, node, &attr->addr, 0); return;
+	case X86_SIZE_80: enc_am(ENC_NONE, 0xDB, 5, node, &attr->addr, 0); return;
+	default:
+		break;
+	}
+	panic("invalid mode size");
+}
+
+static void enc_fild(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	switch (attr->base.size) {
+	case X86_SIZE_16: enc_am(ENC_NONE, 0xDF, 0, node, &attr->addr, 0); return;
+	case X86_SIZE_32: enc_am(ENC_NONE, 0xDB, 0, node, &attr->addr, 0); return;
+	case X86_SIZE_64: enc_am(ENC_NONE, 0xDF, 5, node, &attr->addr, 0); return;
+	default:
+		break;
+	}
+	panic("invalid mode size");
+}
+
+static void enc_fst_pop(ir_node const *const node, bool const pop)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	switch (attr->base.size) {
+	case X86_SIZE_32:
+		enc_am(ENC_NONE, 0xD9, 2 + pop, node, &attr->addr, 0);
+		return;
+	case X86_SIZE_64:
+		enc_am(ENC_NONE, 0xDD, 2 + pop, node, &attr->addr, 0);
+		return;
+	case X86_SIZE_80:
+		if (pop) {
+			enc_am(ENC_NONE, 0xDB, 7, node, &attr->addr, 0);
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+	panic("invalid mode size");
+}
+
+static void enc_fst(ir_node const *const node)
+{
+	enc_fst_pop(node, amd64_get_x87_attr_const(node)->pop);
+}
+
+static void enc_fstp(ir_node const *const node)
+{
+	enc_fst_pop(node, true);
+}
+
+static void enc_fisttp(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	switch (attr->base.size) {
+	case X86_SIZE_16: enc_am(ENC_NONE, 0xDF, 1, node, &attr->addr, 0); return;
+	case X86_SIZE_32: enc_am(ENC_NONE, 0xDB, 1, node, &attr->addr, 0); return;
+	case X86_SIZE_64: enc_am(ENC_NONE, 0xDD, 1, node, &attr->addr, 0); return;
+	default:
+		break;
+	}
+	panic("invalid mode size");
+}
+
+static void amd64_register_binary_emitters(void)
+{
+	be_init_emitters();
+
+	amd64_register_spec_binary_emitters();
+
+	be_set_emitter(op_amd64_call,        enc_call);
+	be_set_emitter(op_amd64_cmpxchg,     enc_cmpxchg);
+	be_set_emitter(op_amd64_copyB,       enc_copyB);
+	be_set_emitter(op_amd64_copyB_i,     enc_copyB_i);
+	be_set_emitter(op_amd64_fild,        enc_fild);
+	be_set_emitter(op_amd64_fisttp,      enc_fisttp);
+	be_set_emitter(op_amd64_fld,         enc_fld);
+	be_set_emitter(op_amd64_fst,         enc_fst);
+	be_set_emitter(op_amd64_fstp,        enc_fstp);
+	be_set_emitter(op_amd64_fucomi,      enc_fucomi);
+	be_set_emitter(op_amd64_ijmp,        enc_ijmp);
+	be_set_emitter(op_amd64_imul,        enc_imul);
+	be_set_emitter(op_amd64_jcc,         enc_amd64_jcc);
+	be_set_emitter(op_amd64_jmp,         enc_amd64_jmp);
+	be_set_emitter(op_amd64_jmp_switch,  enc_jmp_switch);
+	be_set_emitter(op_amd64_lea,         enc_lea);
+	be_set_emitter(op_amd64_mov_gp,      enc_mov_gp);
+	be_set_emitter(op_amd64_mov_imm,     enc_mov_imm);
+	be_set_emitter(op_amd64_mov_store,   enc_mov_store);
+	be_set_emitter(op_amd64_movd,        enc_movd);
+	be_set_emitter(op_amd64_movd_xmm_gp, enc_movd_xmm_gp);
+	be_set_emitter(op_amd64_movs,        enc_movs);
+	be_set_emitter(op_amd64_pop_am,      enc_pop_am);
+	be_set_emitter(op_amd64_push_am,     enc_push_am);
+	be_set_emitter(op_amd64_push_reg,    enc_push_reg);
+	be_set_emitter(op_amd64_pxor_0,      enc_pxor_0);
+	be_set_emitter(op_amd64_setcc,       enc_setcc);
+	be_set_emitter(op_amd64_sub_sp,      enc_sub_sp);
+	be_set_emitter(op_amd64_test,        enc_test);
+	be_set_emitter(op_amd64_xor_0,       enc_xor_0);
+	be_set_emitter(op_amd64_xorp_0,      enc_xorp_0);
+	be_set_emitter(op_be_Copy,           enc_be_Copy);
+	be_set_emitter(op_be_CopyKeep,       enc_be_Copy);
+	be_set_emitter(op_be_IncSP,          enc_be_IncSP);
+	be_set_emitter(op_be_Perm,           enc_be_Perm);
+}
+
+static void assign_block_fragment_num(ir_node *const block, unsigned const num)
+{
+	assert(ir_nodehashmap_get(void, &block_fragmentnum, block) == NULL);
+	ir_nodehashmap_insert(&block_fragmentnum, block, INT_TO_PTR(num));
+}
+
+static void gen_binary_block(ir_node *const block)
+{
+	ir_graph *const irg = get_irn_irg(block);
+
+	uint8_t p2align  = 0;
+	uint8_t max_skip = 0;
+	if (block != get_irg_end_block(irg) && amd64_should_align_block(block)) {
+		p2align  = 4;
+		max_skip = 10;
+	}
+
+	unsigned fragment_num = be_begin_fragment(p2align, max_skip);
+	assert(fragment_num
+	       == (unsigned)PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, block)));
+	(void)fragment_num;
+
+	sched_foreach(block, node) {
+		be_emit_node(node);
+	}
+
+	be_finish_fragment();
+}
+
+/**
+ * Emits the jump table of @p node as a fragment of 32bit offsets relative to
+ * the begin of the table, like the table of PIC code.
+ */
+static void gen_jump_table(ir_node const *const node)
+{
+	amd64_switch_jmp_attr_t const *const attr
+		= get_amd64_switch_jmp_attr_const(node);
+	unsigned long         length;
+	ir_node const **const targets
+		= be_get_jump_table_targets(node, &attr->swtch, &length);
+
+	be_begin_fragment(2, 3);
+	for (unsigned long i = 0; i < length; ++i) {
+		ir_node const *const block = be_emit_get_cfop_target(targets[i]);
+		unsigned       const fragment_num
+			= PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, block));
+		/* the relocation is relative to the entry itself */
+		be_emit_reloc_fragment(4, X86_IMM_PCREL, fragment_num, 4 * i);
+	}
+	be_finish_fragment();
+	free(targets);
+}
+
+ir_jit_function_t *amd64_emit_jit(ir_jit_segment_t *const segment,
+                                  ir_graph *const irg)
+{
+	amd64_register_binary_emitters();
+
+	ir_node **const blk_sched = be_create_block_schedule(irg);
+
+	be_jit_begin_function(segment);
+	jit_literals = amd64_get_irg_data(irg)->jit;
+
+	/* we use links to point to target blocks */
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	be_emit_init_cf_links(blk_sched);
+
+	ir_nodehashmap_init(&block_fragmentnum);
+	size_t n = ARR_LEN(blk_sched);
+	jit_switches = NEW_ARR_F(ir_node const*, 0);
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *block = blk_sched[i];
+		assign_block_fragment_num(block, (unsigned)i);
+		if (!jit_literals)
+			continue;
+		sched_foreach(block, node) {
+			if (is_amd64_jmp_switch(node))
+				ARR_APP1(ir_node const*, jit_switches, node);
+		}
+	}
+	first_table_fragment = n;
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *block = blk_sched[i];
+		gen_binary_block(block);
+	}
+	for (size_t i = 0, n_switches = ARR_LEN(jit_switches); i < n_switches; ++i)
+		gen_jump_table(jit_switches[i]);
+	DEL_ARR_F(jit_switches);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_nodehashmap_destroy(&block_fragmentnum);
+
+	return be_jit_finish_function();
+}
+
+static void enc_nop_callback(char *buffer, unsigned size)
+{
+	memset(buffer, 0, size);
+	while (size > 0) {
+		switch (size) {
+		case 1: buffer[0] = 0x90; return;
+		case 2:
+			buffer[0] = 0x66;
+			++buffer;
+			--size;
+			continue;
+		case 3:
+		sequence_0f1f:
+			buffer[0] = 0x0F;
+			buffer[1] = 0x1F;
+			return;
+		case 4: buffer[2] = 0x40; goto sequence_0f1f;
+		case 5: buffer[2] = 0x44; goto sequence_0f1f;
+		case 6:
+			buffer[0] = 0x66;
+			++buffer;
+			--size;
+			continue;
+		case 7: buffer[2] = 0x80; goto sequence_0f1f;
+		case 8: buffer[2] = 0x84; goto sequence_0f1f;
+		default:
+			buffer[0] = 0x66;
+			buffer[1] = 0x0F;
+			buffer[2] = 0x1F;
+			buffer[3] = 0x84;
+			buffer += 9;
+			size   -= 9;
+			continue;
+		}
+	}
+}
+
+static unsigned enc_relocation_callback(char *const buffer,
+                                        uint8_t const be_kind,
+                                        ir_entity *const entity,
+                                        int32_t const offset)
+{
+	if (entity == NULL) {
+		/* code fragments and literals */
+		assert(be_kind == AMD64_RELOCATION_RELJUMP || be_kind == X86_IMM_PCREL);
+		uint32_t const value = (uint32_t)offset;
+		memcpy(buffer, &value, 4);
+		return 4;
+	}
+
+	intptr_t const entity_addr = (intptr_t)be_jit_get_entity_addr(entity);
+	if (entity_addr == (intptr_t)-1)
+		panic("Could not resolve address of entity %+F", entity);
+	intptr_t addr = entity_addr + offset;
+	if (be_kind == AMD64_RELOCATION_ADDR64) {
+		uint64_t const value = (uint64_t)addr;
+		memcpy(buffer, &value, 8);
+		return 8;
+	}
+
+	if (be_kind == X86_IMM_PCREL || be_kind == X86_IMM_PLT) {
+		addr -= (intptr_t)buffer;
+	} else if (be_kind != X86_IMM_ADDR) {
+		panic("relocation kind %u not supported in JIT mode", be_kind);
+	}
+	int32_t const value = (int32_t)addr;
+	if ((intptr_t)value != addr)
+		panic("Overflow in relocation");
+	memcpy(buffer, &value, 4);
+	return 4;
+}
+
+void amd64_emit_jit_function(char *buffer, ir_jit_function_t *const function)
+{
+	static const be_jit_emit_interface_t jit_emit_interface = {
+		.nops       = enc_nop_callback,
+		.relocation = enc_relocation_callback,
+	};
+	be_jit_emit_memory(buffer, function, &jit_emit_interface);
+}
+
+static unsigned enc_elf_relocation_callback(char *const buffer,
+                                            uint8_t const be_kind,
+                                            ir_entity *const entity,
+                                            int32_t const offset)
+{
+	if (entity == NULL) {
+		assert(be_kind == AMD64_RELOCATION_RELJUMP);
+		uint32_t const value = (uint32_t)offset;
+		memcpy(buffer, &value, 4);
+		return 4;
+	}
+
+	if (be_kind == AMD64_RELOCATION_ADDR64) {
+		be_elf_relocation(buffer, R_X86_64_64, 8, entity, offset);
+		return 8;
+	}
+
+	unsigned type;
+	switch ((x86_immediate_kind_t)be_kind) {
+	case X86_IMM_ADDR:  type = R_X86_64_32S;   break;
+	case X86_IMM_PCREL: type = R_X86_64_PC32;  break;
+	case X86_IMM_PLT:   type = R_X86_64_PLT32; break;
+	default:
+		panic("relocation kind %u not supported in object files", be_kind);
+	}
+	be_elf_relocation(buffer, type, 4, entity, offset);
+	return 4;
+}
+
+void amd64_elf_begin(FILE *const output)
+{
+	static const be_elf_target_t elf_target = {
+		.machine    = EM_X86_64,
+		.is_64bit   = true,
+		.rela       = true,
+		.reloc_addr = R_X86_64_64,
+		.reloc_32   = R_X86_64_32,
+		.nops       = enc_nop_callback,
+	};
+	be_elf_begin(output, &elf_target);
+}
+
+void amd64_emit_elf_function(ir_graph *const irg)
+{
+	static const be_jit_emit_interface_t elf_emit_interface = {
+		.nops       = enc_nop_callback,
+		.relocation = enc_elf_relocation_callback,
+	};
+	ir_jit_segment_t  *const segment  = be_new_jit_segment();
+	ir_jit_function_t *const function = amd64_emit_jit(segment, irg);
+	be_elf_emit_function(get_irg_entity(irg), 4, function, &elf_emit_interface);
+	be_destroy_jit_segment(segment);
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       amd64 binary encoding/emission
+ */
+#ifndef FIRM_BE_AMD64_AMD64_ENCODE_H
+#define FIRM_BE_AMD64_AMD64_ENCODE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "firm_types.h"
+#include "jit.h"
+
+enum {
+	AMD64_RELOCATION_RELJUMP = 128, /**< 32bit jump to a code fragment */
+	AMD64_RELOCATION_ADDR64,        /**< 64bit absolute address */
+};
+
+/** Mandatory prefix of an SSE instruction. */
+typedef enum amd64_xmm_prefix_t {
+	AMD64_XMM_NONE,
+	AMD64_XMM_66,
+	AMD64_XMM_F2,
+	AMD64_XMM_F3,
+	AMD64_XMM_SCALAR, /**< F3 (single) or F2 (double) depending on size */
+	AMD64_XMM_PACKED, /**< none (single) or 66 (double) depending on size */
+} amd64_xmm_prefix_t;
+
+ir_jit_function_t *amd64_emit_jit(ir_jit_segment_t *segment, ir_graph *irg);
+
+void amd64_emit_jit_function(char *buffer, ir_jit_function_t *function);
+
+/** Starts writing an ELF object file to @p output. */
+void amd64_elf_begin(FILE *output);
+
+/** Encodes @p irg and appends it to the object file. */
+void amd64_emit_elf_function(ir_graph *irg);
+
+void amd64_enc_simple(unsigned opcode);
+
+void amd64_enc_binop(ir_node const *node, uint8_t ext);
+
+void amd64_enc_unop(ir_node const *node, uint8_t ext);
+
+void amd64_enc_shiftop(ir_node const *node, uint8_t ext);
+
+void amd64_enc_unop_out(ir_node const *node, unsigned opcode);
+
+void amd64_enc_xmm_binop(ir_node const *node, amd64_xmm_prefix_t prefix,
+                         unsigned opcode);
+
+/**
+ * Encodes a packed integer SSE2 operation, choosing the opcode by the lane
+ * size of @p node.
+ */
+void amd64_enc_xmm_int_binop(ir_node const *node, uint8_t op8, uint8_t op16,
+                             uint8_t op32, uint8_t op64);
+
+void amd64_enc_xmm_unop(ir_node const *node, amd64_xmm_prefix_t prefix,
+                        unsigned opcode);
+
+void amd64_enc_xmm_cvt(ir_node const *node, amd64_xmm_prefix_t prefix,
+                       unsigned opcode);
+
+void amd64_enc_xmm_store(ir_node const *node, amd64_xmm_prefix_t prefix,
+                         unsigned opcode);
+
+void amd64_enc_fma(ir_node const *node, uint8_t opcode);
+
+void amd64_enc_fbinop(ir_node const *node, uint8_t op_fwd, uint8_t op_rev);
+
+void amd64_enc_fop_reg(ir_node const *node, uint8_t op0, uint8_t op1);
+
+#endif
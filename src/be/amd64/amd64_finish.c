@@ -77,7 +77,8 @@ static void transform_sub_to_neg_add(ir_node *node,
 				},
 			},
 		};
-		init_lconst_addr(&xor_attr.base.addr, sign_bit_const);
+		init_lconst_addr(&xor_attr.base.addr, get_irn_irg(node),
+		                 sign_bit_const);
 
 		ir_node *xor_in[] = { in2 };
 		ir_node *const xor = new_bd_amd64_xorp(dbgi, block, ARRAY_SIZE(xor_in), xor_in, amd64_xmm_reqs, &xor_attr);
@@ -102,8 +102,34 @@ static void fix_address_pic_elf(ir_node *const node, void *const data)
 	}
 }
 
+/**
+ * JIT code may end up anywhere in the address space, so all entities are
+ * reached through an address literal next to the code.
+ */
+static void fix_address_jit(ir_node *const node, void *const data)
+{
+	(void)data;
+	foreach_irn_in(node, i, pred) {
+		if (!is_Address(pred))
+			continue;
+		ir_entity *const entity = get_Address_entity(pred);
+		if (is_tls_entity(entity))
+			continue;
+
+		dbg_info *const dbgi = get_irn_dbg_info(pred);
+		ir_graph *const irg  = get_irn_irg(node);
+		set_irn_n(node, i, create_gotpcrel_load(dbgi, irg, entity));
+	}
+}
+
 void amd64_adjust_pic(ir_graph *irg)
 {
+	if (amd64_get_irg_data(irg)->jit) {
+		irg_walk_graph(irg, fix_address_jit, NULL, NULL);
+		be_dump(DUMP_BE, irg, "pic");
+		return;
+	}
+
 	switch (ir_platform.pic_style) {
 	case BE_PIC_NONE:
 		return;
@@ -9,22 +9,22 @@ $mode_x87   = "x86_mode_E";
 	gp => {
 		mode => $mode_gp,
 		registers => [
-			{ name => "rax", dwarf =>  0 },
-			{ name => "rcx", dwarf =>  2 },
-			{ name => "rdx", dwarf =>  1 },
-			{ name => "rsi", dwarf =>  4 },
-			{ name => "rdi", dwarf =>  5 },
-			{ name => "rbx", dwarf =>  3 },
-			{ name => "rbp", dwarf =>  6 },
-			{ name => "rsp", dwarf =>  7 },
-			{ name => "r8",  dwarf =>  8 },
-			{ name => "r9",  dwarf =>  9 },
-			{ name => "r10", dwarf => 10 },
-			{ name => "r11", dwarf => 11 },
-			{ name => "r12", dwarf => 12 },
-			{ name => "r13", dwarf => 13 },
-			{ name => "r14", dwarf => 14 },
-			{ name => "r15", dwarf => 15 },
+			{ name => "rax", encoding =>  0, dwarf =>  0 },
+			{ name => "rcx", encoding =>  1, dwarf =>  2 },
+			{ name => "rdx", encoding =>  2, dwarf =>  1 },
+			{ name => "rsi", encoding =>  6, dwarf =>  4 },
+			{ name => "rdi", encoding =>  7, dwarf =>  5 },
+			{ name => "rbx", encoding =>  3, dwarf =>  3 },
+			{ name => "rbp", encoding =>  5, dwarf =>  6 },
+			{ name => "rsp", encoding =>  4, dwarf =>  7 },
+			{ name => "r8",  encoding =>  8, dwarf =>  8 },
+			{ name => "r9",  encoding =>  9, dwarf =>  9 },
+			{ name => "r10", encoding => 10, dwarf => 10 },
+			{ name => "r11", encoding => 11, dwarf => 11 },
+			{ name => "r12", encoding => 12, dwarf => 12 },
+			{ name => "r13", encoding => 13, dwarf => 13 },
+			{ name => "r14", encoding => 14, dwarf => 14 },
+			{ name => "r15", encoding => 15, dwarf => 15 },
 		]
 	},
 	flags => {
@@ -368,57 +368,101 @@ leave => {
 	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_NONE;\n"
 	            ."x86_insn_size_t size    = X86_SIZE_64;\n",
 	emit      => "leave",
+	encode    => "amd64_enc_simple(0xC9)",
 },
 
-add => { template => $binop_commutative },
+add => {
+	template => $binop_commutative,
+	encode   => "amd64_enc_binop(node, 0)",
+},
 
-and => { template => $binop_commutative },
+and => {
+	template => $binop_commutative,
+	encode   => "amd64_enc_binop(node, 4)",
+},
 
 cltd => {
 	template => $sextop,
 	fixed    => "amd64_op_mode_t op_mode = AMD64_OP_NONE;\n"
 	           ."x86_insn_size_t size    = X86_SIZE_32;\n",
+	encode   => "amd64_enc_simple(0x99)",
 },
 
 cqto => {
 	template => $sextop,
 	fixed    => "amd64_op_mode_t op_mode = AMD64_OP_NONE;\n"
 	           ."x86_insn_size_t size    = X86_SIZE_64;\n",
+	encode   => "amd64_enc_simple(0x4899)",
 },
 
-div => { template => $divop },
+div => {
+	template => $divop,
+	encode   => "amd64_enc_unop(node, 6)",
+},
 
-idiv => { template => $divop },
+idiv => {
+	template => $divop,
+	encode   => "amd64_enc_unop(node, 7)",
+},
 
 imul => { template => $binop_commutative },
 
 imul_1op => {
 	template => $mulop,
 	name     => "imul",
+	encode   => "amd64_enc_unop(node, 5)",
 },
 
-mul => { template => $mulop },
+mul => {
+	template => $mulop,
+	encode   => "amd64_enc_unop(node, 4)",
+},
 
-or => { template => $binop_commutative },
+or => {
+	template => $binop_commutative,
+	encode   => "amd64_enc_binop(node, 1)",
+},
 
-shl => { template => $shiftop },
+shl => {
+	template => $shiftop,
+	encode   => "amd64_enc_shiftop(node, 4)",
+},
 
-shr => { template => $shiftop },
+shr => {
+	template => $shiftop,
+	encode   => "amd64_enc_shiftop(node, 5)",
+},
 
-sar => { template => $shiftop },
+sar => {
+	template => $shiftop,
+	encode   => "amd64_enc_shiftop(node, 7)",
+},
 
 sub => {
 	template  => $binop,
 	irn_flags => [ "modify_flags", "rematerializable" ],
+	encode    => "amd64_enc_binop(node, 5)",
 },
 
-sbb => { template => $binop },
+sbb => {
+	template => $binop,
+	encode   => "amd64_enc_binop(node, 3)",
+},
 
-neg => { template => $unop },
+neg => {
+	template => $unop,
+	encode   => "amd64_enc_unop(node, 3)",
+},
 
-not => { template => $unop },
+not => {
+	template => $unop,
+	encode   => "amd64_enc_unop(node, 2)",
+},
 
-xor => { template => $binop_commutative },
+xor => {
+	template => $binop_commutative,
+	encode   => "amd64_enc_binop(node, 6)",
+},
 
 xor_0 => {
 	op_flags  => [ "constlike" ],
@@ -479,7 +523,10 @@ jmp => {
 	            ."x86_insn_size_t size    = X86_SIZE_64;\n",
 },
 
-cmp => { template => $cmpop },
+cmp => {
+	template => $cmpop,
+	encode   => "amd64_enc_binop(node, 7)",
+},
 
 test => { template => $cmpop },
 
@@ -570,28 +617,43 @@ ret => {
 	fixed    => "amd64_op_mode_t op_mode = AMD64_OP_NONE;\n"
 	           ."x86_insn_size_t size    = X86_SIZE_64;\n",
 	emit     => "ret",
+	encode   => "amd64_enc_simple(0xC3)",
 },
 
-bsf => { template => $unop_out },
+bsf => {
+	template => $unop_out,
+	encode   => "amd64_enc_unop_out(node, 0x0FBC)",
+},
 
-bsr => { template => $unop_out },
+bsr => {
+	template => $unop_out,
+	encode   => "amd64_enc_unop_out(node, 0x0FBD)",
+},
 
 # SSE
 
-adds => { template => $binopx_commutative },
+adds => {
+	template => $binopx_commutative,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_SCALAR, 0x0F58)",
+},
 
 divs => {
 	template => $binopx,
 	emit     => "divs%MX %AM",
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_SCALAR, 0x0F5E)",
 },
 
 movs_xmm => {
 	template => $movopx,
 	attr     => "x86_insn_size_t size, amd64_op_mode_t op_mode, x86_addr_t addr",
 	emit     => "movs%MX %AM, %D0",
+	encode   => "amd64_enc_xmm_unop(node, AMD64_XMM_SCALAR, 0x0F10)",
 },
 
-muls => { template => $binopx_commutative },
+muls => {
+	template => $binopx_commutative,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_SCALAR, 0x0F59)",
+},
 
 movs_store_xmm => {
 	op_flags  => [ "uses_memory" ],
@@ -602,11 +664,13 @@ movs_store_xmm => {
 	attr_type => "amd64_binop_addr_attr_t",
 	attr      => "const amd64_binop_addr_attr_t *attr_init",
 	emit      => "movs%MX %^S0, %A",
+	encode    => "amd64_enc_xmm_store(node, AMD64_XMM_SCALAR, 0x0F11)",
 },
 
 subs => {
 	template => $binopx,
 	emit     => "subs%MX %AM",
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_SCALAR, 0x0F5C)",
 },
 
 ucomis => {
@@ -618,6 +682,7 @@ ucomis => {
 	attr_type => "amd64_binop_addr_attr_t",
 	attr      => "const amd64_binop_addr_attr_t *attr_init",
 	emit      => "ucomis%MX %AM",
+	encode    => "amd64_enc_xmm_binop(node, AMD64_XMM_PACKED, 0x0F2E)",
 },
 
 xorp_0 => {
@@ -630,7 +695,10 @@ xorp_0 => {
 	emit      => "xorp%MX %^D0, %^D0",
 },
 
-xorp => { template => $binopx_commutative },
+xorp => {
+	template => $binopx_commutative,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_PACKED, 0x0F57)",
+},
 
 movd_xmm_gp => {
 	state     => "exc_pinned",
@@ -651,7 +719,8 @@ movd_gp_xmm => {
 	out_reqs  => [ "xmm" ],
 	attr_type => "amd64_addr_attr_t",
 	attr      => "x86_insn_size_t size, amd64_op_mode_t op_mode, x86_addr_t addr",
-	emit      => "movd %S0, %D0"
+	emit      => "movd %S0, %D0",
+	encode    => "amd64_enc_xmm_cvt(node, AMD64_XMM_66, 0x0F6E)",
 },
 
 pxor_0 => {
@@ -666,21 +735,37 @@ pxor_0 => {
 
 # Conversion operations
 
-cvtss2sd => { template => $cvtop2x },
+cvtss2sd => {
+	template => $cvtop2x,
+	encode   => "amd64_enc_xmm_unop(node, AMD64_XMM_F3, 0x0F5A)",
+},
 
 cvtsd2ss => {
 	template => $cvtop2x,
 	attr     => "amd64_op_mode_t op_mode, x86_addr_t addr",
 	fixed    => "x86_insn_size_t size = X86_SIZE_64;\n",
+	encode   => "amd64_enc_xmm_unop(node, AMD64_XMM_F2, 0x0F5A)",
 },
 
-cvttsd2si => { template => $cvtopx2i },
+cvttsd2si => {
+	template => $cvtopx2i,
+	encode   => "amd64_enc_xmm_cvt(node, AMD64_XMM_F2, 0x0F2C)",
+},
 
-cvttss2si => { template => $cvtopx2i },
+cvttss2si => {
+	template => $cvtopx2i,
+	encode   => "amd64_enc_xmm_cvt(node, AMD64_XMM_F3, 0x0F2C)",
+},
 
-cvtsi2ss => { template => $cvtop2x },
+cvtsi2ss => {
+	template => $cvtop2x,
+	encode   => "amd64_enc_xmm_cvt(node, AMD64_XMM_F3, 0x0F2A)",
+},
 
-cvtsi2sd => { template => $cvtop2x },
+cvtsi2sd => {
+	template => $cvtop2x,
+	encode   => "amd64_enc_xmm_cvt(node, AMD64_XMM_F2, 0x0F2A)",
+},
 
 movd => {
 	template => $movopx,
@@ -690,11 +775,13 @@ movd => {
 movdqa => {
 	template => $movopx,
 	fixed    => "x86_insn_size_t size = X86_SIZE_128;\n",
+	encode   => "amd64_enc_xmm_unop(node, AMD64_XMM_66, 0x0F6F)",
 },
 
 movdqu => {
 	template => $movopx,
 	fixed    => "x86_insn_size_t size = X86_SIZE_128;\n",
+	encode   => "amd64_enc_xmm_unop(node, AMD64_XMM_F3, 0x0F6F)",
 },
 
 movdqu_store => {
@@ -706,6 +793,7 @@ movdqu_store => {
 	attr_type => "amd64_binop_addr_attr_t",
 	attr      => "const amd64_binop_addr_attr_t *attr_init",
 	emit      => "movdqu %^S0, %A",
+	encode    => "amd64_enc_xmm_store(node, AMD64_XMM_F3, 0x0F7F)",
 },
 
 copyB => {
@@ -752,15 +840,78 @@ l_haddpd => {
 	mode      => $mode_xmm,
 },
 
-punpckldq => { template => $binopx },
+punpckldq => {
+	template => $binopx,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_66, 0x0F62)",
+},
+
+subpd => {
+	template => $binopx,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_66, 0x0F5C)",
+},
+
+haddpd => {
+	template => $binopx,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_66, 0x0F7C)",
+},
+
+# Packed SSE2 operations on vector modes
+
+addp => {
+	template => $binopx_commutative,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_PACKED, 0x0F58)",
+},
+
+subp => {
+	template => $binopx,
+	emit     => "subp%MX %AM",
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_PACKED, 0x0F5C)",
+},
+
+mulp => {
+	template => $binopx_commutative,
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_PACKED, 0x0F59)",
+},
+
+padd => {
+	template => $binopx_commutative,
+	emit     => "padd%MP %AM",
+	encode   => "amd64_enc_xmm_int_binop(node, 0xFC, 0xFD, 0xFE, 0xD4)",
+},
 
-subpd => { template => $binopx },
+psub => {
+	template => $binopx,
+	emit     => "psub%MP %AM",
+	encode   => "amd64_enc_xmm_int_binop(node, 0xF8, 0xF9, 0xFA, 0xFB)",
+},
 
-haddpd => { template => $binopx },
+pand => {
+	template => $binopx_commutative,
+	emit     => "pand %AM",
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_66, 0x0FDB)",
+},
 
-fldz => { template => $x87const },
+por => {
+	template => $binopx_commutative,
+	emit     => "por %AM",
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_66, 0x0FEB)",
+},
 
-fld1 => { template => $x87const },
+pxor => {
+	template => $binopx_commutative,
+	emit     => "pxor %AM",
+	encode   => "amd64_enc_xmm_binop(node, AMD64_XMM_66, 0x0FEF)",
+},
+
+fldz => {
+	template => $x87const,
+	encode   => "amd64_enc_simple(0xD9EE)",
+},
+
+fld1 => {
+	template => $x87const,
+	encode   => "amd64_enc_simple(0xD9E8)",
+},
 
 fld => {
 	irn_flags => [ "rematerializable" ],
@@ -804,24 +955,31 @@ fstp => {
 fadd => {
 	template => $x87binop,
 	emit     => "fadd%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 0, 0)",
 },
 
 fdiv => {
 	template => $x87binop,
 	emit     => "fdiv%FR%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 6, 7)",
 },
 
 fmul => {
 	template => $x87binop,
 	emit     => "fmul%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 1, 1)",
 },
 
 fsub => {
 	template => $x87binop,
 	emit     => "fsub%FR%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 4, 5)",
 },
 
-fchs => { template => $x87unop },
+fchs => {
+	template => $x87unop,
+	encode   => "amd64_enc_simple(0xD9E0)",
+},
 
 fucomi => {
 	irn_flags => [ "rematerializable" ],
@@ -842,6 +1000,7 @@ fdup => {
 	attr        => "const arch_register_t *reg",
 	init        => "attr->x87.reg = reg;",
 	emit        => "fld %F0",
+	encode      => "amd64_enc_fop_reg(node, 0xD9, 0xC0)",
 },
 
 fxch => {
@@ -852,6 +1011,7 @@ fxch => {
 	attr        => "const arch_register_t *reg",
 	init        => "attr->x87.reg = reg;",
 	emit        => "fxch %F0",
+	encode      => "amd64_enc_fop_reg(node, 0xD9, 0xC8)",
 },
 
 fpop => {
@@ -862,12 +1022,22 @@ fpop => {
 	attr        => "const arch_register_t *reg",
 	init        => "attr->x87.reg = reg;",
 	emit        => "fstp %F0",
+	encode      => "amd64_enc_fop_reg(node, 0xDD, 0xD8)",
 },
 
 # FMA instructions
 
-vfmadd132s => { template => $fmaop },
-vfmadd213s => { template => $fmaop },
-vfmadd231s => { template => $fmaop },
+vfmadd132s => {
+	template => $fmaop,
+	encode   => "amd64_enc_fma(node, 0x99)",
+},
+vfmadd213s => {
+	template => $fmaop,
+	encode   => "amd64_enc_fma(node, 0xA9)",
+},
+vfmadd231s => {
+	template => $fmaop,
+	encode   => "amd64_enc_fma(node, 0xB9)",
+},
 
 );
@@ -361,13 +361,16 @@ ir_entity *create_float_const_entity(ir_tarval *const tv)
 	return entity;
 }
 
-void init_lconst_addr(x86_addr_t *addr, ir_entity *entity)
+void init_lconst_addr(x86_addr_t *addr, ir_graph const *irg, ir_entity *entity)
 {
 	assert(entity_has_definition(entity));
 	assert(get_entity_linkage(entity) & IR_LINKAGE_CONSTANT);
 	assert(get_entity_visibility(entity) == ir_visibility_private);
-	x86_immediate_kind_t kind = ir_platform.pic_style != BE_PIC_NONE
-	                          ? X86_IMM_PCREL : X86_IMM_ADDR;
+	/* JIT code is not loaded into the lower 2GiB, but keeps its constants
+	 * next to the code */
+	x86_immediate_kind_t kind
+		= ir_platform.pic_style != BE_PIC_NONE || amd64_get_irg_data(irg)->jit
+		? X86_IMM_PCREL : X86_IMM_ADDR;
 	*addr = (x86_addr_t) {
 		.immediate = {
 			.entity = entity,
@@ -387,7 +390,7 @@ static ir_node *create_float_const(dbg_info *dbgi, ir_node *block,
 
 	ir_node *in[] = { nomem };
 	x86_addr_t addr;
-	init_lconst_addr(&addr, entity);
+	init_lconst_addr(&addr, irg, entity);
 
 	ir_node *load;
 	unsigned pn_res;
@@ -441,7 +444,7 @@ static ir_node *gen_x87_Const(dbg_info *const dbgi, ir_node *const block, ir_tar
 		ir_node   *nomem  = get_irg_no_mem(irg);
 		ir_node   *in[1]  = { nomem };
 		x86_addr_t addr;
-		init_lconst_addr(&addr, entity);
+		init_lconst_addr(&addr, irg, entity);
 		x86_insn_size_t size = x86_size_from_mode(mode);
 		ir_node *load = new_bd_amd64_fld(dbgi, block, ARRAY_SIZE(in), in,
 		                                 mem_reqs, size, AMD64_OP_ADDR, addr);
@@ -936,6 +939,34 @@ static ir_node *gen_binop_xmm(ir_node *node, ir_node *op0, ir_node *op1,
 	return be_new_Proj(new_node, pn_amd64_subs_res);
 }
 
+/**
+ * Creates a packed SSE operation on two vector mode values. The lane size
+ * selects the instruction variant. Memory operands are not matched, as the
+ * legacy SSE encodings require them to be 16 byte aligned.
+ */
+static ir_node *gen_binop_vector(ir_node *const node, ir_node *const op0,
+                                 ir_node *const op1,
+                                 construct_binop_func const make_node)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	amd64_binop_addr_attr_t attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.base.base.size       = x86_size_from_mode(get_mode_vector_element(mode));
+	attr.base.base.op_mode    = AMD64_OP_REG_REG;
+	attr.base.addr.variant    = X86_ADDR_REG;
+	attr.base.addr.base_input = 0;
+	attr.u.reg_input          = 1;
+
+	ir_node *const in[] = { be_transform_node(op0), be_transform_node(op1) };
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_node  *const new_node  = make_node(dbgi, new_block, ARRAY_SIZE(in), in,
+	                                      amd64_xmm_xmm_reqs, &attr);
+	arch_set_irn_register_req_out(new_node, 0, &amd64_requirement_xmm_same_0);
+	return be_new_Proj(new_node, pn_amd64_addp_res);
+}
+
 typedef ir_node *(*construct_x87_binop_func)(
 		dbg_info *dbgi, ir_node *block, ir_node *op0, ir_node *op1);
 
@@ -1128,7 +1159,11 @@ static ir_node *gen_Add(ir_node *const node)
 	ir_mode *const mode  = get_irn_mode(node);
 	ir_node *const block = get_nodes_block(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		bool const is_float = mode_is_float(get_mode_vector_element(mode));
+		return gen_binop_vector(node, op1, op2,
+		                        is_float ? new_bd_amd64_addp : new_bd_amd64_padd);
+	} else if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fadd);
 		ir_node *const fma = gen_fma(node, op1, op2);
@@ -1171,7 +1206,11 @@ static ir_node *gen_Sub(ir_node *const node)
 	ir_node *const op2  = get_Sub_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		bool const is_float = mode_is_float(get_mode_vector_element(mode));
+		return gen_binop_vector(node, op1, op2,
+		                        is_float ? new_bd_amd64_subp : new_bd_amd64_psub);
+	} else if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fsub);
 		return gen_binop_am(node, op1, op2, new_bd_amd64_subs,
@@ -1194,6 +1233,8 @@ static ir_node *gen_And(ir_node *const node)
 {
 	ir_node *const op1 = get_And_left(node);
 	ir_node *const op2 = get_And_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_binop_vector(node, op1, op2, new_bd_amd64_pand);
 
 	/* Is it a zero extension? */
 	if (is_Const(op2)) {
@@ -1224,6 +1265,8 @@ static ir_node *gen_Eor(ir_node *const node)
 {
 	ir_node *const op1 = get_Eor_left(node);
 	ir_node *const op2 = get_Eor_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_binop_vector(node, op1, op2, new_bd_amd64_pxor);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_xor, pn_amd64_xor_res,
 	                    match_immediate | match_am | match_mode_neutral
 	                    | match_commutative);
@@ -1233,6 +1276,8 @@ static ir_node *gen_Or(ir_node *const node)
 {
 	ir_node *const op1 = get_Or_left(node);
 	ir_node *const op2 = get_Or_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_binop_vector(node, op1, op2, new_bd_amd64_por);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_or, pn_amd64_or_res,
 	                    match_immediate | match_am | match_mode_neutral
 	                    | match_commutative);
@@ -1244,7 +1289,11 @@ static ir_node *gen_Mul(ir_node *const node)
 	ir_node *const op2  = get_Mul_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
-	if (get_mode_size_bits(mode) < 16) {
+	if (mode_is_vector(mode)) {
+		if (!mode_is_float(get_mode_vector_element(mode)))
+			panic("packed integer multiplication not supported for %+F", node);
+		return gen_binop_vector(node, op1, op2, new_bd_amd64_mulp);
+	} else if (get_mode_size_bits(mode) < 16) {
 		/* imulb only supports rax - reg form */
 		ir_node *new_node
 			= gen_binop_rax(node, op1, op2, new_bd_amd64_imul_1op,
@@ -1709,7 +1758,9 @@ static ir_node *gen_Switch(ir_node *const node)
 	int arity = 0;
 	ir_node *in[1];
 	x86_addr_t addr;
-	if (ir_platform.pic_style != BE_PIC_NONE) {
+	/* JIT code may be far away from every absolute address a table could
+	 * hold, so it uses the relative table of PIC code */
+	if (ir_platform.pic_style != BE_PIC_NONE || amd64_get_irg_data(irg)->jit) {
 		ir_node *const base
 			= create_picaddr_lea(dbgi, new_block, X86_IMM_PCREL, entity);
 		ir_node *load_in[3];
@@ -1886,7 +1937,10 @@ static ir_node *make_store_for_mode(ir_mode *const mode, dbg_info *const dbgi, i
 {
 	construct_binop_func               cons;
 	arch_register_req_t const **const *reqs;
-	if (!mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		cons = &new_bd_amd64_movdqu_store;
+		reqs = xmm_am_reqs;
+	} else if (!mode_is_float(mode)) {
 		cons = &new_bd_amd64_mov_store;
 		reqs = gp_am_reqs;
 	} else if (mode == x86_mode_E) {
@@ -2290,6 +2344,8 @@ static ir_node *gen_Phi(ir_node *const node)
 		req = mode == x86_mode_E
 		    ? &amd64_class_reg_req_x87
 		    : &amd64_class_reg_req_xmm;
+	} else if (mode_is_vector(mode)) {
+		req = &amd64_class_reg_req_xmm;
 	} else {
 		req = arch_memory_req;
 	}
@@ -2880,6 +2936,12 @@ static ir_node *gen_Load(ir_node *const node)
 	in[arity++]      = new_mem;
 	assert((size_t)arity <= ARRAY_SIZE(in));
 
+	if (mode_is_vector(mode)) {
+		ir_node *const new_load = new_bd_amd64_movdqu(dbgi, block, arity, in, reqs, AMD64_OP_ADDR, addr);
+		set_irn_pinned(new_load, get_irn_pinned(node));
+		return new_load;
+	}
+
 	create_mov_func   const cons      =
 		mode_is_float(mode)                                   ?
 			(mode == x86_mode_E ? new_bd_amd64_fld : &new_bd_amd64_movs_xmm) :
@@ -2896,7 +2958,7 @@ static ir_node *gen_Unknown(ir_node *const node)
 {
 	ir_node *const block = be_transform_nodes_block(node);
 	ir_mode *const mode  = get_irn_mode(node);
-	if (mode_is_float(mode)) {
+	if (mode_is_float(mode) || mode_is_vector(mode)) {
 		return be_new_Unknown(block, &amd64_class_reg_req_xmm);
 	} else if (be_mode_needs_gp_reg(mode)) {
 		return be_new_Unknown(block, &amd64_class_reg_req_gp);
@@ -2953,6 +3015,13 @@ static ir_node *gen_Proj_Load(ir_node *const node)
 			return be_new_Proj(new_load, pn_amd64_fld_M);
 		}
 		break;
+	case iro_amd64_movdqu:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_M);
+		}
+		break;
 	case iro_amd64_add:
 	case iro_amd64_and:
 	case iro_amd64_cmp:
@@ -42,7 +42,7 @@ ir_node *amd64_new_IncSP(ir_node *block, ir_node *old_sp, int offset,
  */
 ir_entity *create_float_const_entity(ir_tarval *const tv);
 
-void init_lconst_addr(x86_addr_t *addr, ir_entity *entity);
+void init_lconst_addr(x86_addr_t *addr, ir_graph const *irg, ir_entity *entity);
 
 /** Creates a tarval with the given mode and only
   * the most-significant (first) bit set.
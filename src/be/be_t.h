@@ -41,6 +41,10 @@ struct be_options_t {
 	bool do_verify;            /**< backend verify option */
 	char ilp_solver[128];      /**< the ilp solver name */
 	bool verbose_asm;          /**< dump verbose assembler */
+	bool opt_split_cold;       /**< separate never executed code */
+	bool elf_object;           /**< write an object file, not assembler */
+	char cache_dir[256];       /**< directory of the code cache */
+	int  cache_size;           /**< size limit of the code cache in MiB */
 };
 extern be_options_t be_options;
 
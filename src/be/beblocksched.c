@@ -18,6 +18,12 @@
  * to change as many edges to fallthroughs as possible, this is done by setting
  * a next and prev pointers on blocks. The greedy algorithm sorts the edges by
  * execution frequencies and tries to transform them to fallthroughs in this order
+ *
+ * When profile data provides measured edge counts the layout is computed with
+ * the Ext-TSP model instead: Chains of blocks are merged greedily as long as
+ * this increases a score which rewards fallthroughs and, to a lesser degree,
+ * short jumps. Blocks which were never executed are moved behind all other
+ * blocks, so the emitter can place them into a separate section.
  */
 #include "beblocksched.h"
 
@@ -26,7 +32,7 @@
 #include "bemodule.h"
 #include "besched.h"
 #include "debug.h"
-#include "execfreq.h"
+#include "execfreq_t.h"
 #include "iredges_t.h"
 #include "irgmod.h"
 #include "irgwalk.h"
@@ -138,10 +144,15 @@ static void remove_empty_blocks(ir_graph *irg)
 }
 
 typedef struct blocksched_entry_t blocksched_entry_t;
+typedef struct layout_chain_t layout_chain_t;
+
 struct blocksched_entry_t {
 	ir_node            *block;
 	blocksched_entry_t *next;
 	blocksched_entry_t *prev;
+	layout_chain_t     *chain;  /**< chain containing the block (Ext-TSP) */
+	unsigned            offset; /**< offset of the block in its chain */
+	unsigned            size;   /**< estimated code size of the block */
 };
 
 typedef struct edge_t edge_t;
@@ -164,6 +175,8 @@ struct blocksched_env_t {
 	edge_t         *edges;
 	deq_t           worklist;
 	unsigned        blockcount;
+	blocksched_entry_t **entries;
+	bool            has_profile; /**< edge counts from a profile are known */
 };
 
 static blocksched_entry_t* get_blocksched_entry(const ir_node *block)
@@ -189,6 +202,7 @@ static void collect_egde_frequency(ir_node *block, void *data)
 	blocksched_entry_t *entry = OALLOCZ(&env->obst, blocksched_entry_t);
 	entry->block = block;
 	set_irn_link(block, entry);
+	ARR_APP1(blocksched_entry_t*, env->entries, entry);
 
 	int arity = get_Block_n_cfgpreds(block);
 	if (arity == 0) {
@@ -209,6 +223,9 @@ static void collect_egde_frequency(ir_node *block, void *data)
 			edge.outedge_penalty_freq = -(pred_freq - freq);
 		}
 
+		if (get_block_cfgpred_execfreq(block, 0) >= 0)
+			env->has_profile = true;
+
 		edge.block            = block;
 		edge.pos              = 0;
 		edge.execfreq         = freq;
@@ -221,7 +238,11 @@ static void collect_egde_frequency(ir_node *block, void *data)
 		edge.block = block;
 		for (int i = 0; i < arity; ++i) {
 			ir_node *const pred_block = get_Block_cfgpred_block(block, i);
-			double   const execfreq   = get_block_execfreq(pred_block);
+			double         execfreq   = get_block_cfgpred_execfreq(block, i);
+			if (execfreq < 0)
+				execfreq = get_block_execfreq(pred_block);
+			else
+				env->has_profile = true;
 
 			edge.pos              = i;
 			edge.execfreq         = execfreq;
@@ -466,7 +487,10 @@ static void pick_block_successor(blocksched_entry_t *entry, blocksched_env_t *en
 		if (succ_entry->prev != NULL)
 			continue;
 
-		double execfreq = get_block_execfreq(succ_block);
+		/* prefer the most frequently taken edge if it is known */
+		double execfreq = get_block_cfgpred_execfreq(succ_block, get_edge_src_pos(edge));
+		if (execfreq < 0)
+			execfreq = get_block_execfreq(succ_block);
 		if (best_succ_execfreq < execfreq) {
 			best_succ_execfreq = execfreq;
 			succ               = succ_block;
@@ -513,12 +537,383 @@ static blocksched_entry_t *finish_block_schedule(blocksched_env_t *env)
 	return entry;
 }
 
-static ir_node **create_blocksched_array(blocksched_env_t *const env)
+bool be_is_cold_block(ir_node const *const block)
+{
+	int const n_cfgpreds = get_Block_n_cfgpreds(block);
+	if (n_cfgpreds == 0)
+		return false;
+	for (int i = 0; i < n_cfgpreds; ++i) {
+		/* unknown edge frequencies are not cold */
+		if (get_block_cfgpred_execfreq(block, i) != 0.0)
+			return false;
+		/* the block must directly follow its predecessor */
+		if (is_x_regular_Proj(get_Block_cfgpred(block, i)))
+			return false;
+	}
+	return true;
+}
+
+/** Estimated code size of a single instruction. */
+static const unsigned LAYOUT_INSN_SIZE = 4;
+/** Score of a fallthrough edge. */
+static const double   FALLTHROUGH_WEIGHT = 1.0;
+/** Score of a forward jump with distance 0. */
+static const double   FORWARD_WEIGHT = 0.1;
+/** Forward jumps above this distance do not score. */
+static const unsigned FORWARD_DISTANCE = 1024;
+/** Score of a backward jump with distance 0. */
+static const double   BACKWARD_WEIGHT = 0.1;
+/** Backward jumps above this distance do not score. */
+static const unsigned BACKWARD_DISTANCE = 640;
+
+typedef struct layout_edge_t {
+	blocksched_entry_t *src;
+	blocksched_entry_t *dst;
+	double              execfreq;
+} layout_edge_t;
+
+typedef struct chain_pair_t chain_pair_t;
+
+struct layout_chain_t {
+	blocksched_entry_t **blocks; /**< blocks in layout order */
+	chain_pair_t       **pairs;  /**< pairs with the chains connected to this */
+	unsigned             size;   /**< estimated code size */
+	double               weight; /**< sum of execfreq * size of the blocks */
+	bool                 cold;   /**< starts with a never executed block */
+};
+
+/** Chains connected by at least one edge, candidates for merging. */
+struct chain_pair_t {
+	layout_chain_t  *a;
+	layout_chain_t  *b;
+	layout_edge_t  **edges;   /**< edges between the two chains */
+	double           gain;    /**< best score improvement by merging */
+	bool             b_first; /**< gain is achieved by placing b before a */
+	bool             dead;
+};
+
+static double edge_score(layout_edge_t const *const edge,
+                         unsigned const src_pos, unsigned const dst_pos)
+{
+	unsigned const src_end = src_pos + edge->src->size;
+	if (src_end == dst_pos)
+		return edge->execfreq * FALLTHROUGH_WEIGHT;
+	if (src_end < dst_pos) {
+		unsigned const dist = dst_pos - src_end;
+		if (dist <= FORWARD_DISTANCE)
+			return edge->execfreq * FORWARD_WEIGHT * (1.0 - (double)dist / FORWARD_DISTANCE);
+	} else {
+		unsigned const dist = src_end - dst_pos;
+		if (dist <= BACKWARD_DISTANCE)
+			return edge->execfreq * BACKWARD_WEIGHT * (1.0 - (double)dist / BACKWARD_DISTANCE);
+	}
+	return 0.0;
+}
+
+/** Score of the edges between first and second when placing them in this
+ * order. */
+static double concat_score(chain_pair_t const *const pair,
+                           layout_chain_t const *const first)
+{
+	double score = 0.0;
+	for (size_t i = 0, n = ARR_LEN(pair->edges); i < n; ++i) {
+		layout_edge_t const *const edge = pair->edges[i];
+		unsigned src_pos = edge->src->offset;
+		if (edge->src->chain != first)
+			src_pos += first->size;
+		unsigned dst_pos = edge->dst->offset;
+		if (edge->dst->chain != first)
+			dst_pos += first->size;
+		score += edge_score(edge, src_pos, dst_pos);
+	}
+	return score;
+}
+
+static void update_gain(chain_pair_t *const pair, layout_chain_t const *const start_chain)
+{
+	/* nothing may be placed before the start block */
+	double const gain_ab = pair->b == start_chain ? -1.0 : concat_score(pair, pair->a);
+	double const gain_ba = pair->a == start_chain ? -1.0 : concat_score(pair, pair->b);
+	pair->b_first = gain_ba > gain_ab;
+	pair->gain    = pair->b_first ? gain_ba : gain_ab;
+}
+
+static chain_pair_t *find_pair(layout_chain_t const *const chain,
+                               layout_chain_t const *const other)
+{
+	for (size_t i = 0, n = ARR_LEN(chain->pairs); i < n; ++i) {
+		chain_pair_t *const pair = chain->pairs[i];
+		if (pair->a == other || pair->b == other)
+			return pair;
+	}
+	return NULL;
+}
+
+static void remove_pair(layout_chain_t *const chain, chain_pair_t const *const pair)
+{
+	for (size_t i = 0, n = ARR_LEN(chain->pairs); i < n; ++i) {
+		if (chain->pairs[i] == pair) {
+			chain->pairs[i] = chain->pairs[n - 1];
+			ARR_SHRINKLEN(chain->pairs, n - 1);
+			return;
+		}
+	}
+	panic("chain pair not found");
+}
+
+static void add_layout_edge(blocksched_env_t *const env, layout_edge_t *const edge,
+                            chain_pair_t ***const all_pairs)
+{
+	layout_chain_t *const a = edge->src->chain;
+	layout_chain_t *const b = edge->dst->chain;
+	/* edges inside a chain do not change when merging */
+	if (a == b)
+		return;
+
+	chain_pair_t *pair = find_pair(a, b);
+	if (pair == NULL) {
+		pair        = OALLOCZ(&env->obst, chain_pair_t);
+		pair->a     = a;
+		pair->b     = b;
+		pair->edges = NEW_ARR_F(layout_edge_t*, 0);
+		ARR_APP1(chain_pair_t*, a->pairs, pair);
+		ARR_APP1(chain_pair_t*, b->pairs, pair);
+		ARR_APP1(chain_pair_t*, *all_pairs, pair);
+	}
+	ARR_APP1(layout_edge_t*, pair->edges, edge);
+}
+
+static void append_chain_blocks(layout_chain_t *const first,
+                                layout_chain_t *const second)
+{
+	for (size_t i = 0, n = ARR_LEN(second->blocks); i < n; ++i) {
+		blocksched_entry_t *const entry = second->blocks[i];
+		entry->chain   = first;
+		entry->offset += first->size;
+		ARR_APP1(blocksched_entry_t*, first->blocks, entry);
+	}
+	first->size   += second->size;
+	first->weight += second->weight;
+	DEL_ARR_F(second->blocks);
+	second->blocks = NULL;
+}
+
+/** Appends the blocks of @p second to @p first and moves the pairs of
+ * @p second over to @p first. */
+static void merge_chains(layout_chain_t *const first, layout_chain_t *const second,
+                         chain_pair_t *const pair, layout_chain_t const *const start_chain)
+{
+	DB((dbg, LEVEL_2, "Merge chains %+F.. and %+F.. (gain %.3g)\n",
+	    first->blocks[0]->block, second->blocks[0]->block, pair->gain));
+
+	append_chain_blocks(first, second);
+
+	pair->dead = true;
+	remove_pair(first, pair);
+	for (size_t i = 0, n = ARR_LEN(second->pairs); i < n; ++i) {
+		chain_pair_t *const other_pair = second->pairs[i];
+		if (other_pair == pair)
+			continue;
+		layout_chain_t *const other    = other_pair->a == second ? other_pair->b : other_pair->a;
+		chain_pair_t   *const existing = find_pair(first, other);
+		if (existing != NULL) {
+			for (size_t e = 0, n_edges = ARR_LEN(other_pair->edges); e < n_edges; ++e)
+				ARR_APP1(layout_edge_t*, existing->edges, other_pair->edges[e]);
+			other_pair->dead = true;
+			remove_pair(other, other_pair);
+		} else {
+			if (other_pair->a == second)
+				other_pair->a = first;
+			else
+				other_pair->b = first;
+			ARR_APP1(chain_pair_t*, first->pairs, other_pair);
+		}
+	}
+	DEL_ARR_F(second->pairs);
+	second->pairs = NULL;
+
+	/* the offsets of the second part changed */
+	for (size_t i = 0, n = ARR_LEN(first->pairs); i < n; ++i)
+		update_gain(first->pairs[i], start_chain);
+}
+
+static unsigned estimate_block_size(ir_node *const block)
+{
+	unsigned n_insns = 0;
+	sched_foreach_non_phi(block, node) {
+		++n_insns;
+	}
+	return MAX(n_insns, 1) * LAYOUT_INSN_SIZE;
+}
+
+static int cmp_chain_density(const void *d1, const void *d2)
+{
+	layout_chain_t const *const c1 = *(layout_chain_t const**)d1;
+	layout_chain_t const *const c2 = *(layout_chain_t const**)d2;
+	double const density1 = c1->weight / c1->size;
+	double const density2 = c2->weight / c2->size;
+	if (density1 != density2)
+		return density1 < density2 ? 1 : -1;
+	long const nr1 = get_irn_node_nr(c1->blocks[0]->block);
+	long const nr2 = get_irn_node_nr(c2->blocks[0]->block);
+	return (nr1 > nr2) - (nr1 < nr2);
+}
+
+/**
+ * Computes the block order with the Ext-TSP model: Start with a chain per
+ * block and repeatedly merge the two chains whose concatenation improves the
+ * score the most. The remaining chains are ordered by decreasing density,
+ * never executed blocks come last.
+ */
+static blocksched_entry_t *layout_ext_tsp(blocksched_env_t *const env)
+{
+	ir_graph           *const irg         = env->irg;
+	blocksched_entry_t *const start_entry = get_blocksched_entry(get_irg_start_block(irg));
+
+	layout_chain_t **chains = NEW_ARR_F(layout_chain_t*, 0);
+	for (size_t i = 0, n = ARR_LEN(env->entries); i < n; ++i) {
+		blocksched_entry_t *const entry = env->entries[i];
+		ir_node            *const block = entry->block;
+		/* skip blocks removed by remove_empty_blocks() */
+		if (get_Block_n_cfgpreds(block) == 1 && is_Bad(get_Block_cfgpred(block, 0)))
+			continue;
+
+		layout_chain_t *const chain = OALLOCZ(&env->obst, layout_chain_t);
+		entry->chain  = chain;
+		entry->offset = 0;
+		entry->size   = estimate_block_size(block);
+		chain->blocks = NEW_ARR_F(blocksched_entry_t*, 1);
+		chain->blocks[0] = entry;
+		chain->pairs  = NEW_ARR_F(chain_pair_t*, 0);
+		chain->size   = entry->size;
+		chain->weight = get_block_execfreq(block) * entry->size;
+		chain->cold   = be_is_cold_block(block);
+		ARR_APP1(layout_chain_t*, chains, chain);
+	}
+	layout_chain_t *const start_chain = start_entry->chain;
+
+	/* a block reached by a regular exception edge must directly follow its
+	 * predecessor */
+	for (size_t i = 0, n = ARR_LEN(chains); i < n; ++i) {
+		ir_node *const block = chains[i]->blocks == NULL ? NULL : chains[i]->blocks[0]->block;
+		if (block == NULL || get_Block_n_cfgpreds(block) != 1)
+			continue;
+		ir_node *const cfgpred = get_Block_cfgpred(block, 0);
+		if (!is_x_regular_Proj(cfgpred))
+			continue;
+		blocksched_entry_t *const pred_entry = get_blocksched_entry(get_nodes_block(cfgpred));
+		if (pred_entry->chain != chains[i])
+			append_chain_blocks(pred_entry->chain, chains[i]);
+	}
+
+	/* collect edges between hot blocks */
+	size_t n_edges = 0;
+	for (size_t i = 0, n = ARR_LEN(env->entries); i < n; ++i) {
+		n_edges += get_Block_n_cfgpreds(env->entries[i]->block);
+	}
+	layout_edge_t  *const edges     = OALLOCN(&env->obst, layout_edge_t, n_edges);
+	chain_pair_t  **      all_pairs = NEW_ARR_F(chain_pair_t*, 0);
+	size_t                e         = 0;
+	for (size_t i = 0, n = ARR_LEN(env->entries); i < n; ++i) {
+		blocksched_entry_t *const entry = env->entries[i];
+		if (entry->chain == NULL || entry->chain->cold)
+			continue;
+		ir_node *const block = entry->block;
+		for (int p = 0, arity = get_Block_n_cfgpreds(block); p < arity; ++p) {
+			ir_node *const pred_block = get_Block_cfgpred_block(block, p);
+			if (pred_block == NULL || pred_block == block)
+				continue;
+			blocksched_entry_t *const pred_entry = get_blocksched_entry(pred_block);
+			if (pred_entry->chain->cold)
+				continue;
+			/* an edge is not taken more often than its blocks are executed */
+			double execfreq = get_block_cfgpred_execfreq(block, p);
+			if (execfreq < 0)
+				execfreq = MIN(get_block_execfreq(pred_block), get_block_execfreq(block));
+			if (execfreq <= 0)
+				continue;
+
+			layout_edge_t *const edge = &edges[e++];
+			edge->src      = pred_entry;
+			edge->dst      = entry;
+			edge->execfreq = execfreq;
+			add_layout_edge(env, edge, &all_pairs);
+		}
+	}
+	for (size_t i = 0, n = ARR_LEN(all_pairs); i < n; ++i)
+		update_gain(all_pairs[i], start_chain);
+
+	for (;;) {
+		chain_pair_t *best = NULL;
+		for (size_t i = 0, n = ARR_LEN(all_pairs); i < n; ++i) {
+			chain_pair_t *const pair = all_pairs[i];
+			if (!pair->dead && pair->gain > 0 && (best == NULL || pair->gain > best->gain))
+				best = pair;
+		}
+		if (best == NULL)
+			break;
+		if (best->b_first)
+			merge_chains(best->b, best->a, best, start_chain);
+		else
+			merge_chains(best->a, best->b, best, start_chain);
+	}
+
+	/* order the chains: start first, then hot chains by density, then cold
+	 * blocks */
+	layout_chain_t **hot  = NEW_ARR_F(layout_chain_t*, 0);
+	layout_chain_t **cold = NEW_ARR_F(layout_chain_t*, 0);
+	for (size_t i = 0, n = ARR_LEN(chains); i < n; ++i) {
+		layout_chain_t *const chain = chains[i];
+		if (chain->blocks == NULL || chain == start_chain)
+			continue;
+		if (chain->cold) {
+			ARR_APP1(layout_chain_t*, cold, chain);
+		} else {
+			ARR_APP1(layout_chain_t*, hot, chain);
+		}
+	}
+	QSORT_ARR(hot, cmp_chain_density);
+
+	blocksched_entry_t *prev = NULL;
+	for (size_t c = 0, n_hot = ARR_LEN(hot), n_cold = ARR_LEN(cold); c <= n_hot + n_cold; ++c) {
+		layout_chain_t *const chain
+			= c == 0     ? start_chain
+			: c <= n_hot ? hot[c - 1]
+			:              cold[c - 1 - n_hot];
+		for (size_t i = 0, n = ARR_LEN(chain->blocks); i < n; ++i) {
+			blocksched_entry_t *const entry = chain->blocks[i];
+			entry->prev = prev;
+			entry->next = NULL;
+			if (prev != NULL)
+				prev->next = entry;
+			prev = entry;
+			env->blockcount++;
+		}
+	}
+
+	for (size_t i = 0, n = ARR_LEN(all_pairs); i < n; ++i)
+		DEL_ARR_F(all_pairs[i]->edges);
+	DEL_ARR_F(all_pairs);
+	for (size_t i = 0, n = ARR_LEN(chains); i < n; ++i) {
+		layout_chain_t *const chain = chains[i];
+		if (chain->blocks != NULL)
+			DEL_ARR_F(chain->blocks);
+		if (chain->pairs != NULL)
+			DEL_ARR_F(chain->pairs);
+	}
+	DEL_ARR_F(cold);
+	DEL_ARR_F(hot);
+	DEL_ARR_F(chains);
+
+	return start_entry;
+}
+
+static ir_node **create_blocksched_array(blocksched_env_t *const env,
+                                         blocksched_entry_t const *const first)
 {
 	DB((dbg, LEVEL_1, "Blockschedule:\n"));
 
 	unsigned                  i          = 0;
-	blocksched_entry_t *const first      = finish_block_schedule(env);
 	unsigned            const count      = env->blockcount;
 	struct obstack     *const obst       = be_get_be_obst(env->irg);
 	ir_node           **const block_list = NEW_ARR_D(ir_node*, obst, count);
@@ -538,6 +933,7 @@ ir_node **be_create_block_schedule(ir_graph *irg)
 		.irg        = irg,
 		.edges      = NEW_ARR_F(edge_t, 0),
 		.blockcount = 0,
+		.entries    = NEW_ARR_F(blocksched_entry_t*, 0),
 	};
 	obstack_init(&env.obst);
 
@@ -549,11 +945,18 @@ ir_node **be_create_block_schedule(ir_graph *irg)
 
 	remove_empty_blocks(irg);
 
-	coalesce_blocks(&env);
+	blocksched_entry_t *first;
+	if (env.has_profile) {
+		first = layout_ext_tsp(&env);
+	} else {
+		coalesce_blocks(&env);
+		first = finish_block_schedule(&env);
+	}
 
-	ir_node **const block_list = create_blocksched_array(&env);
+	ir_node **const block_list = create_blocksched_array(&env, first);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 
+	DEL_ARR_F(env.entries);
 	DEL_ARR_F(env.edges);
 	obstack_free(&env.obst, NULL);
 
@@ -12,8 +12,19 @@
 #ifndef FIRM_BE_BEBLOCKSCHED_H
 #define FIRM_BE_BEBLOCKSCHED_H
 
+#include <stdbool.h>
+
 #include "firm_types.h"
 
+/**
+ * Computes the order of the blocks in the final code. With profile data the
+ * blocks which were never executed are placed at the end.
+ */
 ir_node **be_create_block_schedule(ir_graph *irg);
 
+/**
+ * Returns whether profile data shows that @p block was never executed.
+ */
+bool be_is_cold_block(ir_node const *block);
+
 #endif
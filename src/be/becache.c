@@ -0,0 +1,529 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Content-addressed cache for the assembler code of functions.
+ *
+ * Before the backend compiles a graph, the binary form of the graph is hashed
+ * together with the target, platform and backend options.  If the cache
+ * directory holds an entry for the hash, its assembler text is emitted instead
+ * of running the backend.  Otherwise the text emitted for the graph is stored
+ * as a new entry.  Hits refresh the modification time of an entry, so the
+ * least recently used entries are removed once the directory grows beyond the
+ * configured size.
+ *
+ * Block labels are numbered per compilation unit, so entries store them
+ * relative to the first label of the function.  Code referring to label
+ * entities or to entities created by the backend itself, like floating point
+ * constants and jump tables, is not cached, as their names differ between
+ * compilations.
+ */
+#include "becache.h"
+
+#include "array.h"
+#include "be_t.h"
+#include "bediagnostic.h"
+#include "bedwarf.h"
+#include "beelf.h"
+#include "beemitter.h"
+#include "begnuas.h"
+#include "irflag_t.h"
+#include "irio_t.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "lc_opts.h"
+#include "obst.h"
+#include "platform_t.h"
+#include "statev.h"
+#include "target_t.h"
+#include "util.h"
+#include "xmalloc.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#define CACHE_MAGIC     "FIRMBEC1"
+#define CACHE_MAGIC_LEN 8
+#define KEY_SIZE        16
+
+/** State of the streaming MurmurHash3 (x64, 128 bit) used for the keys. */
+typedef struct hash_state_t {
+	uint64_t      h1;
+	uint64_t      h2;
+	uint64_t      length;
+	size_t        n_tail;
+	unsigned char tail[16];
+} hash_state_t;
+
+typedef struct cache_entry_t {
+	char   name[2 * KEY_SIZE + 1];
+	time_t mtime;
+	off_t  size;
+} cache_entry_t;
+
+static bool          cache_active;
+static hash_state_t  settings_hash;    /**< hash of everything but the graph */
+static long          first_entity_nr;  /**< first entity created by the backend */
+static bool          recording;        /**< recording the current graph */
+static unsigned char current_key[KEY_SIZE];
+static unsigned      first_block_nr;
+static unsigned      n_hits;
+static unsigned      n_misses;
+static unsigned      n_uncacheable;
+static unsigned      n_stored;
+
+#define C1 UINT64_C(0x87c37b91114253d5)
+#define C2 UINT64_C(0x4cf5ad432745937f)
+
+static uint64_t rotl64(uint64_t const x, int const r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= UINT64_C(0xff51afd7ed558ccd);
+	k ^= k >> 33;
+	k *= UINT64_C(0xc4ceb9fe1a85ec53);
+	k ^= k >> 33;
+	return k;
+}
+
+static void key_init(hash_state_t *const state)
+{
+	memset(state, 0, sizeof(*state));
+}
+
+static void key_block(hash_state_t *const state, unsigned char const *const data)
+{
+	uint64_t k1 = 0;
+	uint64_t k2 = 0;
+	for (unsigned i = 8; i-- > 0;) {
+		k1 = k1 << 8 | data[i];
+		k2 = k2 << 8 | data[8 + i];
+	}
+
+	k1 *= C1; k1 = rotl64(k1, 31); k1 *= C2; state->h1 ^= k1;
+	state->h1 = rotl64(state->h1, 27);
+	state->h1 += state->h2;
+	state->h1 = state->h1 * 5 + 0x52dce729;
+
+	k2 *= C2; k2 = rotl64(k2, 33); k2 *= C1; state->h2 ^= k2;
+	state->h2 = rotl64(state->h2, 31);
+	state->h2 += state->h1;
+	state->h2 = state->h2 * 5 + 0x38495ab5;
+}
+
+static void key_data(void *const ctx, void const *const data, size_t size)
+{
+	hash_state_t        *const state = (hash_state_t*)ctx;
+	unsigned char const *bytes       = (unsigned char const*)data;
+	state->length += size;
+
+	if (state->n_tail > 0) {
+		size_t const n = MIN(size, sizeof(state->tail) - state->n_tail);
+		memcpy(state->tail + state->n_tail, bytes, n);
+		state->n_tail += n;
+		bytes         += n;
+		size          -= n;
+		if (state->n_tail < sizeof(state->tail))
+			return;
+		key_block(state, state->tail);
+		state->n_tail = 0;
+	}
+	for (; size >= sizeof(state->tail); size -= sizeof(state->tail)) {
+		key_block(state, bytes);
+		bytes += sizeof(state->tail);
+	}
+	memcpy(state->tail, bytes, size);
+	state->n_tail = size;
+}
+
+static void key_string(hash_state_t *const state, char const *const string)
+{
+	/* include the terminator, so consecutive strings stay distinguishable */
+	if (string == NULL)
+		key_data(state, "", 1);
+	else
+		key_data(state, string, strlen(string) + 1);
+}
+
+static void key_unsigned(hash_state_t *const state, unsigned const value)
+{
+	key_data(state, &value, sizeof(value));
+}
+
+static void key_finish(hash_state_t const *const state,
+                        unsigned char *const key)
+{
+	uint64_t h1 = state->h1;
+	uint64_t h2 = state->h2;
+	uint64_t k1 = 0;
+	uint64_t k2 = 0;
+	for (size_t i = state->n_tail; i-- > 0;) {
+		if (i >= 8)
+			k2 = k2 << 8 | state->tail[i];
+		else
+			k1 = k1 << 8 | state->tail[i];
+	}
+	k2 *= C2; k2 = rotl64(k2, 33); k2 *= C1; h2 ^= k2;
+	k1 *= C1; k1 = rotl64(k1, 31); k1 *= C2; h1 ^= k1;
+
+	h1 ^= state->length;
+	h2 ^= state->length;
+	h1 += h2;
+	h2 += h1;
+	h1  = fmix64(h1);
+	h2  = fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+
+	for (unsigned i = 0; i < 8; ++i) {
+		key[i]     = (unsigned char)(h1 >> (8 * i));
+		key[8 + i] = (unsigned char)(h2 >> (8 * i));
+	}
+}
+
+static void key_option(const char *name, const char *value, void *env)
+{
+	/* where the cache lives does not influence the generated code */
+	if (streq(name, "cache") || streq(name, "cachesize"))
+		return;
+	hash_state_t *const state = (hash_state_t*)env;
+	key_string(state, name);
+	key_string(state, value);
+}
+
+/** Hashes all settings besides the graph which influence the code. */
+static void hash_settings(hash_state_t *const state)
+{
+	key_init(state);
+	key_data(state, CACHE_MAGIC, CACHE_MAGIC_LEN);
+	key_unsigned(state, ir_get_version_major());
+	key_unsigned(state, ir_get_version_minor());
+	key_unsigned(state, ir_get_version_micro());
+	key_string(state, ir_get_version_revision());
+	key_string(state, ir_get_version_build());
+
+	key_string(state, ir_target.isa->name);
+	key_unsigned(state, ir_target.isa->big_endian);
+	key_string(state, ir_target.experimental);
+	ir_mode *const float_mode = ir_target.mode_float_arithmetic;
+	key_string(state, float_mode != NULL ? get_mode_name(float_mode) : NULL);
+	key_unsigned(state, ir_target.vector_size);
+	key_unsigned(state, ir_target.fast_unaligned_memaccess);
+	key_unsigned(state, ir_target.float_int_overflow);
+
+	key_unsigned(state, ir_platform.user_label_prefix);
+	key_unsigned(state, ir_platform.long_double_size);
+	key_unsigned(state, ir_platform.long_double_align);
+	key_unsigned(state, ir_platform.long_size);
+	key_unsigned(state, ir_platform.int_size);
+	key_unsigned(state, ir_platform.x87_long_double);
+	key_unsigned(state, ir_platform.long_long_and_double_struct_align);
+	key_unsigned(state, ir_platform.pic_is_default);
+	key_unsigned(state, ir_platform.is_darwin);
+	key_unsigned(state, ir_platform.supports_thread_local_storage);
+	key_unsigned(state, ir_platform.ia32_struct_in_regs);
+	key_unsigned(state, ir_platform.ia32_po2_stackalign);
+	key_unsigned(state, ir_platform.amd64_x64abi);
+	key_unsigned(state, ir_platform.object_format);
+	key_unsigned(state, ir_platform.pic_style);
+
+	key_unsigned(state, libFIRM_opt);
+	lc_opt_entry_t *const be_grp = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_walk_values(be_grp, key_option, state);
+}
+
+static void get_entry_path(char *const buf, size_t const size,
+                           unsigned char const *const key)
+{
+	int len = snprintf(buf, size, "%s/", be_options.cache_dir);
+	for (unsigned i = 0; i < KEY_SIZE; ++i)
+		len += snprintf(buf + len, size - len, "%02x", key[i]);
+}
+
+static uint32_t read_u32(unsigned char const *const data)
+{
+	return (uint32_t)data[0] | (uint32_t)data[1] << 8
+	     | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static void write_u32(FILE *const out, uint32_t const value)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		fputc((value >> (8 * i)) & 0xFF, out);
+}
+
+enum {
+	HEADER_SIZE = CACHE_MAGIC_LEN + KEY_SIZE + 4 + 4,
+};
+
+/** Emits the entry for @p key if it exists. */
+static bool emit_entry(unsigned char const *const key)
+{
+	char path[4096];
+	get_entry_path(path, sizeof(path), key);
+	FILE *const in = fopen(path, "rb");
+	if (in == NULL)
+		return false;
+
+	bool          res = false;
+	unsigned char header[HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), in) != sizeof(header)
+	 || memcmp(header, CACHE_MAGIC, CACHE_MAGIC_LEN) != 0
+	 || memcmp(header + CACHE_MAGIC_LEN, key, KEY_SIZE) != 0)
+		goto out;
+
+	uint32_t const n_blocks = read_u32(header + CACHE_MAGIC_LEN + KEY_SIZE);
+	uint32_t const size     = read_u32(header + CACHE_MAGIC_LEN + KEY_SIZE + 4);
+	char    *const text     = XMALLOCN(char, size);
+	if (fread(text, 1, size, in) != size || fgetc(in) != EOF) {
+		free(text);
+		goto out;
+	}
+
+	struct obstack obst;
+	obstack_init(&obst);
+	unsigned const base = be_gas_reserve_block_nrs(0);
+	if (be_gas_relocate_block_labels(&obst, text, size, 0, n_blocks, base)) {
+		be_gas_reserve_block_nrs(n_blocks);
+		size_t const len = obstack_object_size(&obst);
+		be_emit_string_len((char const*)obstack_finish(&obst), len);
+		be_emit_write_line();
+		/* the entry leaves an unknown section behind */
+		be_gas_forget_section();
+		/* mark the entry as recently used */
+		utime(path, NULL);
+		res = true;
+	}
+	obstack_free(&obst, NULL);
+	free(text);
+out:
+	fclose(in);
+	return res;
+}
+
+static bool write_entry(unsigned char const *const key, unsigned const n_blocks,
+                        char const *const text, size_t const size)
+{
+	char path[4096];
+	char tmp_path[4096 + 32];
+	get_entry_path(path, sizeof(path), key);
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid());
+
+	FILE *const out = fopen(tmp_path, "wb");
+	if (out == NULL)
+		return false;
+	fwrite(CACHE_MAGIC, 1, CACHE_MAGIC_LEN, out);
+	fwrite(key, 1, KEY_SIZE, out);
+	write_u32(out, n_blocks);
+	write_u32(out, (uint32_t)size);
+	fwrite(text, 1, size, out);
+	bool const ok = !ferror(out);
+	if (fclose(out) != 0 || !ok || rename(tmp_path, path) != 0) {
+		unlink(tmp_path);
+		return false;
+	}
+	return true;
+}
+
+static bool is_entry_name(char const *const name)
+{
+	size_t i = 0;
+	for (; name[i] != '\0'; ++i) {
+		if (!isxdigit((unsigned char)name[i]))
+			return false;
+	}
+	return i == 2 * KEY_SIZE;
+}
+
+static int cmp_entry_age(void const *const a, void const *const b)
+{
+	cache_entry_t const *const e0 = (cache_entry_t const*)a;
+	cache_entry_t const *const e1 = (cache_entry_t const*)b;
+	int const cmp = QSORT_CMP(e0->mtime, e1->mtime);
+	return cmp != 0 ? cmp : strcmp(e0->name, e1->name);
+}
+
+/**
+ * Removes the least recently used entries until the cache fits into its size
+ * limit.
+ *
+ * @returns the number of removed entries
+ */
+static unsigned evict_entries(void)
+{
+	DIR *const dir = opendir(be_options.cache_dir);
+	if (dir == NULL)
+		return 0;
+
+	cache_entry_t *entries = NEW_ARR_F(cache_entry_t, 0);
+	uint64_t       total   = 0;
+	char           path[4096];
+	for (struct dirent *d; (d = readdir(dir)) != NULL;) {
+		if (!is_entry_name(d->d_name))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", be_options.cache_dir, d->d_name);
+		struct stat st;
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+		cache_entry_t entry;
+		memcpy(entry.name, d->d_name, sizeof(entry.name));
+		entry.mtime = st.st_mtime;
+		entry.size  = st.st_size;
+		ARR_APP1(cache_entry_t, entries, entry);
+		total += st.st_size;
+	}
+	closedir(dir);
+
+	uint64_t const limit     = (uint64_t)MAX(be_options.cache_size, 0) << 20;
+	unsigned       n_evicted = 0;
+	if (total > limit) {
+		size_t const n_entries = ARR_LEN(entries);
+		QSORT_ARR(entries, cmp_entry_age);
+		for (size_t i = 0; i < n_entries && total > limit; ++i) {
+			snprintf(path, sizeof(path), "%s/%s", be_options.cache_dir,
+			         entries[i].name);
+			if (unlink(path) == 0) {
+				total -= entries[i].size;
+				++n_evicted;
+			}
+		}
+	}
+	DEL_ARR_F(entries);
+	return n_evicted;
+}
+
+void be_cache_begin(void)
+{
+	cache_active = be_options.cache_dir[0] != '\0' && !be_elf_enabled()
+	            && !be_dwarf_enabled() && !be_options.opt_profile_generate;
+	recording     = false;
+	n_hits        = 0;
+	n_misses      = 0;
+	n_uncacheable = 0;
+	n_stored      = 0;
+	if (!cache_active)
+		return;
+
+	if (mkdir(be_options.cache_dir, 0777) != 0 && errno != EEXIST) {
+		be_warningf(NULL, "could not create code cache directory '%s'",
+		            be_options.cache_dir);
+		cache_active = false;
+		return;
+	}
+	hash_settings(&settings_hash);
+	first_entity_nr = irp->max_node_nr;
+}
+
+bool be_cache_lookup(ir_graph *const irg)
+{
+	recording = false;
+	if (!cache_active)
+		return false;
+
+	hash_state_t state = settings_hash;
+	if (!ir_export_irg_content(irg, key_data, &state)) {
+		++n_uncacheable;
+		return false;
+	}
+	key_finish(&state, current_key);
+
+	if (emit_entry(current_key)) {
+		++n_hits;
+		return true;
+	}
+
+	++n_misses;
+	recording      = true;
+	first_block_nr = be_gas_reserve_block_nrs(0);
+	/* entries start with their own section switch */
+	be_gas_forget_section();
+	be_gas_get_max_emitted_entity_nr();
+	be_emit_capture_begin();
+	return false;
+}
+
+void be_cache_store(void)
+{
+	if (!recording)
+		return;
+	recording = false;
+
+	size_t             size;
+	char const  *const text     = be_emit_capture_end(&size);
+	unsigned     const end      = be_gas_reserve_block_nrs(0);
+	long         const max_nr   = be_gas_get_max_emitted_entity_nr();
+	bool               storable = max_nr < first_entity_nr;
+	struct obstack     obst;
+	obstack_init(&obst);
+	if (storable) {
+		storable = be_gas_relocate_block_labels(&obst, text, size, first_block_nr, end,
+		                           -(long)first_block_nr);
+	}
+	if (!storable) {
+		--n_misses;
+		++n_uncacheable;
+	} else {
+		size_t const len = obstack_object_size(&obst);
+		if (write_entry(current_key, end - first_block_nr,
+		                (char const*)obstack_finish(&obst), len))
+			++n_stored;
+	}
+	obstack_free(&obst, NULL);
+}
+
+void be_cache_finish(void)
+{
+	if (!cache_active)
+		return;
+	cache_active = false;
+
+	unsigned const n_evicted = n_stored > 0 ? evict_entries() : 0;
+	if (stat_ev_enabled) {
+		unsigned const n_lookups = n_hits + n_misses;
+		stat_ev_ull("becache_hits", n_hits);
+		stat_ev_ull("becache_misses", n_misses);
+		stat_ev_ull("becache_uncacheable", n_uncacheable);
+		stat_ev_ull("becache_evicted", n_evicted);
+		stat_ev_dbl("becache_hit_rate",
+		            n_lookups > 0 ? (double)n_hits / n_lookups : 0.0);
+	}
+}
+
+#else
+
+/* the cache relies on POSIX file system functions */
+
+void be_cache_begin(void)
+{
+}
+
+bool be_cache_lookup(ir_graph *const irg)
+{
+	(void)irg;
+	return false;
+}
+
+void be_cache_store(void)
+{
+}
+
+void be_cache_finish(void)
+{
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Content-addressed cache for the assembler code of functions.
+ */
+#ifndef FIRM_BE_BECACHE_H
+#define FIRM_BE_BECACHE_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+/**
+ * Enables the cache for the current compilation unit if a cache directory is
+ * configured.  Must be called at the end of be_begin().
+ */
+void be_cache_begin(void);
+
+/**
+ * Looks up the code of @p irg in the cache.  On a hit the cached code is
+ * emitted and the backend has to skip the graph.  On a miss the code emitted
+ * until the next be_cache_store() is recorded.
+ *
+ * @returns true if the cached code was emitted
+ */
+bool be_cache_lookup(ir_graph *irg);
+
+/** Stores the code emitted since a missed be_cache_lookup() in the cache. */
+void be_cache_store(void);
+
+/**
+ * Evicts the least recently used entries exceeding the cache size and reports
+ * statistics.  Must be called before the statistics context of the
+ * compilation unit is closed.
+ */
+void be_cache_finish(void);
+
+#endif
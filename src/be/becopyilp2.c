@@ -318,10 +318,11 @@ static void build_clique_star_cstr(ilp_env_t *ienv)
 		ir_node **const nodes = (ir_node**)obstack_finish(&ob);
 
 		/* get all interference edges between these */
-		size_t n_edges = 0;
+		be_ifg_t const *const ifg     = ienv->co->cenv->ifg;
+		size_t                n_edges = 0;
 		for (int i = 0; i < n_nodes; ++i) {
 			for (int o = 0; o < i; ++o) {
-				if (be_values_interfere(nodes[i], nodes[o]))
+				if (be_ifg_connected(ifg, nodes[i], nodes[o]))
 					add_edge(edges, nodes[i], nodes[o], &n_edges);
 			}
 		}
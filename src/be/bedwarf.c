@@ -13,7 +13,9 @@
 #include "array.h"
 #include "bearch.h"
 #include "beemitter.h"
+#include "beelf.h"
 #include "begnuas.h"
+#include "bejit.h"
 #include "bemodule.h"
 #include "dbginfo.h"
 #include "irprog.h"
@@ -307,12 +309,23 @@ void be_dwarf_location(dbg_info *dbgi)
 {
 	if (debug_level < LEVEL_LOCATIONS)
 		return;
+	/* the object file writer builds the line table from the encoded code */
+	if (be_elf_enabled()) {
+		be_jit_location(dbgi);
+		return;
+	}
 	src_loc_t loc = ir_retrieve_dbg_info(dbgi);
 	if (!loc.file)
 		return;
 
 	unsigned filenum = insert_file(loc.file);
-	be_emit_irprintf("\t.loc %u %u %u\n", filenum, loc.line, loc.column);
+	be_emit_cstring("\t.loc ");
+	be_emit_uint(filenum);
+	be_emit_char(' ');
+	be_emit_uint(loc.line);
+	be_emit_char(' ');
+	be_emit_uint(loc.column);
+	be_emit_char('\n');
 	be_emit_write_line();
 }
 
@@ -501,6 +514,21 @@ void be_dwarf_function_before(const ir_entity *entity,
 	env.cur_ent = entity;
 }
 
+bool be_dwarf_enabled(void)
+{
+	return debug_level >= LEVEL_BASIC;
+}
+
+dwarf_source_language be_dwarf_get_source_language(void)
+{
+	return language;
+}
+
+char const *be_dwarf_get_compilation_directory(void)
+{
+	return comp_dir;
+}
+
 void be_dwarf_function_begin(void)
 {
 	if (debug_level < LEVEL_FRAMEINFO)
@@ -5,6 +5,7 @@
 #ifndef FIRM_BE_BEDWARF_T_H
 #define FIRM_BE_BEDWARF_T_H
 
+#include "be.h"
 #include "bedwarf.h"
 
 /* Tag names and codes.  */
@@ -214,6 +215,14 @@ typedef enum dwarf_type {
 	DW_ATE_decimal_float   = 0xF,
 } dwarf_type;
 
+typedef enum dwarf_line_number_ops {
+	DW_LNS_copy         = 1,
+	DW_LNS_advance_pc   = 2,
+	DW_LNS_advance_line = 3,
+	DW_LNS_set_file     = 4,
+	DW_LNS_set_column   = 5,
+} dwarf_line_number_ops;
+
 typedef enum dwarf_line_number_x_ops {
 	DW_LNE_end_sequence = 1,
 	DW_LNE_set_address  = 2,
@@ -375,4 +384,10 @@ typedef enum dwarf_location_op {
 	DW_OP_bit_piece           = 0x9d,
 } dwarf_location_op;
 
+/** Returns the source language set with be_dwarf_set_source_language(). */
+dwarf_source_language be_dwarf_get_source_language(void);
+
+/** Returns the compilation directory or NULL if none was set. */
+char const *be_dwarf_get_compilation_directory(void);
+
 #endif
@@ -0,0 +1,1308 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Writes ELF relocatable object files from binary encoded code.
+ *
+ * Functions are encoded by the backend with the machine code encoder also
+ * used by the JIT.  The writer lays them out in the text section, emits the
+ * global entities into the data sections and turns references to entities
+ * into relocations.  Section and visibility decisions are shared with the gas
+ * emitter, so the resulting object matches an assembled .s file.
+ */
+#include "beelf.h"
+
+#include "array.h"
+#include "be_t.h"
+#include "bedwarf_t.h"
+#include "begnuas.h"
+#include "dbginfo.h"
+#include "entity_t.h"
+#include "irnode_t.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "panic.h"
+#include "platform_t.h"
+#include "pmap.h"
+#include "target_t.h"
+#include "util.h"
+#include "xmalloc.h"
+#include <assert.h>
+#include <string.h>
+
+enum {
+	ET_REL        = 1,
+	EV_CURRENT    = 1,
+	ELFCLASS32    = 1,
+	ELFCLASS64    = 2,
+	ELFDATA2LSB   = 1,
+
+	SHT_PROGBITS  = 1,
+	SHT_SYMTAB    = 2,
+	SHT_STRTAB    = 3,
+	SHT_RELA      = 4,
+	SHT_NOBITS    = 8,
+	SHT_REL       = 9,
+
+	SHF_WRITE     = 0x1,
+	SHF_ALLOC     = 0x2,
+	SHF_EXECINSTR = 0x4,
+	SHF_INFO_LINK = 0x40,
+	SHF_TLS       = 0x400,
+
+	SHN_UNDEF     = 0,
+	SHN_ABS       = 0xFFF1,
+	SHN_COMMON    = 0xFFF2,
+
+	STB_LOCAL     = 0,
+	STB_GLOBAL    = 1,
+	STB_WEAK      = 2,
+
+	STT_NOTYPE    = 0,
+	STT_OBJECT    = 1,
+	STT_FUNC      = 2,
+	STT_SECTION   = 3,
+	STT_FILE      = 4,
+	STT_TLS       = 6,
+
+	STV_DEFAULT   = 0,
+	STV_HIDDEN    = 2,
+	STV_PROTECTED = 3,
+};
+
+typedef enum elf_section_kind_t {
+	SECTION_TEXT,
+	SECTION_DATA,
+	SECTION_BSS,
+	SECTION_RODATA,
+	SECTION_REL_RO,
+	SECTION_REL_RO_LOCAL,
+	SECTION_CTORS,
+	SECTION_DTORS,
+	SECTION_JCR,
+	SECTION_TDATA,
+	SECTION_TBSS,
+	SECTION_DEBUG_INFO,
+	SECTION_DEBUG_ABBREV,
+	SECTION_DEBUG_LINE,
+	SECTION_COUNT,
+} elf_section_kind_t;
+
+typedef struct elf_section_info_t {
+	char const *name;
+	uint32_t    type;
+	uint32_t    flags;
+} elf_section_info_t;
+
+static elf_section_info_t const section_infos[] = {
+	[SECTION_TEXT]         = { ".text",              SHT_PROGBITS, SHF_ALLOC|SHF_EXECINSTR },
+	[SECTION_DATA]         = { ".data",              SHT_PROGBITS, SHF_ALLOC|SHF_WRITE     },
+	[SECTION_BSS]          = { ".bss",               SHT_NOBITS,   SHF_ALLOC|SHF_WRITE     },
+	[SECTION_RODATA]       = { ".rodata",            SHT_PROGBITS, SHF_ALLOC               },
+	[SECTION_REL_RO]       = { ".data.rel.ro",       SHT_PROGBITS, SHF_ALLOC|SHF_WRITE     },
+	[SECTION_REL_RO_LOCAL] = { ".data.rel.ro.local", SHT_PROGBITS, SHF_ALLOC|SHF_WRITE     },
+	[SECTION_CTORS]        = { ".ctors",             SHT_PROGBITS, SHF_ALLOC|SHF_WRITE     },
+	[SECTION_DTORS]        = { ".dtors",             SHT_PROGBITS, SHF_ALLOC|SHF_WRITE     },
+	[SECTION_JCR]          = { ".jcr",               SHT_PROGBITS, SHF_ALLOC|SHF_WRITE     },
+	[SECTION_TDATA]        = { ".tdata",             SHT_PROGBITS, SHF_ALLOC|SHF_WRITE|SHF_TLS },
+	[SECTION_TBSS]         = { ".tbss",              SHT_NOBITS,   SHF_ALLOC|SHF_WRITE|SHF_TLS },
+	[SECTION_DEBUG_INFO]   = { ".debug_info",        SHT_PROGBITS, 0                       },
+	[SECTION_DEBUG_ABBREV] = { ".debug_abbrev",      SHT_PROGBITS, 0                       },
+	[SECTION_DEBUG_LINE]   = { ".debug_line",        SHT_PROGBITS, 0                       },
+};
+
+typedef struct elf_section_t elf_section_t;
+
+typedef struct elf_symbol_t {
+	char const    *name;
+	elf_section_t *section; /**< NULL if undefined or common */
+	uint64_t       value;
+	uint64_t       size;
+	uint8_t        bind;
+	uint8_t        type;
+	uint8_t        other;
+	bool           common;
+	unsigned       index;   /**< index in the symbol table */
+} elf_symbol_t;
+
+typedef struct elf_reloc_t {
+	uint64_t      offset;
+	elf_symbol_t *symbol;
+	int64_t       addend;
+	unsigned      type;
+	unsigned      size;
+} elf_reloc_t;
+
+struct elf_section_t {
+	char         *data;      /**< contents, stays NULL for SHT_NOBITS */
+	size_t        size;
+	size_t        capacity;
+	unsigned      alignment;
+	bool          nobits;    /**< occupies no space in the file */
+	elf_reloc_t  *relocs;    /**< ARR_F */
+	elf_symbol_t *symbol;    /**< the section symbol */
+	unsigned      index;     /**< index in the section header table */
+	size_t        offset;    /**< file offset of the contents */
+	size_t        rel_offset;
+};
+
+typedef struct elf_jump_table_t {
+	ir_entity const *entity;
+	unsigned long    length;
+	unsigned        *fragment_nums;
+} elf_jump_table_t;
+
+static FILE                  *output;
+static be_elf_target_t const *target;
+static elf_section_t          sections[SECTION_COUNT];
+static elf_symbol_t         **symbols;     /**< ARR_F */
+static pmap                  *entity_symbols;
+static struct obstack         obst;
+static elf_jump_table_t      *jump_tables; /**< ARR_F, for the next function */
+static ir_entity const      **aliases;     /**< ARR_F */
+
+/* line number program state */
+static elf_section_t          line_program;
+static pmap                  *file_map;
+static char const           **file_list;   /**< ARR_F */
+
+/* the function currently being emitted */
+static char const            *function_code;
+static size_t                 function_begin;
+
+bool be_elf_enabled(void)
+{
+	return target != NULL;
+}
+
+static unsigned get_pointer_size(void)
+{
+	return target->is_64bit ? 8 : 4;
+}
+
+static char *grow_section(elf_section_t *const section, size_t const size)
+{
+	size_t const offset = section->size;
+	section->size += size;
+	if (section->nobits)
+		return NULL;
+
+	if (section->size > section->capacity) {
+		size_t const capacity = MAX(section->size, 2 * section->capacity);
+		section->data     = XREALLOC(section->data, char, capacity);
+		section->capacity = capacity;
+	}
+	char *const res = section->data + offset;
+	memset(res, 0, size);
+	return res;
+}
+
+static size_t align_section(elf_section_t *const section,
+                            unsigned const alignment)
+{
+	assert(is_po2_or_zero(alignment));
+	section->alignment = MAX(section->alignment, alignment);
+	size_t const offset  = section->size;
+	size_t const aligned = round_up2(offset, MAX(alignment, 1));
+	if (aligned > offset) {
+		char *const padding = grow_section(section, aligned - offset);
+		if (padding != NULL && section == &sections[SECTION_TEXT])
+			target->nops(padding, aligned - offset);
+	}
+	return aligned;
+}
+
+static void write_bytes(elf_section_t *const section, void const *const bytes,
+                        size_t const size)
+{
+	char *const dest = grow_section(section, size);
+	memcpy(dest, bytes, size);
+}
+
+static void write_le(char *const dest, uint64_t value, unsigned const size)
+{
+	for (unsigned i = 0; i < size; ++i) {
+		dest[i] = (char)(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+static void write_int(elf_section_t *const section, uint64_t const value,
+                      unsigned const size)
+{
+	write_le(grow_section(section, size), value, size);
+}
+
+static void write_uleb128(elf_section_t *const section, uint64_t value)
+{
+	do {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			byte |= 0x80;
+		write_int(section, byte, 1);
+	} while (value != 0);
+}
+
+static void write_sleb128(elf_section_t *const section, int64_t value)
+{
+	for (;;) {
+		uint8_t const byte = value & 0x7F;
+		value >>= 7;
+		if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+			write_int(section, byte, 1);
+			return;
+		}
+		write_int(section, byte | 0x80, 1);
+	}
+}
+
+static void write_string(elf_section_t *const section, char const *const str)
+{
+	write_bytes(section, str, strlen(str) + 1);
+}
+
+static elf_symbol_t *new_symbol(char const *const name)
+{
+	elf_symbol_t *const symbol = OALLOCZ(&obst, elf_symbol_t);
+	symbol->name = name;
+	ARR_APP1(elf_symbol_t*, symbols, symbol);
+	return symbol;
+}
+
+static elf_symbol_t *get_entity_symbol(ir_entity const *const entity)
+{
+	elf_symbol_t *symbol = pmap_get(elf_symbol_t, entity_symbols, entity);
+	if (symbol != NULL)
+		return symbol;
+
+	if (get_entity_kind(entity) == IR_ENTITY_LABEL)
+		panic("cannot reference label %+F in object file", entity);
+
+	ir_visibility const visibility = get_entity_visibility(entity);
+	char const   *const ld_name    = get_entity_ld_name(entity);
+	char const         *name       = ld_name;
+	if (visibility == ir_visibility_private) {
+		obstack_printf(&obst, "%s%s", be_gas_get_private_prefix(), ld_name);
+		obstack_1grow(&obst, '\0');
+		name = (char const*)obstack_finish(&obst);
+	}
+
+	symbol = new_symbol(name);
+	switch (visibility) {
+	case ir_visibility_local:
+	case ir_visibility_private:
+		symbol->bind = STB_LOCAL;
+		break;
+	case ir_visibility_external_private:
+		symbol->other = STV_HIDDEN;
+		goto global;
+	case ir_visibility_external_protected:
+		symbol->other = STV_PROTECTED;
+		goto global;
+	case ir_visibility_external:
+global:
+		symbol->bind = get_entity_linkage(entity) & IR_LINKAGE_WEAK
+		             ? STB_WEAK : STB_GLOBAL;
+		break;
+	}
+	/* there are no COMDAT groups, let the linker pick one of the copies */
+	if ((get_entity_linkage(entity) & IR_LINKAGE_MERGE)
+	    && (get_entity_linkage(entity) & IR_LINKAGE_GARBAGE_COLLECT)
+	    && symbol->bind == STB_GLOBAL)
+		symbol->bind = STB_WEAK;
+	pmap_insert(entity_symbols, entity, symbol);
+	return symbol;
+}
+
+static void define_symbol(elf_symbol_t *const symbol,
+                          elf_section_t *const section, uint64_t const value,
+                          uint64_t const size, uint8_t const type)
+{
+	if (symbol->section != NULL || symbol->common)
+		panic("symbol %s defined twice", symbol->name);
+	symbol->section = section;
+	symbol->value   = value;
+	symbol->size    = size;
+	symbol->type    = type;
+}
+
+static void add_reloc(elf_section_t *const section, uint64_t const offset,
+                      unsigned const type, unsigned const size,
+                      elf_symbol_t *const symbol, int64_t const addend)
+{
+	elf_reloc_t const reloc = {
+		.offset = offset,
+		.symbol = symbol,
+		.addend = addend,
+		.type   = type,
+		.size   = size,
+	};
+	ARR_APP1(elf_reloc_t, section->relocs, reloc);
+}
+
+static void write_address(elf_section_t *const section,
+                          elf_symbol_t *const symbol, int64_t const addend)
+{
+	unsigned const size   = get_pointer_size();
+	size_t   const offset = section->size;
+	grow_section(section, size);
+	add_reloc(section, offset, target->reloc_addr, size, symbol, addend);
+}
+
+void be_elf_begin(FILE *const file, be_elf_target_t const *const new_target)
+{
+	if (ir_target_big_endian())
+		panic("object file output only supports little endian targets");
+	if (ir_platform.object_format != OBJECT_FORMAT_ELF)
+		panic("object file output only supports ELF targets");
+	if (ir_platform.pic_style != BE_PIC_NONE)
+		panic("object file output does not support position independent code");
+	if (get_irp_n_asms() > 0)
+		panic("object file output does not support global assembler");
+
+	output = file;
+	target = new_target;
+	obstack_init(&obst);
+	memset(sections, 0, sizeof(sections));
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		sections[i].relocs = NEW_ARR_F(elf_reloc_t, 0);
+		sections[i].nobits = section_infos[i].type == SHT_NOBITS;
+	}
+	memset(&line_program, 0, sizeof(line_program));
+	line_program.relocs = NEW_ARR_F(elf_reloc_t, 0);
+	symbols        = NEW_ARR_F(elf_symbol_t*, 0);
+	entity_symbols = pmap_create();
+	jump_tables    = NEW_ARR_F(elf_jump_table_t, 0);
+	aliases        = NEW_ARR_F(ir_entity const*, 0);
+	file_map       = pmap_create();
+	file_list      = NEW_ARR_F(char const*, 0);
+
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		elf_symbol_t *const symbol = new_symbol("");
+		symbol->type       = STT_SECTION;
+		symbol->section    = &sections[i];
+		sections[i].symbol = symbol;
+	}
+}
+
+void be_elf_relocation(char const *const position, unsigned const type,
+                       unsigned const size, ir_entity const *const entity,
+                       int64_t const addend)
+{
+	assert(function_code != NULL && position >= function_code);
+	size_t const offset = function_begin + (size_t)(position - function_code);
+	add_reloc(&sections[SECTION_TEXT], offset, type, size,
+	          get_entity_symbol(entity), addend);
+}
+
+void be_elf_jump_table(ir_entity const *const entity,
+                       unsigned long const length,
+                       unsigned const *const fragment_nums)
+{
+	unsigned *const copy = OALLOCN(&obst, unsigned, length);
+	MEMCPY(copy, fragment_nums, length);
+	elf_jump_table_t const table = {
+		.entity        = entity,
+		.length        = length,
+		.fragment_nums = copy,
+	};
+	ARR_APP1(elf_jump_table_t, jump_tables, table);
+}
+
+static void emit_jump_tables(ir_jit_function_t const *const function)
+{
+	elf_section_t *const rodata       = &sections[SECTION_RODATA];
+	elf_symbol_t  *const text         = sections[SECTION_TEXT].symbol;
+	unsigned       const pointer_size = get_pointer_size();
+	for (size_t i = 0, n = ARR_LEN(jump_tables); i < n; ++i) {
+		elf_jump_table_t const *const table  = &jump_tables[i];
+		size_t                  const offset = align_section(rodata, pointer_size);
+		define_symbol(get_entity_symbol(table->entity), rodata, offset,
+		              table->length * pointer_size, STT_OBJECT);
+		for (unsigned long e = 0; e < table->length; ++e) {
+			unsigned const address
+				= be_jit_get_fragment_address(function, table->fragment_nums[e]);
+			write_address(rodata, text, function_begin + address);
+		}
+	}
+	ARR_SHRINKLEN(jump_tables, 0);
+}
+
+static unsigned get_file_num(char const *const file)
+{
+	unsigned num = PTR_TO_INT(pmap_get(void, file_map, file));
+	if (num == 0) {
+		ARR_APP1(char const*, file_list, file);
+		num = ARR_LEN(file_list);
+		pmap_insert(file_map, file, INT_TO_PTR(num));
+	}
+	return num;
+}
+
+/** Appends a line number sequence for the function just emitted. */
+static void emit_line_sequence(ir_jit_function_t const *const function)
+{
+	elf_section_t *const program = &line_program;
+	write_int(program, 0, 1);
+	write_uleb128(program, 1 + get_pointer_size());
+	write_int(program, DW_LNE_set_address, 1);
+	write_address(program, sections[SECTION_TEXT].symbol, function_begin);
+
+	unsigned address = 0;
+	unsigned file    = 1;
+	unsigned line    = 1;
+	unsigned column  = 0;
+	for (size_t i = 0, n = be_jit_get_n_locations(function); i < n; ++i) {
+		unsigned        loc_address;
+		dbg_info *const dbgi = be_jit_get_location(function, i, &loc_address);
+		src_loc_t const loc  = ir_retrieve_dbg_info(dbgi);
+		if (loc.file == NULL)
+			continue;
+		unsigned const loc_file = get_file_num(loc.file);
+		if (loc_file == file && loc.line == line && loc.column == column)
+			continue;
+
+		if (loc_file != file) {
+			write_int(program, DW_LNS_set_file, 1);
+			write_uleb128(program, loc_file);
+			file = loc_file;
+		}
+		if (loc.column != column) {
+			write_int(program, DW_LNS_set_column, 1);
+			write_uleb128(program, loc.column);
+			column = loc.column;
+		}
+		if (loc_address != address) {
+			assert(loc_address > address);
+			write_int(program, DW_LNS_advance_pc, 1);
+			write_uleb128(program, loc_address - address);
+			address = loc_address;
+		}
+		if (loc.line != line) {
+			write_int(program, DW_LNS_advance_line, 1);
+			write_sleb128(program, (int64_t)loc.line - line);
+			line = loc.line;
+		}
+		write_int(program, DW_LNS_copy, 1);
+	}
+
+	unsigned const size = be_get_function_size(function);
+	if (size > address) {
+		write_int(program, DW_LNS_advance_pc, 1);
+		write_uleb128(program, size - address);
+	}
+	write_int(program, 0, 1);
+	write_uleb128(program, 1);
+	write_int(program, DW_LNE_end_sequence, 1);
+}
+
+void be_elf_emit_function(ir_entity const *const entity,
+                          unsigned const p2alignment,
+                          ir_jit_function_t *const function,
+                          be_jit_emit_interface_t const *const emitter)
+{
+	elf_section_t *const text   = &sections[SECTION_TEXT];
+	size_t         const begin  = align_section(text, 1u << p2alignment);
+	unsigned       const size   = be_get_function_size(function);
+	char          *const buffer = grow_section(text, size);
+
+	function_code  = buffer;
+	function_begin = begin;
+	be_jit_emit_memory(buffer, function, emitter);
+	function_code  = NULL;
+
+	define_symbol(get_entity_symbol(entity), text, begin, size, STT_FUNC);
+	emit_jump_tables(function);
+	if (be_dwarf_enabled())
+		emit_line_sequence(function);
+}
+
+static uint64_t get_tarval_bytes(ir_tarval *const tv, unsigned const size)
+{
+	uint64_t value = 0;
+	for (unsigned i = MIN(size, 8); i-- != 0;)
+		value = value << 8 | get_tarval_sub_bits(tv, i);
+	return value;
+}
+
+static void write_tarval(char *const dest, ir_tarval *const tv,
+                         unsigned const size)
+{
+	for (unsigned i = 0; i < size; ++i)
+		dest[i] = (char)get_tarval_sub_bits(tv, i);
+}
+
+/**
+ * Evaluates an initializer expression.  A referenced entity is returned in
+ * @p entity, the result is the offset to its address then.
+ */
+static int64_t eval_init_expression(ir_node *const init,
+                                    ir_entity **const entity)
+{
+	switch (get_irn_opcode(init)) {
+	case iro_Conv:
+		return eval_init_expression(get_Conv_op(init), entity);
+
+	case iro_Const: {
+		ir_tarval *const tv   = get_Const_tarval(init);
+		unsigned   const size = get_mode_size_bytes(get_tarval_mode(tv));
+		uint64_t         val  = get_tarval_bytes(tv, size);
+		/* sign extend, the value is truncated when written anyway */
+		if (size < 8 && mode_is_signed(get_tarval_mode(tv))
+		    && (val >> (size * 8 - 1)) & 1)
+			val |= ~UINT64_C(0) << (size * 8);
+		return (int64_t)val;
+	}
+
+	case iro_Address:
+		if (*entity != NULL)
+			panic("initializer %+F references multiple entities", init);
+		*entity = get_Address_entity(init);
+		return 0;
+
+	case iro_Offset:
+		return get_entity_offset(get_Offset_entity(init));
+
+	case iro_Align:
+		return get_type_alignment(get_Align_type(init));
+
+	case iro_Size:
+		return get_type_size(get_Size_type(init));
+
+	case iro_Add:
+		return eval_init_expression(get_Add_left(init), entity)
+		     + eval_init_expression(get_Add_right(init), entity);
+
+	case iro_Sub: {
+		int64_t          const left  = eval_init_expression(get_Sub_left(init), entity);
+		ir_entity       *      right_entity = NULL;
+		int64_t          const right = eval_init_expression(get_Sub_right(init), &right_entity);
+		if (right_entity != NULL)
+			panic("cannot subtract addresses in initializer %+F", init);
+		return left - right;
+	}
+
+	case iro_Mul: {
+		ir_entity *mul_entity = NULL;
+		int64_t const left  = eval_init_expression(get_Mul_left(init), &mul_entity);
+		int64_t const right = eval_init_expression(get_Mul_right(init), &mul_entity);
+		if (mul_entity != NULL)
+			panic("cannot multiply addresses in initializer %+F", init);
+		return left * right;
+	}
+
+	case iro_Unknown:
+		return 0;
+
+	default:
+		panic("unsupported IR-node %+F", init);
+	}
+}
+
+static void write_init_node(elf_section_t *const section, size_t const offset,
+                            ir_node *const init, ir_type *const type)
+{
+	unsigned const size = get_type_size(type);
+	if (is_Const(init)) {
+		/* larger values are written like tarval initializers */
+		ir_tarval *const tv    = get_Const_tarval(init);
+		unsigned   const bytes = get_mode_size_bytes(get_tarval_mode(tv));
+		write_tarval(section->data + offset, tv, size > 8 ? size : MIN(size, bytes));
+		return;
+	}
+	if (size > 8)
+		panic("12/16byte initializers only support Const nodes yet");
+
+	ir_entity     *entity = NULL;
+	int64_t  const value  = eval_init_expression(init, &entity);
+	if (entity == NULL) {
+		write_le(section->data + offset, (uint64_t)value, size);
+	} else if (size == get_pointer_size()) {
+		add_reloc(section, offset, target->reloc_addr, size,
+		          get_entity_symbol(entity), value);
+	} else {
+		panic("address in initializer %+F does not fit its type", init);
+	}
+}
+
+static void write_bitfield(char *const dest, unsigned const offset_bits,
+                           unsigned const bitfield_size,
+                           ir_initializer_t const *const initializer)
+{
+	ir_tarval *tv = NULL;
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_NULL:
+		return;
+	case IR_INITIALIZER_TARVAL:
+		tv = get_initializer_tarval_value(initializer);
+		break;
+	case IR_INITIALIZER_CONST: {
+		ir_node *const node = get_initializer_const_value(initializer);
+		if (!is_Const(node))
+			panic("bitfield initializer not a Const node");
+		tv = get_Const_tarval(node);
+		break;
+	}
+	case IR_INITIALIZER_COMPOUND:
+		panic("bitfield initializer is compound");
+	}
+	if (!tv || tv == tarval_bad)
+		panic("couldn't get numeric value for bitfield initializer");
+
+	for (unsigned bit = 0; bit < bitfield_size; ++bit) {
+		unsigned const src = get_tarval_sub_bits(tv, bit / 8) >> (bit % 8) & 1;
+		unsigned const dst = bit + offset_bits;
+		dest[dst / 8] |= (char)(src << (dst % 8));
+	}
+}
+
+static void write_initializer(elf_section_t *const section, size_t const offset,
+                              ir_initializer_t const *const initializer,
+                              ir_type *const type)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_NULL:
+		return;
+
+	case IR_INITIALIZER_TARVAL:
+		write_tarval(section->data + offset,
+		             get_initializer_tarval_value(initializer),
+		             get_type_size(type));
+		return;
+
+	case IR_INITIALIZER_CONST:
+		write_init_node(section, offset,
+		                get_initializer_const_value(initializer), type);
+		return;
+
+	case IR_INITIALIZER_COMPOUND:
+		if (is_Array_type(type)) {
+			ir_type *const element_type = get_array_element_type(type);
+			size_t   const alignment    = get_type_alignment(element_type);
+			size_t   const skip
+				= round_up2(get_type_size(element_type), MAX(alignment, 1));
+			for (size_t i = 0, n = get_initializer_compound_n_entries(initializer);
+			     i < n; ++i) {
+				ir_initializer_t const *const sub_initializer
+					= get_initializer_compound_value(initializer, i);
+				write_initializer(section, offset + i * skip, sub_initializer,
+				                  element_type);
+			}
+		} else {
+			assert(is_compound_type(type));
+			for (size_t i = 0, n_members = get_compound_n_members(type);
+			     i < n_members; ++i) {
+				ir_entity *const member        = get_compound_member(type, i);
+				size_t     const member_offset = offset + get_entity_offset(member);
+
+				assert(i < get_initializer_compound_n_entries(initializer));
+				ir_initializer_t const *const sub_initializer
+					= get_initializer_compound_value(initializer, i);
+
+				unsigned const bitfield_size = get_entity_bitfield_size(member);
+				if (bitfield_size > 0) {
+					write_bitfield(section->data + member_offset,
+					               get_entity_bitfield_offset(member),
+					               bitfield_size, sub_initializer);
+					continue;
+				}
+				write_initializer(section, member_offset, sub_initializer,
+				                  get_entity_type(member));
+			}
+		}
+		return;
+	}
+	panic("invalid ir_initializer kind found");
+}
+
+static elf_section_t *get_section(be_gas_section_t const section)
+{
+	be_gas_section_t const base = section & GAS_SECTION_TYPE_MASK;
+	if (section & GAS_SECTION_FLAG_TLS) {
+		switch (base) {
+		case GAS_SECTION_DATA:
+		case GAS_SECTION_RODATA: return &sections[SECTION_TDATA];
+		case GAS_SECTION_BSS:    return &sections[SECTION_TBSS];
+		default:                 break;
+		}
+	} else {
+		switch (base) {
+		case GAS_SECTION_TEXT:           return &sections[SECTION_TEXT];
+		case GAS_SECTION_DATA:           return &sections[SECTION_DATA];
+		case GAS_SECTION_RODATA:         return &sections[SECTION_RODATA];
+		case GAS_SECTION_REL_RO:         return &sections[SECTION_REL_RO];
+		case GAS_SECTION_REL_RO_LOCAL:   return &sections[SECTION_REL_RO_LOCAL];
+		case GAS_SECTION_BSS:            return &sections[SECTION_BSS];
+		case GAS_SECTION_CONSTRUCTORS:   return &sections[SECTION_CTORS];
+		case GAS_SECTION_DESTRUCTORS:    return &sections[SECTION_DTORS];
+		case GAS_SECTION_JCR:            return &sections[SECTION_JCR];
+		default:                         break;
+		}
+	}
+	panic("section %u not supported in object files", (unsigned)section);
+}
+
+static void emit_global(be_main_env_t const *const main_env,
+                        ir_entity const *const entity)
+{
+	ir_entity_kind const kind = get_entity_kind(entity);
+	/* functions were emitted by be_elf_emit_function() */
+	if (kind == IR_ENTITY_LABEL || kind == IR_ENTITY_METHOD)
+		return;
+
+	be_gas_section_t const section    = be_gas_get_section(main_env, entity);
+	ir_visibility    const visibility = get_entity_visibility(entity);
+	ir_linkage       const linkage    = get_entity_linkage(entity);
+	unsigned         const alignment  = be_gas_get_entity_alignment(entity);
+	unsigned long          size       = be_gas_get_entity_size(entity);
+	if (size == 0)
+		size = 1;
+	if (!is_po2_or_zero(alignment))
+		panic("alignment not a power of 2");
+
+	/* mirror the .comm handling of the gas emitter */
+	bool const zero_initializer
+		= (section & GAS_SECTION_TYPE_MASK) == GAS_SECTION_BSS;
+	if ((linkage & IR_LINKAGE_MERGE || zero_initializer)
+	    && !(section & GAS_SECTION_FLAG_TLS)) {
+		switch (visibility) {
+		case ir_visibility_external:
+		case ir_visibility_external_private:
+		case ir_visibility_external_protected:
+			if (linkage & IR_LINKAGE_MERGE) {
+				elf_symbol_t *const symbol = get_entity_symbol(entity);
+				if (symbol->section != NULL)
+					panic("symbol %s defined twice", symbol->name);
+				symbol->common = true;
+				symbol->bind   = STB_GLOBAL;
+				symbol->type   = STT_OBJECT;
+				symbol->value  = MAX(alignment, 1);
+				symbol->size   = size;
+				return;
+			}
+			break;
+		case ir_visibility_local:
+		case ir_visibility_private:
+			if (!(linkage & IR_LINKAGE_CONSTANT)) {
+				elf_section_t *const bss    = &sections[SECTION_BSS];
+				size_t         const offset = align_section(bss, alignment);
+				grow_section(bss, size);
+				define_symbol(get_entity_symbol(entity), bss, offset, size,
+				              STT_OBJECT);
+				return;
+			}
+			break;
+		}
+	}
+
+	if (!entity_has_definition(entity))
+		return;
+
+	if (kind == IR_ENTITY_ALIAS) {
+		ARR_APP1(ir_entity const*, aliases, entity);
+		return;
+	}
+
+	elf_section_t *const elf_section = get_section(section);
+	size_t         const offset      = align_section(elf_section, alignment);
+	uint8_t        const type
+		= section & GAS_SECTION_FLAG_TLS ? STT_TLS : STT_OBJECT;
+	define_symbol(get_entity_symbol(entity), elf_section, offset,
+	              get_type_size(get_entity_type(entity)), type);
+
+	grow_section(elf_section, size);
+	if (!elf_section->nobits) {
+		ir_initializer_t const *const initializer
+			= get_entity_initializer(entity);
+		if (initializer != NULL)
+			write_initializer(elf_section, offset, initializer,
+			                  get_entity_type(entity));
+	}
+}
+
+static void emit_globals(ir_type *const type,
+                         be_main_env_t const *const main_env)
+{
+	for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+		ir_entity *const entity = get_compound_member(type, i);
+		if (!(get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN))
+			emit_global(main_env, entity);
+	}
+}
+
+static void resolve_aliases(void)
+{
+	for (size_t i = 0, n = ARR_LEN(aliases); i < n; ++i) {
+		ir_entity    const *const entity = aliases[i];
+		elf_symbol_t const *const aliased
+			= get_entity_symbol(get_entity_alias(entity));
+		if (aliased->section == NULL)
+			panic("alias %+F refers to an entity not defined here", entity);
+		define_symbol(get_entity_symbol(entity), aliased->section,
+		              aliased->value, aliased->size, aliased->type);
+	}
+}
+
+/** Emits a compilation unit referencing the line number program. */
+static void emit_debug_info(be_main_env_t const *const main_env)
+{
+	elf_section_t *const abbrev = &sections[SECTION_DEBUG_ABBREV];
+	dwarf_source_language const language = be_dwarf_get_source_language();
+	char const *const comp_dir = be_dwarf_get_compilation_directory();
+	bool const has_text = sections[SECTION_TEXT].size > 0;
+
+	write_uleb128(abbrev, 1);
+	write_uleb128(abbrev, DW_TAG_compile_unit);
+	write_int(abbrev, DW_CHILDREN_no, 1);
+	write_uleb128(abbrev, DW_AT_stmt_list);
+	write_uleb128(abbrev, DW_FORM_data4);
+	write_uleb128(abbrev, DW_AT_producer);
+	write_uleb128(abbrev, DW_FORM_string);
+	write_uleb128(abbrev, DW_AT_name);
+	write_uleb128(abbrev, DW_FORM_string);
+	if (language != 0) {
+		write_uleb128(abbrev, DW_AT_language);
+		write_uleb128(abbrev, DW_FORM_data2);
+	}
+	if (comp_dir != NULL) {
+		write_uleb128(abbrev, DW_AT_comp_dir);
+		write_uleb128(abbrev, DW_FORM_string);
+	}
+	if (has_text) {
+		write_uleb128(abbrev, DW_AT_low_pc);
+		write_uleb128(abbrev, DW_FORM_addr);
+		write_uleb128(abbrev, DW_AT_high_pc);
+		write_uleb128(abbrev, DW_FORM_addr);
+	}
+	write_uleb128(abbrev, 0);
+	write_uleb128(abbrev, 0);
+	write_uleb128(abbrev, 0);
+
+	elf_section_t *const info = &sections[SECTION_DEBUG_INFO];
+	write_int(info, 0, 4); /* unit length, patched below */
+	write_int(info, 3, 2); /* dwarf version */
+	add_reloc(info, info->size, target->reloc_32, 4, abbrev->symbol, 0);
+	write_int(info, 0, 4);
+	write_int(info, get_pointer_size(), 1);
+
+	write_uleb128(info, 1);
+	add_reloc(info, info->size, target->reloc_32, 4,
+	          sections[SECTION_DEBUG_LINE].symbol, 0);
+	write_int(info, 0, 4);
+	obstack_printf(&obst, "libFirm (%u.%u %s)", ir_get_version_major(),
+	               ir_get_version_minor(), ir_get_version_revision());
+	obstack_1grow(&obst, '\0');
+	write_string(info, (char const*)obstack_finish(&obst));
+	write_string(info, main_env->cup_name);
+	if (language != 0)
+		write_int(info, language, 2);
+	if (comp_dir != NULL)
+		write_string(info, comp_dir);
+	if (has_text) {
+		elf_symbol_t *const text = sections[SECTION_TEXT].symbol;
+		write_address(info, text, 0);
+		write_address(info, text, sections[SECTION_TEXT].size);
+	}
+	write_le(info->data, info->size - 4, 4);
+}
+
+/** Emits the line number program header followed by the sequences. */
+static void emit_debug_line(void)
+{
+	elf_section_t *const line = &sections[SECTION_DEBUG_LINE];
+	write_int(line, 0, 4); /* unit length, patched below */
+	write_int(line, 2, 2); /* version */
+	write_int(line, 0, 4); /* header length, patched below */
+	size_t const header_begin = line->size;
+	write_int(line, 1, 1);   /* len of smallest instruction */
+	write_int(line, 1, 1);   /* default is statement */
+	write_int(line, 246, 1); /* line base */
+	write_int(line, 245, 1); /* line range */
+	write_int(line, 10, 1);  /* opcode base */
+	static uint8_t const opcode_lengths[] = { 0, 1, 1, 1, 1, 0, 0, 0, 1 };
+	write_bytes(line, opcode_lengths, sizeof(opcode_lengths));
+
+	/* include directory list */
+	write_int(line, 0, 1);
+
+	/* file list */
+	for (size_t i = 0, n = ARR_LEN(file_list); i < n; ++i) {
+		write_string(line, file_list[i]);
+		write_uleb128(line, 0); /* directory */
+		write_uleb128(line, 0); /* modification time */
+		write_uleb128(line, 0); /* file length */
+	}
+	write_int(line, 0, 1);
+	write_le(line->data + 6, line->size - header_begin, 4);
+
+	size_t const program_begin = line->size;
+	if (line_program.size > 0)
+		write_bytes(line, line_program.data, line_program.size);
+	for (size_t i = 0, n = ARR_LEN(line_program.relocs); i < n; ++i) {
+		elf_reloc_t reloc = line_program.relocs[i];
+		reloc.offset += program_begin;
+		ARR_APP1(elf_reloc_t, line->relocs, reloc);
+	}
+	write_le(line->data, line->size - 4, 4);
+}
+
+/* ---- object file writer ---- */
+
+static void out_int(uint64_t value, unsigned const size)
+{
+	for (unsigned i = 0; i < size; ++i) {
+		obstack_1grow(&obst, (char)(value & 0xFF));
+		value >>= 8;
+	}
+}
+
+static void out_addr(uint64_t const value)
+{
+	out_int(value, get_pointer_size());
+}
+
+static void out_align(unsigned const alignment)
+{
+	size_t const size = obstack_object_size(&obst);
+	for (size_t i = size; i < round_up2(size, alignment); ++i)
+		obstack_1grow(&obst, 0);
+}
+
+static unsigned add_string(struct obstack *const strtab, char const *const str)
+{
+	if (str[0] == '\0')
+		return 0;
+	unsigned const offset = obstack_object_size(strtab);
+	obstack_grow(strtab, str, strlen(str) + 1);
+	return offset;
+}
+
+static bool is_used(elf_section_t const *const section)
+{
+	return section == &sections[SECTION_TEXT]
+	    || section == &sections[SECTION_DATA]
+	    || section == &sections[SECTION_BSS]
+	    || section->size > 0;
+}
+
+typedef struct section_header_t {
+	unsigned name;
+	uint32_t type;
+	uint64_t flags;
+	uint64_t offset;
+	uint64_t size;
+	unsigned link;
+	unsigned info;
+	uint64_t alignment;
+	uint64_t entsize;
+} section_header_t;
+
+static void out_section_header(section_header_t const *const header)
+{
+	bool const is_64bit = target->is_64bit;
+	out_int(header->name, 4);
+	out_int(header->type, 4);
+	out_int(header->flags, is_64bit ? 8 : 4);
+	out_addr(0);
+	out_addr(header->offset);
+	out_addr(header->size);
+	out_int(header->link, 4);
+	out_int(header->info, 4);
+	out_addr(header->alignment);
+	out_addr(header->entsize);
+}
+
+static void write_object_file(be_main_env_t const *const main_env)
+{
+	bool     const is_64bit     = target->is_64bit;
+	unsigned const pointer_size = get_pointer_size();
+
+	/* apply implicit addends */
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		elf_section_t *const section = &sections[i];
+		for (size_t r = 0, n = ARR_LEN(section->relocs); r < n; ++r) {
+			elf_reloc_t const *const reloc = &section->relocs[r];
+			write_le(section->data + reloc->offset,
+			         target->rela ? 0 : (uint64_t)reloc->addend, reloc->size);
+		}
+	}
+
+	/* number the sections */
+	unsigned n_headers = 1;
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		elf_section_t *const section = &sections[i];
+		if (!is_used(section))
+			continue;
+		section->index = n_headers++;
+		if (ARR_LEN(section->relocs) > 0)
+			++n_headers;
+	}
+	++n_headers; /* .note.GNU-stack */
+	unsigned const symtab_index   = n_headers++;
+	unsigned const strtab_index   = n_headers++;
+	unsigned const shstrtab_index = n_headers++;
+
+	/* order the symbol table: after the null and the file symbol all local
+	 * symbols have to precede the global ones */
+	elf_symbol_t       **syms         = NEW_ARR_F(elf_symbol_t*, 0);
+	unsigned             first_global = 0;
+	for (int global = 0; global < 2; ++global) {
+		first_global = 2 + ARR_LEN(syms);
+		for (size_t i = 0, n = ARR_LEN(symbols); i < n; ++i) {
+			elf_symbol_t *const symbol = symbols[i];
+			if ((symbol->bind != STB_LOCAL) != global)
+				continue;
+			if (symbol->type == STT_SECTION && !is_used(symbol->section))
+				continue;
+			symbol->index = 2 + ARR_LEN(syms);
+			ARR_APP1(elf_symbol_t*, syms, symbol);
+		}
+	}
+	size_t const n_syms = ARR_LEN(syms);
+
+	struct obstack strtab;
+	obstack_init(&strtab);
+	obstack_1grow(&strtab, '\0');
+	struct obstack shstrtab;
+	obstack_init(&shstrtab);
+	obstack_1grow(&shstrtab, '\0');
+
+	/* ELF header */
+	unsigned const ehdr_size = is_64bit ? 64 : 52;
+	unsigned const shdr_size = is_64bit ? 64 : 40;
+	out_int(0x464C457F, 4);
+	out_int(is_64bit ? ELFCLASS64 : ELFCLASS32, 1);
+	out_int(ELFDATA2LSB, 1);
+	out_int(EV_CURRENT, 1);
+	out_int(0, 9);
+	out_int(ET_REL, 2);
+	out_int(target->machine, 2);
+	out_int(EV_CURRENT, 4);
+	out_addr(0); /* entry */
+	out_addr(0); /* program headers */
+	size_t const shoff_pos = obstack_object_size(&obst);
+	out_addr(0); /* section headers, patched below */
+	out_int(0, 4);
+	out_int(ehdr_size, 2);
+	out_int(0, 2);
+	out_int(0, 2);
+	out_int(shdr_size, 2);
+	out_int(n_headers, 2);
+	out_int(shstrtab_index, 2);
+
+	/* section contents */
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		elf_section_t *const section = &sections[i];
+		if (!is_used(section))
+			continue;
+		out_align(MAX(section->alignment, 1));
+		section->offset = obstack_object_size(&obst);
+		if (!section->nobits && section->size > 0)
+			obstack_grow(&obst, section->data, section->size);
+
+		if (ARR_LEN(section->relocs) > 0) {
+			out_align(pointer_size);
+			section->rel_offset = obstack_object_size(&obst);
+			for (size_t r = 0, n = ARR_LEN(section->relocs); r < n; ++r) {
+				elf_reloc_t const *const reloc = &section->relocs[r];
+				uint64_t const sym = reloc->symbol->index;
+				out_addr(reloc->offset);
+				if (is_64bit) {
+					out_int(sym << 32 | reloc->type, 8);
+				} else {
+					out_int(sym << 8 | reloc->type, 4);
+				}
+				if (target->rela)
+					out_addr((uint64_t)reloc->addend);
+			}
+		}
+	}
+
+	/* symbol table */
+	out_align(pointer_size);
+	size_t const symtab_offset = obstack_object_size(&obst);
+	unsigned const sym_size = is_64bit ? 24 : 16;
+	for (size_t i = 0; i < 2 + n_syms; ++i) {
+		unsigned name  = 0;
+		uint8_t  info  = 0;
+		uint8_t  other = 0;
+		unsigned shndx = SHN_UNDEF;
+		uint64_t value = 0;
+		uint64_t size  = 0;
+		if (i == 1) {
+			name  = add_string(&strtab, main_env->cup_name);
+			info  = STB_LOCAL << 4 | STT_FILE;
+			shndx = SHN_ABS;
+		} else if (i > 1) {
+			elf_symbol_t const *const symbol = syms[i - 2];
+			name  = add_string(&strtab, symbol->name);
+			info  = symbol->bind << 4 | symbol->type;
+			other = symbol->other;
+			shndx = symbol->common  ? SHN_COMMON
+			      : symbol->section ? symbol->section->index : SHN_UNDEF;
+			value = symbol->value;
+			size  = symbol->size;
+		}
+		out_int(name, 4);
+		if (is_64bit) {
+			out_int(info, 1);
+			out_int(other, 1);
+			out_int(shndx, 2);
+			out_int(value, 8);
+			out_int(size, 8);
+		} else {
+			out_int(value, 4);
+			out_int(size, 4);
+			out_int(info, 1);
+			out_int(other, 1);
+			out_int(shndx, 2);
+		}
+	}
+	size_t const symtab_size = obstack_object_size(&obst) - symtab_offset;
+
+	size_t const strtab_offset = obstack_object_size(&obst);
+	size_t const strtab_size   = obstack_object_size(&strtab);
+	obstack_grow(&obst, obstack_finish(&strtab), strtab_size);
+
+	/* section header names */
+	unsigned section_names[SECTION_COUNT];
+	unsigned rel_names[SECTION_COUNT];
+	char const *const rel_prefix = target->rela ? ".rela" : ".rel";
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		elf_section_t const *const section = &sections[i];
+		if (!is_used(section))
+			continue;
+		if (ARR_LEN(section->relocs) > 0) {
+			rel_names[i] = obstack_object_size(&shstrtab);
+			obstack_printf(&shstrtab, "%s%s", rel_prefix, section_infos[i].name);
+			obstack_1grow(&shstrtab, '\0');
+		}
+		section_names[i] = add_string(&shstrtab, section_infos[i].name);
+	}
+	unsigned const note_name     = add_string(&shstrtab, ".note.GNU-stack");
+	unsigned const symtab_name   = add_string(&shstrtab, ".symtab");
+	unsigned const strtab_name   = add_string(&shstrtab, ".strtab");
+	unsigned const shstrtab_name = add_string(&shstrtab, ".shstrtab");
+
+	size_t const shstrtab_offset = obstack_object_size(&obst);
+	size_t const shstrtab_size   = obstack_object_size(&shstrtab);
+	obstack_grow(&obst, obstack_finish(&shstrtab), shstrtab_size);
+
+	/* section header table */
+	out_align(pointer_size);
+	size_t const shoff = obstack_object_size(&obst);
+	section_header_t const null_header = { .type = 0 };
+	out_section_header(&null_header);
+	unsigned const rel_entsize
+		= (target->rela ? 3 : 2) * pointer_size;
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		elf_section_t const *const section = &sections[i];
+		if (!is_used(section))
+			continue;
+		section_header_t const header = {
+			.name      = section_names[i],
+			.type      = section_infos[i].type,
+			.flags     = section_infos[i].flags,
+			.offset    = section->offset,
+			.size      = section->size,
+			.alignment = MAX(section->alignment, 1),
+		};
+		out_section_header(&header);
+		if (ARR_LEN(section->relocs) == 0)
+			continue;
+		section_header_t const rel_header = {
+			.name      = rel_names[i],
+			.type      = target->rela ? SHT_RELA : SHT_REL,
+			.flags     = SHF_INFO_LINK,
+			.offset    = section->rel_offset,
+			.size      = ARR_LEN(section->relocs) * rel_entsize,
+			.link      = symtab_index,
+			.info      = section->index,
+			.alignment = pointer_size,
+			.entsize   = rel_entsize,
+		};
+		out_section_header(&rel_header);
+	}
+	section_header_t const note_header = {
+		.name      = note_name,
+		.type      = SHT_PROGBITS,
+		.offset    = shstrtab_offset,
+		.alignment = 1,
+	};
+	out_section_header(&note_header);
+	section_header_t const symtab_header = {
+		.name      = symtab_name,
+		.type      = SHT_SYMTAB,
+		.offset    = symtab_offset,
+		.size      = symtab_size,
+		.link      = strtab_index,
+		.info      = first_global,
+		.alignment = pointer_size,
+		.entsize   = sym_size,
+	};
+	out_section_header(&symtab_header);
+	section_header_t const strtab_header = {
+		.name      = strtab_name,
+		.type      = SHT_STRTAB,
+		.offset    = strtab_offset,
+		.size      = strtab_size,
+		.alignment = 1,
+	};
+	out_section_header(&strtab_header);
+	section_header_t const shstrtab_header = {
+		.name      = shstrtab_name,
+		.type      = SHT_STRTAB,
+		.offset    = shstrtab_offset,
+		.size      = shstrtab_size,
+		.alignment = 1,
+	};
+	out_section_header(&shstrtab_header);
+
+	size_t const file_size = obstack_object_size(&obst);
+	char  *const file_data = (char*)obstack_finish(&obst);
+	write_le(file_data + shoff_pos, shoff, pointer_size);
+	fwrite(file_data, 1, file_size, output);
+
+	obstack_free(&strtab, NULL);
+	obstack_free(&shstrtab, NULL);
+	DEL_ARR_F(syms);
+}
+
+void be_elf_finish(be_main_env_t const *const main_env)
+{
+	assert(ARR_LEN(jump_tables) == 0);
+
+	emit_globals(get_glob_type(), main_env);
+	emit_globals(get_tls_type(), main_env);
+	emit_globals(get_segment_type(IR_SEGMENT_CONSTRUCTORS), main_env);
+	emit_globals(get_segment_type(IR_SEGMENT_DESTRUCTORS), main_env);
+	emit_globals(get_segment_type(IR_SEGMENT_JCR), main_env);
+	resolve_aliases();
+
+	if (be_dwarf_enabled()) {
+		emit_debug_line();
+		emit_debug_info(main_env);
+	}
+
+	write_object_file(main_env);
+
+	for (size_t i = 0; i < SECTION_COUNT; ++i) {
+		free(sections[i].data);
+		DEL_ARR_F(sections[i].relocs);
+	}
+	free(line_program.data);
+	DEL_ARR_F(line_program.relocs);
+	DEL_ARR_F(symbols);
+	DEL_ARR_F(jump_tables);
+	DEL_ARR_F(aliases);
+	DEL_ARR_F(file_list);
+	pmap_destroy(entity_symbols);
+	pmap_destroy(file_map);
+	obstack_free(&obst, NULL);
+	target = NULL;
+	output = NULL;
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Writes ELF relocatable object files from binary encoded code.
+ */
+#ifndef FIRM_BE_BEELF_H
+#define FIRM_BE_BEELF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "be_types.h"
+#include "bejit.h"
+#include "firm_types.h"
+
+/** Describes the machine an object file is written for. */
+typedef struct be_elf_target_t {
+	uint16_t machine;    /**< value of the e_machine header field */
+	bool     is_64bit;   /**< write ELFCLASS64 instead of ELFCLASS32 */
+	bool     rela;       /**< relocations carry explicit addends */
+	unsigned reloc_addr; /**< relocation type of a pointer sized address */
+	unsigned reloc_32;   /**< relocation type of a 32 bit address */
+	/** fill @p size bytes of code padding */
+	void   (*nops)(char *buffer, unsigned size);
+} be_elf_target_t;
+
+/**
+ * Starts writing an object file for @p target to @p output.  Must be called
+ * before be_begin(), which then skips the assembler specific parts.
+ */
+void be_elf_begin(FILE *output, be_elf_target_t const *target);
+
+/** Returns whether an object file is written instead of assembler. */
+bool be_elf_enabled(void);
+
+/**
+ * Appends the binary encoded @p function for @p entity to the text section.
+ * The relocation callback of @p emitter has to call be_elf_relocation() for
+ * all references to entities.
+ */
+void be_elf_emit_function(ir_entity const *entity, unsigned p2alignment,
+                          ir_jit_function_t *function,
+                          be_jit_emit_interface_t const *emitter);
+
+/**
+ * Records a relocation of @p size bytes at @p position in the code buffer of
+ * the function currently being emitted.
+ */
+void be_elf_relocation(char const *position, unsigned type, unsigned size,
+                       ir_entity const *entity, int64_t addend);
+
+/**
+ * Records a jump table for the function encoded next.  Entry @c i of table
+ * @p entity holds the address of fragment @p fragment_nums[i].
+ */
+void be_elf_jump_table(ir_entity const *entity, unsigned long length,
+                       unsigned const *fragment_nums);
+
+/** Emits all global entities and writes the object file. */
+void be_elf_finish(be_main_env_t const *env);
+
+#endif
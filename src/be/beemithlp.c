@@ -56,12 +56,16 @@ void be_emit_node(ir_node const *const node)
 	emit(node);
 }
 
+size_t be_emit_get_comment_padding(size_t const column)
+{
+	return 34 - MIN(column, 30);
+}
+
 void be_emit_pad_comment(void)
 {
-	size_t col = be_emit_get_column();
-	col = MIN(col, 30);
+	size_t const padding = be_emit_get_comment_padding(be_emit_get_column());
 	/* 34 spaces */
-	be_emit_string_len("                                  ", 34 - col);
+	be_emit_string_len("                                  ", padding);
 }
 
 void be_emit_init_cf_links(ir_node **const block_schedule)
@@ -19,6 +19,11 @@
 #include "irop_t.h"
 #include "irnode_t.h"
 
+/**
+ * Returns the number of spaces be_emit_pad_comment() emits at @p column.
+ */
+size_t be_emit_get_comment_padding(size_t column);
+
 /**
  * Emit spaces until the comment position is reached.
  */
@@ -120,7 +125,7 @@ bool be_is_fallthrough(ir_node const *jmp);
 		} else if (*fmt == 'd') { \
 			++fmt; \
 			int const num = va_arg(ap, int); \
-			be_emit_irprintf("%d", num); \
+			be_emit_int(num); \
 		} else if (*fmt == 's') { \
 			++fmt; \
 			char const *const string = va_arg(ap, char const*); \
@@ -128,7 +133,7 @@ bool be_is_fallthrough(ir_node const *jmp);
 		} else if (*fmt == 'u') { \
 			++fmt; \
 			unsigned const num = va_arg(ap, unsigned); \
-			be_emit_irprintf("%u", num); \
+			be_emit_uint(num); \
 		} else
 
 #define BE_EMIT_JMP(arch, node, name, jmp) \
@@ -13,21 +13,48 @@
 
 #include "irprintf.h"
 #include "panic.h"
+#include <assert.h>
+#include <stdbool.h>
+
+/** Finished lines are collected until this many bytes are pending. */
+#define EMIT_FLUSH_SIZE (64 * 1024)
 
 static FILE    *emit_file;
+static bool     emit_capturing;
 struct obstack  emit_obst;
+size_t          emit_line_start;
 
 void be_emit_init(FILE *file)
 {
-	emit_file = file;
+	emit_file       = file;
+	emit_line_start = 0;
 	obstack_init(&emit_obst);
 }
 
+static void emit_flush(void)
+{
+	size_t const len  = obstack_object_size(&emit_obst);
+	char  *const data = (char*)obstack_finish(&emit_obst);
+	if (emit_file != NULL)
+		fwrite(data, 1, len, emit_file);
+	obstack_free(&emit_obst, data);
+	emit_line_start = 0;
+}
+
 void be_emit_exit(void)
 {
+	emit_flush();
 	obstack_free(&emit_obst, NULL);
 }
 
+void be_emit_redirect(FILE *const file)
+{
+	assert(!emit_capturing);
+	obstack_free(&emit_obst, obstack_finish(&emit_obst));
+	emit_file       = file;
+	emit_line_start = 0;
+}
+
 void be_emit_irvprintf(const char *fmt, va_list args)
 {
 	ir_obst_vprintf(&emit_obst, fmt, args);
@@ -41,10 +68,47 @@ void be_emit_irprintf(const char *fmt, ...)
 	va_end(ap);
 }
 
+void be_emit_uint(uint64_t value)
+{
+	char  buf[20];
+	char *p = buf + sizeof(buf);
+	do {
+		*--p   = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	be_emit_string_len(p, buf + sizeof(buf) - p);
+}
+
+void be_emit_int(int64_t value)
+{
+	if (value < 0) {
+		be_emit_char('-');
+		be_emit_uint(-(uint64_t)value);
+	} else {
+		be_emit_uint(value);
+	}
+}
+
 void be_emit_write_line(void)
 {
-	size_t const len  = obstack_object_size(&emit_obst);
-	char  *const line = (char*)obstack_finish(&emit_obst);
-	fwrite(line, 1, len, emit_file);
-	obstack_free(&emit_obst, line);
+	size_t const len = obstack_object_size(&emit_obst);
+	if (len >= EMIT_FLUSH_SIZE && !emit_capturing)
+		emit_flush();
+	else
+		emit_line_start = len;
+}
+
+void be_emit_capture_begin(void)
+{
+	assert(!emit_capturing);
+	emit_flush();
+	emit_capturing = true;
+}
+
+char const *be_emit_capture_end(size_t *size)
+{
+	assert(emit_capturing);
+	emit_capturing = false;
+	*size = obstack_object_size(&emit_obst);
+	return (char const*)obstack_base(&emit_obst);
 }
@@ -15,11 +15,13 @@
 #ifndef FIRM_BE_BEEMITTER_H
 #define FIRM_BE_BEEMITTER_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include "obst.h"
 
 /* don't use the following vars directly, they're only here for the inlines */
 extern struct obstack  emit_obst;
+extern size_t          emit_line_start;
 
 /**
  * Emit a character to the (assembler) output.
@@ -86,14 +88,45 @@ void be_emit_irprintf(const char *fmt, ...);
 void be_emit_irvprintf(const char *fmt, va_list args);
 
 /**
- * Flush the line in the current line buffer to the emitter file.
+ * Emit a signed decimal number, without going through a format string.
+ */
+void be_emit_int(int64_t value);
+
+/**
+ * Emit an unsigned decimal number, without going through a format string.
+ */
+void be_emit_uint(uint64_t value);
+
+/**
+ * Finish the current line.  Finished lines are buffered and written to the
+ * emitter file in large chunks; be_emit_exit() writes out the remainder.
  */
 void be_emit_write_line(void);
 
+/**
+ * Drops the pending output and writes all further output to @p file, or
+ * discards it if @p file is NULL.
+ */
+void be_emit_redirect(FILE *file);
+
+/**
+ * Start collecting the emitted output instead of writing it to the file.
+ */
+void be_emit_capture_begin(void);
+
+/**
+ * Stop collecting the emitted output.
+ *
+ * @param size  receives the size of the output
+ * @returns the output emitted since be_emit_capture_begin(), which stays valid
+ *          until the next emitter call and is written to the file as usual
+ */
+char const *be_emit_capture_end(size_t *size);
+
 /** Return column in current line. Counting starts at 0. */
 static inline size_t be_emit_get_column(void)
 {
-	return obstack_object_size(&emit_obst);
+	return obstack_object_size(&emit_obst) - emit_line_start;
 }
 
 #endif
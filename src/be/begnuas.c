@@ -13,6 +13,8 @@
 
 #include "be_t.h"
 #include "bearch.h"
+#include "beblocksched.h"
+#include "bedwarf.h"
 #include "beemithlp.h"
 #include "beemitter.h"
 #include "bemodule.h"
@@ -38,6 +40,10 @@ char                   be_gas_elf_type_char = '@';
 static be_gas_section_t current_section = (be_gas_section_t) -1;
 static pmap            *block_numbers;
 static unsigned         next_block_nr;
+/** highest number of an entity emitted since it was last queried */
+static long             max_emitted_entity_nr = -1;
+/** first block of the current function emitted into the cold section */
+static ir_node const   *cold_block;
 
 static bool is_macho(void)
 {
@@ -124,6 +130,7 @@ typedef struct {
 
 static const elf_sectioninfo_t elf_sectioninfos[] = {
 	[GAS_SECTION_TEXT]           = { "text",              "progbits", "ax" },
+	[GAS_SECTION_TEXT_UNLIKELY]  = { "text.unlikely",     "progbits", "ax" },
 	[GAS_SECTION_DATA]           = { "data",              "progbits", "aw" },
 	[GAS_SECTION_RODATA]         = { "rodata",            "progbits", "a"  },
 	[GAS_SECTION_REL_RO_LOCAL]   = { "data.rel.ro.local", "progbits", "aw" },
@@ -481,7 +488,7 @@ static be_gas_section_t determine_basic_section(const ir_entity *entity)
 	return GAS_SECTION_DATA;
 }
 
-static be_gas_section_t determine_section(be_main_env_t const *const main_env, ir_entity const *const entity)
+be_gas_section_t be_gas_get_section(be_main_env_t const *const main_env, ir_entity const *const entity)
 {
 	ir_type *owner = get_entity_owner(entity);
 
@@ -597,7 +604,7 @@ void be_gas_emit_function_prolog(const ir_entity *entity, unsigned po2alignment,
 {
 	be_dwarf_function_before(entity, parameter_infos);
 
-	be_gas_section_t const section = determine_section(NULL, entity);
+	be_gas_section_t const section = be_gas_get_section(NULL, entity);
 	emit_section(section, entity);
 
 	/* write the begin line (makes the life easier for scripts parsing the
@@ -644,8 +651,53 @@ void be_gas_emit_function_prolog(const ir_entity *entity, unsigned po2alignment,
 	be_dwarf_function_begin();
 }
 
+static void emit_cold_name(ir_entity const *const entity)
+{
+	be_gas_emit_entity(entity);
+	be_emit_cstring(".cold");
+}
+
+void be_gas_split_cold_blocks(ir_node **const block_schedule)
+{
+	cold_block = NULL;
+	/* cold code is only split off for plain ELF text sections and without
+	 * debug information, which would have to describe both parts */
+	if (!be_options.opt_split_cold
+	 || ir_platform.object_format != OBJECT_FORMAT_ELF
+	 || be_gas_elf_variant != ELF_VARIANT_NORMAL
+	 || be_dwarf_enabled())
+		return;
+
+	size_t const     n      = ARR_LEN(block_schedule);
+	ir_entity *const entity = get_irg_entity(get_irn_irg(block_schedule[0]));
+	if (be_gas_get_section(NULL, entity) != GAS_SECTION_TEXT)
+		return;
+
+	/* the block schedule places cold blocks last */
+	size_t first = n;
+	while (first > 1 && be_is_cold_block(block_schedule[first - 1]))
+		--first;
+	if (first == n)
+		return;
+
+	cold_block = block_schedule[first];
+	/* control flow must not fall through into the other section */
+	set_irn_link(block_schedule[first], NULL);
+}
+
 void be_gas_emit_function_epilog(ir_entity const *const entity)
 {
+	if (cold_block != NULL) {
+		be_emit_cstring("\t.size\t");
+		emit_cold_name(entity);
+		be_emit_cstring(", .-");
+		emit_cold_name(entity);
+		be_emit_char('\n');
+		be_emit_write_line();
+		emit_section(GAS_SECTION_TEXT, entity);
+		cold_block = NULL;
+	}
+
 	be_dwarf_function_end();
 
 	if (ir_platform.object_format == OBJECT_FORMAT_ELF) {
@@ -721,15 +773,15 @@ static void emit_init_expression(ir_node *const init)
 		return;
 
 	case iro_Offset:
-		be_emit_irprintf("%d", get_entity_offset(get_Offset_entity(init)));
+		be_emit_int(get_entity_offset(get_Offset_entity(init)));
 		return;
 
 	case iro_Align:
-		be_emit_irprintf("%u", get_type_alignment(get_Align_type(init)));
+		be_emit_uint(get_type_alignment(get_Align_type(init)));
 		return;
 
 	case iro_Size:
-		be_emit_irprintf("%u", get_type_size(get_Size_type(init)));
+		be_emit_uint(get_type_size(get_Size_type(init)));
 		return;
 
 	case iro_Add:
@@ -898,7 +950,7 @@ static size_t get_initializer_size(const ir_initializer_t *initializer,
 	panic("found invalid initializer");
 }
 
-static unsigned long compute_entity_size(ir_entity const *const entity)
+unsigned long be_gas_get_entity_size(ir_entity const *const entity)
 {
 	ir_type *const type = get_entity_type(entity);
 	unsigned long  size = get_type_size(type);
@@ -1190,7 +1242,7 @@ static void emit_align(unsigned p2alignment)
 	be_emit_write_line();
 }
 
-static unsigned get_effective_entity_alignment(const ir_entity *entity)
+unsigned be_gas_get_entity_alignment(const ir_entity *entity)
 {
 	unsigned alignment = get_entity_alignment(entity);
 	if (alignment == 0) {
@@ -1203,7 +1255,7 @@ static unsigned get_effective_entity_alignment(const ir_entity *entity)
 static void emit_common(const ir_entity *entity, unsigned long size,
                         bool is_local)
 {
-	unsigned const alignment = get_effective_entity_alignment(entity);
+	unsigned const alignment = be_gas_get_entity_alignment(entity);
 
 	switch (ir_platform.object_format) {
 	case OBJECT_FORMAT_MACH_O:
@@ -1238,7 +1290,7 @@ static void emit_zerofill(const ir_entity *entity, const char *section_segment,
 	be_emit_string(section_segment);
 	be_emit_char(',');
 	be_gas_emit_entity(entity);
-	unsigned const alignment = get_effective_entity_alignment(entity);
+	unsigned const alignment = be_gas_get_entity_alignment(entity);
 	be_emit_irprintf(",%lu,%u\n", size, log2_floor(alignment));
 	be_emit_write_line();
 }
@@ -1297,10 +1349,15 @@ void be_gas_emit_entity(const ir_entity *entity)
 {
 	if (entity->kind == IR_ENTITY_LABEL) {
 		ir_label_t label = get_entity_label(entity);
-		be_emit_irprintf("%s_%lu", be_gas_get_private_prefix(), label);
+		be_emit_string(be_gas_get_private_prefix());
+		be_emit_char('_');
+		be_emit_uint(label);
 		return;
 	}
 
+	if (entity->nr > max_emitted_entity_nr)
+		max_emitted_entity_nr = entity->nr;
+
 	char const *const name         = get_entity_ld_name(entity);
 	bool        const needs_quotes = check_needs_quotes(name);
 	if (needs_quotes)
@@ -1326,8 +1383,114 @@ void be_gas_emit_block_name(const ir_node *block)
 		} else {
 			nr = PTR_TO_INT(nr_val) - 1;
 		}
-		be_emit_irprintf("%s%d", be_gas_get_private_prefix(), nr);
+		be_emit_string(be_gas_get_private_prefix());
+		be_emit_int(nr);
+	}
+}
+
+unsigned be_gas_reserve_block_nrs(unsigned n)
+{
+	unsigned const first = next_block_nr;
+	next_block_nr += n;
+	return first;
+}
+
+static bool is_ident_char(char const c)
+{
+	return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$';
+}
+
+bool be_gas_relocate_block_labels(struct obstack *const obst,
+                                  char const *const text, size_t const size,
+                                  unsigned const begin, unsigned const end,
+                                  long const delta)
+{
+	char const *const prefix     = be_gas_get_private_prefix();
+	size_t      const prefix_len = strlen(prefix);
+	char const *const text_end   = text + size;
+	char const       *copied     = text;
+	char const       *line       = text;
+	/* change of the column by the labels moved in the current line */
+	long              shift      = 0;
+	for (char const *p = text; (size_t)(text_end - p) > prefix_len; ++p) {
+		if (*p == '\n') {
+			line  = p + 1;
+			shift = 0;
+			continue;
+		}
+		if (shift != 0 && *p == ' ' && p[-1] != ' ') {
+			/* realign the padding of a verbose comment */
+			char const *q = p;
+			while (q != text_end && *q == ' ')
+				++q;
+			size_t const column = p - line;
+			if (text_end - q >= 2 && q[0] == '/' && q[1] == '*'
+			 && (size_t)(q - p) == be_emit_get_comment_padding(column)) {
+				size_t const padding
+					= be_emit_get_comment_padding(column + shift);
+				obstack_grow(obst, copied, p - copied);
+				for (size_t i = 0; i < padding; ++i)
+					obstack_1grow(obst, ' ');
+				shift += (long)padding - (q - p);
+				copied = q;
+				p      = q - 1;
+				continue;
+			}
+		}
+		if (memcmp(p, prefix, prefix_len) != 0
+		 || (p != text && is_ident_char(p[-1])))
+			continue;
+
+		char const *const digits = p + prefix_len;
+		if (!isdigit((unsigned char)*digits)) {
+			/* label entities and the unique labels of the ia32 PIC code */
+			if (*digits == '_' || strncmp(digits, "PIC_BASE", 8) == 0)
+				return false;
+			continue;
+		}
+
+		unsigned long nr = 0;
+		char const   *q  = digits;
+		for (; q != text_end && isdigit((unsigned char)*q); ++q) {
+			nr = nr * 10 + (*q - '0');
+			if (nr >= end)
+				return false;
+		}
+		if (nr < begin || (q != text_end && is_ident_char(*q)))
+			return false;
+
+		char buf[32];
+		int const len = snprintf(buf, sizeof(buf), "%ld", (long)nr + delta);
+		obstack_grow(obst, copied, digits - copied);
+		obstack_grow(obst, buf, len);
+		shift += len - (q - digits);
+		copied = q;
+		p      = q - 1;
 	}
+	obstack_grow(obst, copied, text_end - copied);
+	return true;
+}
+
+long be_gas_get_max_emitted_entity_nr(void)
+{
+	long const res = max_emitted_entity_nr;
+	max_emitted_entity_nr = -1;
+	return res;
+}
+
+void be_gas_forget_section(void)
+{
+	current_section = (be_gas_section_t)-1;
+}
+
+be_gas_section_t be_gas_get_current_section(void)
+{
+	return current_section;
+}
+
+void be_gas_set_current_section(be_gas_section_t const section)
+{
+	current_section = section;
 }
 
 static bool block_needs_label(ir_node const *const block)
@@ -1356,6 +1519,17 @@ static bool block_needs_label(ir_node const *const block)
 
 void be_gas_begin_block(ir_node const *const block)
 {
+	if (block == cold_block) {
+		ir_entity const *const entity = get_irg_entity(get_irn_irg(block));
+		emit_section(GAS_SECTION_TEXT_UNLIKELY, entity);
+		be_emit_cstring("\t.type\t");
+		emit_cold_name(entity);
+		be_emit_irprintf(", %cfunction\n", be_gas_elf_type_char);
+		emit_cold_name(entity);
+		be_emit_cstring(":\n");
+		be_emit_write_line();
+	}
+
 	if (block_needs_label(block)) {
 		be_gas_emit_block_name(block);
 		be_emit_char(':');
@@ -1403,7 +1577,7 @@ static void emit_global(be_main_env_t const *const main_env,
 
 	/* we already emitted all functions with graphs in other functions like
 	 * be_gas_emit_function_prolog(). All others don't need to be emitted. */
-	be_gas_section_t const section = determine_section(main_env, entity);
+	be_gas_section_t const section = be_gas_get_section(main_env, entity);
 	if (kind == IR_ENTITY_METHOD && section != GAS_SECTION_PIC_TRAMPOLINES)
 		return;
 
@@ -1419,7 +1593,7 @@ static void emit_global(be_main_env_t const *const main_env,
 	ir_visibility const visibility       = get_entity_visibility(entity);
 	ir_linkage    const linkage          = get_entity_linkage(entity);
 	bool          const zero_initializer = entity_is_zero_initialized(entity);
-	unsigned long       size             = compute_entity_size(entity);
+	unsigned long       size             = be_gas_get_entity_size(entity);
 
 	/* We need to output at least 1 byte, otherwise macho will merge
 	 * the label with the next thing */
@@ -1475,7 +1649,7 @@ static void emit_global(be_main_env_t const *const main_env,
 	}
 
 	/* alignment */
-	unsigned alignment = get_effective_entity_alignment(entity);
+	unsigned alignment = be_gas_get_entity_alignment(entity);
 	if (!is_po2_or_zero(alignment))
 		panic("alignment not a power of 2");
 	if (alignment > 1)
@@ -1544,7 +1718,7 @@ static void emit_global_decls(be_main_env_t const *const main_env)
 	}
 }
 
-void be_emit_jump_table(ir_node const *const node, be_switch_attr_t const *const swtch, ir_mode *const entry_mode, emit_target_func const emit_target)
+ir_node const **be_get_jump_table_targets(ir_node const *const node, be_switch_attr_t const *const swtch, unsigned long *const length_out)
 {
 	/* go over all proj's and collect their jump targets */
 	unsigned        n_outs  = arch_get_irn_n_outs(node);
@@ -1604,6 +1778,22 @@ void be_emit_jump_table(ir_node const *const node, be_switch_attr_t const *const
 		}
 	}
 
+	/* unlisted values go to the default target */
+	for (unsigned long i = 0; i < length; ++i) {
+		if (labels[i] == NULL)
+			labels[i] = targets[0];
+	}
+	free(targets);
+
+	*length_out = length;
+	return labels;
+}
+
+void be_emit_jump_table(ir_node const *const node, be_switch_attr_t const *const swtch, ir_mode *const entry_mode, emit_target_func const emit_target)
+{
+	unsigned long         length;
+	ir_node const **const labels = be_get_jump_table_targets(node, swtch, &length);
+
 	/* emit table */
 	unsigned         const pointer_size = get_mode_size_bytes(entry_mode);
 	ir_entity const *const entity       = swtch->table_entity;
@@ -1616,11 +1806,8 @@ void be_emit_jump_table(ir_node const *const node, be_switch_attr_t const *const
 	}
 
 	for (unsigned long i = 0; i < length; ++i) {
-		ir_node const *target = labels[i];
-		if (target == NULL)
-			target = targets[0];
 		emit_size_type(pointer_size);
-		emit_target(entity, target);
+		emit_target(entity, labels[i]);
 		be_emit_char('\n');
 		be_emit_write_line();
 	}
@@ -1629,7 +1816,6 @@ void be_emit_jump_table(ir_node const *const node, be_switch_attr_t const *const
 		be_gas_emit_switch_section(GAS_SECTION_TEXT);
 
 	free(labels);
-	free(targets);
 }
 
 static void emit_global_asms(void)
@@ -16,9 +16,11 @@
 #include "be_types.h"
 #include "bedwarf.h"
 #include "benode.h"
+#include "obst.h"
 
 typedef enum {
 	GAS_SECTION_TEXT,            /**< text section - program code */
+	GAS_SECTION_TEXT_UNLIKELY,   /**< program code which is rarely executed */
 	GAS_SECTION_DATA,            /**< data section - arbitrary data */
 	GAS_SECTION_RODATA,          /**< read only data no relocations */
 	GAS_SECTION_REL_RO,          /**< read only data containing relocations */
@@ -72,6 +74,13 @@ void be_gas_emit_function_prolog(const ir_entity *entity,
 
 void be_gas_emit_function_epilog(const ir_entity *entity);
 
+/**
+ * Emits the blocks at the end of @p block_schedule which were never executed
+ * according to the profile into a separate section, if the target allows it.
+ * Requires a prior call to be_emit_init_cf_links().
+ */
+void be_gas_split_cold_blocks(ir_node **block_schedule);
+
 char const *be_gas_get_private_prefix(void);
 
 /**
@@ -86,6 +95,46 @@ void be_gas_emit_entity(const ir_entity *entity);
  */
 void be_gas_emit_block_name(const ir_node *block);
 
+/**
+ * Reserves @p n consecutive block label numbers.
+ *
+ * @returns the first reserved number
+ */
+unsigned be_gas_reserve_block_nrs(unsigned n);
+
+/**
+ * Appends @p text to @p obst, adding @p delta to the numbers of all block
+ * labels.  The padding of verbose comments is adapted to the new label
+ * widths.
+ *
+ * @returns false if a label outside of [@p begin, @p end) or a label which
+ *          cannot be moved to another compilation unit was found
+ */
+bool be_gas_relocate_block_labels(struct obstack *obst, char const *text,
+                                  size_t size, unsigned begin, unsigned end,
+                                  long delta);
+
+/**
+ * Returns the highest number of the entities emitted by be_gas_emit_entity()
+ * since the last call, or -1 if there were none.
+ */
+long be_gas_get_max_emitted_entity_nr(void);
+
+/**
+ * Forgets the current output section, so the next section switch is emitted
+ * even if it does not change the section.
+ */
+void be_gas_forget_section(void);
+
+/** Returns the current output section. */
+be_gas_section_t be_gas_get_current_section(void);
+
+/**
+ * Sets the current output section without emitting a section switch, e.g.
+ * after code emitted by another process.
+ */
+void be_gas_set_current_section(be_gas_section_t section);
+
 /**
  * Starts a basic block. Emits an assembler label "blockname:" if any control
  * flow predecessor does not fall through, otherwise a comment with the
@@ -122,8 +171,33 @@ void be_gas_end_compilation_unit(const be_main_env_t *env);
  */
 const char *be_gas_insn_label_prefix(void);
 
+/**
+ * Returns the section @p entity is placed in. @p main_env may be NULL for
+ * entities which cannot live in the PIC segments.
+ */
+be_gas_section_t be_gas_get_section(be_main_env_t const *main_env,
+                                    ir_entity const *entity);
+
+/**
+ * Returns the number of bytes occupied by @p entity.  This may be larger than
+ * the size of its type if the initializer fills a flexible array.
+ */
+unsigned long be_gas_get_entity_size(ir_entity const *entity);
+
+/** Returns the alignment of @p entity, falling back to its type's. */
+unsigned be_gas_get_entity_alignment(ir_entity const *entity);
+
 typedef void (*emit_target_func)(ir_entity const *table, ir_node const *proj_x);
 
+/**
+ * Returns the jump targets (control flow Projs) of switch @p node indexed by
+ * the normalized switch value.  The number of entries is stored in
+ * @p length.  The caller has to free() the result.
+ */
+ir_node const **be_get_jump_table_targets(ir_node const *node,
+                                          be_switch_attr_t const *swtch,
+                                          unsigned long *length);
+
 /**
  * Emits a jump table for switch operations
  */
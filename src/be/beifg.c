@@ -11,6 +11,7 @@
  */
 #include "beifg.h"
 
+#include "array.h"
 #include "bechordal_t.h"
 #include "beirg.h"
 #include "belive.h"
@@ -20,15 +21,46 @@
 #include "irnode_t.h"
 #include "lc_opts.h"
 #include "lc_opts_enum.h"
+#include "raw_bitset.h"
 #include "timing.h"
+#include "util.h"
 #include "xmalloc.h"
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+
+/** Graphs with at most this many nodes get an adjacency bit matrix. */
+#define IFG_MATRIX_MAX_NODES 2048
 
 void be_ifg_free(be_ifg_t *self)
 {
+	if (self->nodes != NULL)
+		DEL_ARR_F(self->nodes);
+	free(self->node_pos);
+	free(self->adj_begin);
+	free(self->adj);
+	free(self->matrix);
 	free(self);
 }
 
+/** Returns the position of @p irn in the list flavor or UINT_MAX. */
+static unsigned get_node_pos(const be_ifg_t *ifg, const ir_node *irn)
+{
+	unsigned const idx = get_irn_idx(irn);
+	return idx < ifg->n_idx ? ifg->node_pos[idx] : UINT_MAX;
+}
+
+/** Returns the bit of the edge between positions @p a and @p b. */
+static size_t matrix_bit(unsigned a, unsigned b)
+{
+	if (a < b) {
+		unsigned const t = a;
+		a = b;
+		b = t;
+	}
+	return (size_t)a * (a - 1) / 2 + b;
+}
+
 static void nodes_walker(ir_node *bl, void *data)
 {
 	nodes_iter_t     *it   = (nodes_iter_t*)data;
@@ -45,10 +77,18 @@ static void nodes_walker(ir_node *bl, void *data)
 nodes_iter_t be_ifg_nodes_begin(be_ifg_t const *const ifg)
 {
 	nodes_iter_t iter;
-	obstack_init(&iter.obst);
-	iter.n    = 0;
 	iter.curr = 0;
 	iter.env  = ifg->env;
+	if (ifg->nodes != NULL) {
+		iter.on_obst = false;
+		iter.n       = ifg->n_nodes;
+		iter.nodes   = ifg->nodes;
+		return iter;
+	}
+
+	obstack_init(&iter.obst);
+	iter.on_obst = true;
+	iter.n       = 0;
 
 	irg_block_walk_graph(ifg->env->irg, nodes_walker, NULL, &iter);
 	obstack_ptr_grow(&iter.obst, NULL);
@@ -61,7 +101,8 @@ ir_node *be_ifg_nodes_next(nodes_iter_t *const it)
 	if (it->curr < it->n) {
 		return it->nodes[it->curr++];
 	} else {
-		obstack_free(&it->obst, NULL);
+		if (it->on_obst)
+			obstack_free(&it->obst, NULL);
 		return NULL;
 	}
 }
@@ -101,6 +142,22 @@ static void find_neighbours(const be_ifg_t *ifg, neighbours_iter_t *it, const ir
 	it->env         = ifg->env;
 	it->irn         = irn;
 	it->valid       = 1;
+	it->adj         = NULL;
+
+	if (ifg->nodes != NULL) {
+		unsigned const pos = get_node_pos(ifg, irn);
+		it->nodes   = ifg->nodes;
+		it->adj_pos = 0;
+		if (pos == UINT_MAX) {
+			it->adj   = ifg->adj;
+			it->n_adj = 0;
+		} else {
+			it->adj   = &ifg->adj[ifg->adj_begin[pos]];
+			it->n_adj = ifg->adj_begin[pos + 1] - ifg->adj_begin[pos];
+		}
+		return;
+	}
+
 	ir_nodeset_init(&it->neighbours);
 
 	dom_tree_walk(get_nodes_block(irn), find_neighbour_walker, NULL, it);
@@ -112,12 +169,19 @@ static inline void neighbours_break(neighbours_iter_t *it, int force)
 {
 	(void) force;
 	assert(it->valid == 1);
-	ir_nodeset_destroy(&it->neighbours);
+	if (it->adj == NULL)
+		ir_nodeset_destroy(&it->neighbours);
 	it->valid = 0;
 }
 
 static ir_node *get_next_neighbour(neighbours_iter_t *it)
 {
+	if (it->adj != NULL) {
+		if (it->adj_pos < it->n_adj)
+			return it->nodes[it->adj[it->adj_pos++]];
+		return NULL;
+	}
+
 	ir_node *res = ir_nodeset_iterator_next(&it->iter);
 
 	if (res == NULL) {
@@ -242,6 +306,13 @@ void be_ifg_cliques_break(cliques_iter_t *iter)
 
 int be_ifg_degree(const be_ifg_t *ifg, const ir_node *irn)
 {
+	if (ifg->nodes != NULL) {
+		unsigned const pos = get_node_pos(ifg, irn);
+		if (pos == UINT_MAX)
+			return 0;
+		return ifg->adj_begin[pos + 1] - ifg->adj_begin[pos];
+	}
+
 	neighbours_iter_t it;
 	int degree;
 	find_neighbours(ifg, &it, irn);
@@ -250,11 +321,187 @@ int be_ifg_degree(const be_ifg_t *ifg, const ir_node *irn)
 	return degree;
 }
 
-be_ifg_t *be_create_ifg(const be_chordal_env_t *env)
+bool be_ifg_connected(const be_ifg_t *ifg, const ir_node *a, const ir_node *b)
+{
+	/* the std flavor has no edges to look up, ask liveness directly instead
+	 * of collecting all neighbours of a */
+	if (ifg->nodes == NULL)
+		return a != b && be_values_interfere(a, b);
+
+	unsigned const pos_a = get_node_pos(ifg, a);
+	unsigned const pos_b = get_node_pos(ifg, b);
+	if (pos_a == UINT_MAX || pos_b == UINT_MAX || pos_a == pos_b)
+		return false;
+	if (ifg->matrix != NULL)
+		return rbitset_is_set(ifg->matrix, matrix_bit(pos_a, pos_b));
+
+	/* binary search in the sorted neighbours of a */
+	unsigned lo = ifg->adj_begin[pos_a];
+	unsigned hi = ifg->adj_begin[pos_a + 1];
+	while (lo < hi) {
+		unsigned const md = lo + (hi - lo) / 2;
+		unsigned const other = ifg->adj[md];
+		if (other == pos_b)
+			return true;
+		if (other < pos_b)
+			lo = md + 1;
+		else
+			hi = md;
+	}
+	return false;
+}
+
+typedef struct ifg_edge_t {
+	unsigned a; /**< the position of the first node */
+	unsigned b; /**< the position of the second node, larger than a */
+} ifg_edge_t;
+
+typedef struct build_env_t {
+	be_ifg_t   *ifg;
+	unsigned   *live;      /**< ARR_F of the positions of the live nodes */
+	unsigned   *live_slot; /**< position -> slot in live */
+	ifg_edge_t *edges;     /**< ARR_F of all edges, may contain duplicates */
+} build_env_t;
+
+static void collect_nodes_walker(ir_node *bl, void *data)
+{
+	build_env_t      *env  = (build_env_t*)data;
+	be_ifg_t         *ifg  = env->ifg;
+	struct list_head *head = get_block_border_head(ifg->env, bl);
+
+	foreach_border_head(head, b) {
+		if (b->is_def && b->is_real) {
+			ifg->node_pos[get_irn_idx(b->irn)] = ARR_LEN(ifg->nodes);
+			ARR_APP1(ir_node*, ifg->nodes, b->irn);
+		}
+	}
+}
+
+/**
+ * Walks the borders of a block and connects every value with all values
+ * live at its definition.
+ */
+static void collect_edges_walker(ir_node *bl, void *data)
+{
+	build_env_t      *env  = (build_env_t*)data;
+	be_ifg_t         *ifg  = env->ifg;
+	struct list_head *head = get_block_border_head(ifg->env, bl);
+
+	foreach_border_head(head, b) {
+		unsigned const pos = get_node_pos(ifg, b->irn);
+		if (pos == UINT_MAX)
+			continue;
+
+		if (b->is_def) {
+			for (size_t i = 0, n = ARR_LEN(env->live); i < n; ++i) {
+				unsigned const other = env->live[i];
+				ifg_edge_t const edge = {
+					pos < other ? pos : other, pos < other ? other : pos
+				};
+				ARR_APP1(ifg_edge_t, env->edges, edge);
+			}
+			env->live_slot[pos] = ARR_LEN(env->live);
+			ARR_APP1(unsigned, env->live, pos);
+		} else {
+			/* remove the dead value by moving the last one into its slot */
+			unsigned const slot = env->live_slot[pos];
+			unsigned const last = env->live[ARR_LEN(env->live) - 1];
+			env->live[slot]       = last;
+			env->live_slot[last]  = slot;
+			ARR_SHRINKLEN(env->live, ARR_LEN(env->live) - 1);
+		}
+	}
+	assert(ARR_LEN(env->live) == 0);
+}
+
+static int cmp_edge(const void *a, const void *b)
 {
-	be_ifg_t *ifg = XMALLOC(be_ifg_t);
+	ifg_edge_t const *const e0 = (ifg_edge_t const*)a;
+	ifg_edge_t const *const e1 = (ifg_edge_t const*)b;
+	if (e0->a != e1->a)
+		return e0->a < e1->a ? -1 : 1;
+	if (e0->b != e1->b)
+		return e0->b < e1->b ? -1 : 1;
+	return 0;
+}
+
+/**
+ * Builds the adjacency lists of the list flavor, so consumers querying
+ * the neighbours of a node repeatedly do not walk the dominance subtree of
+ * the node every time.
+ */
+static void build_adjacency_lists(be_ifg_t *ifg)
+{
+	ir_graph *const irg   = ifg->env->irg;
+	unsigned  const n_idx = get_irg_last_idx(irg);
+
+	build_env_t env;
+	env.ifg       = ifg;
+	env.live      = NEW_ARR_F(unsigned, 0);
+	env.edges     = NEW_ARR_F(ifg_edge_t, 0);
+	ifg->n_idx    = n_idx;
+	ifg->node_pos = XMALLOCN(unsigned, n_idx);
+	memset(ifg->node_pos, 0xFF, n_idx * sizeof(*ifg->node_pos));
+
+	ifg->nodes = NEW_ARR_F(ir_node*, 0);
+	irg_block_walk_graph(irg, collect_nodes_walker, NULL, &env);
+	unsigned const n_nodes = ARR_LEN(ifg->nodes);
+
+	env.live_slot = XMALLOCN(unsigned, n_nodes);
+	irg_block_walk_graph(irg, collect_edges_walker, NULL, &env);
+	free(env.live_slot);
+	DEL_ARR_F(env.live);
+
+	/* values live into several blocks produce the same edge repeatedly */
+	size_t n_edges = ARR_LEN(env.edges);
+	QSORT_ARR(env.edges, cmp_edge);
+	size_t n_unique = 0;
+	for (size_t i = 0; i < n_edges; ++i) {
+		if (n_unique == 0 || cmp_edge(&env.edges[n_unique - 1], &env.edges[i]) != 0)
+			env.edges[n_unique++] = env.edges[i];
+	}
+	n_edges = n_unique;
+
+	/* As the edges are sorted, each adjacency list gets sorted, too:
+	 * smaller neighbours are appended first by their own edge groups. */
+	unsigned *const adj_begin = XMALLOCNZ(unsigned, n_nodes + 1);
+	for (size_t i = 0; i < n_edges; ++i) {
+		++adj_begin[env.edges[i].a + 1];
+		++adj_begin[env.edges[i].b + 1];
+	}
+	for (unsigned i = 0; i < n_nodes; ++i)
+		adj_begin[i + 1] += adj_begin[i];
+
+	unsigned *const adj  = XMALLOCN(unsigned, 2 * n_edges + 1);
+	unsigned *const fill = XMALLOCN(unsigned, n_nodes + 1);
+	MEMCPY(fill, adj_begin, n_nodes + 1);
+	for (size_t i = 0; i < n_edges; ++i) {
+		ifg_edge_t const *const edge = &env.edges[i];
+		adj[fill[edge->a]++] = edge->b;
+		adj[fill[edge->b]++] = edge->a;
+	}
+	free(fill);
+
+	if (n_nodes <= IFG_MATRIX_MAX_NODES) {
+		ifg->matrix = rbitset_malloc(matrix_bit(n_nodes, 0) + 1);
+		for (size_t i = 0; i < n_edges; ++i)
+			rbitset_set(ifg->matrix, matrix_bit(env.edges[i].a, env.edges[i].b));
+	}
+	DEL_ARR_F(env.edges);
+
+	ifg->n_nodes   = n_nodes;
+	ifg->adj_begin = adj_begin;
+	ifg->adj       = adj;
+}
+
+be_ifg_t *be_create_ifg(const be_chordal_env_t *env, be_ifg_flavor_t flavor)
+{
+	be_ifg_t *ifg = XMALLOCZ(be_ifg_t);
 	ifg->env = env;
 
+	if (flavor == BE_IFG_LIST)
+		build_adjacency_lists(ifg);
+
 	return ifg;
 }
 
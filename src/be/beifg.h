@@ -18,13 +18,33 @@
 #include "obstack.h"
 #include "pset.h"
 
+/**
+ * Interference graph flavors.
+ */
+typedef enum be_ifg_flavor_t {
+	BE_IFG_STD  = 1, /**< neighbours are recomputed from the borders */
+	BE_IFG_LIST = 2, /**< materialized adjacency lists */
+} be_ifg_flavor_t;
+
 struct be_ifg_t {
 	const be_chordal_env_t *env;
+	/* The following fields are only used by the list flavor. */
+	ir_node               **nodes;      /**< ARR_F of all nodes in block walk
+	                                         order */
+	unsigned                n_nodes;
+	unsigned                n_idx;      /**< size of node_pos */
+	unsigned               *node_pos;   /**< node index -> position in nodes */
+	unsigned               *adj_begin;  /**< neighbours of nodes[i] are
+	                                         adj[adj_begin[i] .. adj_begin[i+1]] */
+	unsigned               *adj;        /**< sorted positions of neighbours */
+	unsigned               *matrix;     /**< triangular adjacency bit matrix
+	                                         for small graphs, or NULL */
 };
 
 typedef struct nodes_iter_t {
 	const be_chordal_env_t *env;
 	struct obstack         obst;
+	bool                   on_obst;     /**< nodes are allocated on obst */
 	int                    n;
 	int                    curr;
 	ir_node                **nodes;
@@ -36,6 +56,10 @@ typedef struct neighbours_iter_t {
 	int                   valid;
 	ir_nodeset_t          neighbours;
 	ir_nodeset_iterator_t iter;
+	ir_node       *const *nodes;        /**< list flavor: the ifg nodes */
+	unsigned const       *adj;          /**< list flavor: the neighbours */
+	unsigned              n_adj;
+	unsigned              adj_pos;
 } neighbours_iter_t;
 
 typedef struct cliques_iter_t {
@@ -61,6 +85,12 @@ int      be_ifg_cliques_next(cliques_iter_t *iter);
 void     be_ifg_cliques_break(cliques_iter_t *iter);
 int      be_ifg_degree(const be_ifg_t *ifg, const ir_node *irn);
 
+/**
+ * Check whether there is an interference edge between @p a and @p b.
+ */
+bool     be_ifg_connected(const be_ifg_t *ifg, const ir_node *a,
+                          const ir_node *b);
+
 #define be_ifg_foreach_neighbour(ifg, iter, irn, pos) \
 	for (ir_node *pos = be_ifg_neighbours_begin(ifg, iter, irn); pos; pos = be_ifg_neighbours_next(iter))
 
@@ -82,6 +112,10 @@ typedef struct {
 
 void be_ifg_stat(ir_graph *irg, be_ifg_t *ifg, be_ifg_stat_t *stat);
 
-be_ifg_t *be_create_ifg(const be_chordal_env_t *env);
+/**
+ * Create the interference graph of the register class of @p env.
+ * The border lists of @p env must not change while the graph is in use.
+ */
+be_ifg_t *be_create_ifg(const be_chordal_env_t *env, be_ifg_flavor_t flavor);
 
 #endif
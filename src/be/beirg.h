@@ -55,6 +55,11 @@ typedef struct be_irg_t {
 	/** Architecture specific per-graph data */
 	void             *isa_link;
 	bool              has_returns_twice_call;
+	/** CSE setting before entering the backend, restored by be_step_last() */
+	int               saved_cse;
+	/** Favor compile time over code quality: use the trivial scheduler and
+	 * the preference allocator regardless of the selected modules. */
+	bool              fast_tier;
 } be_irg_t;
 
 static inline be_irg_t *be_birg_from_irg(const ir_graph *irg)
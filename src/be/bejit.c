@@ -19,12 +19,24 @@
 #include "entity_t.h"
 #include "obst.h"
 #include "panic.h"
+#include "tv.h"
+#include "util.h"
+#include "xmalloc.h"
 #include <assert.h>
 #include <limits.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 typedef enum reloc_dest_kind_t {
 	RELOC_DEST_CODE_FRAGMENT,
 	RELOC_DEST_ENTITY,
+	RELOC_DEST_LITERAL,
 } reloc_dest_kind_t;
 
 typedef struct relocation_t {
@@ -34,6 +46,7 @@ typedef struct relocation_t {
 	int32_t                   dest_offset;
 	union dest {
 		uint16_t   fragment_num;
+		uint16_t   literal_num;
 		ir_entity *entity;
 	} dest;
 } relocation_t;
@@ -47,10 +60,36 @@ typedef struct fragment_info_t {
 	relocation_t relocations[];
 } fragment_info_t;
 
+/** A source location recorded while encoding, see be_jit_location(). */
+typedef struct location_t {
+	uint16_t  fragment_num;
+	unsigned  offset;       /**< offset in the fragment, address after layout */
+	dbg_info *dbgi;
+} location_t;
+
+/**
+ * A literal placed behind the code of a function, see
+ * be_emit_reloc_literal().
+ */
+typedef struct literal_t {
+	ir_entity *entity;
+	bool       data;    /**< copy of the initializer instead of the address */
+	unsigned   address; /**< address from begin of the function */
+} literal_t;
+
+/** A block of executable memory owned by a jit segment. */
+typedef struct jit_mapping_t {
+	void   *base;
+	size_t  size;
+} jit_mapping_t;
+
 struct ir_jit_segment_t {
 	struct obstack code_obst;
 	struct obstack fragment_info_obst;
 	struct obstack fragment_info_arr_obst;
+	struct obstack location_obst;
+	struct obstack literal_obst;
+	jit_mapping_t *mappings; /**< executable memory, ARR_F */
 };
 
 struct ir_jit_function_t {
@@ -58,11 +97,22 @@ struct ir_jit_function_t {
 	unsigned          n_fragments;
 	char const       *code;
 	fragment_info_t **fragment_infos;
+	size_t            n_locations;
+	location_t       *locations;
+	unsigned          n_literals;
+	literal_t        *literals;
 };
 
 struct obstack        *code_obst;
 static struct obstack *fragment_info_obst;
 static struct obstack *fragment_info_arr_obst;
+static struct obstack *location_obst;
+static struct obstack *literal_obst;
+
+/** Alignment of functions emitted by be_jit_emit_executable(). */
+#define JIT_FUNCTION_ALIGN 16
+
+static void free_executable(jit_mapping_t const *mapping);
 
 ir_jit_segment_t *be_new_jit_segment(void)
 {
@@ -70,6 +120,9 @@ ir_jit_segment_t *be_new_jit_segment(void)
 	obstack_init(&segment->code_obst);
 	obstack_init(&segment->fragment_info_obst);
 	obstack_init(&segment->fragment_info_arr_obst);
+	obstack_init(&segment->location_obst);
+	obstack_init(&segment->literal_obst);
+	segment->mappings = NEW_ARR_F(jit_mapping_t, 0);
 	return segment;
 }
 
@@ -78,6 +131,11 @@ void be_destroy_jit_segment(ir_jit_segment_t *segment)
 	obstack_free(&segment->code_obst, NULL);
 	obstack_free(&segment->fragment_info_obst, NULL);
 	obstack_free(&segment->fragment_info_arr_obst, NULL);
+	obstack_free(&segment->location_obst, NULL);
+	obstack_free(&segment->literal_obst, NULL);
+	for (size_t i = 0, n = ARR_LEN(segment->mappings); i < n; ++i)
+		free_executable(&segment->mappings[i]);
+	DEL_ARR_F(segment->mappings);
 	free(segment);
 }
 
@@ -98,9 +156,27 @@ void be_jit_begin_function(ir_jit_segment_t *const segment)
 	assert(obstack_object_size(&segment->code_obst) == 0);
 	assert(obstack_object_size(&segment->fragment_info_obst) == 0);
 	assert(obstack_object_size(&segment->fragment_info_arr_obst) == 0);
+	assert(obstack_object_size(&segment->location_obst) == 0);
+	assert(obstack_object_size(&segment->literal_obst) == 0);
 	code_obst              = &segment->code_obst;
 	fragment_info_obst     = &segment->fragment_info_obst;
 	fragment_info_arr_obst = &segment->fragment_info_arr_obst;
+	location_obst          = &segment->location_obst;
+	literal_obst           = &segment->literal_obst;
+}
+
+static unsigned get_literal_size(literal_t const *const literal)
+{
+	if (!literal->data)
+		return sizeof(void*);
+	return get_type_size(get_entity_type(literal->entity));
+}
+
+static unsigned get_literal_alignment(literal_t const *const literal)
+{
+	if (!literal->data)
+		return sizeof(void*);
+	return MAX(get_type_alignment(get_entity_type(literal->entity)), 1);
 }
 
 static void layout_fragments(ir_jit_function_t *const function,
@@ -130,9 +206,20 @@ static void layout_fragments(ir_jit_function_t *const function,
 		orig_address += fragment->len;
 #endif
 	}
+	for (unsigned i = 0, n = function->n_literals; i < n; ++i) {
+		literal_t *const literal = &function->literals[i];
+		address          = round_up2(address, get_literal_alignment(literal));
+		literal->address = address;
+		address         += get_literal_size(literal);
+	}
 	function->size = address;
 	assert(code_size == orig_address);
 	(void)code_size;
+
+	for (size_t i = 0, n = function->n_locations; i < n; ++i) {
+		location_t *const location = &function->locations[i];
+		location->offset += fragment_infos[location->fragment_num]->address;
+	}
 }
 
 ir_jit_function_t *be_jit_finish_function(void)
@@ -146,10 +233,20 @@ ir_jit_function_t *be_jit_finish_function(void)
 
 	unsigned const code_size = obstack_object_size(code_obst);
 
+	size_t const location_size = obstack_object_size(location_obst);
+	assert(location_size % sizeof(location_t) == 0);
+
+	size_t const literal_size = obstack_object_size(literal_obst);
+	assert(literal_size % sizeof(literal_t) == 0);
+
 	ir_jit_function_t *const res = OALLOCZ(obst, ir_jit_function_t);
 	res->n_fragments    = n_fragments;
 	res->fragment_infos = fragment_infos;
 	res->code           = obstack_finish(code_obst);
+	res->n_locations    = location_size / sizeof(location_t);
+	res->locations      = obstack_finish(location_obst);
+	res->n_literals     = literal_size / sizeof(literal_t);
+	res->literals       = obstack_finish(literal_obst);
 
 	layout_fragments(res, code_size);
 
@@ -157,6 +254,8 @@ ir_jit_function_t *be_jit_finish_function(void)
 	code_obst              = NULL;
 	fragment_info_obst     = NULL;
 	fragment_info_arr_obst = NULL;
+	location_obst          = NULL;
+	literal_obst           = NULL;
 #endif
 
 	return res;
@@ -167,6 +266,27 @@ unsigned be_get_function_size(ir_jit_function_t const *const function)
 	return function->size;
 }
 
+unsigned be_jit_get_fragment_address(ir_jit_function_t const *const function,
+                                     unsigned const fragment_num)
+{
+	assert(fragment_num < function->n_fragments);
+	return function->fragment_infos[fragment_num]->address;
+}
+
+size_t be_jit_get_n_locations(ir_jit_function_t const *const function)
+{
+	return function->n_locations;
+}
+
+dbg_info *be_jit_get_location(ir_jit_function_t const *const function,
+                              size_t const i, unsigned *const address)
+{
+	assert(i < function->n_locations);
+	location_t const *const location = &function->locations[i];
+	*address = location->offset;
+	return location->dbgi;
+}
+
 unsigned be_begin_fragment(uint8_t const p2align, uint8_t const max_skip)
 {
 	assert(obstack_object_size(fragment_info_obst) == 0);
@@ -203,6 +323,27 @@ void be_finish_fragment(void)
 #endif
 }
 
+void be_jit_location(dbg_info *const dbgi)
+{
+	size_t const size = obstack_object_size(location_obst);
+	if (size > 0) {
+		location_t const *const last
+			= (location_t const*)((char const*)obstack_base(location_obst) + size) - 1;
+		if (last->dbgi == dbgi)
+			return;
+	}
+
+	fragment_info_t const *const fragment = obstack_base(fragment_info_obst);
+	assert(obstack_object_size(fragment_info_obst) >= sizeof(fragment_info_t));
+	location_t const location = {
+		.fragment_num = obstack_object_size(fragment_info_arr_obst)
+		                / sizeof(fragment_info_t*),
+		.offset       = obstack_object_size(code_obst) - fragment->address,
+		.dbgi         = dbgi,
+	};
+	obstack_grow(location_obst, &location, sizeof(location));
+}
+
 static void be_emit_relocation(unsigned const len, relocation_t *const relocation)
 {
 	fragment_info_t *const fragment = obstack_base(fragment_info_obst);
@@ -240,6 +381,36 @@ void be_emit_reloc_entity(unsigned const len, uint8_t be_kind,
 	be_emit_relocation(len, &relocation);
 }
 
+void be_emit_reloc_literal(unsigned const len, uint8_t const be_kind,
+                           ir_entity *const entity, bool const data,
+                           int32_t const offset)
+{
+	literal_t const *const literals = obstack_base(literal_obst);
+	size_t           const n        = obstack_object_size(literal_obst)
+	                                  / sizeof(literal_t);
+	size_t                 num      = 0;
+	for (; num < n; ++num) {
+		if (literals[num].entity == entity && literals[num].data == data)
+			break;
+	}
+	if (num == n) {
+		literal_t const literal = {
+			.entity  = entity,
+			.data    = data,
+			.address = ~0u,
+		};
+		obstack_grow(literal_obst, &literal, sizeof(literal));
+	}
+
+	relocation_t relocation = {
+		.be_kind          = be_kind,
+		.dest_kind        = RELOC_DEST_LITERAL,
+		.dest_offset      = offset,
+		.dest.literal_num = num,
+	};
+	be_emit_relocation(len, &relocation);
+}
+
 static int32_t resolve_relocation_code(ir_jit_function_t const *const function,
                                        relocation_t const *const relocation,
                                        unsigned const relocation_address)
@@ -267,6 +438,14 @@ static unsigned emit_relocation(ir_jit_function_t const *const function,
 	case RELOC_DEST_ENTITY:
 		return emit(relocation_abs, relocation->be_kind,
 		            relocation->dest.entity, relocation->dest_offset);
+	case RELOC_DEST_LITERAL: {
+		unsigned const literal_num = relocation->dest.literal_num;
+		assert(literal_num < function->n_literals);
+		unsigned const dest_address
+			= function->literals[literal_num].address + relocation->dest_offset;
+		return emit(relocation_abs, relocation->be_kind, NULL,
+		            (int32_t)dest_address - relocation_address);
+	}
 	}
 	panic("Invalid relocation");
 }
@@ -303,6 +482,8 @@ static void emit_fragment_as_asm(ir_jit_function_t const *const function,
 void be_jit_emit_as_asm(ir_jit_function_t *const function,
                         emit_relocation_func const emit)
 {
+	assert(function->n_literals == 0);
+
 	/* Move fragments to their final addresses */
 	char const *const code         = function->code;
 	unsigned          orig_address = 0;
@@ -350,6 +531,27 @@ static void emit_fragment(ir_jit_function_t const *const function,
 	memcpy(d, b, end-b);
 }
 
+static void emit_literal(char *const buffer, literal_t const *const literal)
+{
+	ir_entity *const entity = literal->entity;
+	if (!literal->data) {
+		void const *const address = be_jit_get_entity_addr(entity);
+		if (address == (void const*)-1)
+			panic("Could not resolve address of entity %+F", entity);
+		memcpy(buffer, &address, sizeof(address));
+		return;
+	}
+
+	ir_initializer_t const *const init = get_entity_initializer(entity);
+	assert(get_initializer_kind(init) == IR_INITIALIZER_TARVAL);
+	ir_tarval *const tv   = get_initializer_tarval_value(init);
+	unsigned   const size = get_literal_size(literal);
+	unsigned   const n    = MIN(get_mode_size_bytes(get_tarval_mode(tv)), size);
+	for (unsigned i = 0; i < n; ++i)
+		buffer[i] = get_tarval_sub_bits(tv, i);
+	memset(buffer + n, 0, size - n);
+}
+
 void be_jit_emit_memory(char *const buffer, ir_jit_function_t *const function,
                         be_jit_emit_interface_t const *const emitter)
 {
@@ -360,7 +562,7 @@ void be_jit_emit_memory(char *const buffer, ir_jit_function_t *const function,
 	for (size_t i = 0, n = function->n_fragments; i < n; ++i) {
 		fragment_info_t const *const fragment  = function->fragment_infos[i];
 		unsigned               const address   = fragment->address;
-		unsigned               const nop_bytes = last_address - address;
+		unsigned               const nop_bytes = address - last_address;
 		assert(address >= last_address);
 		if (nop_bytes > 0)
 			emitter->nops(buffer + last_address, nop_bytes);
@@ -371,4 +573,104 @@ void be_jit_emit_memory(char *const buffer, ir_jit_function_t *const function,
 		orig_address += fragment->len;
 		last_address = address + fragment->len;
 	}
+
+	for (unsigned i = 0, n = function->n_literals; i < n; ++i) {
+		literal_t const *const literal = &function->literals[i];
+		assert(literal->address >= last_address);
+		if (literal->address > last_address)
+			emitter->nops(buffer + last_address, literal->address - last_address);
+		emit_literal(buffer + literal->address, literal);
+		last_address = literal->address + get_literal_size(literal);
+	}
+}
+
+/** Returns the granularity of memory protection changes. */
+static size_t get_page_size(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	long const page_size = sysconf(_SC_PAGESIZE);
+	return page_size > 0 ? (size_t)page_size : 4096;
+#endif
+}
+
+/** Allocates @p size bytes of writable, not executable memory. */
+static void *alloc_writable(size_t const size)
+{
+#ifdef _WIN32
+	return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	void *const res = mmap(NULL, size, PROT_READ | PROT_WRITE,
+	                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return res != MAP_FAILED ? res : NULL;
+#endif
+}
+
+/** Turns memory from alloc_writable() into executable, read-only memory. */
+static bool make_executable(void *const base, size_t const size)
+{
+#ifdef _WIN32
+	DWORD old_protect;
+	if (!VirtualProtect(base, size, PAGE_EXECUTE_READ, &old_protect))
+		return false;
+	return FlushInstructionCache(GetCurrentProcess(), base, size);
+#else
+	if (mprotect(base, size, PROT_READ | PROT_EXEC) != 0)
+		return false;
+	__builtin___clear_cache((char*)base, (char*)base + size);
+	return true;
+#endif
+}
+
+static void free_executable(jit_mapping_t const *const mapping)
+{
+#ifdef _WIN32
+	VirtualFree(mapping->base, 0, MEM_RELEASE);
+#else
+	munmap(mapping->base, mapping->size);
+#endif
+}
+
+void *be_jit_emit_executable(ir_jit_segment_t *const segment,
+                             size_t const n_functions,
+                             ir_jit_function_t *const *const functions,
+                             ir_entity *const *const entities,
+                             void **const addresses)
+{
+	/* Lay out all functions in a single mapping. */
+	unsigned size = 0;
+	for (size_t i = 0; i < n_functions; ++i) {
+		size  = round_up2(size, JIT_FUNCTION_ALIGN);
+		size += be_get_function_size(functions[i]);
+	}
+	size_t const page_size = get_page_size();
+	size_t const map_size  = (MAX(size, 1) + page_size - 1) & ~(page_size - 1);
+
+	char *const base = (char*)alloc_writable(map_size);
+	if (base == NULL)
+		return NULL;
+
+	/* Publish all addresses before emitting, so the functions may reference
+	 * each other. */
+	unsigned address = 0;
+	for (size_t i = 0; i < n_functions; ++i) {
+		address       = round_up2(address, JIT_FUNCTION_ALIGN);
+		addresses[i]  = base + address;
+		address      += be_get_function_size(functions[i]);
+		if (entities != NULL && entities[i] != NULL)
+			be_jit_set_entity_addr(entities[i], addresses[i]);
+	}
+	for (size_t i = 0; i < n_functions; ++i)
+		be_emit_function((char*)addresses[i], functions[i]);
+
+	jit_mapping_t const mapping = { .base = base, .size = map_size };
+	if (!make_executable(base, map_size)) {
+		free_executable(&mapping);
+		return NULL;
+	}
+	ARR_APP1(jit_mapping_t, segment->mappings, mapping);
+	return base;
 }
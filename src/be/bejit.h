@@ -12,6 +12,8 @@
 #ifndef FIRM_BE_BEEMITTER_BINARY_H
 #define FIRM_BE_BEEMITTER_BINARY_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "firm_types.h"
@@ -38,6 +40,27 @@ void be_jit_emit_as_asm(ir_jit_function_t *function, emit_relocation_func emit);
 void be_jit_begin_function(ir_jit_segment_t *segment);
 ir_jit_function_t *be_jit_finish_function(void);
 
+/** Returns the address of a fragment relative to the function start. */
+unsigned be_jit_get_fragment_address(ir_jit_function_t const *function,
+                                     unsigned fragment_num);
+
+/**
+ * Records that the code emitted next into the current fragment stems from
+ * the source location @p dbgi.
+ */
+void be_jit_location(dbg_info *dbgi);
+
+/** Returns the number of source locations recorded for @p function. */
+size_t be_jit_get_n_locations(ir_jit_function_t const *function);
+
+/**
+ * Returns the @p i-th source location of @p function and stores its address
+ * relative to the function start in @p address.  Locations are sorted by
+ * address.
+ */
+dbg_info *be_jit_get_location(ir_jit_function_t const *function, size_t i,
+                              unsigned *address);
+
 unsigned be_begin_fragment(uint8_t p2align, uint8_t max_skip);
 void be_finish_fragment(void);
 
@@ -67,4 +90,13 @@ void be_emit_reloc_fragment(unsigned len, uint8_t be_kind,
 void be_emit_reloc_entity(unsigned len, uint8_t be_kind, ir_entity *entity,
                           int32_t offset);
 
+/**
+ * Emits a relocation to a literal placed behind the code of the function.
+ * The literal holds the address of @p entity or, if @p data is set, a copy of
+ * its initializer, which has to be a tarval.  The relocation is resolved like
+ * one to a code fragment, so @p offset is relative to the literal.
+ */
+void be_emit_reloc_literal(unsigned len, uint8_t be_kind, ir_entity *entity,
+                           bool data, int32_t offset);
+
 #endif
@@ -0,0 +1,297 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Compiles the functions of a compilation unit in worker
+ *              processes.
+ *
+ * With n jobs set by be_main_jobs(), be_begin() forks n-1 workers once all
+ * graphs are prepared, so each worker has its own copy of the backend state,
+ * the obstacks and the emitter.  All processes then run the same backend loop
+ * and the k-th graph reaching be_step_first() belongs to process k mod n, the
+ * main process being process 0.  A worker skips the graphs of the other
+ * processes and sends the assembler text of its own graphs through a pipe,
+ * one record per graph in the order of the graphs.  The main process compiles
+ * its own graphs and emits the text of the other graphs in place of compiling
+ * them, so the output keeps the order of a sequential compilation.  The
+ * workers return from be_main_jobs() and the driver ends them.
+ *
+ * Block labels are moved to the numbering of the main process like the
+ * entries of the code cache.  The main process switches to the section of
+ * the function itself and continues in the section the code of the worker
+ * ended in, so the section switches are the same as in a sequential
+ * compilation.  Only the node numbers in the comments of verbose assembler
+ * output differ.  Code referring to entities created by the backend or to
+ * label entities cannot be moved between processes, the main process
+ * compiles such graphs itself.  So does it for the remaining graphs of a
+ * worker which failed.
+ */
+#include "bejobs.h"
+
+#include "be_t.h"
+#include "bedwarf.h"
+#include "beelf.h"
+#include "beemitter.h"
+#include "begnuas.h"
+#include "irgraph_t.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "statev.h"
+#include "util.h"
+#include "xmalloc.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/** Size of a record whose code cannot be moved to the main process. */
+#define NO_CODE UINT32_MAX
+
+typedef struct worker_t {
+	pid_t pid;
+	FILE *in;  /**< the records of the worker, NULL if it failed */
+} worker_t;
+
+static unsigned  requested_jobs = 1; /**< set by be_main_jobs() */
+static unsigned  n_jobs;           /**< number of processes, 0 if inactive */
+static unsigned  job;              /**< number of this process */
+static worker_t *workers;          /**< the workers of the main process */
+static FILE     *out;              /**< the records of this worker */
+static unsigned  n_lookups;
+static long      first_entity_nr;  /**< first entity created by the backend */
+static bool      recording;        /**< recording the current graph */
+static unsigned  first_block_nr;
+
+static void start_worker(unsigned const nr, int const fd)
+{
+	for (unsigned i = 1; i < nr; ++i) {
+		if (workers[i].in != NULL)
+			fclose(workers[i].in);
+	}
+	free(workers);
+	workers = NULL;
+	job     = nr;
+	out     = fdopen(fd, "wb");
+	/* without a pipe the main process compiles the graphs of this worker */
+	if (out == NULL)
+		close(fd);
+
+	/* the main process writes the output, statistics and timings */
+	be_emit_redirect(NULL);
+	stat_ev_enabled   = 0;
+	be_timing         = 0;
+	be_options.timing = false;
+}
+
+void be_jobs_set(unsigned const n)
+{
+	requested_jobs = n;
+}
+
+bool be_jobs_is_worker(void)
+{
+	return job != 0;
+}
+
+void be_jobs_begin(void)
+{
+	n_jobs    = 0;
+	job       = 0;
+	n_lookups = 0;
+	recording = false;
+	/* the code cache already skips the backend for unchanged graphs */
+	if (requested_jobs <= 1 || be_options.cache_dir[0] != '\0'
+	 || be_elf_enabled() || be_dwarf_enabled()
+	 || be_options.opt_profile_generate)
+		return;
+
+	unsigned const n = requested_jobs;
+	first_entity_nr = irp->max_node_nr;
+	workers         = XMALLOCNZ(worker_t, n);
+	n_jobs          = n;
+	for (unsigned i = 1; i < n; ++i) {
+		int fds[2];
+		if (pipe(fds) != 0)
+			break;
+		pid_t const pid = fork();
+		if (pid == 0) {
+			close(fds[0]);
+			start_worker(i, fds[1]);
+			return;
+		}
+		close(fds[1]);
+		if (pid < 0) {
+			close(fds[0]);
+			break;
+		}
+		workers[i].pid = pid;
+		workers[i].in  = fdopen(fds[0], "rb");
+	}
+}
+
+/**
+ * Emits the next code sent by @p worker, if there is any.  The code of a
+ * function in @p section starts without a switch to it.
+ */
+static bool emit_record(worker_t *const worker, be_gas_section_t const section)
+{
+	FILE *const in = worker->in;
+	if (in == NULL)
+		return false;
+
+	uint32_t header[3];
+	if (fread(header, sizeof(*header), ARRAY_SIZE(header), in)
+	    != ARRAY_SIZE(header))
+		goto failed;
+	uint32_t const n_blocks = header[0];
+	uint32_t const size     = header[1];
+	uint32_t const end      = header[2];
+	if (size == NO_CODE)
+		return false;
+	char *const text = XMALLOCN(char, size);
+	if (fread(text, 1, size, in) != size) {
+		free(text);
+		goto failed;
+	}
+
+	struct obstack obst;
+	obstack_init(&obst);
+	unsigned const base = be_gas_reserve_block_nrs(0);
+	bool     const res  = be_gas_relocate_block_labels(&obst, text, size, 0,
+	                                                   n_blocks, base);
+	if (res) {
+		be_gas_reserve_block_nrs(n_blocks);
+		/* comdat code always starts with its own section switch */
+		if (!(section & GAS_SECTION_FLAG_COMDAT))
+			be_gas_emit_switch_section(section);
+		size_t const len = obstack_object_size(&obst);
+		be_emit_string_len((char const*)obstack_finish(&obst), len);
+		be_emit_write_line();
+		be_gas_set_current_section((be_gas_section_t)end);
+	}
+	obstack_free(&obst, NULL);
+	free(text);
+	return res;
+
+failed:
+	/* compile the remaining graphs of the worker here */
+	fclose(in);
+	worker->in = NULL;
+	return false;
+}
+
+bool be_jobs_lookup(ir_graph *const irg)
+{
+	recording = false;
+	if (n_jobs == 0)
+		return false;
+
+	unsigned         const owner   = n_lookups++ % n_jobs;
+	be_gas_section_t const section
+		= be_gas_get_section(NULL, get_irg_entity(irg));
+	if (job == 0)
+		return owner != 0 && emit_record(&workers[owner], section);
+	if (owner != job || out == NULL)
+		return true;
+
+	recording      = true;
+	first_block_nr = be_gas_reserve_block_nrs(0);
+	/* the main process switches to the section of the function */
+	be_gas_set_current_section(section);
+	be_gas_get_max_emitted_entity_nr();
+	be_emit_capture_begin();
+	return false;
+}
+
+void be_jobs_store(void)
+{
+	if (!recording)
+		return;
+	recording = false;
+
+	size_t             size;
+	char const  *const text      = be_emit_capture_end(&size);
+	unsigned     const end       = be_gas_reserve_block_nrs(0);
+	long         const max_nr    = be_gas_get_max_emitted_entity_nr();
+	uint32_t           header[3] = {
+		end - first_block_nr, NO_CODE, be_gas_get_current_section()
+	};
+	struct obstack     obst;
+	obstack_init(&obst);
+	if (max_nr < first_entity_nr && size < NO_CODE
+	 && be_gas_relocate_block_labels(&obst, text, size, first_block_nr, end,
+	                                 -(long)first_block_nr))
+		header[1] = obstack_object_size(&obst);
+	fwrite(header, sizeof(*header), ARRAY_SIZE(header), out);
+	if (header[1] != NO_CODE)
+		fwrite(obstack_finish(&obst), 1, header[1], out);
+	/* the main process is possibly waiting for the code */
+	fflush(out);
+	obstack_free(&obst, NULL);
+}
+
+void be_jobs_finish(void)
+{
+	unsigned const n = n_jobs;
+	if (n == 0)
+		return;
+	n_jobs = 0;
+
+	if (job != 0) {
+		/* the rest of the backend runs into the discarded output */
+		if (out != NULL)
+			fclose(out);
+		out = NULL;
+		return;
+	}
+
+	for (unsigned i = 1; i < n; ++i) {
+		worker_t *const worker = &workers[i];
+		if (worker->in != NULL)
+			fclose(worker->in);
+		if (worker->pid > 0)
+			waitpid(worker->pid, NULL, 0);
+	}
+	free(workers);
+	workers = NULL;
+}
+
+#else
+
+/* the workers rely on fork() */
+
+void be_jobs_set(unsigned const n)
+{
+	(void)n;
+}
+
+bool be_jobs_is_worker(void)
+{
+	return false;
+}
+
+void be_jobs_begin(void)
+{
+}
+
+bool be_jobs_lookup(ir_graph *const irg)
+{
+	(void)irg;
+	return false;
+}
+
+void be_jobs_store(void)
+{
+}
+
+void be_jobs_finish(void)
+{
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Compiles the functions of a compilation unit in worker
+ *              processes.
+ */
+#ifndef FIRM_BE_BEJOBS_H
+#define FIRM_BE_BEJOBS_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+/** Sets the number of processes compiling the next compilation unit. */
+void be_jobs_set(unsigned n);
+
+/** Returns true in a worker process. */
+bool be_jobs_is_worker(void);
+
+/**
+ * Starts the worker processes for the current compilation unit if more than
+ * one job is set.  Must be called at the end of be_begin().
+ */
+void be_jobs_begin(void);
+
+/**
+ * Decides where the next graph is compiled.  In a worker the backend has to
+ * skip all graphs of the other processes.  In the main process the code of a
+ * graph compiled by a worker is emitted and the backend has to skip the
+ * graph.
+ *
+ * @returns true if the backend has to skip the graph
+ */
+bool be_jobs_lookup(ir_graph *irg);
+
+/** Sends the code emitted since be_jobs_lookup() to the main process. */
+void be_jobs_store(void);
+
+/**
+ * Closes the pipe of a worker process and waits for the workers in the main
+ * process.  Must be called at the beginning of be_finish().
+ */
+void be_jobs_finish(void);
+
+#endif
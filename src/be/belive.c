@@ -18,6 +18,11 @@
 #include "irprintf.h"
 #include "irdump_t.h"
 #include "irnodeset.h"
+#include "irtools.h"
+#include "lc_opts.h"
+#include "lc_opts_enum.h"
+#include "panic.h"
+#include "raw_bitset.h"
 
 #include "statev_t.h"
 #include "be_t.h"
@@ -58,30 +63,103 @@ static unsigned _be_liveness_bsearch(be_lv_info_t const *const arr, ir_node cons
 	return res;
 }
 
-be_lv_info_node_t *be_lv_get(const be_lv_t *li, const ir_node *bl,
-                             const ir_node *irn)
+/** Representation of the liveness sets. */
+typedef enum lv_representation_t {
+	LV_REPR_SORTED, /**< sorted arrays only */
+	LV_REPR_DENSE,  /**< additional dense bitsets */
+	LV_REPR_AUTO,   /**< dense bitsets for large graphs */
+} lv_representation_t;
+
+static int lv_representation = LV_REPR_AUTO;
+
+/** Graphs with fewer nodes use sorted arrays only with LV_REPR_AUTO. */
+#define LV_DENSE_MIN_NODES      4096
+/** Memory limit for the dense bitsets with LV_REPR_AUTO. */
+#define LV_DENSE_MAX_BYTES      (16u << 20)
+
+/**
+ * Decides whether to keep dense bitsets in addition to the sorted arrays.
+ * Membership tests in the sorted arrays need a binary search, which is
+ * noticeable for large graphs with many values live per block.
+ *
+ * @return the number of bits of the dense sets, 0 if they are not used
+ */
+static unsigned choose_dense_size(unsigned const n_idx, unsigned const n_blocks)
+{
+	switch ((lv_representation_t)lv_representation) {
+	case LV_REPR_SORTED:
+		return 0;
+	case LV_REPR_DENSE:
+		return n_idx;
+	case LV_REPR_AUTO: {
+		double const bytes = 3.0 * BITSET_SIZE_BYTES(n_idx) * n_blocks;
+		return n_idx >= LV_DENSE_MIN_NODES && bytes <= LV_DENSE_MAX_BYTES
+		     ? n_idx : 0;
+	}
+	}
+	panic("invalid liveness representation");
+}
+
+/** Returns the dense set of @p info for the liveness state bit @p i. */
+static unsigned *lv_dense_set(be_lv_t const *const lv,
+                              be_lv_info_t const *const info, unsigned const i)
+{
+	return info->dense + i * BITSET_SIZE_ELEMS(lv->n_dense_idx);
+}
+
+/** Adds the liveness state @p flags of @p irn to the dense sets of @p info. */
+static void lv_dense_add(be_lv_t const *const lv, be_lv_info_t const *const info,
+                         ir_node const *const irn, be_lv_state_t const flags)
+{
+	unsigned const idx = get_irn_idx(irn);
+	if (info->dense == NULL || idx >= lv->n_dense_idx)
+		return;
+	for (unsigned i = 0; i < 3; ++i) {
+		if (flags & (1u << i))
+			rbitset_set(lv_dense_set(lv, info, i), idx);
+	}
+}
+
+/** Adds the liveness state @p flags to the entry @p n of the block @p info. */
+static void lv_add_flags(be_lv_t const *const lv, be_lv_info_t const *const info,
+                         be_lv_info_node_t *const n, be_lv_state_t const flags)
+{
+	n->flags |= flags;
+	lv_dense_add(lv, info, n->node, flags);
+}
+
+be_lv_state_t be_lv_get_state(const be_lv_t *li, const ir_node *bl,
+                              const ir_node *irn)
 {
 	stat_ev_tim_push();
-	be_lv_info_t      *irn_live = ir_nodehashmap_get(be_lv_info_t, &li->map, bl);
-	be_lv_info_node_t *res      = NULL;
+	be_lv_info_t *irn_live = ir_nodehashmap_get(be_lv_info_t, &li->map, bl);
+	be_lv_state_t res      = be_lv_state_none;
 	if (irn_live != NULL) {
-		/* Get the position of the index in the array. */
-		unsigned pos = _be_liveness_bsearch(irn_live, irn);
+		unsigned const idx = get_irn_idx(irn);
+		if (irn_live->dense != NULL && idx < li->n_dense_idx) {
+			for (unsigned i = 0; i < 3; ++i) {
+				if (rbitset_is_set(lv_dense_set(li, irn_live, i), idx))
+					res |= (be_lv_state_t)(1u << i);
+			}
+		} else {
+			/* Get the position of the index in the array. */
+			unsigned pos = _be_liveness_bsearch(irn_live, irn);
 
-		/* Get the record in question. */
-		be_lv_info_node_t *const rec = &irn_live->nodes[pos];
+			/* Get the record in question. */
+			be_lv_info_node_t *const rec = &irn_live->nodes[pos];
 
-		/* Check, if the irn is in deed in the array. */
-		if (rec->node == irn)
-			res = rec;
+			/* Check, if the irn is in deed in the array. */
+			if (rec->node == irn)
+				res = rec->flags;
+		}
 	}
-	stat_ev_tim_pop("be_lv_get");
+	stat_ev_tim_pop("be_lv_get_state");
 
 	return res;
 }
 
 static be_lv_info_node_t *be_lv_get_or_set(be_lv_t *li, ir_node *bl,
-                                           ir_node *irn)
+                                           ir_node *irn, be_lv_info_t **info)
 {
 	assert(get_irn_mode(irn) != mode_T);
 
@@ -89,6 +167,10 @@ static be_lv_info_node_t *be_lv_get_or_set(be_lv_t *li, ir_node *bl,
 	if (irn_live == NULL) {
 		irn_live = OALLOCFZ(&li->obst, be_lv_info_t, nodes, LV_STD_SIZE);
 		irn_live->n_size = LV_STD_SIZE;
+		if (li->n_dense_idx != 0) {
+			size_t const n_bits = 3 * BITSET_SIZE_ELEMS(li->n_dense_idx) * BITS_PER_ELEM;
+			irn_live->dense = rbitset_obstack_alloc(&li->obst, n_bits);
+		}
 		ir_nodehashmap_insert(&li->map, bl, irn_live);
 	}
 
@@ -123,6 +205,7 @@ static be_lv_info_node_t *be_lv_get_or_set(be_lv_t *li, ir_node *bl,
 		res->flags = 0;
 	}
 
+	*info = irn_live;
 	return res;
 }
 
@@ -155,6 +238,12 @@ static void lv_remove_irn_walker(ir_node *const bl, void *const data)
 	irn_live->nodes[n - 1].node  = NULL;
 	irn_live->nodes[n - 1].flags = 0;
 
+	unsigned const idx = get_irn_idx(irn);
+	if (irn_live->dense != NULL && idx < w->lv->n_dense_idx) {
+		for (unsigned i = 0; i < 3; ++i)
+			rbitset_clear(lv_dense_set(w->lv, irn_live, i), idx);
+	}
+
 	--irn_live->n_members;
 	DBG((dbg, LEVEL_3, "\tdeleting %+F from %+F at pos %d\n", irn, bl, pos));
 }
@@ -174,13 +263,14 @@ static struct {
  */
 static void live_end_at_block(ir_node *const block, be_lv_state_t const state)
 {
-	be_lv_info_node_t *const n      = be_lv_get_or_set(re.lv, block, re.def);
+	be_lv_info_t             *info;
+	be_lv_info_node_t *const n      = be_lv_get_or_set(re.lv, block, re.def, &info);
 	be_lv_state_t      const before = n->flags;
 
 	assert(state == be_lv_state_end || state == (be_lv_state_end | be_lv_state_out));
 	DBG((dbg, LEVEL_2, "marking %+F live %s at %+F\n", re.def,
 	     state & be_lv_state_out ? "end+out" : "end", block));
-	n->flags |= state;
+	lv_add_flags(re.lv, info, n, state);
 
 	/* There is no need to recurse further, if we where here before (i.e., any
 	 * live state bits were set before). */
@@ -192,7 +282,7 @@ static void live_end_at_block(ir_node *const block, be_lv_state_t const state)
 		return;
 
 	DBG((dbg, LEVEL_2, "marking %+F live in at %+F\n", re.def, block));
-	n->flags |= be_lv_state_in;
+	lv_add_flags(re.lv, info, n, be_lv_state_in);
 
 	for (unsigned i = get_Block_n_cfgpreds(block); i-- > 0;) {
 		ir_node *const pred_block = get_Block_cfgpred_block(block, i);
@@ -235,9 +325,10 @@ static void liveness_for_node(ir_node *irn)
 		} else if (def_block != use_block) {
 			/* Else, the value is live in at this block. Mark it and call live
 			 * out on the predecessors. */
-			be_lv_info_node_t *const n = be_lv_get_or_set(re.lv, use_block, irn);
+			be_lv_info_t             *info;
+			be_lv_info_node_t *const n = be_lv_get_or_set(re.lv, use_block, irn, &info);
 			DBG((dbg, LEVEL_2, "marking %+F live in at %+F\n", irn, use_block));
-			n->flags |= be_lv_state_in;
+			lv_add_flags(re.lv, info, n, be_lv_state_in);
 
 			for (unsigned i = get_Block_n_cfgpreds(use_block); i-- > 0; ) {
 				ir_node *pred_block = get_Block_cfgpred_block(use_block, i);
@@ -247,15 +338,22 @@ static void liveness_for_node(ir_node *irn)
 	}
 }
 
+typedef struct collect_env_t {
+	ir_node **nodes;
+	unsigned  n_blocks;
+} collect_env_t;
+
 /**
  * Walker, collect all nodes for which we want calculate liveness info
  * on an obstack.
  */
 static void collect_liveness_nodes(ir_node *irn, void *data)
 {
-	ir_node **nodes = (ir_node**)data;
+	collect_env_t *const env = (collect_env_t*)data;
 	if (is_liveness_node(irn))
-		nodes[get_irn_idx(irn)] = irn;
+		env->nodes[get_irn_idx(irn)] = irn;
+	else if (is_Block(irn))
+		++env->n_blocks;
 }
 
 void be_liveness_compute_sets(be_lv_t *lv)
@@ -269,21 +367,22 @@ void be_liveness_compute_sets(be_lv_t *lv)
 
 	ir_graph *irg = lv->irg;
 	unsigned n = get_irg_last_idx(irg);
-	ir_node **const nodes = NEW_ARR_FZ(ir_node*, n);
+	collect_env_t env = { NEW_ARR_FZ(ir_node*, n), 0 };
 
 	/* inserting the variables sorted by their ID is probably
 	 * more efficient since the binary sorted set insertion
 	 * will not need to move around the data. */
-	irg_walk_graph(irg, NULL, collect_liveness_nodes, nodes);
+	irg_walk_graph(irg, NULL, collect_liveness_nodes, &env);
 
+	lv->n_dense_idx = choose_dense_size(n, env.n_blocks);
 	re.lv = lv;
 
 	for (unsigned i = 0; i < n; ++i) {
-		if (nodes[i] != NULL)
-			liveness_for_node(nodes[i]);
+		if (env.nodes[i] != NULL)
+			liveness_for_node(env.nodes[i]);
 	}
 
-	DEL_ARR_F(nodes);
+	DEL_ARR_F(env.nodes);
 	lv->sets_valid = true;
 	be_timer_pop(T_LIVE);
 }
@@ -355,6 +454,17 @@ void be_liveness_update(be_lv_t *lv, ir_node *irn)
 	be_liveness_introduce(lv, irn);
 }
 
+void be_liveness_update_values(be_lv_t *const lv, unsigned const *const values,
+                               unsigned const n_idx)
+{
+	ir_graph *const irg = lv->irg;
+	rbitset_foreach(values, n_idx, idx) {
+		ir_node *const node = get_idx_irn(irg, idx);
+		if (node != NULL && !is_Deleted(node) && is_liveness_node(node))
+			be_liveness_update(lv, node);
+	}
+}
+
 void be_liveness_transfer(const arch_register_class_t *cls,
                           ir_node *node, ir_nodeset_t *nodeset)
 {
@@ -564,6 +674,23 @@ static void be_live_chk_compare(be_lv_t *lv, lv_chk_t *lvc)
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_live)
 void be_init_live(void)
 {
+	static const lc_opt_enum_int_items_t representation_items[] = {
+		{ "sorted", LV_REPR_SORTED },
+		{ "dense",  LV_REPR_DENSE  },
+		{ "auto",   LV_REPR_AUTO   },
+		{ NULL,     0              }
+	};
+	static lc_opt_enum_int_var_t representation_var = {
+		&lv_representation, representation_items
+	};
+	static const lc_opt_table_entry_t options[] = {
+		LC_OPT_ENT_ENUM_INT("liveness", "representation of the liveness sets",
+		                    &representation_var),
+		LC_OPT_LAST
+	};
+	lc_opt_entry_t *be_grp = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_add_table(be_grp, options);
+
 	(void)be_live_chk_compare;
 	FIRM_DBG_REGISTER(dbg, "firm.be.liveness");
 }
@@ -76,6 +76,16 @@ void be_liveness_remove(be_lv_t *lv, const ir_node *irn);
  */
 void be_liveness_introduce(be_lv_t *lv, ir_node *irn);
 
+/**
+ * Update the liveness information of all values whose index is set in the
+ * raw bitset @p values, e.g. because their users changed.
+ * @param lv      The liveness info.
+ * @param values  Raw bitset over node indices.
+ * @param n_idx   Size of @p values.
+ */
+void be_liveness_update_values(be_lv_t *lv, unsigned const *values,
+                               unsigned n_idx);
+
 /**
  * The liveness transfer function.
  * Updates a live set over a single step from a given node to its predecessor.
@@ -133,6 +143,7 @@ struct be_lv_t {
 	ir_nodehashmap_t map;
 	struct obstack   obst;
 	bool             sets_valid;
+	unsigned         n_dense_idx; /**< size of the dense sets, 0 if unused */
 	ir_graph        *irg;
 	lv_chk_t        *lvc;
 };
@@ -144,19 +155,21 @@ struct be_lv_info_node_t {
 };
 
 struct be_lv_info_t {
+	/** Optional dense representation: the raw bitsets of the values live in,
+	 * live end and live out, each of be_lv_t::n_dense_idx bits. */
+	unsigned         *dense;
 	unsigned          n_members;
 	unsigned          n_size;
 	be_lv_info_node_t nodes[];
 };
 
-be_lv_info_node_t *be_lv_get(const be_lv_t *li, const ir_node *block,
-                             const ir_node *irn);
+be_lv_state_t be_lv_get_state(const be_lv_t *li, const ir_node *block,
+                              const ir_node *irn);
 
 static inline be_lv_state_t be_get_live_state(be_lv_t const *const li, ir_node const *const block, ir_node const *const irn)
 {
 	if (li->sets_valid) {
-		be_lv_info_node_t *info = be_lv_get(li, block, irn);
-		return info ? info->flags : be_lv_state_none;
+		return be_lv_get_state(li, block, irn);
 	} else {
 		return lv_chk_bl_xxx(li->lvc, block, irn);
 	}
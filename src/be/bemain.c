@@ -11,8 +11,11 @@
  */
 #include "be_t.h"
 #include "beasm.h"
+#include "becache.h"
+#include "bejobs.h"
 #include "bechordal_t.h"
 #include "bediagnostic.h"
+#include "beelf.h"
 #include "beemitter.h"
 #include "begnuas.h"
 #include "beifg.h"
@@ -39,7 +42,7 @@
 #include "irgopt.h"
 #include "irloop_t.h"
 #include "iroptimize.h"
-#include "irprofile.h"
+#include "irprofile_t.h"
 #include "irprog.h"
 #include "irtools.h"
 #include "irverify.h"
@@ -64,6 +67,10 @@ be_options_t be_options = {
 	.do_verify            = true,
 	.ilp_solver           = "",
 	.verbose_asm          = true,
+	.opt_split_cold       = true,
+	.elf_object           = false,
+	.cache_dir            = "",
+	.cache_size           = 256,
 };
 
 /* possible dumping options */
@@ -91,8 +98,12 @@ static const lc_opt_table_entry_t be_main_options[] = {
 	LC_OPT_ENT_BOOL     ("profilegenerate", "instrument the code for execution count profiling", &be_options.opt_profile_generate),
 	LC_OPT_ENT_BOOL     ("profileuse",      "use existing profile data",                         &be_options.opt_profile_use),
 	LC_OPT_ENT_BOOL     ("verboseasm", "enable verbose assembler output",                        &be_options.verbose_asm),
+	LC_OPT_ENT_BOOL     ("splitcold",  "move code never executed in the profile to .text.unlikely", &be_options.opt_split_cold),
+	LC_OPT_ENT_BOOL     ("elfobject",  "write an ELF object file instead of assembler (ia32 and amd64 only)", &be_options.elf_object),
 
 	LC_OPT_ENT_STR("ilp.solver", "the ilp solver name", &be_options.ilp_solver),
+	LC_OPT_ENT_STR("cache",      "reuse the code of unchanged functions from this directory", &be_options.cache_dir),
+	LC_OPT_ENT_INT("cachesize",  "size limit of the code cache in MiB", &be_options.cache_size),
 	LC_OPT_LAST
 };
 
@@ -382,7 +393,10 @@ void be_begin(FILE *file_handle, const char *cup_name)
 	if (prof_init_irg != NULL)
 		initialize_birg(&birgs[num_birgs++], prof_init_irg, &env);
 
-	be_gas_begin_compilation_unit(&env);
+	if (!be_elf_enabled())
+		be_gas_begin_compilation_unit(&env);
+	be_cache_begin();
+	be_jobs_begin();
 }
 
 void firm_be_finish(void)
@@ -457,13 +471,15 @@ void be_lower_for_target(void)
 	}
 }
 
-static int cse_setting;
-
 bool be_step_first(ir_graph *irg)
 {
 	ir_entity *const entity = get_irg_entity(irg);
 	if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
 		return false;
+	if (be_jobs_lookup(irg) || be_cache_lookup(irg)) {
+		be_free_birg(irg);
+		return false;
+	}
 
 	be_timer_push(T_OTHER);
 	if (stat_ev_enabled) {
@@ -471,7 +487,7 @@ bool be_step_first(ir_graph *irg)
 		stat_ev_ull("bemain_insns_start", be_count_insns(irg));
 		stat_ev_ull("bemain_blocks_start", be_count_blocks(irg));
 	}
-	cse_setting = get_opt_cse();
+	be_birg_from_irg(irg)->saved_cse = get_opt_cse();
 	return true;
 }
 
@@ -518,6 +534,8 @@ void be_step_last(ir_graph *irg)
 		stat_ev_ull("bemain_blocks_finish", be_count_blocks(irg));
 	}
 
+	be_cache_store();
+	be_jobs_store();
 	be_dump(DUMP_FINAL, irg, "final");
 	be_regalloc_verify(irg);
 
@@ -543,15 +561,21 @@ void be_step_last(ir_graph *irg)
 		}
 	}
 
+	int const saved_cse = be_birg_from_irg(irg)->saved_cse;
 	be_free_birg(irg);
 	stat_ev_ctx_pop("bemain_irg");
 
-	set_opt_cse(cse_setting);
+	set_opt_cse(saved_cse);
 }
 
 void be_finish(void)
 {
-	be_gas_end_compilation_unit(&env);
+	be_jobs_finish();
+	if (be_elf_enabled()) {
+		be_elf_finish(&env);
+	} else {
+		be_gas_end_compilation_unit(&env);
+	}
 
 	if (be_options.timing) {
 		ir_timer_stop(bemain_timer);
@@ -564,6 +588,7 @@ void be_finish(void)
 		}
 	}
 
+	be_cache_finish();
 	if (stat_ev_enabled) {
 		stat_ev_ctx_pop("bemain_compilation_unit");
 	}
@@ -583,24 +608,46 @@ void be_main(FILE *file_handle, const char *cup_name)
 	ir_target.isa->generate_code(file_handle, cup_name);
 }
 
+int be_main_jobs(FILE *const file_handle, const char *const cup_name,
+                 unsigned const n_jobs)
+{
+	be_jobs_set(n_jobs);
+	be_main(file_handle, cup_name);
+	be_jobs_set(1);
+	return be_jobs_is_worker();
+}
+
 ir_jit_function_t *be_jit_compile(ir_jit_segment_t *const segment,
                                   ir_graph *const irg)
+{
+	return be_jit_compile_tier(segment, irg, ir_jit_tier_default);
+}
+
+ir_jit_function_t *be_jit_compile_tier(ir_jit_segment_t *const segment,
+                                       ir_graph *const irg,
+                                       ir_jit_tier_t const tier)
 {
 	if (ir_target.isa->jit_compile == NULL)
 		return NULL;
 
-	obstack_init(&obst);
-
 	ir_entity *entity = get_irg_entity(irg);
 	if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
 		return NULL;
-	be_irg_t *const birg = OALLOCZ(&obst, be_irg_t);
-	initialize_birg(birg, irg, &env);
+	/* The backend is done with the graph when jit_compile returns, so the
+	 * birg need not outlive this call. Do not use the global obstack here, it
+	 * belongs to be_main(), and the graph obstack gets replaced during code
+	 * selection. */
+	be_irg_t birg;
+	initialize_birg(&birg, irg, &env);
+	birg.fast_tier = tier == ir_jit_tier_fast;
 	if (ir_target.isa->handle_intrinsics)
 		ir_target.isa->handle_intrinsics(irg);
 	be_dump(DUMP_INITIAL, irg, "prepared");
 
-	return ir_target.isa->jit_compile(segment, irg);
+	ir_jit_function_t *const res = ir_target.isa->jit_compile(segment, irg);
+	if (irg->be_data != NULL)
+		be_free_birg(irg);
+	return res;
 }
 
 void be_emit_function(char *const buffer, ir_jit_function_t *const function)
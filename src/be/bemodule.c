@@ -145,17 +145,11 @@ static bool set_opt_module(void *const data, size_t const length, char const *co
 	(void)length;
 
 	const module_opt_data_t *moddata = (module_opt_data_t*)data;
-	bool                     res     = false;
-	for (const be_module_list_entry_t *module = *(moddata->list_head);
-	     module != NULL; module = module->next) {
-		if (streq(module->name, opt)) {
-			*(moddata->var) = module->data;
-			res = true;
-			break;
-		}
-	}
-
-	return res;
+	void                    *module  = be_find_module(*moddata->list_head, opt);
+	if (module == NULL)
+		return false;
+	*(moddata->var) = module;
+	return true;
 }
 
 /**
@@ -215,6 +209,17 @@ void be_add_module_to_list(be_module_list_entry_t **list_head, const char *name,
 	*list_head  = entry;
 }
 
+void *be_find_module(be_module_list_entry_t const *const list_head,
+                     char const *const name)
+{
+	for (be_module_list_entry_t const *module = list_head; module != NULL;
+	     module = module->next) {
+		if (streq(module->name, name))
+			return module->data;
+	}
+	return NULL;
+}
+
 /**
  * Add an option for a module.
  */
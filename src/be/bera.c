@@ -11,6 +11,7 @@
  */
 #include "bera.h"
 
+#include "beirg.h"
 #include "bemodule.h"
 #include "irtools.h"
 
@@ -27,7 +28,15 @@ void be_register_allocator(const char *name, allocate_func allocator)
 
 void be_allocate_registers(ir_graph *irg, const regalloc_if_t *regif)
 {
-	selected_allocator(irg, regif);
+	allocate_func allocator = selected_allocator;
+	if (be_birg_from_irg(irg)->fast_tier) {
+		/* single pass allocation without copy minimization */
+		allocate_func const pref
+			= (allocate_func)be_find_module(register_allocators, "pref");
+		if (pref != NULL)
+			allocator = pref;
+	}
+	allocator(irg, regif);
 }
 
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_ra)
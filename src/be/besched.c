@@ -10,6 +10,7 @@
  */
 #include "besched.h"
 
+#include "beirg.h"
 #include "belistsched.h"
 #include "belive.h"
 #include "bemodule.h"
@@ -153,7 +154,14 @@ void be_register_scheduler(const char *name, schedule_func func)
 
 void be_schedule_graph(ir_graph *irg)
 {
-	scheduler(irg);
+	schedule_func func = scheduler;
+	if (be_birg_from_irg(irg)->fast_tier) {
+		schedule_func const trivial
+			= (schedule_func)be_find_module(schedulers, "trivial");
+		if (trivial != NULL)
+			func = trivial;
+	}
+	func(irg);
 }
 
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_sched)
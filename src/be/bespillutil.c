@@ -22,6 +22,7 @@
 #include "bespill.h"
 #include "bessaconstr.h"
 #include "beutil.h"
+#include "beverify.h"
 #include "debug.h"
 #include "execfreq.h"
 #include "ident_t.h"
@@ -32,6 +33,7 @@
 #include "irgwalk.h"
 #include "irnode_t.h"
 #include "irnodehashmap.h"
+#include "raw_bitset.h"
 #include "statev_t.h"
 #include "target_t.h"
 #include "type_t.h"
@@ -536,10 +538,58 @@ static void determine_spill_costs(spill_env_t *env, spill_info_t *spillinfo)
 	DB((dbg, LEVEL_1, "spill %+F after definition\n", to_spill));
 }
 
+/**
+ * Updates the liveness sets after spills, reloads and remats have been
+ * inserted.  Only the spilled values and the operands of new nodes changed
+ * their users, all other values keep their liveness.
+ *
+ * @return false if too many values changed, so recomputing the liveness from
+ *         scratch is cheaper
+ */
+static bool update_liveness(spill_env_t *const env, unsigned const first_new_idx)
+{
+	ir_graph *const irg      = env->irg;
+	unsigned  const last_idx = get_irg_last_idx(irg);
+	unsigned *const changed  = rbitset_malloc(first_new_idx);
+	for (spill_info_t *si = env->spills; si != NULL; si = si->next)
+		rbitset_set(changed, get_irn_idx(si->to_spill));
+
+	for (unsigned idx = first_new_idx; idx < last_idx; ++idx) {
+		ir_node *const node = get_idx_irn(irg, idx);
+		if (node == NULL || is_Deleted(node))
+			continue;
+		foreach_irn_in(node, i, op) {
+			unsigned const op_idx = get_irn_idx(op);
+			if (op_idx < first_new_idx)
+				rbitset_set(changed, op_idx);
+		}
+	}
+
+	/* Updating a value walks the dominance subtree of its definition, so do
+	 * not bother if a large part of the graph changed. */
+	unsigned const n_changed = rbitset_popcount(changed, first_new_idx)
+	                         + (last_idx - first_new_idx);
+	bool const incremental = n_changed < first_new_idx / 8;
+	if (incremental) {
+		be_lv_t *const lv = be_get_irg_liveness(irg);
+		be_liveness_update_values(lv, changed, first_new_idx);
+		for (unsigned idx = first_new_idx; idx < last_idx; ++idx) {
+			ir_node *const node = get_idx_irn(irg, idx);
+			if (node != NULL && !is_Deleted(node))
+				be_liveness_introduce(lv, node);
+		}
+	}
+	free(changed);
+	return incremental;
+}
+
 void be_insert_spills_reloads(spill_env_t *env)
 {
 	be_timer_push(T_RA_SPILL_APPLY);
 
+	/* Nodes created from here on are spills, reloads, remats and Phis. */
+	unsigned const first_new_idx = get_irg_last_idx(env->irg);
+
 	/* create all phi-ms first, this is needed so, that phis, hanging on
 	   spilled phis work correctly */
 	for (spill_info_t *info = env->mem_phis; info != NULL;
@@ -669,12 +719,21 @@ void be_insert_spills_reloads(spill_env_t *env)
 	stat_ev_dbl("spill_remats", env->remat_count);
 	stat_ev_dbl("spill_spilled_phis", env->spilled_phi_count);
 
-	/* Matze: In theory be_ssa_construction should take care of the liveness...
-	 * try to disable this again in the future */
-	be_invalidate_live_sets(env->irg);
+	be_lv_t *const lv = be_get_irg_liveness(env->irg);
+	if (lv->sets_valid && !update_liveness(env, first_new_idx))
+		be_invalidate_live_sets(env->irg);
 
 	be_remove_dead_nodes_from_schedule(env->irg);
 
+#ifdef DEBUG_libfirm
+	/* the incrementally updated sets must match a full recomputation */
+	if (be_options.do_verify && lv->sets_valid) {
+		be_timer_push(T_VERIFY);
+		be_check_verify_result(be_liveness_check(lv), env->irg);
+		be_timer_pop(T_VERIFY);
+	}
+#endif
+
 	be_timer_pop(T_RA_SPILL_APPLY);
 }
 
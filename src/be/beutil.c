@@ -24,6 +24,7 @@
 #include "irnodeset.h"
 #include "iropt.h"
 #include "irtools.h"
+#include "raw_bitset.h"
 #include "util.h"
 #include <stdio.h>
 
@@ -111,6 +112,7 @@ ir_node *insert_Perm_before(ir_graph *irg, const arch_register_class_t *cls,
 typedef struct remove_dead_nodes_env_t_ {
 	bitset_t *reachable;
 	be_lv_t  *lv;
+	unsigned *lost_users; /**< live values which lost a user, if lv is valid */
 } remove_dead_nodes_env_t;
 
 /**
@@ -134,8 +136,12 @@ static void remove_dead_nodes_walker(ir_node *block, void *data)
 		if (bitset_is_set(env->reachable, get_irn_idx(node)))
 			continue;
 
-		if (env->lv->sets_valid)
+		if (env->lv->sets_valid) {
 			be_liveness_remove(env->lv, node);
+			foreach_irn_in(node, i, op) {
+				rbitset_set(env->lost_users, get_irn_idx(op));
+			}
+		}
 		sched_remove(node);
 
 		/* kill projs */
@@ -155,15 +161,24 @@ static void remove_dead_nodes_walker(ir_node *block, void *data)
 
 void be_remove_dead_nodes_from_schedule(ir_graph *irg)
 {
+	unsigned const n_idx = get_irg_last_idx(irg);
 	remove_dead_nodes_env_t env;
-	env.reachable = bitset_alloca(get_irg_last_idx(irg));
-	env.lv        = be_get_irg_liveness(irg);
+	env.reachable  = bitset_alloca(n_idx);
+	env.lv         = be_get_irg_liveness(irg);
+	env.lost_users = env.lv->sets_valid ? rbitset_malloc(n_idx) : NULL;
 
 	/* mark all reachable nodes */
 	irg_walk_graph(irg, mark_dead_nodes_walker, NULL, &env);
 
 	/* walk schedule and remove non-marked nodes */
 	irg_block_walk_graph(irg, remove_dead_nodes_walker, NULL, &env);
+
+	/* the operands of removed nodes may be live shorter now */
+	if (env.lost_users != NULL) {
+		rbitset_and(env.lost_users, env.reachable->data, n_idx);
+		be_liveness_update_values(env.lv, env.lost_users, n_idx);
+		free(env.lost_users);
+	}
 }
 
 void be_keep_if_unused(ir_node *node)
@@ -449,6 +449,7 @@ bool be_verify_register_allocation(ir_graph *const irg)
 typedef struct lv_walker_t {
 	be_lv_t *given;
 	be_lv_t *fresh;
+	bool     problem_found;
 } lv_walker_t;
 
 static const char *lv_flags_to_str(unsigned flags)
@@ -467,6 +468,22 @@ static const char *lv_flags_to_str(unsigned flags)
 	return states[flags & 7];
 }
 
+/**
+ * Checks that every member of @p info has the same state in @p other.
+ */
+static bool lv_members_agree(be_lv_info_t const *const info,
+                             be_lv_t const *const other, ir_node const *const bl)
+{
+	if (info == NULL)
+		return true;
+	for (unsigned i = 0; i < info->n_members; ++i) {
+		be_lv_info_node_t const *const n = &info->nodes[i];
+		if (be_lv_get_state(other, bl, n->node) != n->flags)
+			return false;
+	}
+	return true;
+}
+
 static void lv_check_walker(ir_node *bl, void *data)
 {
 	lv_walker_t    *const w       = (lv_walker_t*)data;
@@ -474,8 +491,9 @@ static void lv_check_walker(ir_node *bl, void *data)
 	be_lv_info_t   *const fresh   = ir_nodehashmap_get(be_lv_info_t, &w->fresh->map, bl);
 	unsigned const        n_curr  = curr  ? curr->n_members  : 0;
 	unsigned const        n_fresh = fresh ? fresh->n_members : 0;
-	if (n_curr != n_fresh) {
-		ir_fprintf(stderr, "%+F: liveness set sizes differ. curr %d, correct %d\n", bl, n_curr, n_fresh);
+	if (n_curr != n_fresh || !lv_members_agree(curr, w->fresh, bl)
+	    || !lv_members_agree(fresh, w->given, bl)) {
+		ir_fprintf(stderr, "%+F: liveness sets differ. curr %d, correct %d\n", bl, n_curr, n_fresh);
 
 		ir_fprintf(stderr, "current:\n");
 		for (unsigned i = 0; i < n_curr; ++i) {
@@ -488,17 +506,20 @@ static void lv_check_walker(ir_node *bl, void *data)
 			be_lv_info_node_t *const n = &fresh->nodes[i];
 			ir_fprintf(stderr, "%+F %u %+F %s\n", bl, i, n->node, lv_flags_to_str(n->flags));
 		}
+		w->problem_found = true;
 	}
 }
 
-void be_liveness_check(be_lv_t *lv)
+bool be_liveness_check(be_lv_t *lv)
 {
 	be_lv_t *const fresh = be_liveness_new(lv->irg);
 	be_liveness_compute_sets(fresh);
 	lv_walker_t w = {
-		.given = lv,
-		.fresh = fresh,
+		.given         = lv,
+		.fresh         = fresh,
+		.problem_found = false,
 	};
 	irg_block_walk_graph(lv->irg, lv_check_walker, NULL, &w);
 	be_liveness_free(fresh);
+	return !w.problem_found;
 }
@@ -48,7 +48,10 @@ bool be_verify_register_allocation(ir_graph *irg);
 
 /**
  * Check the given liveness information against a freshly computed one.
+ *
+ * @param lv    The liveness information to check
+ * @return      true if both agree, false otherwise
  */
-void be_liveness_check(be_lv_t *lv);
+bool be_liveness_check(be_lv_t *lv);
 
 #endif
@@ -10,6 +10,7 @@
  */
 #include "ia32_bearch_t.h"
 
+#include "beelf.h"
 #include "beflags.h"
 #include "begnuas.h"
 #include "bemodule.h"
@@ -1416,6 +1417,8 @@ static void ia32_generate_code(FILE *output, const char *cup_name)
 {
 	ia32_tv_ent = pmap_create();
 
+	if (be_options.elf_object)
+		ia32_elf_begin(output);
 	be_begin(output, cup_name);
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_IA32_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_ESP);
@@ -1425,13 +1428,18 @@ static void ia32_generate_code(FILE *output, const char *cup_name)
 			continue;
 
 		be_timer_push(T_EMIT);
-		ia32_emit_function(irg);
+		if (be_elf_enabled()) {
+			ia32_emit_elf_function(irg);
+		} else {
+			ia32_emit_function(irg);
+		}
 		be_timer_pop(T_EMIT);
 
 		be_step_last(irg);
 	}
 
-	ia32_emit_thunks();
+	if (!be_elf_enabled())
+		ia32_emit_thunks();
 
 	be_finish();
 	pmap_destroy(ia32_tv_ent);
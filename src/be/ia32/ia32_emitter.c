@@ -587,7 +587,7 @@ x86_condition_code_t ia32_determine_final_cc(ir_node const *const node,
 static void ia32_emit_exc_label(const ir_node *node)
 {
 	be_emit_string(be_gas_insn_label_prefix());
-	be_emit_irprintf("%lu", get_ia32_exc_label_id(node));
+	be_emit_uint(get_ia32_exc_label_id(node));
 }
 
 static void emit_jmp(ir_node const *const node, ir_node const *const target)
@@ -1392,6 +1392,7 @@ static void emit_function_text(ir_graph *const irg, exc_entry **const exc_list)
 	irg_block_walk_graph(irg, ia32_gen_labels, NULL, exc_list);
 
 	be_emit_init_cf_links(blk_sched);
+	be_gas_split_cold_blocks(blk_sched);
 
 	for (size_t i = 0, n = ARR_LEN(blk_sched); i < n; ++i) {
 		ir_node *const block = blk_sched[i];
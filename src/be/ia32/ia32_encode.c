@@ -12,6 +12,7 @@
 
 #include "bearch.h"
 #include "beblocksched.h"
+#include "beelf.h"
 #include "beemithlp.h"
 #include "begnuas.h"
 #include "bejit.h"
@@ -25,8 +26,18 @@
 #include "ia32_new_nodes.h"
 #include "irnodehashmap.h"
 #include "x86_node.h"
+#include "xmalloc.h"
 #include <stdint.h>
 
+/** ELF relocation types of i386. */
+enum {
+	EM_386       = 3,
+	R_386_32     = 1,
+	R_386_PC32   = 2,
+	R_386_TLS_IE = 15,
+	R_386_TLS_LE = 17,
+};
+
 static ir_nodehashmap_t block_fragmentnum;
 
 /** Returns the encoding for a pnc field. */
@@ -340,12 +351,25 @@ void ia32_enc_unop(ir_node const *const node, uint8_t const code,
 	be_emit8(code);
 	if (get_ia32_op_type(node) == ia32_Normal) {
 		const arch_register_t *in = arch_get_irn_register_in(node, input);
-		enc_modru(in, ext);
+		if (get_ia32_attr_const(node)->use_8bit_high) {
+			be_emit8(MOD_REG | ENC_RM(in->encoding, REG_HIGH) | ENC_REG(ext, REG_LOW));
+		} else {
+			enc_modru(in, ext);
+		}
 	} else {
 		enc_mod_am(ext, node);
 	}
 }
 
+void ia32_enc_unop_size(ir_node const *const node, uint8_t const code,
+                        uint8_t const ext, int const input)
+{
+	x86_insn_size_t const size = get_ia32_attr_const(node)->size;
+	if (size == X86_SIZE_16)
+		be_emit8(0x66);
+	ia32_enc_unop(node, size == X86_SIZE_8 ? code : code | OP_16_32, ext, input);
+}
+
 void ia32_enc_unop_mem(ir_node const *const node, uint8_t const code,
                        uint8_t const ext)
 {
@@ -360,6 +384,7 @@ static bool use_eax_short_form(ir_node const *const node)
 {
 	return
 		get_ia32_op_type(node) == ia32_Normal &&
+		!get_ia32_attr_const(node)->use_8bit_high &&
 		arch_get_irn_register_in(node, n_ia32_binary_left)->index == REG_GP_EAX;
 }
 
@@ -369,7 +394,11 @@ static void enc_binop_reg(ir_node const *const node, unsigned char const code, i
 	arch_register_t const *const dst = arch_get_irn_register_in(node, n_ia32_binary_left);
 	if (get_ia32_op_type(node) == ia32_Normal) {
 		arch_register_t const *const src = arch_get_irn_register(right);
-		enc_modrr(src, dst);
+		if (get_ia32_attr_const(node)->use_8bit_high) {
+			enc_modrr8(REG_HIGH, src, REG_HIGH, dst);
+		} else {
+			enc_modrr(src, dst);
+		}
 	} else {
 		enc_mod_am(dst->encoding, node);
 	}
@@ -763,7 +792,21 @@ zero_neg:
  */
 static void enc_load(const ir_node *node)
 {
-	arch_register_t const *const out = arch_get_irn_register_out(node, pn_ia32_Load_res);
+	arch_register_t const *const out  = arch_get_irn_register_out(node, pn_ia32_Load_res);
+	ia32_attr_t     const *const attr = get_ia32_attr_const(node);
+
+	if (attr->size != X86_SIZE_32) {
+		/*        8 16 bit source
+		 * movzx B6 B7
+		 * movsx BE BF */
+		unsigned opcode = 0xB6;
+		if (attr->sign_extend)         opcode |= 0x08;
+		if (attr->size == X86_SIZE_16) opcode |= 0x01;
+		be_emit8(0x0F);
+		be_emit8(opcode);
+		enc_mod_am(out->encoding, node);
+		return;
+	}
 
 	if (out->index == REG_GP_EAX) {
 		ir_node const *const base = get_irn_n_reg(node, n_ia32_base);
@@ -772,7 +815,6 @@ static void enc_load(const ir_node *node)
 			/* load from constant address to EAX can be encoded
 			   as 0xA1 [offset] */
 			be_emit8(0xA1);
-			ia32_attr_t const *const attr = get_ia32_attr_const(node);
 			enc_relocation(&attr->addr.immediate);
 			return;
 		}
@@ -892,7 +934,7 @@ static void enc_call(ir_node const *const node)
 			= &get_ia32_immediate_attr_const(callee)->imm;
 		assert(imm->kind == X86_IMM_PCREL);
 
-		if (ia32_cg_config.emit_machcode) {
+		if (ia32_cg_config.emit_machcode && !be_elf_enabled()) {
 			/* Cheat because I cannot find a way to output .long ENTITY
 			 * as a PC relative relocation. See emit_jit_entity_relocation_asm()
 			 * for the other half of the cheat! */
@@ -1001,7 +1043,23 @@ static void enc_switchjmp(const ir_node *node)
 	enc_mod_am(0x05, node);
 
 	ia32_switch_attr_t const *const attr = get_ia32_switch_attr_const(node);
-	be_emit_jump_table(node, &attr->swtch, mode_P, ia32_emit_jumptable_target);
+	if (!be_elf_enabled()) {
+		be_emit_jump_table(node, &attr->swtch, mode_P, ia32_emit_jumptable_target);
+		return;
+	}
+
+	unsigned long         length;
+	ir_node const **const targets
+		= be_get_jump_table_targets(node, &attr->swtch, &length);
+	unsigned *const fragment_nums = XMALLOCN(unsigned, length);
+	for (unsigned long i = 0; i < length; ++i) {
+		ir_node const *const block = be_emit_get_cfop_target(targets[i]);
+		fragment_nums[i]
+			= PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, block));
+	}
+	be_elf_jump_table(attr->swtch.table_entity, length, fragment_nums);
+	free(fragment_nums);
+	free(targets);
 }
 
 static void enc_return(const ir_node *node)
@@ -1145,6 +1203,7 @@ enc:
 		// There is only a pop variant for 64 bit integer store.
 		assert(size < X86_SIZE_64 || get_ia32_x87_attr_const(node)->x87.pop);
 		enc_mod_am(op, node);
+		return;
 
 	case X86_SIZE_8:
 	case X86_SIZE_80:
@@ -1216,6 +1275,7 @@ enc:
 		/* There is only a pop variant for long double store. */
 		assert(size < X86_SIZE_80 || get_ia32_x87_attr_const(node)->x87.pop);
 		enc_mod_am(op, node);
+		return;
 
 	case X86_SIZE_8:
 	case X86_SIZE_16:
@@ -1286,6 +1346,7 @@ static void ia32_register_binary_emitters(void)
 	be_set_emitter(op_ia32_Call,          enc_call);
 	be_set_emitter(op_ia32_Const,         enc_mov_const);
 	be_set_emitter(op_ia32_Conv_I2I,      enc_conv_i2i);
+	be_set_emitter(op_ia32_CopyEbpEsp,    enc_copy);
 	be_set_emitter(op_ia32_CopyB_i,       enc_copybi);
 	be_set_emitter(op_ia32_Dec,           enc_dec);
 	be_set_emitter(op_ia32_FldCW,         enc_fldcw);
@@ -1454,3 +1515,54 @@ void ia32_emit_jit_function(char *buffer, ir_jit_function_t *const function)
 	};
 	be_jit_emit_memory(buffer, function, &jit_emit_interface);
 }
+
+static unsigned enc_elf_relocation_callback(char *const buffer,
+                                            uint8_t const be_kind,
+                                            ir_entity *const entity,
+                                            int32_t const offset)
+{
+	if (entity == NULL) {
+		assert(be_kind == IA32_RELOCATION_RELJUMP);
+		uint32_t const value = (uint32_t)offset;
+		memcpy(buffer, &value, 4);
+		return 4;
+	}
+
+	unsigned type;
+	switch ((x86_immediate_kind_t)be_kind) {
+	case X86_IMM_ADDR:   type = R_386_32;     break;
+	case X86_IMM_PCREL:  type = R_386_PC32;   break;
+	case X86_IMM_TLS_IE: type = R_386_TLS_IE; break;
+	case X86_IMM_TLS_LE: type = R_386_TLS_LE; break;
+	default:
+		panic("relocation kind %u not supported in object files", be_kind);
+	}
+	be_elf_relocation(buffer, type, 4, entity, offset);
+	return 4;
+}
+
+void ia32_elf_begin(FILE *const output)
+{
+	static const be_elf_target_t elf_target = {
+		.machine    = EM_386,
+		.is_64bit   = false,
+		.rela       = false,
+		.reloc_addr = R_386_32,
+		.reloc_32   = R_386_32,
+		.nops       = enc_nop_callback,
+	};
+	be_elf_begin(output, &elf_target);
+}
+
+void ia32_emit_elf_function(ir_graph *const irg)
+{
+	static const be_jit_emit_interface_t elf_emit_interface = {
+		.nops       = enc_nop_callback,
+		.relocation = enc_elf_relocation_callback,
+	};
+	ir_jit_segment_t  *const segment  = be_new_jit_segment();
+	ir_jit_function_t *const function = ia32_emit_jit(segment, irg);
+	be_elf_emit_function(get_irg_entity(irg), ia32_cg_config.function_alignment,
+	                     function, &elf_emit_interface);
+	be_destroy_jit_segment(segment);
+}
@@ -12,6 +12,7 @@
 #define FIRM_BE_IA32_IA32_ENCODE_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include "firm_types.h"
 #include "jit.h"
 
@@ -23,6 +24,12 @@ ir_jit_function_t *ia32_emit_jit(ir_jit_segment_t *segment, ir_graph *irg);
 
 void ia32_emit_jit_function(char *buffer, ir_jit_function_t *function);
 
+/** Starts writing an ELF object file to @p output. */
+void ia32_elf_begin(FILE *output);
+
+/** Encodes @p irg and appends it to the object file. */
+void ia32_emit_elf_function(ir_graph *irg);
+
 void ia32_enc_simple(uint8_t opcode);
 
 void ia32_enc_binop(ir_node const *node, unsigned code);
@@ -35,6 +42,8 @@ void ia32_enc_shiftop_mem(ir_node const *node, uint8_t ext);
 
 void ia32_enc_unop(ir_node const *node, uint8_t code, uint8_t ext, int input);
 
+void ia32_enc_unop_size(ir_node const *node, uint8_t code, uint8_t ext, int input);
+
 void ia32_enc_unop_mem(ir_node const *node, uint8_t code, uint8_t ext);
 
 void ia32_enc_0f_unop_reg(ir_node const *node, uint8_t code, int input);
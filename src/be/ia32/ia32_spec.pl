@@ -779,7 +779,7 @@ RolMem => {
 
 Neg => {
 	template => $unop,
-	encode   => "ia32_enc_unop(node, 0xF7, 3, n_ia32_Neg_val)",
+	encode   => "ia32_enc_unop_size(node, 0xF6, 3, n_ia32_Neg_val)",
 	latency  => 1,
 },
 
@@ -837,7 +837,7 @@ Not => {
 		""     => { in_reqs => [ "gp" ] },
 		"8bit" => { in_reqs => [ "eax ebx ecx edx" ] },
 	},
-	encode   => "ia32_enc_unop(node, 0xF7, 2, n_ia32_Not_val)",
+	encode   => "ia32_enc_unop_size(node, 0xF6, 2, n_ia32_Not_val)",
 	latency  => 1,
 },
 
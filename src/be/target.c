@@ -144,6 +144,12 @@ int ir_target_fast_unaligned_memaccess(void)
 	return ir_target.fast_unaligned_memaccess;
 }
 
+unsigned ir_target_vector_size(void)
+{
+	assert(ir_target.isa_initialized);
+	return ir_target.vector_size;
+}
+
 int ir_target_supports_pic(void)
 {
 	return ir_target.isa->pic_supported;
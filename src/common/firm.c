@@ -25,9 +25,11 @@
 #include "irflag_t.h"
 #include "irgraph_t.h"
 #include "irhooks.h"
+#include "irio_t.h"
 #include "irmemory_t.h"
 #include "irmode_t.h"
 #include "irnode_t.h"
+#include "irprofile_t.h"
 #include "irprog_t.h"
 #include "irtools.h"
 #include "lc_opts.h"
@@ -76,6 +78,7 @@ void ir_init_library(void)
 	firm_init_loop_opt();
 
 	init_execfreq();
+	firm_init_profile();
 	firm_be_init();
 
 #ifdef DEBUG_libfirm
@@ -92,6 +95,7 @@ void ir_finish(void)
 	firm_be_finish();
 
 	free_ir_prog();
+	finish_irio();
 	firm_finish_op();
 	finish_tarval();
 	finish_mode();
@@ -34,6 +34,8 @@
  */
 static uninitialized_local_variable_func_t *default_initialize_local_variable = NULL;
 
+bool ir_cons_verify_disabled;
+
 ir_node *new_rd_Const_long(dbg_info *db, ir_graph *irg, ir_mode *mode,
                            long value)
 {
@@ -20,6 +20,12 @@
 #define verify_new_node(node) verify_new_node_((node))
 #define get_cur_block()       _get_cur_block()
 
+/**
+ * Set while nodes are built from untrusted input, whose reader verifies the
+ * nodes itself instead of aborting on the first invalid one.
+ */
+extern bool ir_cons_verify_disabled;
+
 static inline ir_node *_get_cur_block(void)
 {
 	return current_ir_graph->current_block;
@@ -28,7 +34,7 @@ static inline ir_node *_get_cur_block(void)
 static inline void verify_new_node_(ir_node *const node)
 {
 #ifdef DEBUG_libfirm
-	if (UNLIKELY(!irn_verify(node)))
+	if (UNLIKELY(!ir_cons_verify_disabled && !irn_verify(node)))
 		abort();
 #else
 	(void)node;
@@ -20,6 +20,7 @@
 #include "irloop.h"
 #include "irnodemap.h"
 #include "irprog.h"
+#include "irvaluetable.h"
 #include "list.h"
 #include "obst.h"
 #include "pset.h"
@@ -138,7 +139,7 @@ struct ir_graph {
 	ir_node *current_block;    /**< Block for new_*()ly created nodes. */
 
 	/** Hash table for global value numbering (CSE) */
-	pset               *value_table;
+	ir_valuetable_t    *value_table;
 	struct obstack      out_obst;    /**< Space for the Def-Use arrays. */
 	bool                out_obst_allocated;
 	ir_bitinfo          bitinfo;     /**< bit info */
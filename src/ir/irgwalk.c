@@ -9,12 +9,14 @@
  * @author  Boris Boesler, Goetz Lindenmaier, Michael Beck
  * @brief
  *  traverse an ir graph
- *  - execute the pre function before recursion
- *  - execute the post function after recursion
+ *  - execute the pre function before visiting the predecessors
+ *  - execute the post function after visiting the predecessors
+ *  The walkers use an explicit stack instead of recursion.
  */
 #include "irgwalk.h"
 
 #include "array.h"
+#include "compiler.h"
 #include "entity_t.h"
 #include "ircons.h"
 #include "irgraph_t.h"
@@ -24,78 +26,132 @@
 #include "irnodeset.h"
 #include "panic.h"
 #include "pset_new.h"
+#include "util.h"
+#include "xmalloc.h"
 #include <stdlib.h>
 
+/** Number of walker stack frames kept in automatic storage. */
+#define WALK_STACK_INITIAL 128
+
+/** Position of a frame whose block input has not been visited yet. */
+#define POS_BLOCK (-2)
+/** Position of a frame whose operands have not been visited yet. */
+#define POS_OPERANDS (-1)
+
+typedef struct walk_frame_t {
+	ir_node *node;
+	int      pos;  /**< next input to visit, counting downwards */
+} walk_frame_t;
+
 /**
- * specialized version of irg_walk_2, called if only pre callback exists
+ * Explicit stack replacing recursion in the walkers, so the graph depth is
+ * not limited by the size of the machine stack.  The first frames live in
+ * the walker's own stack frame, deeper walks move to the heap.
  */
-static void irg_walk_2_pre(ir_node *node, irg_walk_func *pre, void *env)
+typedef struct walk_stack_t {
+	walk_frame_t *frames;
+	size_t        n_frames;
+	size_t        size;
+	walk_frame_t  initial[WALK_STACK_INITIAL];
+} walk_stack_t;
+
+static void walk_stack_init(walk_stack_t *const stack)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
+	stack->frames   = stack->initial;
+	stack->n_frames = 0;
+	stack->size     = ARRAY_SIZE(stack->initial);
+}
 
-	pre(node, env);
+static void walk_stack_free(walk_stack_t *const stack)
+{
+	if (stack->frames != stack->initial)
+		free(stack->frames);
+}
 
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_2_pre(pred, pre, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_2_pre(pred, pre, env);
+static void walk_stack_push(walk_stack_t *const stack, ir_node *const node,
+                            int const pos)
+{
+	if (UNLIKELY(stack->n_frames == stack->size)) {
+		size_t const size = stack->size * 2;
+		if (stack->frames == stack->initial) {
+			stack->frames = XMALLOCN(walk_frame_t, size);
+			MEMCPY(stack->frames, stack->initial, stack->n_frames);
+		} else {
+			stack->frames = XREALLOC(stack->frames, walk_frame_t, size);
+		}
+		stack->size = size;
 	}
+	/* the operands are inspected soon, fetch them while the callbacks run */
+	PREFETCH(node->in);
+	walk_frame_t *const frame = &stack->frames[stack->n_frames++];
+	frame->node = node;
+	frame->pos  = pos;
 }
 
 /**
- * specialized version of irg_walk_2, called if only post callback exists
+ * Marks @p node visited, calls @p pre and schedules its predecessors.
  */
-static void irg_walk_2_post(ir_node *node, irg_walk_func *post, void *env)
+static void walk_enter(walk_stack_t *const stack, ir_node *const node,
+                       ir_visited_t const visited, irg_walk_func *const pre,
+                       void *const env)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
 	set_irn_visited(node, visited);
-
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_2_post(pred, post, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_2_post(pred, post, env);
-	}
-
-	post(node, env);
+	if (pre != NULL)
+		pre(node, env);
+	walk_stack_push(stack, node, POS_BLOCK);
 }
 
 /**
- * specialized version of irg_walk_2, called if pre and post callbacks exist
+ * Walks the graph below @p node in depth first order: The block of a node
+ * is visited first, then its operands from the last to the first.  This is
+ * the same order the former recursive walker used.
  */
-static void irg_walk_2_both(ir_node *node, irg_walk_func *pre,
-                                irg_walk_func *post, void *env)
+static void irg_walk_2_iterative(ir_node *const node, irg_walk_func *const pre,
+                                 irg_walk_func *const post, void *const env)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
-
-	pre(node, env);
+	ir_graph    *const irg     = get_irn_irg(node);
+	ir_visited_t const visited = irg->visited;
+
+	walk_stack_t stack;
+	walk_stack_init(&stack);
+	walk_enter(&stack, node, visited, pre, env);
+
+	while (stack.n_frames > 0) {
+		walk_frame_t *const frame = &stack.frames[stack.n_frames - 1];
+		ir_node      *const cur   = frame->node;
+
+		if (frame->pos == POS_BLOCK) {
+			frame->pos = POS_OPERANDS;
+			if (!is_Block(cur)) {
+				ir_node *const block = get_nodes_block(cur);
+				if (block->visited < visited) {
+					walk_enter(&stack, block, visited, pre, env);
+					continue;
+				}
+			}
+		}
+		if (frame->pos == POS_OPERANDS)
+			frame->pos = get_irn_arity(cur);
+
+		ir_node *next = NULL;
+		while (frame->pos > 0) {
+			ir_node *const pred = get_irn_n(cur, --frame->pos);
+			if (pred->visited < visited) {
+				next = pred;
+				break;
+			}
+		}
+		if (next != NULL) {
+			walk_enter(&stack, next, visited, pre, env);
+			continue;
+		}
 
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_2_both(pred, pre, post, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_2_both(pred, pre, post, env);
+		--stack.n_frames;
+		if (post != NULL)
+			post(cur, env);
 	}
 
-	post(node, env);
+	walk_stack_free(&stack);
 }
 
 void irg_walk_2(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
@@ -104,9 +160,7 @@ void irg_walk_2(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
 	if (irn_visited(node))
 		return;
 
-	if      (post == NULL) irg_walk_2_pre (node, pre, env);
-	else if (pre  == NULL) irg_walk_2_post(node, post, env);
-	else                   irg_walk_2_both(node, pre, post, env);
+	irg_walk_2_iterative(node, pre, post, env);
 }
 
 void irg_walk_core(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
@@ -139,80 +193,6 @@ void all_irg_walk(irg_walk_func *pre, irg_walk_func *post, void *env)
 	}
 }
 
-/**
- * specialized version of irg_walk_in_or_dep_2, called if only pre callback exists
- */
-static void irg_walk_in_or_dep_2_pre(ir_node *node, irg_walk_func *pre,
-                                     void *env)
-{
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
-
-	pre(node, env);
-
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_pre(pred, pre, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_pre(pred, pre, env);
-	}
-}
-
-/**
- * specialized version of irg_walk_in_or_dep_2, called if only post callback exists
- */
-static void irg_walk_in_or_dep_2_post(ir_node *node, irg_walk_func *post,
-                                      void *env)
-{
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
-
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_post(pred, post, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_post(pred, post, env);
-	}
-
-	post(node, env);
-}
-
-/**
- * specialized version of irg_walk_in_or_dep_2, called if pre and post callbacks exist
- */
-static void irg_walk_in_or_dep_2_both(ir_node *node, irg_walk_func *pre,
-                                      irg_walk_func *post, void *env)
-{
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
-
-	pre(node, env);
-
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_both(pred, pre, post, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_both(pred, pre, post, env);
-	}
-
-	post(node, env);
-}
-
 /**
  * Intraprozedural graph walker. Follows dependency edges as well.
  */
@@ -222,9 +202,7 @@ static void irg_walk_in_or_dep_2(ir_node *node, irg_walk_func *pre,
 	if (irn_visited(node))
 		return;
 
-	if      (post == NULL) irg_walk_in_or_dep_2_pre (node, pre, env);
-	else if (pre == NULL)  irg_walk_in_or_dep_2_post(node, post, env);
-	else                   irg_walk_in_or_dep_2_both(node, pre, post, env);
+	irg_walk_2_iterative(node, pre, post, env);
 }
 
 void irg_walk_in_or_dep(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
@@ -309,23 +287,48 @@ static void irg_block_walk_2(ir_node *node, irg_walk_func *pre,
 {
 	if (Block_block_visited(node))
 		return;
-	mark_Block_block_visited(node);
 
+	walk_stack_t stack;
+	walk_stack_init(&stack);
+
+	mark_Block_block_visited(node);
 	if (pre != NULL)
 		pre(node, env);
-
-	for (int i = get_Block_n_cfgpreds(node); i-- > 0; ) {
-		/* find the corresponding predecessor block. */
-		ir_node *pred_cfop  = get_cf_op(get_Block_cfgpred(node, i));
-		if (is_Bad(pred_cfop))
+	walk_stack_push(&stack, node, POS_OPERANDS);
+
+	while (stack.n_frames > 0) {
+		walk_frame_t *const frame = &stack.frames[stack.n_frames - 1];
+		ir_node      *const block = frame->node;
+		if (frame->pos == POS_OPERANDS)
+			frame->pos = get_Block_n_cfgpreds(block);
+
+		ir_node *next = NULL;
+		while (frame->pos > 0) {
+			/* find the corresponding predecessor block. */
+			ir_node *const pred_cfop
+				= get_cf_op(get_Block_cfgpred(block, --frame->pos));
+			if (is_Bad(pred_cfop))
+				continue;
+			ir_node *const pred_block = get_nodes_block(pred_cfop);
+			if (!Block_block_visited(pred_block)) {
+				next = pred_block;
+				break;
+			}
+		}
+		if (next != NULL) {
+			mark_Block_block_visited(next);
+			if (pre != NULL)
+				pre(next, env);
+			walk_stack_push(&stack, next, POS_OPERANDS);
 			continue;
-		ir_node *pred_block = get_nodes_block(pred_cfop);
-		/* recursion */
-		irg_block_walk_2(pred_block, pre, post, env);
+		}
+
+		--stack.n_frames;
+		if (post != NULL)
+			post(block, env);
 	}
 
-	if (post != NULL)
-		post(node, env);
+	walk_stack_free(&stack);
 }
 
 void irg_block_walk(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
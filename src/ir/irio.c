@@ -11,6 +11,7 @@
 #include "irio_t.h"
 
 #include "array.h"
+#include "execfreq_t.h"
 #include "ircons_t.h"
 #include "irflag_t.h"
 #include "irgmod.h"
@@ -23,11 +24,22 @@
 #include "pmap.h"
 #include "tv_t.h"
 #include "util.h"
+#include "xmalloc.h"
 #include <ctype.h>
+#include <limits.h>
+#include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define SYMERROR ((unsigned) ~0)
 
 typedef enum typetag_t {
@@ -68,6 +80,7 @@ typedef enum keyword_t {
 	kw_type,
 	kw_typegraph,
 	kw_unknown,
+	kw_vector_mode,
 } keyword_t;
 
 typedef struct symbol_t {
@@ -81,6 +94,98 @@ typedef struct id_entry {
 	void *elem;
 } id_entry;
 
+/**
+ * The binary format stores the same sequence of tokens as the textual one,
+ * but encodes every token as a tag byte followed by its payload. Strings are
+ * stored once in a string table and referenced by index, node references are
+ * dense indices per graph.
+ *
+ * A binary file consists of
+ *   - the magic and the version (4 bytes),
+ *   - the global section with the modes, the type graph, the const code
+ *     graph and the program,
+ *   - one section per graph,
+ *   - the graph table with entity number, offset, size and number of nodes of
+ *     every graph section,
+ *   - the string table: the offsets of the strings followed by the strings,
+ *   - the trailer with offset and size of the global section, offset and
+ *     length of graph table and string table and the magic again.
+ * All fixed size numbers are little endian, so a single graph can be found
+ * and read from a mapped file without parsing the other graphs.
+ */
+typedef enum binary_token_t {
+	bt_number,      /**< a number, followed by its zigzag encoded varint */
+	bt_string,      /**< a string, followed by its string table index */
+	bt_word,        /**< a symbol, followed by its string table index */
+	bt_list_begin,
+	bt_list_end,
+	bt_scope_begin,
+	bt_scope_end,
+	bt_line_end,    /**< end of a record, skipped unless searched for */
+} binary_token_t;
+
+#define BINARY_VERSION      1
+#define BINARY_HEADER_SIZE  12
+#define BINARY_TRAILER_SIZE 56
+#define BINARY_IRG_SIZE     32
+
+static char const binary_magic[8] = "\177FIRMIR\n";
+
+/** Indices of the nodes of a graph in the binary format. */
+typedef struct node_index_t {
+	unsigned *index;   /**< index + 1 by node idx, 0 if not assigned yet */
+	unsigned  n_nodes; /**< number of assigned indices */
+} node_index_t;
+
+typedef struct binary_output_t {
+	uint64_t      offset;      /**< number of bytes written so far */
+	pmap         *string_ids;  /**< maps idents to string table index + 1 */
+	ident       **strings;     /**< the string table */
+	node_index_t  nodes;       /**< node indices of the current graph */
+	node_index_t  const_nodes; /**< node indices of the const code graph */
+	/** receives the output instead of the file when writing graph content */
+	write_content_func *content_func;
+	void               *content_ctx;
+	pmap               *content_ids; /**< entities and types written so far */
+	bool                incomplete;  /**< content depends on unwritten data */
+	size_t        n_buffered;
+	unsigned char buffer[4096];
+} binary_output_t;
+
+/** A graph section of a binary file. */
+typedef struct irg_section_t {
+	long      entity_nr; /**< number of the graph entity in the file */
+	uint64_t  offset;
+	uint64_t  size;
+	uint64_t  n_nodes;
+	ir_graph *irg;       /**< the imported graph, NULL if not imported yet */
+} irg_section_t;
+
+typedef struct binary_input_t {
+	unsigned char const *data;
+	size_t               size;
+	unsigned char const *pos;         /**< current read position */
+	unsigned char const *end;         /**< end of the current section */
+	size_t               n_strings;
+	char const         **strings;     /**< the string table */
+	ident              **idents;      /**< idents of the strings */
+	ir_mode            **modes;       /**< modes named by the strings */
+	symbol_t const     **symbols;     /**< symbols named by the strings */
+	ir_node            **nodes;       /**< nodes of the current graph */
+	ir_node            **const_nodes; /**< nodes of the const code graph */
+	size_t               n_irgs;
+	irg_section_t       *irgs;
+	pmap                *irg_sections; /**< maps entities to their section */
+	jmp_buf              error;        /**< resumed after a fatal read error */
+} binary_input_t;
+
+struct ir_lazy_import {
+	read_env_t     env;
+	binary_input_t bin;
+	bool           mapped; /**< data is a mapped file, not allocated */
+	char          *name;
+};
+
 /** The symbol table, a set of symbol_t elements. */
 static set *symtbl;
 
@@ -126,23 +231,55 @@ static int id_cmp(const void *elt, const void *key, size_t size)
 	return entry->id - keyentry->id;
 }
 
-static void FIRM_PRINTF(2, 3)
-parse_error(read_env_t *env, const char *fmt, ...)
+static void report_error(read_env_t *env, const char *fmt, va_list ap)
 {
-	/* workaround read_c "feature" that a '\n' triggers the line++
-	 * instead of the character after the '\n' */
-	unsigned line = env->line;
-	if (env->c == '\n') {
-		line--;
-	}
+	if (env->bin != NULL) {
+		binary_input_t const *const bin = env->bin;
+		fprintf(stderr, "%s:0x%zx: error ", env->inputname,
+		        (size_t)(bin->pos - bin->data));
+	} else {
+		/* workaround read_c "feature" that a '\n' triggers the line++
+		 * instead of the character after the '\n' */
+		unsigned line = env->line;
+		if (env->c == '\n') {
+			line--;
+		}
 
-	fprintf(stderr, "%s:%u: error ", env->inputname, line);
+		fprintf(stderr, "%s:%u: error ", env->inputname, line);
+	}
 	env->read_errors = true;
+	vfprintf(stderr, fmt, ap);
+}
+
+/**
+ * Reports an error in the binary input and gives up reading the current
+ * section: The import function, which called setjmp() on bin->error,
+ * continues.
+ */
+static FIRM_NORETURN FIRM_PRINTF(2, 3)
+binary_error(read_env_t *env, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	report_error(env, fmt, ap);
+	va_end(ap);
+	longjmp(env->bin->error, 1);
+}
 
+/**
+ * Reports an error in the input. Reading textual input goes on, while the
+ * current section of a binary file is given up as in binary_error(), because
+ * the reader cannot resynchronize.
+ */
+static void FIRM_PRINTF(2, 3)
+parse_error(read_env_t *env, const char *fmt, ...)
+{
 	va_list ap;
 	va_start(ap, fmt);
-	vfprintf(stderr, fmt, ap);
+	report_error(env, fmt, ap);
 	va_end(ap);
+	if (env->bin != NULL)
+		longjmp(env->bin->error, 1);
 }
 
 COMPILETIME_ASSERT(ir_bk_va_arg == ir_bk_last, complete_builtin_list)
@@ -219,6 +356,7 @@ static void symtbl_init(void)
 	INSERTKEYWORD(type);
 	INSERTKEYWORD(typegraph);
 	INSERTKEYWORD(unknown);
+	INSERTKEYWORD(vector_mode);
 
 	INSERTENUM(tt_align, align_non_aligned);
 	INSERTENUM(tt_align, align_is_aligned);
@@ -306,51 +444,192 @@ static const char *get_mode_arithmetic_name(ir_mode_arithmetic arithmetic)
 	panic("invalid mode_arithmetic");
 }
 
-/** Returns the according symbol value for the given string and tag, or SYMERROR if none was found. */
-static unsigned symbol(const char *str, typetag_t typetag)
+/** Returns the symbol for the given string and tag, or NULL if none was found. */
+static symbol_t const *find_symbol(const char *str, typetag_t typetag)
 {
 	symbol_t key;
 	key.str     = str;
 	key.typetag = typetag;
 
-	symbol_t *entry = set_find(symbol_t, symtbl, &key, sizeof(key),
-	                           hash_str(str) + typetag * 17);
+	return set_find(symbol_t, symtbl, &key, sizeof(key),
+	                hash_str(str) + typetag * 17);
+}
+
+/** Returns the according symbol value for the given string and tag, or SYMERROR if none was found. */
+static unsigned symbol(const char *str, typetag_t typetag)
+{
+	symbol_t const *const entry = find_symbol(str, typetag);
 	return entry ? entry->code : SYMERROR;
 }
 
+static void binary_flush(write_env_t *env)
+{
+	binary_output_t *const bin = env->bin;
+	if (bin->content_func != NULL) {
+		bin->content_func(bin->content_ctx, bin->buffer, bin->n_buffered);
+	} else {
+		fwrite(bin->buffer, 1, bin->n_buffered, env->file);
+	}
+	bin->n_buffered = 0;
+}
+
+static void binary_write_byte(write_env_t *env, unsigned char byte)
+{
+	binary_output_t *const bin = env->bin;
+	if (bin->n_buffered == ARRAY_SIZE(bin->buffer))
+		binary_flush(env);
+	bin->buffer[bin->n_buffered++] = byte;
+	++bin->offset;
+}
+
+static void binary_write_varint(write_env_t *env, uint64_t value)
+{
+	while (value >= 0x80) {
+		binary_write_byte(env, (unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	binary_write_byte(env, (unsigned char)value);
+}
+
+/** Writes @p value as little endian number of @p n_bytes bytes. */
+static void binary_write_fixed(write_env_t *env, uint64_t value,
+                               unsigned n_bytes)
+{
+	for (unsigned i = 0; i < n_bytes; ++i) {
+		binary_write_byte(env, (unsigned char)value);
+		value >>= 8;
+	}
+}
+
+static void binary_write_number(write_env_t *env, int64_t value)
+{
+	binary_write_byte(env, bt_number);
+	uint64_t const bits = (uint64_t)value << 1;
+	binary_write_varint(env, value < 0 ? ~bits : bits);
+}
+
+static void binary_write_string(write_env_t *env, binary_token_t token,
+                                const char *string)
+{
+	binary_output_t *const bin = env->bin;
+	if (bin->content_func != NULL) {
+		/* graph content has no string table, write the string itself */
+		binary_write_byte(env, token);
+		for (char const *c = string;; ++c) {
+			binary_write_byte(env, (unsigned char)*c);
+			if (*c == '\0')
+				break;
+		}
+		return;
+	}
+	ident           *const id  = new_id_from_str(string);
+	size_t                 idx = PTR_TO_INT(pmap_get(void, bin->string_ids, id));
+	if (idx == 0) {
+		ARR_APP1(ident*, bin->strings, id);
+		idx = ARR_LEN(bin->strings);
+		pmap_insert(bin->string_ids, id, INT_TO_PTR(idx));
+	}
+	binary_write_byte(env, token);
+	binary_write_varint(env, idx - 1);
+}
+
+/** Returns the index of @p node in the binary format. */
+static unsigned get_node_index(write_env_t *env, const ir_node *node)
+{
+	binary_output_t *const bin = env->bin;
+	node_index_t    *const map = get_irn_irg(node) == get_const_code_irg()
+	                             ? &bin->const_nodes : &bin->nodes;
+	unsigned        *const idx = &map->index[get_irn_idx(node)];
+	if (*idx == 0)
+		*idx = ++map->n_nodes;
+	return *idx - 1;
+}
+
+static void init_node_index(node_index_t *map, ir_graph *irg)
+{
+	map->index   = NEW_ARR_FZ(unsigned, get_irg_last_idx(irg));
+	map->n_nodes = 0;
+}
+
+static void write_indent(write_env_t *env)
+{
+	if (env->bin == NULL)
+		fputc('\t', env->file);
+}
+
+static void write_line_end(write_env_t *env)
+{
+	if (env->bin != NULL) {
+		binary_write_byte(env, bt_line_end);
+	} else {
+		fputc('\n', env->file);
+	}
+}
+
 void write_long(write_env_t *env, long value)
 {
+	if (env->bin != NULL) {
+		binary_write_number(env, value);
+		return;
+	}
 	fprintf(env->file, "%ld ", value);
 }
 
 void write_int(write_env_t *env, int value)
 {
+	if (env->bin != NULL) {
+		binary_write_number(env, value);
+		return;
+	}
 	fprintf(env->file, "%d ", value);
 }
 
 void write_unsigned(write_env_t *env, unsigned value)
 {
+	if (env->bin != NULL) {
+		binary_write_number(env, value);
+		return;
+	}
 	fprintf(env->file, "%u ", value);
 }
 
 void write_size_t(write_env_t *env, size_t value)
 {
+	if (env->bin != NULL) {
+		binary_write_number(env, (int64_t)value);
+		return;
+	}
 	ir_fprintf(env->file, "%zu ", value);
 }
 
 void write_symbol(write_env_t *env, const char *symbol)
 {
+	if (env->bin != NULL) {
+		binary_write_string(env, bt_word, symbol);
+		return;
+	}
 	fputs(symbol, env->file);
 	fputc(' ', env->file);
 }
 
+static void write_entity_content(write_env_t *env, ir_entity *entity);
+static void write_type_content(write_env_t *env, ir_type *type);
+
 void write_entity_ref(write_env_t *env, ir_entity *entity)
 {
+	if (env->bin != NULL && env->bin->content_func != NULL) {
+		write_entity_content(env, entity);
+		return;
+	}
 	write_long(env, get_entity_nr(entity));
 }
 
 void write_type_ref(write_env_t *env, ir_type *type)
 {
+	if (env->bin != NULL && env->bin->content_func != NULL) {
+		write_type_content(env, type);
+		return;
+	}
 	switch (get_type_opcode(type)) {
 	case tpo_unknown:
 		write_symbol(env, "unknown");
@@ -366,6 +645,10 @@ void write_type_ref(write_env_t *env, ir_type *type)
 
 void write_string(write_env_t *env, const char *string)
 {
+	if (env->bin != NULL) {
+		binary_write_string(env, bt_string, string);
+		return;
+	}
 	fputc('"', env->file);
 	for (const char *c = string; *c != '\0'; ++c) {
 		switch (*c) {
@@ -394,7 +677,7 @@ void write_ident(write_env_t *env, ident *id)
 void write_ident_null(write_env_t *env, ident *id)
 {
 	if (id == NULL) {
-		fputs("NULL ", env->file);
+		write_symbol(env, "NULL");
 	} else {
 		write_ident(env, id);
 	}
@@ -411,26 +694,22 @@ void write_tarval_ref(write_env_t *env, ir_tarval *tv)
 	write_mode_ref(env, mode);
 	char buf[128];
 	const char *ascii = ir_tarval_to_ascii(buf, sizeof(buf), tv);
-	fputs(ascii, env->file);
-	fputc(' ', env->file);
+	write_symbol(env, ascii);
 }
 
 void write_align(write_env_t *env, ir_align align)
 {
-	fputs(get_align_name(align), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_align_name(align));
 }
 
 void write_builtin_kind(write_env_t *env, ir_builtin_kind kind)
 {
-	fputs(get_builtin_kind_name(kind), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_builtin_kind_name(kind));
 }
 
 void write_cond_jmp_predicate(write_env_t *env, cond_jmp_predicate pred)
 {
-	fputs(get_cond_jmp_predicate_name(pred), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_cond_jmp_predicate_name(pred));
 }
 
 void write_relation(write_env_t *env, ir_relation relation)
@@ -450,37 +729,55 @@ void write_loop(write_env_t *env, bool loop)
 
 static void write_list_begin(write_env_t *env)
 {
+	if (env->bin != NULL) {
+		binary_write_byte(env, bt_list_begin);
+		return;
+	}
 	fputs("[", env->file);
 }
 
 static void write_list_end(write_env_t *env)
 {
+	if (env->bin != NULL) {
+		binary_write_byte(env, bt_list_end);
+		return;
+	}
 	fputs("] ", env->file);
 }
 
 static void write_scope_begin(write_env_t *env)
 {
+	if (env->bin != NULL) {
+		binary_write_byte(env, bt_scope_begin);
+		return;
+	}
 	fputs("{\n", env->file);
 }
 
 static void write_scope_end(write_env_t *env)
 {
+	if (env->bin != NULL) {
+		binary_write_byte(env, bt_scope_end);
+		return;
+	}
 	fputs("}\n\n", env->file);
 }
 
 void write_node_ref(write_env_t *env, const ir_node *node)
 {
+	if (env->bin != NULL) {
+		binary_write_number(env, get_node_index(env, node));
+		return;
+	}
 	write_long(env, get_irn_node_nr(node));
 }
 
 void write_initializer(write_env_t *const env,
                        ir_initializer_t const *const ini)
 {
-	FILE *f = env->file;
 	ir_initializer_kind_t ini_kind = get_initializer_kind(ini);
 
-	fputs(get_initializer_kind_name(ini_kind), f);
-	fputc(' ', f);
+	write_symbol(env, get_initializer_kind_name(ini_kind));
 
 	switch (ini_kind) {
 	case IR_INITIALIZER_CONST:
@@ -507,37 +804,32 @@ void write_initializer(write_env_t *const env,
 
 void write_pin_state(write_env_t *env, op_pin_state state)
 {
-	fputs(get_op_pin_state_name(state), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_op_pin_state_name(state));
 }
 
 void write_volatility(write_env_t *env, ir_volatility vol)
 {
-	fputs(get_volatility_name(vol), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_volatility_name(vol));
 }
 
 static void write_type_state(write_env_t *env, ir_type_state state)
 {
-	fputs(get_type_state_name(state), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_type_state_name(state));
 }
 
 void write_visibility(write_env_t *env, ir_visibility visibility)
 {
-	fputs(get_visibility_name(visibility), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_visibility_name(visibility));
 }
 
 static void write_mode_arithmetic(write_env_t *env, ir_mode_arithmetic arithmetic)
 {
-	fputs(get_mode_arithmetic_name(arithmetic), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_mode_arithmetic_name(arithmetic));
 }
 
 static void write_type_common(write_env_t *env, ir_type *tp)
 {
-	fputc('\t', env->file);
+	write_indent(env);
 	write_symbol(env, "type");
 	write_long(env, get_type_nr(tp));
 	write_symbol(env, get_type_opcode_name(get_type_opcode(tp)));
@@ -552,7 +844,7 @@ static void write_type(write_env_t *env, ir_type *tp);
 static bool is_internal_mode(ir_mode *mode)
 {
 	return !mode_is_int(mode) && !mode_is_reference(mode)
-	    && !mode_is_float(mode);
+	    && !mode_is_float(mode) && !mode_is_vector(mode);
 }
 
 static bool is_default_mode(ir_mode *mode)
@@ -571,7 +863,7 @@ static void write_type_primitive(write_env_t *env, ir_type *tp)
 
 	write_type_common(env, tp);
 	write_mode_ref(env, mode);
-	fputc('\n', env->file);
+	write_line_end(env);
 }
 
 static void write_type_compound(write_env_t *env, ir_type *tp)
@@ -585,7 +877,7 @@ static void write_type_compound(write_env_t *env, ir_type *tp)
 	}
 	write_type_common(env, tp);
 	write_ident_null(env, get_compound_ident(tp));
-	fputc('\n', env->file);
+	write_line_end(env);
 
 	for (size_t i = 0, n = get_compound_n_members(tp); i < n; ++i) {
 		ir_entity *member = get_compound_member(tp, i);
@@ -601,7 +893,7 @@ static void write_type_array(write_env_t *env, ir_type *tp)
 	write_type_common(env, tp);
 	write_type_ref(env, element_type);
 	write_unsigned(env, get_array_size(tp));
-	fputc('\n', env->file);
+	write_line_end(env);
 }
 
 static void write_type_method(write_env_t *env, ir_type *tp)
@@ -623,7 +915,7 @@ static void write_type_method(write_env_t *env, ir_type *tp)
 		write_type_ref(env, get_method_param_type(tp, i));
 	for (size_t i = 0; i < nresults; i++)
 		write_type_ref(env, get_method_res_type(tp, i));
-	fputc('\n', env->file);
+	write_line_end(env);
 }
 
 static void write_type_pointer(write_env_t *env, ir_type *tp)
@@ -634,7 +926,7 @@ static void write_type_pointer(write_env_t *env, ir_type *tp)
 
 	write_type_common(env, tp);
 	write_type_ref(env, points_to);
-	fputc('\n', env->file);
+	write_line_end(env);
 }
 
 static void write_type(write_env_t *env, ir_type *tp)
@@ -683,7 +975,7 @@ static void write_entity(write_env_t *env, ir_entity *ent)
 		write_entity(env, aliased);
 	}
 
-	fputc('\t', env->file);
+	write_indent(env);
 	switch ((ir_entity_kind)ent->kind) {
 	case IR_ENTITY_ALIAS:           write_symbol(env, "alias");           break;
 	case IR_ENTITY_NORMAL:          write_symbol(env, "entity");          break;
@@ -771,7 +1063,7 @@ static void write_entity(write_env_t *env, ir_entity *ent)
 	}
 
 end_line:
-	fputc('\n', env->file);
+	write_line_end(env);
 }
 
 void write_switch_table_ref(write_env_t *env, const ir_switch_table *table)
@@ -802,7 +1094,7 @@ void write_pred_refs(write_env_t *env, const ir_node *node, int from)
 
 void write_node_nr(write_env_t *env, const ir_node *node)
 {
-	write_long(env, get_irn_node_nr(node));
+	write_node_ref(env, node);
 }
 
 static void write_ASM(write_env_t *env, const ir_node *node)
@@ -848,6 +1140,13 @@ static void write_Phi(write_env_t *env, const ir_node *node)
 	write_pred_refs(env, node, 0);
 }
 
+static void write_freq(write_env_t *env, double freq)
+{
+	int64_t bits;
+	memcpy(&bits, &freq, sizeof(bits));
+	binary_write_number(env, bits);
+}
+
 static void write_Block(write_env_t *env, const ir_node *node)
 {
 	ir_entity *entity = get_Block_entity(node);
@@ -860,6 +1159,13 @@ static void write_Block(write_env_t *env, const ir_node *node)
 		write_symbol(env, "Block");
 		write_node_nr(env, node);
 	}
+	/* the code generated for a graph depends on its block frequencies, the
+	 * block layout also on the profiled edge counts (-1 if there are none) */
+	if (env->bin != NULL && env->bin->content_func != NULL) {
+		write_freq(env, get_block_execfreq(node));
+		for (int i = 0, n = get_Block_n_cfgpreds(node); i < n; ++i)
+			write_freq(env, get_block_cfgpred_execfreq(node, i));
+	}
 	write_pred_refs(env, node, 0);
 }
 
@@ -890,11 +1196,16 @@ static void write_node(const ir_node *node, write_env_t *env)
 	ir_op           *const op   = get_irn_op(node);
 	write_node_func *const func = get_generic_function_ptr(write_node_func, op);
 
-	fputc('\t', env->file);
-	if (func == NULL)
-		panic("no write_node_func for %+F", node);
-	func(env, node);
-	fputc('\n', env->file);
+	write_indent(env);
+	if (func == NULL) {
+		if (env->bin == NULL || env->bin->content_func == NULL)
+			panic("no write_node_func for %+F", node);
+		write_symbol(env, get_irn_opname(node));
+		env->bin->incomplete = true;
+	} else {
+		func(env, node);
+	}
+	write_line_end(env);
 }
 
 static void write_node_recursive(ir_node *node, write_env_t *env);
@@ -957,6 +1268,11 @@ static void write_mode(write_env_t *env, ir_mode *mode)
 		write_unsigned(env, get_mode_exponent_size(mode));
 		write_unsigned(env, get_mode_mantissa_size(mode));
 		write_unsigned(env, get_mode_float_int_overflow(mode));
+	} else if (mode_is_vector(mode)) {
+		write_symbol(env, "vector_mode");
+		write_string(env, get_mode_name(mode));
+		write_mode_ref(env, get_mode_vector_element(mode));
+		write_unsigned(env, get_mode_vector_lanes(mode));
 	} else {
 		panic("cannot write internal modes");
 	}
@@ -965,18 +1281,18 @@ static void write_mode(write_env_t *env, ir_mode *mode)
 static void write_modes(write_env_t *env)
 {
 	write_symbol(env, "modes");
-	fputs("{\n", env->file);
+	write_scope_begin(env);
 
 	for (size_t i = 0, n_modes = ir_get_n_modes(); i < n_modes; i++) {
 		ir_mode *mode = ir_get_mode(i);
 		if (is_internal_mode(mode))
 			continue;
-		fputc('\t', env->file);
+		write_indent(env);
 		write_mode(env, mode);
-		fputc('\n', env->file);
+		write_line_end(env);
 	}
 
-	fputs("}\n\n", env->file);
+	write_scope_end(env);
 }
 
 static void write_program(write_env_t *env)
@@ -984,15 +1300,15 @@ static void write_program(write_env_t *env)
 	write_symbol(env, "program");
 	write_scope_begin(env);
 	if (irp_prog_name_is_set()) {
-		fputc('\t', env->file);
+		write_indent(env);
 		write_symbol(env, "name");
 		write_string(env, get_irp_name());
-		fputc('\n', env->file);
+		write_line_end(env);
 	}
 
 	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
 		ir_type *segment_type = get_segment_type(s);
-		fputc('\t', env->file);
+		write_indent(env);
 		write_symbol(env, "segment_type");
 		write_symbol(env, get_segment_name(s));
 		if (segment_type == NULL) {
@@ -1000,15 +1316,15 @@ static void write_program(write_env_t *env)
 		} else {
 			write_type_ref(env, segment_type);
 		}
-		fputc('\n', env->file);
+		write_line_end(env);
 	}
 
 	for (size_t i = 0, n_asms = get_irp_n_asms(); i < n_asms; ++i) {
 		ident *asm_text = get_irp_asm(i);
-		fputc('\t', env->file);
+		write_indent(env);
 		write_symbol(env, "asm");
 		write_ident(env, asm_text);
-		fputc('\n', env->file);
+		write_line_end(env);
 	}
 	write_scope_end(env);
 }
@@ -1072,6 +1388,170 @@ static void write_irg(write_env_t *env, ir_graph *irg)
 	write_scope_end(env);
 }
 
+static void write_constirg(write_env_t *env)
+{
+	write_symbol(env, "constirg");
+	write_node_ref(env, get_const_code_irg()->current_block);
+	write_scope_begin(env);
+	walk_const_code(NULL, write_node_cb, env);
+	write_scope_end(env);
+}
+
+/**
+ * Writes a back reference if @p thing was written before, otherwise assigns
+ * it the next reference number.
+ *
+ * @returns true if a back reference was written
+ */
+static bool write_content_backref(write_env_t *env, void const *thing)
+{
+	binary_output_t *const bin = env->bin;
+	size_t           const nr  = PTR_TO_INT(pmap_get(void, bin->content_ids, thing));
+	if (nr != 0) {
+		write_symbol(env, "ref");
+		write_size_t(env, nr - 1);
+		return true;
+	}
+	pmap_insert(bin->content_ids, thing, INT_TO_PTR(pmap_count(bin->content_ids) + 1));
+	return false;
+}
+
+/** Writes the properties of @p entity that matter to code referencing it. */
+static void write_entity_content(write_env_t *env, ir_entity *entity)
+{
+	if (write_content_backref(env, entity))
+		return;
+
+	ir_entity_kind const kind = get_entity_kind(entity);
+	write_unsigned(env, kind);
+	switch (kind) {
+	case IR_ENTITY_LABEL:
+		/* label numbers differ between programs */
+		env->bin->incomplete = true;
+		write_long(env, get_entity_label(entity));
+		return;
+	case IR_ENTITY_PARAMETER:
+		write_size_t(env, get_entity_parameter_number(entity));
+		/* FALLTHROUGH */
+	case IR_ENTITY_COMPOUND_MEMBER:
+	case IR_ENTITY_SPILLSLOT:
+		write_int(env, get_entity_offset(entity));
+		write_unsigned(env, get_entity_bitfield_offset(entity));
+		write_unsigned(env, get_entity_bitfield_size(entity));
+		break;
+	case IR_ENTITY_METHOD:
+		write_unsigned(env, get_entity_additional_properties(entity));
+		break;
+	case IR_ENTITY_ALIAS:
+		write_entity_content(env, get_entity_alias(entity));
+		break;
+	case IR_ENTITY_NORMAL:
+	case IR_ENTITY_UNKNOWN:
+		break;
+	}
+
+	write_ident(env, get_entity_ld_ident(entity));
+	write_visibility(env, get_entity_visibility(entity));
+	write_unsigned(env, get_entity_linkage(entity));
+	write_volatility(env, get_entity_volatility(entity));
+	write_unsigned(env, get_entity_alignment(entity));
+	write_unsigned(env, entity_has_definition(entity));
+
+	/* segments are only distinguished, their members are not written */
+	ir_type *const owner = get_entity_owner(entity);
+	if (is_segment_type(owner)) {
+		long segment = -1;
+		for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+			if (get_segment_type(s) == owner)
+				segment = s;
+		}
+		write_long(env, segment);
+	}
+	write_type_content(env, get_entity_type(entity));
+}
+
+/** Writes the structure of @p type. */
+static void write_type_content(write_env_t *env, ir_type *type)
+{
+	if (write_content_backref(env, type))
+		return;
+
+	tp_opcode const opcode = get_type_opcode(type);
+	write_symbol(env, get_type_opcode_name(opcode));
+	write_unsigned(env, get_type_size(type));
+	write_unsigned(env, get_type_alignment(type));
+	write_type_state(env, get_type_state(type));
+	switch (opcode) {
+	case tpo_primitive:
+		write_mode_ref(env, get_type_mode(type));
+		break;
+	case tpo_pointer:
+		write_type_content(env, get_pointer_points_to_type(type));
+		break;
+	case tpo_array:
+		write_unsigned(env, get_array_size(type));
+		write_type_content(env, get_array_element_type(type));
+		break;
+	case tpo_method: {
+		size_t const n_params = get_method_n_params(type);
+		size_t const n_ress   = get_method_n_ress(type);
+		write_size_t(env, n_params);
+		for (size_t i = 0; i < n_params; ++i)
+			write_type_content(env, get_method_param_type(type, i));
+		write_size_t(env, n_ress);
+		for (size_t i = 0; i < n_ress; ++i)
+			write_type_content(env, get_method_res_type(type, i));
+		write_unsigned(env, get_method_calling_convention(type));
+		write_unsigned(env, get_method_additional_properties(type));
+		write_unsigned(env, is_method_variadic(type));
+		break;
+	}
+	case tpo_class:
+	case tpo_struct:
+	case tpo_union: {
+		size_t const n_members = get_compound_n_members(type);
+		write_size_t(env, n_members);
+		for (size_t i = 0; i < n_members; ++i)
+			write_entity_content(env, get_compound_member(type, i));
+		break;
+	}
+	case tpo_code:
+	case tpo_segment:
+	case tpo_uninitialized:
+	case tpo_unknown:
+		break;
+	}
+}
+
+bool ir_export_irg_content(ir_graph *irg, write_content_func *func, void *ctx)
+{
+	binary_output_t bin;
+	memset(&bin, 0, sizeof(bin));
+	bin.content_func = func;
+	bin.content_ctx  = ctx;
+	bin.content_ids  = pmap_create();
+	init_node_index(&bin.nodes, irg);
+	init_node_index(&bin.const_nodes, get_const_code_irg());
+
+	write_env_t my_env;
+	write_env_t *env = &my_env;
+	memset(env, 0, sizeof(*env));
+	env->bin = &bin;
+	deq_init(&env->write_queue);
+	deq_init(&env->entity_queue);
+
+	writers_init();
+	write_irg(env, irg);
+	binary_flush(env);
+
+	DEL_ARR_F(bin.const_nodes.index);
+	DEL_ARR_F(bin.nodes.index);
+	pmap_destroy(bin.content_ids);
+	deq_free(&env->entity_queue);
+	deq_free(&env->write_queue);
+	return !bin.incomplete;
+}
+
 /* Exports the whole irp to the given file in a textual form. */
 void ir_export_file(FILE *file)
 {
@@ -1092,20 +1572,192 @@ void ir_export_file(FILE *file)
 		write_irg(env, irg);
 	}
 
-	write_symbol(env, "constirg");
-	write_node_ref(env, get_const_code_irg()->current_block);
-	write_scope_begin(env);
-	walk_const_code(NULL, write_node_cb, env);
-	write_scope_end(env);
+	write_constirg(env);
+
+	write_program(env);
+
+	deq_free(&env->entity_queue);
+	deq_free(&env->write_queue);
+}
 
+int ir_export_binary(const char *filename)
+{
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL) {
+		perror(filename);
+		return 1;
+	}
+
+	ir_export_binary_file(file);
+	int res = ferror(file);
+	fclose(file);
+	return res;
+}
+
+/* Exports the whole irp to the given file in the binary format. */
+void ir_export_binary_file(FILE *file)
+{
+	binary_output_t bin;
+	memset(&bin, 0, sizeof(bin));
+	bin.string_ids = pmap_create();
+	bin.strings    = NEW_ARR_F(ident*, 0);
+	init_node_index(&bin.const_nodes, get_const_code_irg());
+
+	write_env_t my_env;
+	write_env_t *env = &my_env;
+	memset(env, 0, sizeof(*env));
+	env->file = file;
+	env->bin  = &bin;
+	deq_init(&env->write_queue);
+	deq_init(&env->entity_queue);
+
+	writers_init();
+	for (size_t i = 0; i < sizeof(binary_magic); ++i)
+		binary_write_byte(env, binary_magic[i]);
+	binary_write_fixed(env, BINARY_VERSION, 4);
+
+	/* the global section */
+	uint64_t const global_offset = bin.offset;
+	write_modes(env);
+	write_typegraph(env);
+	write_constirg(env);
 	write_program(env);
+	uint64_t const global_size = bin.offset - global_offset;
 
+	size_t         const n_irgs   = get_irp_n_irgs();
+	irg_section_t *const sections = XMALLOCN(irg_section_t, n_irgs);
+	foreach_irp_irg(i, irg) {
+		irg_section_t *const section = &sections[i];
+		section->entity_nr = get_entity_nr(get_irg_entity(irg));
+		section->offset    = bin.offset;
+		init_node_index(&bin.nodes, irg);
+		write_irg(env, irg);
+		section->size    = bin.offset - section->offset;
+		section->n_nodes = bin.nodes.n_nodes;
+		DEL_ARR_F(bin.nodes.index);
+	}
+
+	uint64_t const irgs_offset = bin.offset;
+	for (size_t i = 0; i < n_irgs; ++i) {
+		irg_section_t const *const section = &sections[i];
+		binary_write_fixed(env, (uint64_t)section->entity_nr, 8);
+		binary_write_fixed(env, section->offset, 8);
+		binary_write_fixed(env, section->size, 8);
+		binary_write_fixed(env, section->n_nodes, 8);
+	}
+	free(sections);
+
+	uint64_t const strings_offset = bin.offset;
+	size_t   const n_strings      = ARR_LEN(bin.strings);
+	uint64_t       string_offset  = 0;
+	for (size_t i = 0; i < n_strings; ++i) {
+		binary_write_fixed(env, string_offset, 8);
+		string_offset += strlen(get_id_str(bin.strings[i])) + 1;
+	}
+	for (size_t i = 0; i < n_strings; ++i) {
+		char const *const string = get_id_str(bin.strings[i]);
+		for (char const *c = string;; ++c) {
+			binary_write_byte(env, (unsigned char)*c);
+			if (*c == '\0')
+				break;
+		}
+	}
+
+	binary_write_fixed(env, global_offset, 8);
+	binary_write_fixed(env, global_size, 8);
+	binary_write_fixed(env, irgs_offset, 8);
+	binary_write_fixed(env, n_irgs, 8);
+	binary_write_fixed(env, strings_offset, 8);
+	binary_write_fixed(env, n_strings, 8);
+	for (size_t i = 0; i < sizeof(binary_magic); ++i)
+		binary_write_byte(env, binary_magic[i]);
+	binary_flush(env);
+
+	DEL_ARR_F(bin.const_nodes.index);
+	DEL_ARR_F(bin.strings);
+	pmap_destroy(bin.string_ids);
 	deq_free(&env->entity_queue);
 	deq_free(&env->write_queue);
 }
 
 
 
+/** Returns the tag of the next token of the binary input or EOF. */
+static int binary_peek(read_env_t *env)
+{
+	binary_input_t *const bin = env->bin;
+	while (bin->pos != bin->end && *bin->pos == bt_line_end)
+		++bin->pos;
+	return bin->pos != bin->end ? *bin->pos : EOF;
+}
+
+static void binary_expect(read_env_t *env, binary_token_t token)
+{
+	int const next = binary_peek(env);
+	if (next != (int)token) {
+		binary_error(env, "Unexpected token %d, expected %d\n", next, token);
+	}
+	++env->bin->pos;
+}
+
+static uint64_t binary_read_varint(read_env_t *env)
+{
+	binary_input_t *const bin   = env->bin;
+	uint64_t              value = 0;
+	for (unsigned shift = 0; shift < 64; shift += 7) {
+		if (bin->pos == bin->end)
+			break;
+		unsigned char const byte = *bin->pos++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+	binary_error(env, "Malformed number\n");
+}
+
+static long binary_read_number(read_env_t *env)
+{
+	binary_expect(env, bt_number);
+	uint64_t const bits = binary_read_varint(env);
+	return (long)(bits & 1 ? ~(bits >> 1) : bits >> 1);
+}
+
+/** Reads a string or word token and returns its string table index. */
+static size_t binary_read_string_index(read_env_t *env, binary_token_t token)
+{
+	binary_expect(env, token);
+	uint64_t const idx = binary_read_varint(env);
+	if (idx >= env->bin->n_strings) {
+		binary_error(env, "Invalid string index %zu\n", (size_t)idx);
+	}
+	return (size_t)idx;
+}
+
+static char const *binary_read_string(read_env_t *env, binary_token_t token)
+{
+	return env->bin->strings[binary_read_string_index(env, token)];
+}
+
+static ident *binary_read_ident(read_env_t *env, binary_token_t token)
+{
+	binary_input_t *const bin = env->bin;
+	size_t          const idx = binary_read_string_index(env, token);
+	if (bin->idents[idx] == NULL)
+		bin->idents[idx] = new_id_from_str(bin->strings[idx]);
+	return bin->idents[idx];
+}
+
+/** Checks whether the next token is the word NULL and skips it if so. */
+static bool binary_read_null(read_env_t *env)
+{
+	if (binary_peek(env) != bt_word)
+		return false;
+	if (!streq(binary_read_string(env, bt_word), "NULL")) {
+		binary_error(env, "Expected \"string\" or NULL\n");
+	}
+	return true;
+}
+
 static void read_c(read_env_t *env)
 {
 	int c = fgetc(env->file);
@@ -1134,6 +1786,17 @@ static void skip_ws(read_env_t *env)
 
 static void skip_to(read_env_t *env, char to_ch)
 {
+	if (env->bin != NULL) {
+		/* records end with a line end token, which is not skipped */
+		assert(to_ch == '\n');
+		binary_input_t *const bin = env->bin;
+		while (bin->pos != bin->end && *bin->pos != bt_line_end) {
+			unsigned char const token = *bin->pos++;
+			if (token == bt_number || token == bt_string || token == bt_word)
+				binary_read_varint(env);
+		}
+		return;
+	}
 	while (env->c != to_ch && env->c != EOF) {
 		read_c(env);
 	}
@@ -1141,6 +1804,14 @@ static void skip_to(read_env_t *env, char to_ch)
 
 static bool expect_char(read_env_t *env, char ch)
 {
+	if (env->bin != NULL) {
+		assert(ch == '{');
+		if (binary_peek(env) != bt_scope_begin) {
+			binary_error(env, "Expected '%c'\n", ch);
+		}
+		++env->bin->pos;
+		return true;
+	}
 	skip_ws(env);
 	if (env->c != ch) {
 		parse_error(env, "Unexpected char '%c', expected '%c'\n",
@@ -1153,8 +1824,50 @@ static bool expect_char(read_env_t *env, char ch)
 
 #define EXPECT(c) if (expect_char(env, (c))) {} else return
 
+/**
+ * Checks whether another element follows in the current scope and skips the
+ * end of the scope otherwise.
+ */
+static bool scope_has_next(read_env_t *env)
+{
+	if (env->bin != NULL) {
+		int const token = binary_peek(env);
+		if (token == EOF) {
+			binary_error(env, "Unexpected end of section while reading scope\n");
+		}
+		if (token == bt_scope_end) {
+			++env->bin->pos;
+			return false;
+		}
+		return true;
+	}
+	skip_ws(env);
+	if (env->c == '}' || env->c == EOF) {
+		read_c(env);
+		return false;
+	}
+	return true;
+}
+
+static bool input_has_next(read_env_t *env)
+{
+	if (env->bin != NULL)
+		return binary_peek(env) != EOF;
+	skip_ws(env);
+	return env->c != EOF;
+}
+
 static char *read_word(read_env_t *env)
 {
+	if (env->bin != NULL) {
+		if (binary_peek(env) == bt_number) {
+			obstack_printf(&env->obst, "%ld", binary_read_number(env));
+			obstack_1grow(&env->obst, '\0');
+			return (char*)obstack_finish(&env->obst);
+		}
+		char const *const word = binary_read_string(env, bt_word);
+		return (char*)obstack_copy0(&env->obst, word, strlen(word));
+	}
 	skip_ws(env);
 
 	assert(obstack_object_size(&env->obst) == 0);
@@ -1182,6 +1895,10 @@ endofword:
 
 static char *read_string(read_env_t *env)
 {
+	if (env->bin != NULL) {
+		char const *const string = binary_read_string(env, bt_string);
+		return (char*)obstack_copy0(&env->obst, string, strlen(string));
+	}
 	skip_ws(env);
 	if (env->c != '"') {
 		parse_error(env, "Expected string, got '%c'\n", env->c);
@@ -1223,6 +1940,8 @@ static char *read_string(read_env_t *env)
 
 static ident *read_ident(read_env_t *env)
 {
+	if (env->bin != NULL)
+		return binary_read_ident(env, bt_string);
 	char  *str = read_string(env);
 	ident *res = new_id_from_str(str);
 	obstack_free(&env->obst, str);
@@ -1231,6 +1950,8 @@ static ident *read_ident(read_env_t *env)
 
 static ident *read_symbol(read_env_t *env)
 {
+	if (env->bin != NULL)
+		return binary_read_ident(env, bt_word);
 	char  *str = read_word(env);
 	ident *res = new_id_from_str(str);
 	obstack_free(&env->obst, str);
@@ -1242,6 +1963,8 @@ static ident *read_symbol(read_env_t *env)
  */
 static char *read_string_null(read_env_t *env)
 {
+	if (env->bin != NULL)
+		return binary_read_null(env) ? NULL : read_string(env);
 	skip_ws(env);
 	if (env->c == 'N') {
 		char *str = read_word(env);
@@ -1259,6 +1982,8 @@ static char *read_string_null(read_env_t *env)
 
 static ident *read_ident_null(read_env_t *env)
 {
+	if (env->bin != NULL)
+		return binary_read_null(env) ? NULL : binary_read_ident(env, bt_string);
 	char *str = read_string_null(env);
 	if (str == NULL)
 		return NULL;
@@ -1270,6 +1995,8 @@ static ident *read_ident_null(read_env_t *env)
 
 static long read_long(read_env_t *env)
 {
+	if (env->bin != NULL)
+		return binary_read_number(env);
 	skip_ws(env);
 	if (!isdigit(env->c) && env->c != '-') {
 		parse_error(env, "Expected number, got '%c'\n", env->c);
@@ -1297,7 +2024,10 @@ int read_int(read_env_t *env)
 
 unsigned read_unsigned(read_env_t *env)
 {
-	return (unsigned) read_long(env);
+	long const value = read_long(env);
+	if (env->bin != NULL && (value < 0 || value > (long)UINT_MAX))
+		binary_error(env, "Invalid unsigned number %ld\n", value);
+	return (unsigned) value;
 }
 
 size_t read_size_t(read_env_t *env)
@@ -1308,6 +2038,10 @@ size_t read_size_t(read_env_t *env)
 
 static void expect_list_begin(read_env_t *env)
 {
+	if (env->bin != NULL) {
+		binary_expect(env, bt_list_begin);
+		return;
+	}
 	skip_ws(env);
 	if (env->c != '[') {
 		parse_error(env, "Expected list, got '%c'\n", env->c);
@@ -1318,6 +2052,17 @@ static void expect_list_begin(read_env_t *env)
 
 static bool list_has_next(read_env_t *env)
 {
+	if (env->bin != NULL) {
+		int const token = binary_peek(env);
+		if (token == EOF) {
+			binary_error(env, "Unexpected end of section while reading list\n");
+		}
+		if (token == bt_list_end) {
+			++env->bin->pos;
+			return false;
+		}
+		return true;
+	}
 	if (feof(env->file)) {
 		parse_error(env, "Unexpected EOF while reading list");
 		exit(1);
@@ -1349,8 +2094,41 @@ static void set_id(read_env_t *env, long id, void *elem)
 	(void)set_insert(id_entry, env->idset, &key, sizeof(key), (unsigned) id);
 }
 
+/** Returns the nodes of the graph currently read from binary input. */
+static ir_node ***get_binary_nodes(read_env_t *env)
+{
+	binary_input_t *const bin = env->bin;
+	return env->irg == get_const_code_irg() ? &bin->const_nodes : &bin->nodes;
+}
+
+static void set_node_id(read_env_t *env, long nodenr, ir_node *node)
+{
+	if (env->bin == NULL) {
+		set_id(env, nodenr, node);
+		return;
+	}
+	/* every node takes several bytes, so larger indices are corrupt */
+	if (nodenr < 0 || (size_t)nodenr >= env->bin->size) {
+		parse_error(env, "Invalid node index %ld\n", nodenr);
+		return;
+	}
+	ir_node ***const nodes   = get_binary_nodes(env);
+	size_t     const old_len = ARR_LEN(*nodes);
+	if ((size_t)nodenr >= old_len) {
+		ARR_RESIZE(ir_node*, *nodes, nodenr + 1);
+		memset(*nodes + old_len, 0, (nodenr + 1 - old_len) * sizeof(**nodes));
+	}
+	(*nodes)[nodenr] = node;
+}
+
 static ir_node *get_node_or_null(read_env_t *env, long nodenr)
 {
+	if (env->bin != NULL) {
+		ir_node **const nodes = *get_binary_nodes(env);
+		if (nodenr < 0 || (size_t)nodenr >= ARR_LEN(nodes))
+			return NULL;
+		return nodes[nodenr];
+	}
 	ir_node *node = (ir_node *) get_id(env, nodenr);
 	if (node && node->kind != k_ir_node) {
 		parse_error(env, "Irn ID %ld collides with something else\n",
@@ -1376,6 +2154,8 @@ static ir_type *get_type(read_env_t *env, long typenr)
 
 ir_type *read_type_ref(read_env_t *env)
 {
+	if (env->bin != NULL && binary_peek(env) == bt_number)
+		return get_type(env, binary_read_number(env));
 	char *str = read_word(env);
 	if (streq(str, "unknown")) {
 		obstack_free(&env->obst, str);
@@ -1419,15 +2199,36 @@ ir_entity *read_entity_ref(read_env_t *env)
 	return get_entity(env, nr);
 }
 
-ir_mode *read_mode_ref(read_env_t *env)
+static ir_mode *find_mode(const char *name)
 {
-	char *str = read_string(env);
 	for (size_t i = 0, n = ir_get_n_modes(); i < n; i++) {
 		ir_mode *mode = ir_get_mode(i);
-		if (streq(str, get_mode_name(mode))) {
-			obstack_free(&env->obst, str);
+		if (streq(name, get_mode_name(mode)))
 			return mode;
+	}
+	return NULL;
+}
+
+ir_mode *read_mode_ref(read_env_t *env)
+{
+	if (env->bin != NULL) {
+		binary_input_t *const bin = env->bin;
+		size_t          const idx = binary_read_string_index(env, bt_string);
+		if (bin->modes[idx] == NULL) {
+			bin->modes[idx] = find_mode(bin->strings[idx]);
+			if (bin->modes[idx] == NULL) {
+				parse_error(env, "unknown mode \"%s\"\n", bin->strings[idx]);
+				return mode_ANY;
+			}
 		}
+		return bin->modes[idx];
+	}
+
+	char    *str  = read_string(env);
+	ir_mode *mode = find_mode(str);
+	if (mode != NULL) {
+		obstack_free(&env->obst, str);
+		return mode;
 	}
 
 	parse_error(env, "unknown mode \"%s\"\n", str);
@@ -1461,6 +2262,18 @@ static const char *get_typetag_name(typetag_t typetag)
  */
 static unsigned read_enum(read_env_t *env, typetag_t typetag)
 {
+	if (env->bin != NULL) {
+		binary_input_t  *const bin = env->bin;
+		size_t           const idx = binary_read_string_index(env, bt_word);
+		symbol_t const **const sym = &bin->symbols[idx];
+		if (*sym == NULL || (*sym)->typetag != typetag)
+			*sym = find_symbol(bin->strings[idx], typetag);
+		if (*sym != NULL)
+			return (*sym)->code;
+		parse_error(env, "invalid %s: \"%s\"\n", get_typetag_name(typetag),
+		            bin->strings[idx]);
+		return 0;
+	}
 	char    *str  = read_word(env);
 	unsigned code = symbol(str, typetag);
 
@@ -1546,6 +2359,8 @@ ir_relation read_relation(read_env_t *env)
 ir_tarval *read_tarval_ref(read_env_t *env)
 {
 	ir_mode   *tvmode = read_mode_ref(env);
+	if (env->bin != NULL)
+		return ir_tarval_from_ascii(binary_read_string(env, bt_word), tvmode);
 	char      *str    = read_word(env);
 	ir_tarval *tv     = ir_tarval_from_ascii(str, tvmode);
 	obstack_free(&env->obst, str);
@@ -1889,15 +2704,8 @@ static void read_typegraph(read_env_t *env)
 	env->irg = get_const_code_irg();
 
 	/* parse all types first */
-	while (true) {
-		keyword_t kwkind;
-		skip_ws(env);
-		if (env->c == '}') {
-			read_c(env);
-			break;
-		}
-
-		kwkind = read_keyword(env);
+	while (scope_has_next(env)) {
+		keyword_t kwkind = read_keyword(env);
 		switch (kwkind) {
 		case kw_type:
 			read_type(env);
@@ -2070,13 +2878,19 @@ static ir_node *read_node(read_env_t *env)
 	} else {
 		res = func(env);
 	}
-	set_id(env, nr, res);
+	/* construction does not verify binary input, see ir_cons_verify_disabled */
+	if (env->bin != NULL && !irn_verify(res))
+		binary_error(env, "Invalid node %ld\n", nr);
+	set_node_id(env, nr, res);
 	return res;
 }
 
+/** Initializes the node readers. May be called more than once without problems. */
 static void readers_init(void)
 {
-	assert(node_readers == NULL);
+	if (node_readers != NULL)
+		return;
+
 	node_readers = pmap_create();
 	register_node_reader("Anchor", read_Anchor);
 	register_node_reader("ASM",    read_ASM);
@@ -2086,19 +2900,25 @@ static void readers_init(void)
 	register_generated_node_readers();
 }
 
+void finish_irio(void)
+{
+	if (node_readers != NULL) {
+		pmap_destroy(node_readers);
+		node_readers = NULL;
+	}
+	if (symtbl != NULL) {
+		del_set(symtbl);
+		symtbl = NULL;
+	}
+}
+
 static void read_graph(read_env_t *env, ir_graph *irg)
 {
 	env->irg           = irg;
 	env->delayed_preds = NEW_ARR_F(const delayed_pred_t*, 0);
 
 	EXPECT('{');
-	while (true) {
-		skip_ws(env);
-		if (env->c == '}' || env->c == EOF) {
-			read_c(env);
-			break;
-		}
-
+	while (scope_has_next(env)) {
 		read_node(env);
 	}
 
@@ -2132,6 +2952,7 @@ static ir_graph *read_irg(read_env_t *env)
 {
 	ir_entity *irgent    = get_entity(env, read_long(env));
 	ir_graph  *irg       = new_ir_graph(irgent, 0);
+	env->irg = irg;
 	ir_type   *frame     = read_type_ref(env);
 	ir_type   *old_frame = get_irg_frame_type(irg);
 	set_irg_frame_type(irg, frame);
@@ -2146,22 +2967,15 @@ static void read_modes(read_env_t *env)
 {
 	EXPECT('{');
 
-	while (true) {
-		keyword_t kwkind;
-
-		skip_ws(env);
-		if (env->c == '}' || env->c == EOF) {
-			read_c(env);
-			break;
-		}
-
-		kwkind = read_keyword(env);
+	while (scope_has_next(env)) {
+		keyword_t kwkind = read_keyword(env);
 		switch (kwkind) {
 		case kw_int_mode: {
 			const char *name = read_string(env);
 			ir_mode_arithmetic arith = read_mode_arithmetic(env);
-			assert(arith == irma_twos_complement);
-			(void)arith;
+			if (arith != irma_twos_complement)
+				parse_error(env, "invalid arithmetic of integer mode \"%s\"\n",
+				            name);
 			int size = read_long(env);
 			int sign = read_long(env);
 			unsigned modulo_shift = read_long(env);
@@ -2171,8 +2985,9 @@ static void read_modes(read_env_t *env)
 		case kw_reference_mode: {
 			const char *name = read_string(env);
 			ir_mode_arithmetic arith = read_mode_arithmetic(env);
-			assert(arith == irma_twos_complement);
-			(void)arith;
+			if (arith != irma_twos_complement)
+				parse_error(env, "invalid arithmetic of reference mode \"%s\"\n",
+				            name);
 			int size = read_long(env);
 			unsigned modulo_shift = read_long(env);
 			ir_mode *mode = new_reference_mode(name, size, modulo_shift);
@@ -2193,6 +3008,13 @@ static void read_modes(read_env_t *env)
 			               overflow);
 			break;
 		}
+		case kw_vector_mode: {
+			const char *name    = read_string(env);
+			ir_mode    *element = read_mode_ref(env);
+			unsigned    n_lanes = read_unsigned(env);
+			new_vector_mode(name, element, n_lanes);
+			break;
+		}
 
 		default:
 			skip_to(env, '\n');
@@ -2205,13 +3027,7 @@ static void read_program(read_env_t *env)
 {
 	EXPECT('{');
 
-	while (true) {
-		skip_ws(env);
-		if (env->c == '}') {
-			read_c(env);
-			break;
-		}
-
+	while (scope_has_next(env)) {
 		keyword_t kwkind = read_keyword(env);
 		switch (kwkind) {
 		case kw_segment_type: {
@@ -2232,25 +3048,8 @@ static void read_program(read_env_t *env)
 	}
 }
 
-int ir_import(const char *filename)
+static void init_read_env(read_env_t *env, const char *inputname)
 {
-	FILE *file = fopen(filename, "rt");
-	if (file == NULL) {
-		perror(filename);
-		return 1;
-	}
-
-	int res = ir_import_file(file, filename);
-	fclose(file);
-	return res;
-}
-
-int ir_import_file(FILE *input, const char *inputname)
-{
-	read_env_t          myenv;
-	int                 oldoptimize = get_optimize();
-	read_env_t         *env         = &myenv;
-
 	readers_init();
 	symtbl_init();
 
@@ -2260,30 +3059,28 @@ int ir_import_file(FILE *input, const char *inputname)
 	env->idset      = new_set(id_cmp, 128);
 	env->fixedtypes = NEW_ARR_F(ir_type *, 0);
 	env->inputname  = inputname;
-	env->file       = input;
 	env->line       = 1;
 	env->delayed_initializers = NEW_ARR_F(delayed_initializer_t, 0);
 
-	/* read first character */
-	read_c(env);
-
-	/* if the first line starts with '#', it contains a comment. */
-	if (env->c == '#')
-		skip_to(env, '\n');
-
-	set_optimize(0);
-
 	n_initial_types = get_irp_n_types();
 	maybe_initial_type = true;
+}
 
-	while (true) {
-		keyword_t kw;
-
-		skip_ws(env);
-		if (env->c == EOF)
-			break;
+static void free_read_env(read_env_t *env)
+{
+	if (env->fixedtypes != NULL)
+		DEL_ARR_F(env->fixedtypes);
+	if (env->delayed_initializers != NULL)
+		DEL_ARR_F(env->delayed_initializers);
+	del_set(env->idset);
+	obstack_free(&env->preds_obst, NULL);
+	obstack_free(&env->obst, NULL);
+}
 
-		kw = read_keyword(env);
+static void read_toplevel(read_env_t *env)
+{
+	while (input_has_next(env)) {
+		keyword_t kw = read_keyword(env);
 		switch (kw) {
 		case kw_modes:
 			read_modes(env);
@@ -2300,7 +3097,8 @@ int ir_import_file(FILE *input, const char *inputname)
 		case kw_constirg: {
 			ir_graph *constirg = get_const_code_irg();
 			long bodyblockid = read_long(env);
-			set_id(env, bodyblockid, constirg->current_block);
+			env->irg = constirg;
+			set_node_id(env, bodyblockid, constirg->current_block);
 			read_graph(env, constirg);
 			break;
 		}
@@ -2315,13 +3113,22 @@ int ir_import_file(FILE *input, const char *inputname)
 		}
 		}
 	}
+}
 
+/**
+ * Fixes the layout of the types read and resolves the initializers referring
+ * to nodes of the const code graph.
+ */
+static void finish_types(read_env_t *env)
+{
 	for (size_t i = 0, n = ARR_LEN(env->fixedtypes); i < n; i++)
 		set_type_state(env->fixedtypes[i], layout_fixed);
 
 	DEL_ARR_F(env->fixedtypes);
+	env->fixedtypes = NULL;
 
 	/* resolve delayed initializers */
+	env->irg = get_const_code_irg();
 	for (size_t i = 0, n = ARR_LEN(env->delayed_initializers); i < n; ++i) {
 		const delayed_initializer_t *di   = &env->delayed_initializers[i];
 		ir_node                     *node = get_node_or_null(env, di->node_nr);
@@ -2335,16 +3142,333 @@ int ir_import_file(FILE *input, const char *inputname)
 	}
 	DEL_ARR_F(env->delayed_initializers);
 	env->delayed_initializers = NULL;
+}
 
-	del_set(env->idset);
+static uint64_t get_fixed(unsigned char const *data, unsigned n_bytes)
+{
+	uint64_t value = 0;
+	for (unsigned i = n_bytes; i-- > 0;)
+		value = value << 8 | data[i];
+	return value;
+}
+
+/** Checks whether the range [@p offset, @p offset + @p size) lies within @p limit. */
+static bool is_valid_range(uint64_t offset, uint64_t size, uint64_t limit)
+{
+	return offset <= limit && size <= limit - offset;
+}
+
+/**
+ * Decodes header, trailer, string table and graph table of a binary file and
+ * positions the input at the global section.
+ */
+static void read_binary_tables(read_env_t *env)
+{
+	binary_input_t      *const bin  = env->bin;
+	unsigned char const *const data = bin->data;
+	size_t               const size = bin->size;
+	if (size < BINARY_HEADER_SIZE + BINARY_TRAILER_SIZE
+	    || memcmp(data, binary_magic, sizeof(binary_magic)) != 0
+	    || memcmp(data + size - sizeof(binary_magic), binary_magic,
+	              sizeof(binary_magic)) != 0) {
+		binary_error(env, "not a binary IR file\n");
+	}
+	unsigned const version = (unsigned)get_fixed(data + sizeof(binary_magic), 4);
+	if (version != BINARY_VERSION)
+		binary_error(env, "unsupported binary IR version %u\n", version);
+
+	uint64_t             const limit          = size - BINARY_TRAILER_SIZE;
+	unsigned char const *const trailer        = data + limit;
+	uint64_t             const global_offset  = get_fixed(trailer,      8);
+	uint64_t             const global_size    = get_fixed(trailer +  8, 8);
+	uint64_t             const irgs_offset    = get_fixed(trailer + 16, 8);
+	uint64_t             const n_irgs         = get_fixed(trailer + 24, 8);
+	uint64_t             const strings_offset = get_fixed(trailer + 32, 8);
+	uint64_t             const n_strings      = get_fixed(trailer + 40, 8);
+	if (!is_valid_range(global_offset, global_size, limit)
+	    || irgs_offset > limit
+	    || n_irgs > (limit - irgs_offset) / BINARY_IRG_SIZE
+	    || strings_offset > limit
+	    || n_strings > (limit - strings_offset) / 8) {
+		binary_error(env, "corrupt binary IR trailer\n");
+	}
+
+	/* the string table, all strings must be terminated within the table */
+	unsigned char const *const blob      = data + strings_offset + n_strings * 8;
+	uint64_t             const blob_size = limit - (strings_offset + n_strings * 8);
+	if (n_strings > 0 && (blob_size == 0 || blob[blob_size - 1] != '\0')) {
+		binary_error(env, "corrupt binary IR string table\n");
+	}
+	bin->n_strings = n_strings;
+	bin->strings   = XMALLOCN(char const*, n_strings);
+	bin->idents    = XMALLOCNZ(ident*, n_strings);
+	bin->modes     = XMALLOCNZ(ir_mode*, n_strings);
+	bin->symbols   = XMALLOCNZ(symbol_t const*, n_strings);
+	for (size_t i = 0; i < n_strings; ++i) {
+		uint64_t const offset = get_fixed(data + strings_offset + i * 8, 8);
+		if (offset >= blob_size)
+			binary_error(env, "corrupt binary IR string table\n");
+		bin->strings[i] = (char const*)blob + offset;
+	}
+
+	bin->n_irgs = n_irgs;
+	bin->irgs   = XMALLOCNZ(irg_section_t, n_irgs);
+	for (size_t i = 0; i < n_irgs; ++i) {
+		unsigned char const *const entry   = data + irgs_offset + i * BINARY_IRG_SIZE;
+		irg_section_t       *const section = &bin->irgs[i];
+		section->entity_nr = (long)get_fixed(entry, 8);
+		section->offset    = get_fixed(entry +  8, 8);
+		section->size      = get_fixed(entry + 16, 8);
+		section->n_nodes   = get_fixed(entry + 24, 8);
+		if (!is_valid_range(section->offset, section->size, limit)
+		    || section->n_nodes > section->size) {
+			binary_error(env, "corrupt binary IR graph table\n");
+		}
+	}
+
+	bin->pos = data + global_offset;
+	bin->end = bin->pos + global_size;
+}
+
+/** Maps the graph entities of a binary file to their sections. */
+static void map_irg_sections(read_env_t *env)
+{
+	binary_input_t *const bin = env->bin;
+	bin->irg_sections = pmap_create_ex(bin->n_irgs);
+	for (size_t i = 0; i < bin->n_irgs; ++i) {
+		irg_section_t *const section = &bin->irgs[i];
+		ir_entity     *const entity  = (ir_entity*)get_id(env, section->entity_nr);
+		if (entity == NULL || !is_entity(entity))
+			binary_error(env, "unknown graph entity: %ld\n", section->entity_nr);
+		pmap_insert(bin->irg_sections, entity, section);
+	}
+}
 
+/**
+ * Opens the binary file in @p data and imports its global section.
+ * Takes ownership of @p data.
+ */
+static ir_lazy_import *open_binary(unsigned char const *data, size_t size,
+                                   bool mapped, const char *inputname)
+{
+	ir_lazy_import *const import = XMALLOCZ(ir_lazy_import);
+	import->mapped = mapped;
+	import->name   = xstrdup(inputname);
+
+	binary_input_t *const bin = &import->bin;
+	bin->data        = data;
+	bin->size        = size;
+	bin->pos         = data;
+	bin->end         = data;
+	bin->nodes       = NEW_ARR_F(ir_node*, 0);
+	bin->const_nodes = NEW_ARR_F(ir_node*, 0);
+
+	read_env_t *const env = &import->env;
+	init_read_env(env, import->name);
+	env->bin = bin;
+
+	int const oldoptimize = get_optimize();
+	if (setjmp(bin->error) != 0) {
+		set_optimize(oldoptimize);
+		ir_cons_verify_disabled = false;
+		ir_import_lazy_free(import);
+		return NULL;
+	}
+	read_binary_tables(env);
+	set_optimize(0);
+	ir_cons_verify_disabled = true;
+	read_toplevel(env);
+	finish_types(env);
+	ir_cons_verify_disabled = false;
 	set_optimize(oldoptimize);
 
-	obstack_free(&env->preds_obst, NULL);
-	obstack_free(&env->obst, NULL);
+	map_irg_sections(env);
+	return import;
+}
+
+static unsigned char *read_file(FILE *file, size_t *size)
+{
+	size_t         capacity = 1 << 16;
+	size_t         n        = 0;
+	unsigned char *data     = XMALLOCN(unsigned char, capacity);
+	for (;;) {
+		n += fread(data + n, 1, capacity - n, file);
+		if (n < capacity)
+			break;
+		capacity *= 2;
+		data = XREALLOC(data, unsigned char, capacity);
+	}
+	*size = n;
+	return data;
+}
+
+int ir_import(const char *filename)
+{
+	FILE *file = fopen(filename, "rb");
+	if (file == NULL) {
+		perror(filename);
+		return 1;
+	}
+
+	int res = ir_import_file(file, filename);
+	fclose(file);
+	return res;
+}
+
+/** Imports all graphs of a binary file read from @p input. */
+static int import_binary_file(FILE *input, const char *inputname)
+{
+	size_t                size;
+	unsigned char  *const data   = read_file(input, &size);
+	ir_lazy_import *const import = open_binary(data, size, false, inputname);
+	if (import == NULL)
+		return 1;
+
+	for (size_t i = 0, n = import->bin.n_irgs; i < n; ++i) {
+		irg_section_t const *const section = &import->bin.irgs[i];
+		ir_entity *const entity = (ir_entity*)get_id(&import->env, section->entity_nr);
+		if (entity != NULL && is_entity(entity))
+			ir_import_lazy_irg(import, entity);
+	}
+
+	int const res = import->env.read_errors;
+	ir_import_lazy_free(import);
+	return res;
+}
+
+int ir_import_file(FILE *input, const char *inputname)
+{
+	/* binary files start with a magic that is no valid text */
+	int const first = fgetc(input);
+	if (first != EOF)
+		ungetc(first, input);
+	if (first == (unsigned char)binary_magic[0])
+		return import_binary_file(input, inputname);
+
+	read_env_t  myenv;
+	int         oldoptimize = get_optimize();
+	read_env_t *env         = &myenv;
+
+	init_read_env(env, inputname);
+	env->file = input;
+
+	/* read first character */
+	read_c(env);
+
+	/* if the first line starts with '#', it contains a comment. */
+	if (env->c == '#')
+		skip_to(env, '\n');
+
+	set_optimize(0);
+
+	read_toplevel(env);
+	finish_types(env);
+
+	set_optimize(oldoptimize);
 
-	pmap_destroy(node_readers);
-	node_readers = NULL;
+	free_read_env(env);
 
 	return env->read_errors;
 }
+
+ir_lazy_import *ir_import_lazy(const char *filename)
+{
+#ifndef _WIN32
+	int const fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		perror(filename);
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void *const data = mmap(NULL, (size_t)st.st_size, PROT_READ,
+		                        MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data != MAP_FAILED)
+			return open_binary((unsigned char const*)data, (size_t)st.st_size,
+			                   true, filename);
+	} else {
+		close(fd);
+	}
+#endif
+
+	/* fall back to reading the file */
+	FILE *file = fopen(filename, "rb");
+	if (file == NULL) {
+		perror(filename);
+		return NULL;
+	}
+	size_t               size;
+	unsigned char *const data = read_file(file, &size);
+	fclose(file);
+	return open_binary(data, size, false, filename);
+}
+
+ir_graph *ir_import_lazy_irg(ir_lazy_import *import, ir_entity *entity)
+{
+	binary_input_t *const bin     = &import->bin;
+	irg_section_t  *const section = pmap_get(irg_section_t, bin->irg_sections, entity);
+	if (section == NULL)
+		return NULL;
+	if (section->irg != NULL)
+		return section->irg;
+
+	read_env_t *const env = &import->env;
+	bin->pos = bin->data + section->offset;
+	bin->end = bin->pos + section->size;
+	ARR_RESIZE(ir_node*, bin->nodes, section->n_nodes);
+	memset(bin->nodes, 0, section->n_nodes * sizeof(*bin->nodes));
+
+	/* errors stay recorded in env->read_errors for import_binary_file() */
+	int const oldoptimize = get_optimize();
+	env->irg = NULL;
+	if (setjmp(bin->error) != 0) {
+		/* drop the partially read graph */
+		set_optimize(oldoptimize);
+		ir_cons_verify_disabled = false;
+		if (obstack_object_size(&env->preds_obst) > 0)
+			obstack_free(&env->preds_obst, obstack_finish(&env->preds_obst));
+		if (env->delayed_preds != NULL) {
+			DEL_ARR_F(env->delayed_preds);
+			env->delayed_preds = NULL;
+		}
+		if (env->irg != NULL)
+			free_ir_graph(env->irg);
+		env->irg = NULL;
+		return NULL;
+	}
+	set_optimize(0);
+	ir_cons_verify_disabled = true;
+	keyword_t const kw = read_keyword(env);
+	if (kw != kw_irg)
+		binary_error(env, "Expected graph, got keyword %d\n", kw);
+	ir_graph *const irg = read_irg(env);
+	ir_cons_verify_disabled = false;
+	set_optimize(oldoptimize);
+
+	section->irg = irg;
+	return irg;
+}
+
+void ir_import_lazy_free(ir_lazy_import *import)
+{
+	binary_input_t *const bin = &import->bin;
+	free_read_env(&import->env);
+	if (bin->irg_sections != NULL)
+		pmap_destroy(bin->irg_sections);
+	DEL_ARR_F(bin->const_nodes);
+	DEL_ARR_F(bin->nodes);
+	free(bin->irgs);
+	free(bin->symbols);
+	free(bin->modes);
+	free(bin->idents);
+	free(bin->strings);
+#ifndef _WIN32
+	if (import->mapped)
+		munmap((void*)bin->data, bin->size);
+	else
+#endif
+		free((void*)bin->data);
+	free(import->name);
+	free(import);
+}
@@ -27,6 +27,7 @@ typedef struct read_env_t {
 	FILE          *file;
 	const char    *inputname;
 	unsigned       line;
+	struct binary_input_t *bin; /**< binary input, NULL for textual input */
 
 	ir_graph      *irg;
 	set           *idset;       /**< id_entry set, which maps from file ids to
@@ -43,6 +44,7 @@ typedef struct write_env_t {
 	FILE *file;
 	deq_t write_queue;
 	deq_t entity_queue;
+	struct binary_output_t *bin; /**< binary output, NULL for textual output */
 } write_env_t;
 
 void write_align(write_env_t *env, ir_align align);
@@ -98,6 +100,9 @@ ir_relation read_relation(read_env_t *env);
 ir_tarval *read_tarval_ref(read_env_t *env);
 ir_volatility read_volatility(read_env_t *env);
 
+/** Frees the node reader table and the symbol table. */
+void finish_irio(void);
+
 typedef ir_node* read_node_func(read_env_t *env);
 void register_node_reader(char const *const name, read_node_func *const func);
 
@@ -105,6 +110,18 @@ typedef void write_node_func(write_env_t *env, ir_node const *node);
 void register_node_writer(ir_op *op, write_node_func *func);
 
 void register_generated_node_writers(void);
+
+typedef void write_content_func(void *ctx, void const *data, size_t size);
+
+/**
+ * Writes the binary form of @p irg to @p func. Entities and types are written
+ * by their properties instead of their numbers, so equal graphs of different
+ * programs produce equal output.
+ *
+ * @returns false if the output does not describe the graph completely, for
+ *          example because it refers to labels
+ */
+bool ir_export_irg_content(ir_graph *irg, write_content_func *func, void *ctx);
 void register_generated_node_readers(void);
 
 #endif
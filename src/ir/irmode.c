@@ -32,6 +32,9 @@ static bool modes_are_equal(const ir_mode *m, const ir_mode *n)
 {
 	if (m->sort != n->sort)
 		return false;
+	if (m->vector_element != NULL || n->vector_element != NULL)
+		return m->vector_element == n->vector_element
+		    && m->vector_lanes   == n->vector_lanes;
 	if (m->sort == irms_auxiliary || m->sort == irms_data)
 		return streq(m->name, n->name);
 	return m->arithmetic        == n->arithmetic
@@ -206,6 +209,18 @@ ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size)
 	return register_mode(result);
 }
 
+ir_mode *new_vector_mode(const char *name, ir_mode *element_mode,
+                         unsigned n_lanes)
+{
+	assert(mode_is_int(element_mode) || mode_is_float(element_mode));
+	assert(n_lanes > 1);
+	unsigned const bit_size = get_mode_size_bits(element_mode) * n_lanes;
+	ir_mode *result = alloc_mode(name, irms_data, irma_none, bit_size, 0, 0);
+	result->vector_element = element_mode;
+	result->vector_lanes   = n_lanes;
+	return register_mode(result);
+}
+
 static ir_mode *new_non_data_mode(const char *name)
 {
 	ir_mode *result = alloc_mode(name, irms_auxiliary, irma_none, 0, 0, 0);
@@ -300,6 +315,23 @@ int (mode_is_reference)(const ir_mode *mode)
 	return mode_is_reference_(mode);
 }
 
+int (mode_is_vector)(const ir_mode *mode)
+{
+	return mode_is_vector_(mode);
+}
+
+ir_mode *get_mode_vector_element(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return mode->vector_element;
+}
+
+unsigned get_mode_vector_lanes(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return mode->vector_lanes;
+}
+
 int (mode_is_num)(const ir_mode *mode)
 {
 	return mode_is_num_(mode);
@@ -28,6 +28,7 @@
 #define mode_is_float(mode)            mode_is_float_(mode)
 #define mode_is_int(mode)              mode_is_int_(mode)
 #define mode_is_reference(mode)        mode_is_reference_(mode)
+#define mode_is_vector(mode)           mode_is_vector_(mode)
 #define mode_is_num(mode)              mode_is_num_(mode)
 #define mode_is_data(mode)             mode_is_data_(mode)
 #define get_type_for_mode(mode)        get_type_for_mode_(mode)
@@ -92,6 +93,9 @@ struct ir_mode {
 	/** For reference modes, a signed integer mode used to add/subtract
 	 * offsets. */
 	ir_mode            *offset_mode;
+	/** For vector modes, the mode of a single lane. */
+	ir_mode            *vector_element;
+	unsigned            vector_lanes; /**< number of lanes of a vector mode */
 };
 
 static inline ident *get_mode_ident_(const ir_mode *mode)
@@ -146,6 +150,11 @@ static inline int mode_is_reference_(const ir_mode *mode)
 	return get_mode_sort(mode) == irms_reference;
 }
 
+static inline int mode_is_vector_(const ir_mode *mode)
+{
+	return mode->vector_element != NULL;
+}
+
 static inline int mode_is_num_(const ir_mode *mode)
 {
 	return (get_mode_sort(mode) & irmsh_is_num) != 0;
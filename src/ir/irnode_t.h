@@ -98,6 +98,9 @@ typedef struct block_attr {
 	ir_entity  *entity;         /**< entity representing this block */
 	ir_node    *phis;           /**< The list of Phi nodes in this block. */
 	double      execfreq;       /**< block execution frequency */
+	double     *cfgpred_execfreqs;   /**< profiled frequencies of the incoming
+	                                      edges or NULL */
+	unsigned    n_cfgpred_execfreqs; /**< length of cfgpred_execfreqs */
 } block_attr;
 
 /** Attributes for Cond nodes. */
@@ -20,6 +20,7 @@
 #include "irverify_t.h"
 #include "panic.h"
 #include "reassoc_t.h"
+#include "util.h"
 #include "xmalloc.h"
 #include <string.h>
 
@@ -463,6 +464,14 @@ static void block_copy_attr(ir_graph *irg, const ir_node *old_node,
 	 */
 	new_node->attr.block.entity         = old_node->attr.block.entity;
 	new_node->attr.block.phis           = NULL;
+	/* the edge frequencies live on the obstack of the old graph */
+	double const *const freqs = old_node->attr.block.cfgpred_execfreqs;
+	if (freqs != NULL) {
+		unsigned const n    = old_node->attr.block.n_cfgpred_execfreqs;
+		double  *const copy = OALLOCN(get_irg_obstack(irg), double, n);
+		MEMCPY(copy, freqs, n);
+		new_node->attr.block.cfgpred_execfreqs = copy;
+	}
 }
 
 /**
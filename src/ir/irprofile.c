@@ -8,41 +8,97 @@
  * @brief       Code instrumentation and execution count profiling.
  * @author      Adam M. Szalkowski, Steven Schaefer
  * @date        06.04.2006, 11.11.2010
+ *
+ * The instrumented program counts how often control flow edges are taken.
+ * Only edges outside a maximum spanning tree of the control flow graph
+ * (weighted by estimated execution frequencies) get a counter; the counts of
+ * the tree edges follow from flow conservation (Knuth, Ball & Larus). A
+ * virtual node connected to the start block and to all blocks without
+ * successors closes the flow.
+ *
+ * Profile file format (all values little endian):
+ *   header:    char magic[8] = "FIRMPROF", u32 version, u32 n_functions,
+ *              u32 n_counters, u32 reserved
+ *   functions: n_functions records sorted by name hash:
+ *              u64 name_hash, u64 cfg_hash, u32 n_edges, u32 n_counters,
+ *              u32 first_counter, u32 reserved
+ *   edges:     u32 edge number for each counter, padded to 8 bytes
+ *   counters:  u64 count for each counter
+ * The file is mapped into memory and functions are looked up by binary
+ * search, so reading a profile does not depend on its size. Functions whose
+ * control flow graph hash does not match are considered stale and ignored.
  */
-#include "irprofile.h"
+#include "irprofile_t.h"
 
+#include "array.h"
 #include "debug.h"
 #include "execfreq_t.h"
-#include "hashptr.h"
 #include "ident_t.h"
 #include "ircons_t.h"
 #include "irdump_t.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
 #include "irprog_t.h"
+#include "irtools.h"
 #include "obst.h"
 #include "set.h"
 #include "typerep.h"
 #include "util.h"
 #include "xmalloc.h"
-
-/* Instrument blocks walker. */
-typedef struct block_id_walker_data_t {
-	unsigned int  id;       /**< current block id number */
-	ir_node      *counters; /**< the node representing the counter array */
-} block_id_walker_data_t;
-
-/* Associate counters with blocks. */
-typedef struct block_assoc_t {
-	unsigned int i;          /**< current block id number */
-	unsigned int *counters;  /**< block execution counts */
-} block_assoc_t;
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define PROFILE_MAGIC       "FIRMPROF"
+#define PROFILE_VERSION     2
+#define PROFILE_HEADER_SIZE 24
+#define PROFILE_RECORD_SIZE 32
 
 /* minimal execution frequency (an execfreq of 0 confuses algos) */
 #define MIN_EXECFREQ 0.00001
 
+/** A control flow edge of a function. */
+typedef struct profile_edge_t {
+	unsigned src; /**< source block number, n_blocks for the virtual node */
+	unsigned dst; /**< target block number, n_blocks for the virtual node */
+	int      pos; /**< predecessor number at dst, -1 for virtual edges */
+} profile_edge_t;
+
+/**
+ * The control flow graph as seen by the profiler. Blocks and edges are
+ * numbered in a deterministic order, so instrumentation and profile use
+ * agree on them.
+ */
+typedef struct profile_cfg_t {
+	ir_node        **blocks;  /**< blocks by number (ARR_F) */
+	profile_edge_t  *edges;   /**< all edges (ARR_F) */
+	unsigned        *n_succs; /**< number of successors per block */
+	uint64_t         hash;    /**< hash of the graph structure */
+} profile_cfg_t;
+
+/**
+ * Since the backend creates a new firm graph we cannot associate counts with
+ * blocks directly. Instead we associate them with the block ids, which are
+ * maintained.
+ */
+typedef struct execcount_t {
+	long      block;       /**< block id */
+	uint64_t  count;       /**< execution count */
+	uint64_t *pred_counts; /**< execution counts of the incoming edges */
+} execcount_t;
+
 /* keep the execcounts here because they are only read once per compiler run */
 static set *profile = NULL;
+static struct obstack profile_obst;
 
 /* Hook for vcg output. */
 static hook_entry_t *hook;
@@ -50,70 +106,326 @@ static hook_entry_t *hook;
 /* The debug module handle. */
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
+static uint64_t hash_bytes(uint64_t hash, void const *const data, size_t size)
+{
+	unsigned char const *const bytes = (unsigned char const*)data;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+static uint64_t hash_u32(uint64_t const hash, uint32_t const value)
+{
+	unsigned char const bytes[] = {
+		value, value >> 8, value >> 16, value >> 24
+	};
+	return hash_bytes(hash, bytes, sizeof(bytes));
+}
+
+#define HASH_INIT UINT64_C(14695981039346656037)
+
+static uint64_t get_irg_name_hash(ir_graph const *const irg)
+{
+	char const *const name = get_entity_ld_name(get_irg_entity(irg));
+	return hash_bytes(HASH_INIT, name, strlen(name));
+}
+
+static void number_block(ir_node *const block, void *const data)
+{
+	ir_node ***const blocks = (ir_node***)data;
+	set_irn_link(block, INT_TO_PTR(ARR_LEN(*blocks)));
+	ARR_APP1(ir_node*, *blocks, block);
+}
+
+static unsigned get_block_number(ir_node const *const block)
+{
+	return PTR_TO_INT(get_irn_link(block));
+}
+
 /**
- * Since the backend creates a new firm graph we cannot associate counts with
- * blocks directly. Instead we associate them with the block ids, which are
- * maintained.
+ * Enumerates the blocks and control flow edges of @p irg.
  */
-typedef struct execcount_t {
-	unsigned long block; /**< block id */
-	uint32_t      count; /**< execution count */
-} execcount_t;
+static void build_cfg(ir_graph *const irg, profile_cfg_t *const cfg)
+{
+	cfg->blocks = NEW_ARR_F(ir_node*, 0);
+	cfg->edges  = NEW_ARR_F(profile_edge_t, 0);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_block_walk_graph(irg, number_block, NULL, &cfg->blocks);
+
+	unsigned const n_blocks = ARR_LEN(cfg->blocks);
+	cfg->n_succs = XMALLOCNZ(unsigned, n_blocks);
+
+	unsigned const start = get_block_number(get_irg_start_block(irg));
+	profile_edge_t const entry = { .src = n_blocks, .dst = start, .pos = -1 };
+	ARR_APP1(profile_edge_t, cfg->edges, entry);
+	for (unsigned b = 0; b < n_blocks; ++b) {
+		ir_node *const block = cfg->blocks[b];
+		for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				continue;
+			unsigned       const src  = get_block_number(pred);
+			profile_edge_t const edge = { .src = src, .dst = b, .pos = i };
+			ARR_APP1(profile_edge_t, cfg->edges, edge);
+			++cfg->n_succs[src];
+		}
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	/* blocks without successors (the end block, noreturn calls) leave the
+	 * function */
+	for (unsigned b = 0; b < n_blocks; ++b) {
+		if (cfg->n_succs[b] != 0)
+			continue;
+		profile_edge_t const exit = { .src = b, .dst = n_blocks, .pos = -1 };
+		ARR_APP1(profile_edge_t, cfg->edges, exit);
+	}
+
+	uint64_t hash = hash_u32(HASH_INIT, n_blocks);
+	for (size_t e = 0, n = ARR_LEN(cfg->edges); e < n; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		hash = hash_u32(hash, edge->src);
+		hash = hash_u32(hash, edge->dst);
+	}
+	cfg->hash = hash;
+}
+
+static void free_cfg(profile_cfg_t *const cfg)
+{
+	DEL_ARR_F(cfg->blocks);
+	DEL_ARR_F(cfg->edges);
+	free(cfg->n_succs);
+}
 
 /**
- * Compare two execcount_t entries.
+ * Returns true if a counter for @p edge can be placed in its source block,
+ * its target block or a new block splitting it.
  */
-static int cmp_execcount(const void *a, const void *b, size_t size)
+static bool is_countable(profile_cfg_t const *const cfg,
+                         profile_edge_t const *const edge)
 {
-	const execcount_t *ea = (const execcount_t*)a;
-	const execcount_t *eb = (const execcount_t*)b;
-	(void)size;
-	return ea->block != eb->block;
+	if (edge->pos < 0)
+		return false;
+	if (cfg->n_succs[edge->src] == 1)
+		return true;
+	/* we cannot put code into the end block */
+	ir_node const *const dst = cfg->blocks[edge->dst];
+	return dst != get_irg_end_block(get_irn_irg(dst));
+}
+
+typedef struct weighted_edge_t {
+	unsigned edge;
+	bool     forced;
+	double   weight;
+} weighted_edge_t;
+
+static int cmp_weighted_edge(void const *const a, void const *const b)
+{
+	weighted_edge_t const *const ea = (weighted_edge_t const*)a;
+	weighted_edge_t const *const eb = (weighted_edge_t const*)b;
+	if (ea->forced != eb->forced)
+		return ea->forced ? -1 : 1;
+	if (ea->weight != eb->weight)
+		return ea->weight > eb->weight ? -1 : 1;
+	return ea->edge < eb->edge ? -1 : ea->edge > eb->edge;
 }
 
-uint32_t ir_profile_get_block_execcount(const ir_node *block)
+static int cmp_edge_number(void const *const a, void const *const b)
 {
-	execcount_t  const query = { .block = get_irn_node_nr(block), .count = 0 };
-	execcount_t *const ec    = set_find(execcount_t, profile, &query, sizeof(query), query.block);
+	unsigned const ea = *(unsigned const*)a;
+	unsigned const eb = *(unsigned const*)b;
+	return ea < eb ? -1 : ea > eb;
+}
 
-	if (ec != NULL) {
-		return ec->count;
-	} else {
-		DBG((dbg, LEVEL_3, "Warning: Profile contains no data for %+F\n", block));
-		return 0;
+static unsigned uf_find(unsigned *const parent, unsigned x)
+{
+	while (parent[x] != x) {
+		parent[x] = parent[parent[x]];
+		x         = parent[x];
 	}
+	return x;
 }
 
 /**
- * Block walker, count number of blocks.
+ * Chooses the edges to instrument: all edges not in a maximum spanning tree
+ * of the control flow graph. Uses the estimated execution frequencies of the
+ * blocks as weights.
+ *
+ * @return an ARR_F of edge numbers
  */
-static void block_counter(ir_node *bb, void *data)
+static unsigned *choose_counted_edges(profile_cfg_t const *const cfg)
 {
-	unsigned *const count = (unsigned*)data;
-	(void)bb;
-	++*count;
+	unsigned         const n_blocks = ARR_LEN(cfg->blocks);
+	size_t           const n_edges  = ARR_LEN(cfg->edges);
+	weighted_edge_t *const sorted   = XMALLOCN(weighted_edge_t, n_edges);
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		double weight = 0.0;
+		if (edge->pos >= 0) {
+			double const src_freq = get_block_execfreq(cfg->blocks[edge->src]);
+			double const dst_freq = get_block_execfreq(cfg->blocks[edge->dst]);
+			if (cfg->n_succs[edge->src] == 1)
+				weight = src_freq;
+			else if (get_Block_n_cfgpreds(cfg->blocks[edge->dst]) == 1)
+				weight = dst_freq;
+			else
+				weight = MIN(src_freq, dst_freq);
+		}
+		sorted[e] = (weighted_edge_t){
+			.edge   = e,
+			.forced = !is_countable(cfg, edge),
+			.weight = weight,
+		};
+	}
+	qsort(sorted, n_edges, sizeof(*sorted), cmp_weighted_edge);
+
+	unsigned *const parent = XMALLOCN(unsigned, n_blocks + 1);
+	for (unsigned i = 0; i <= n_blocks; ++i)
+		parent[i] = i;
+
+	unsigned *counted = NEW_ARR_F(unsigned, 0);
+	for (size_t i = 0; i < n_edges; ++i) {
+		weighted_edge_t const *const w    = &sorted[i];
+		profile_edge_t  const *const edge = &cfg->edges[w->edge];
+		unsigned const src = uf_find(parent, edge->src);
+		unsigned const dst = uf_find(parent, edge->dst);
+		if (src != dst) {
+			parent[src] = dst;
+		} else if (!w->forced) {
+			ARR_APP1(unsigned, counted, w->edge);
+		} else {
+			DBG((dbg, LEVEL_2, "cannot count edge %u\n", w->edge));
+		}
+	}
+	free(parent);
+	free(sorted);
+
+	/* counters are laid out by edge number */
+	QSORT_ARR(counted, cmp_edge_number);
+	return counted;
 }
 
 /**
- * Returns the number of blocks the given graph.
+ * Computes the counts of all edges from the counted ones using flow
+ * conservation. Edges which cannot be determined get a count of 0.
  */
-static unsigned int get_irg_n_blocks(ir_graph *irg)
+static void solve_edge_counts(profile_cfg_t const *const cfg,
+                              uint64_t *const counts, bool *const known)
 {
-	unsigned int count = 0;
-	irg_block_walk_graph(irg, block_counter, NULL, &count);
-	return count;
+	unsigned const n_nodes = ARR_LEN(cfg->blocks) + 1;
+	size_t   const n_edges = ARR_LEN(cfg->edges);
+
+	/* incidence lists */
+	unsigned *const begin = XMALLOCNZ(unsigned, n_nodes + 1);
+	for (size_t e = 0; e < n_edges; ++e) {
+		++begin[cfg->edges[e].src + 1];
+		++begin[cfg->edges[e].dst + 1];
+	}
+	for (unsigned v = 0; v < n_nodes; ++v)
+		begin[v + 1] += begin[v];
+	unsigned *const incident = XMALLOCN(unsigned, 2 * n_edges);
+	unsigned *const fill     = XMALLOCN(unsigned, n_nodes);
+	MEMCPY(fill, begin, n_nodes);
+	for (size_t e = 0; e < n_edges; ++e) {
+		incident[fill[cfg->edges[e].src]++] = e;
+		incident[fill[cfg->edges[e].dst]++] = e;
+	}
+
+	/* balance[v] is the known inflow minus the known outflow */
+	int64_t  *const balance   = XMALLOCNZ(int64_t, n_nodes);
+	unsigned *const n_unknown = fill;
+	memset(n_unknown, 0, n_nodes * sizeof(*n_unknown));
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		if (known[e]) {
+			balance[edge->dst] += counts[e];
+			balance[edge->src] -= counts[e];
+		} else {
+			++n_unknown[edge->src];
+			++n_unknown[edge->dst];
+		}
+	}
+
+	unsigned *worklist = NEW_ARR_F(unsigned, 0);
+	for (unsigned v = 0; v < n_nodes; ++v) {
+		if (n_unknown[v] == 1)
+			ARR_APP1(unsigned, worklist, v);
+	}
+	while (ARR_LEN(worklist) > 0) {
+		unsigned const v = worklist[ARR_LEN(worklist) - 1];
+		ARR_SHRINKLEN(worklist, ARR_LEN(worklist) - 1);
+		if (n_unknown[v] != 1)
+			continue;
+
+		unsigned e = 0;
+		for (unsigned i = begin[v]; i < begin[v + 1]; ++i) {
+			e = incident[i];
+			if (!known[e])
+				break;
+		}
+		profile_edge_t const *const edge = &cfg->edges[e];
+		/* self loops are never part of the spanning tree */
+		assert(edge->src != edge->dst);
+		int64_t value = edge->dst == v ? -balance[v] : balance[v];
+		/* inconsistent counts, e.g. from exit() or longjmp() */
+		if (value < 0)
+			value = 0;
+		counts[e] = value;
+		known[e]  = true;
+		balance[edge->dst] += value;
+		balance[edge->src] -= value;
+
+		unsigned const other = edge->dst == v ? edge->src : edge->dst;
+		--n_unknown[v];
+		if (--n_unknown[other] == 1)
+			ARR_APP1(unsigned, worklist, other);
+	}
+	DEL_ARR_F(worklist);
+
+	for (size_t e = 0; e < n_edges; ++e) {
+		if (!known[e])
+			counts[e] = 0;
+	}
+
+	free(balance);
+	free(fill);
+	free(incident);
+	free(begin);
 }
 
-/**
- * Returns the number of basic blocks in the current ir program.
- */
-static unsigned int get_irp_n_blocks(void)
+static int cmp_execcount(const void *a, const void *b, size_t size)
 {
-	unsigned int count = 0;
-	foreach_irp_irg(i, irg) {
-		count += get_irg_n_blocks(irg);
+	const execcount_t *ea = (const execcount_t*)a;
+	const execcount_t *eb = (const execcount_t*)b;
+	(void)size;
+	return ea->block != eb->block;
+}
+
+static execcount_t *find_execcount(const ir_node *block)
+{
+	if (profile == NULL)
+		return NULL;
+	execcount_t const query = { .block = get_irn_node_nr(block) };
+	return set_find(execcount_t, profile, &query, sizeof(query), query.block);
+}
+
+bool ir_profile_has_block_execcount(const ir_node *block)
+{
+	return find_execcount(block) != NULL;
+}
+
+uint64_t ir_profile_get_block_execcount(const ir_node *block)
+{
+	execcount_t const *const ec = find_execcount(block);
+	if (ec != NULL) {
+		return ec->count;
+	} else {
+		DBG((dbg, LEVEL_3, "Warning: Profile contains no data for %+F\n", block));
+		return 0;
 	}
-	return count;
 }
 
 /* vcg helper */
@@ -121,8 +433,8 @@ static void dump_profile_node_info(void *ctx, FILE *f, const ir_node *irn)
 {
 	(void)ctx;
 	if (is_Block(irn)) {
-		unsigned int execcount = ir_profile_get_block_execcount(irn);
-		fprintf(f, "profiled execution count: %u\n", execcount);
+		uint64_t const execcount = ir_profile_get_block_execcount(irn);
+		fprintf(f, "profiled execution count: %" PRIu64 "\n", execcount);
 	}
 }
 
@@ -145,51 +457,64 @@ static void add_constructor(ir_entity *method)
 }
 
 /**
- * Returns an entity representing the __init_firmprof function from libfirmprof
- * This is the equivalent of:
- * extern void __init_firmprof(char *filename, uint *counters, uint size)
+ * Returns an entity representing the __firmprof_register function from
+ * libfirmprof. This is the equivalent of:
+ * extern void __firmprof_register(char const *filename,
+ *     unsigned char const *data, unsigned data_size, void *counters,
+ *     unsigned n_counters, unsigned counter_size)
  */
-static ir_entity *get_init_firmprof_ref(void)
+static ir_entity *get_firmprof_register_ref(void)
 {
-	ident   *const init_name = new_id_from_str("__init_firmprof");
-	ir_type *const init_type = new_type_method(3, 0, false, cc_cdecl_set, mtp_no_property);
-	ir_type *const uint      = get_type_for_mode(mode_Iu);
-	ir_type *const uintptr   = new_type_pointer(uint);
-	ir_type *const string    = new_type_pointer(get_type_for_mode(mode_Bs));
-
-	set_method_param_type(init_type, 0, string);
-	set_method_param_type(init_type, 1, uintptr);
-	set_method_param_type(init_type, 2, uint);
-
-	return new_entity(get_glob_type(), init_name, init_type);
+	ident   *const name    = new_id_from_str("__firmprof_register");
+	ir_type *const type    = new_type_method(6, 0, false, cc_cdecl_set, mtp_no_property);
+	ir_type *const uint    = get_type_for_mode(mode_Iu);
+	ir_type *const bytes   = new_type_pointer(get_type_for_mode(mode_Bu));
+	ir_type *const string  = new_type_pointer(get_type_for_mode(mode_Bs));
+
+	set_method_param_type(type, 0, string);
+	set_method_param_type(type, 1, bytes);
+	set_method_param_type(type, 2, uint);
+	set_method_param_type(type, 3, bytes);
+	set_method_param_type(type, 4, uint);
+	set_method_param_type(type, 5, uint);
+
+	return new_entity(get_glob_type(), name, type);
 }
 
 /**
- * Generates a new irg which calls the initializer
+ * Generates a new irg which registers the counters
  *
  * Pseudocode:
  *    static void __firmprof_initializer(void) __attribute__ ((constructor))
  *    {
- *        __init_firmprof(ent_filename, bblock_counts, n_blocks);
+ *        __firmprof_register(ent_filename, data, data_size, counters,
+ *                            n_counters, sizeof(counters[0]));
  *    }
  */
-static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_counts, int n_blocks)
+static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *data,
+                                     unsigned data_size, ir_entity *counters,
+                                     unsigned n_counters)
 {
 	ident     *const name  = new_id_from_str("__firmprof_initializer");
 	ir_type   *const owner = get_glob_type();
 	ir_type   *const type  = new_type_method(0, 0, false, cc_cdecl_set, mtp_no_property);
 	ir_entity *const ent   = new_global_entity(owner, name, type, ir_visibility_local, IR_LINKAGE_DEFAULT);
 
+	ir_type   *const ctr_type  = get_array_element_type(get_entity_type(counters));
 	ir_graph  *const irg       = new_ir_graph(ent, 0);
 	ir_node   *const bb        = get_r_cur_block(irg);
 	ir_node   *const init_mem  = get_irg_initial_mem(irg);
-	ir_entity *const init_ent  = get_init_firmprof_ref();
-	ir_node   *const callee    = new_r_Address(irg, init_ent);
-	ir_node   *const filename  = new_r_Address(irg, ent_filename);
-	ir_node   *const counters  = new_r_Address(irg, bblock_counts);
-	ir_node   *const size      = new_r_Const_long(irg, mode_Iu, n_blocks);
-	ir_node   *const ins[]     = { filename, counters, size };
-	ir_type   *const call_type = get_entity_type(init_ent);
+	ir_entity *const reg_ent   = get_firmprof_register_ref();
+	ir_node   *const callee    = new_r_Address(irg, reg_ent);
+	ir_node   *const ins[]     = {
+		new_r_Address(irg, ent_filename),
+		new_r_Address(irg, data),
+		new_r_Const_long(irg, mode_Iu, data_size),
+		new_r_Address(irg, counters),
+		new_r_Const_long(irg, mode_Iu, n_counters),
+		new_r_Const_long(irg, mode_Iu, get_type_size(ctr_type)),
+	};
+	ir_type   *const call_type = get_entity_type(reg_ent);
 	ir_node   *const call      = new_r_Call(bb, init_mem, callee, ARRAY_SIZE(ins), ins, call_type);
 	ir_node   *const call_mem  = new_r_Proj(call, mode_M, pn_Call_M);
 	ir_node   *const ret       = new_r_Return(bb, call_mem, 0, NULL);
@@ -201,87 +526,139 @@ static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_
 	return irg;
 }
 
+/** Instrumentation code of a block. */
+typedef struct block_instr_t {
+	ir_node *first_load; /**< the first counter Load, NULL if none */
+	ir_node *last_mem;   /**< memory after the last counter Store */
+	ir_node *in_mem;     /**< incoming instrumentation memory */
+} block_instr_t;
+
+static block_instr_t *get_block_instr(struct obstack *const obst,
+                                      ir_node *const bb)
+{
+	block_instr_t *info = (block_instr_t*)get_irn_link(bb);
+	if (info == NULL) {
+		info = OALLOCZ(obst, block_instr_t);
+		set_irn_link(bb, info);
+	}
+	return info;
+}
+
 /**
- * Instrument a block with code needed for profiling.
- * This just inserts the instruction nodes, it doesn't connect the memory
- * nodes in a meaningful way.
+ * Instrument a block with code incrementing counter @p id.
+ * This just inserts the instruction nodes, the memory of the first counter
+ * is connected by fix_ssa().
  */
-static void instrument_block(ir_node *const bb, ir_node *const address, unsigned int const id)
+static void instrument_block(struct obstack *const obst, ir_node *const bb,
+                             ir_node *const address, unsigned const id)
 {
-	ir_graph *const irg = get_irn_irg(bb);
+	ir_graph      *const irg      = get_irn_irg(bb);
+	block_instr_t *const info     = get_block_instr(obst, bb);
+	ir_type       *const type_arr = get_entity_type(get_irn_entity_attr(address));
+	ir_type       *const type_ctr = get_array_element_type(type_arr);
+	ir_mode       *const mode_ctr = get_type_mode(type_ctr);
+	ir_node       *const mem      = info->last_mem != NULL ? info->last_mem : new_r_Unknown(irg, mode_M);
+	ir_mode       *const mode_off = get_reference_offset_mode(get_irn_mode(address));
+	ir_node       *const cnst     = new_r_Const_long(irg, mode_off, get_mode_size_bytes(mode_ctr) * id);
+	ir_node       *const offset   = new_r_Add(bb, address, cnst);
+	ir_node       *const load     = new_r_Load(bb, mem, offset, mode_ctr, type_arr, cons_none);
+	ir_node       *const lmem     = new_r_Proj(load, mode_M, pn_Load_M);
+	ir_node       *const proji    = new_r_Proj(load, mode_ctr, pn_Load_res);
+	ir_node       *const one      = new_r_Const_one(irg, mode_ctr);
+	ir_node       *const add      = new_r_Add(bb, proji, one);
+	ir_node       *const store    = new_r_Store(bb, lmem, offset, add, type_arr, cons_none);
+
+	if (info->first_load == NULL)
+		info->first_load = load;
+	info->last_mem = new_r_Proj(store, mode_M, pn_Store_M);
+}
 
-	/* We can't instrument the end block */
-	if (bb == get_irg_end_block(irg))
-		return;
+/**
+ * Splits the control flow edge entering @p block at predecessor @p pos and
+ * returns the new block.
+ */
+static ir_node *split_edge(ir_node *const block, int const pos)
+{
+	ir_graph *const irg       = get_irn_irg(block);
+	ir_node  *const pred      = get_Block_cfgpred(block, pos);
+	ir_node  *const new_block = new_r_Block(irg, 1, &pred);
+	ir_node  *const jmp       = new_r_Jmp(new_block);
+	set_Block_cfgpred(block, pos, jmp);
+	return new_block;
+}
+
+static ir_node *get_out_mem(ir_node *bb);
 
-	ir_type *const type_arr = get_entity_type(get_irn_entity_attr(address));
-	ir_type *const type_ctr = get_array_element_type(type_arr);
-	ir_mode *const mode_ctr = get_type_mode(type_ctr);
-	ir_node *const unknown  = new_r_Unknown(irg, mode_M);
-	ir_mode *const mode_off = get_reference_offset_mode(get_irn_mode(address));
-	ir_node *const cnst     = new_r_Const_long(irg, mode_off, get_mode_size_bytes(mode_ctr) * id);
-	ir_node *const offset   = new_r_Add(bb, address, cnst);
-	ir_node *const load     = new_r_Load(bb, unknown, offset, mode_ctr, type_arr, cons_none);
-	ir_node *const lmem     = new_r_Proj(load, mode_M, pn_Load_M);
-	ir_node *const proji    = new_r_Proj(load, mode_ctr, pn_Load_res);
-	ir_node *const one      = new_r_Const_one(irg, mode_ctr);
-	ir_node *const add      = new_r_Add(bb, proji, one);
-	ir_node *const store    = new_r_Store(bb, lmem, offset, add, type_arr, cons_none);
-	ir_node *const smem     = new_r_Proj(store, mode_M, pn_Store_M);
-
-	set_irn_link(bb, smem);
-	set_irn_link(smem, load);
+static ir_node *get_in_mem(ir_node *const bb)
+{
+	block_instr_t *const info = (block_instr_t*)get_irn_link(bb);
+	if (info->in_mem != NULL)
+		return info->in_mem;
+	/* blocks with a single predecessor inherit its memory */
+	assert(get_Block_n_cfgpreds(bb) == 1);
+	ir_node *const pred = get_Block_cfgpred_block(bb, 0);
+	return pred != NULL ? get_out_mem(pred) : new_r_NoMem(get_irn_irg(bb));
+}
+
+static ir_node *get_out_mem(ir_node *const bb)
+{
+	block_instr_t const *const info = (block_instr_t const*)get_irn_link(bb);
+	return info->last_mem != NULL ? info->last_mem : get_in_mem(bb);
 }
 
 /**
- * SSA Construction for instrumentation code memory.
- *
- * This introduces a new memory node and connects it to the instrumentation
- * codes, inserting phiM nodes as necessary. Note that afterwards, the new
- * memory is not connected to any return nodes and thus still dead.
+ * SSA Construction for instrumentation code memory, part 1: Creates the
+ * memory Phis of all blocks with multiple predecessors.
  */
-static void fix_ssa(ir_node *const bb, void *const data)
+static void create_mem_phis(ir_node *const bb, void *const data)
 {
-	(void)data;
+	struct obstack *const obst = (struct obstack*)data;
+	ir_graph       *const irg  = get_irn_irg(bb);
+	block_instr_t  *const info = get_block_instr(obst, bb);
 
-	ir_graph *const irg = get_irn_irg(bb);
-
-	/* end blocks are not instrumented, skip! */
+	/* the end block contains no code */
 	if (bb == get_irg_end_block(irg))
 		return;
 
-	ir_node  *mem;
 	int const arity = get_Block_n_cfgpreds(bb);
 	if (bb == get_irg_start_block(irg)) {
-		mem = get_irg_initial_mem(irg);
-	} else if (arity == 1) {
-		ir_node *const pred = get_Block_cfgpred_block(bb, 0);
-		mem = pred ? (ir_node*)get_irn_link(pred) : new_r_NoMem(irg);
-	} else {
+		info->in_mem = get_irg_initial_mem(irg);
+	} else if (arity == 0) {
+		info->in_mem = new_r_NoMem(irg);
+	} else if (arity > 1) {
+		/* use distinct placeholders, so the Phi is not optimized away */
 		ir_node **ins = ALLOCAN(ir_node*, arity);
-		for (int n = arity; n-- != 0;) {
-			ir_node *const pred = get_Block_cfgpred_block(bb, n);
-			ins[n] = pred ? (ir_node*)get_irn_link(pred) : new_r_NoMem(irg);
-		}
-		mem = new_r_Phi(bb, arity, ins, mode_M);
+		for (int n = arity; n-- != 0;)
+			ins[n] = new_r_Dummy(irg, mode_M);
+		info->in_mem = new_r_Phi(bb, arity, ins, mode_M);
 	}
-
-	/* The block link fields point to the projm from the instrumentation code,
-	 * the projm in turn links to the initial load which lacks a memory
-	 * argument at this point. */
-	ir_node *const proj = (ir_node*)get_irn_link(bb);
-	ir_node *const load = (ir_node*)get_irn_link(proj);
-	set_Load_mem(load, mem);
 }
 
 /**
- * Instrument a single block.
+ * SSA Construction for instrumentation code memory, part 2: Connects the
+ * Phis and the counters.
+ *
+ * This introduces a new memory node and connects it to the instrumentation
+ * codes. Note that afterwards, the new memory is not connected to any
+ * return nodes and thus still dead.
  */
-static void block_instrument_walker(ir_node *bb, void *data)
+static void fix_ssa(ir_node *const bb, void *const data)
 {
-	block_id_walker_data_t *wd = (block_id_walker_data_t*)data;
-	instrument_block(bb, wd->counters, wd->id);
-	++wd->id;
+	(void)data;
+	block_instr_t const *const info = (block_instr_t const*)get_irn_link(bb);
+	if (info == NULL)
+		return;
+	if (info->first_load != NULL)
+		set_Load_mem(info->first_load, get_in_mem(bb));
+
+	ir_node *const phi = info->in_mem;
+	if (phi != NULL && is_Phi(phi) && get_nodes_block(phi) == bb) {
+		for (int n = get_Block_n_cfgpreds(bb); n-- != 0;) {
+			ir_node *const pred = get_Block_cfgpred_block(bb, n);
+			ir_node *const mem  = pred != NULL ? get_out_mem(pred) : new_r_NoMem(get_irn_irg(bb));
+			set_Phi_pred(phi, n, mem);
+		}
+	}
 }
 
 /**
@@ -290,23 +667,43 @@ static void block_instrument_walker(ir_node *bb, void *data)
  */
 static ir_node *sync_mem(ir_node *bb, ir_node *mem)
 {
-	ir_node *const ins[] = { (ir_node*)get_irn_link(bb), mem };
+	ir_node *const ins[] = { get_out_mem(bb), mem };
 	return new_r_Sync(bb, ARRAY_SIZE(ins), ins);
 }
 
 /**
- * Instrument a single ir_graph, counters should point to the bblock
- * counters array.
+ * Instrument a single ir_graph: Places a counter for each edge in
+ * @p counted, using the counters starting at @p first_counter.
  */
-static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_data_t *wd)
+static void instrument_irg(ir_graph *irg, ir_entity *counters,
+                           profile_cfg_t const *cfg, unsigned const *counted,
+                           unsigned first_counter)
 {
+	struct obstack obst;
+	obstack_init(&obst);
+
 	/* generate a node pointing to the count array */
-	wd->counters = new_r_Address(irg, counters);
+	ir_node *const address = new_r_Address(irg, counters);
 
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_block_walk_graph(irg, firm_clear_link, NULL, NULL);
+
+	for (size_t i = 0, n = ARR_LEN(counted); i < n; ++i) {
+		profile_edge_t const *const edge = &cfg->edges[counted[i]];
+		ir_node              *const dst  = cfg->blocks[edge->dst];
+		ir_node                    *bb;
+		if (cfg->n_succs[edge->src] == 1) {
+			bb = cfg->blocks[edge->src];
+		} else if (get_Block_n_cfgpreds(dst) == 1) {
+			bb = dst;
+		} else {
+			bb = split_edge(dst, edge->pos);
+			set_irn_link(bb, NULL);
+		}
+		instrument_block(&obst, bb, address, first_counter + i);
+	}
 
-	/* instrument each block in the current irg */
-	irg_block_walk_graph(irg, block_instrument_walker, NULL, wd);
+	irg_block_walk_graph(irg, create_mem_phis, NULL, &obst);
 	irg_block_walk_graph(irg, fix_ssa, NULL, NULL);
 
 	/* connect the new memory nodes to the return nodes */
@@ -348,6 +745,11 @@ static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_d
 	}
 
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	obstack_free(&obst, NULL);
+
+	/* new blocks were created and the memory placeholders are dead, which
+	 * matters if the graph is optimized further */
+	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
 }
 
 /**
@@ -365,20 +767,17 @@ static ir_entity *new_array_entity(ident *const name, ir_mode *const element_mod
 
 /**
  * Creates a new entity representing the equivalent of
- * static const char name[strlen(string)+1] = string
+ * static const <mode> name[length] = { data... }
  */
-static ir_entity *new_static_string_entity(char const *const name, char const *const string)
+static ir_entity *new_static_bytes_entity(char const *const name, ir_mode *const mode, unsigned char const *const data, size_t const length)
 {
-	/* Create the type for a fixed-length string */
-	ir_mode   *const mode   = mode_Bs;
-	size_t     const length = strlen(string) + 1;
 	ir_entity *const result = new_array_entity(name, mode, length, IR_LINKAGE_CONSTANT);
 
 	/* There seems to be no simpler way to do this. Or at least, cparser
 	 * does exactly the same thing... */
 	ir_initializer_t *const contents = create_initializer_compound(length);
 	for (size_t i = 0; i < length; i++) {
-		ir_tarval        *const c    = new_tarval_from_long(string[i], mode);
+		ir_tarval        *const c    = new_tarval_from_long(data[i], mode);
 		ir_initializer_t *const init = create_initializer_tarval(c);
 		set_initializer_compound_value(contents, i, init);
 	}
@@ -387,95 +786,295 @@ static ir_entity *new_static_string_entity(char const *const name, char const *c
 	return result;
 }
 
-ir_graph *ir_profile_instrument(const char *filename)
+static void append_u32(unsigned char **const blob, uint32_t const value)
 {
-	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
+	for (unsigned i = 0; i < 4; ++i)
+		ARR_APP1(unsigned char, *blob, value >> (i * 8));
+}
+
+static void append_u64(unsigned char **const blob, uint64_t const value)
+{
+	append_u32(blob, value);
+	append_u32(blob, value >> 32);
+}
+
+static uint32_t read_u32(unsigned char const *const p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16
+	     | (uint32_t)p[3] << 24;
+}
+
+static uint64_t read_u64(unsigned char const *const p)
+{
+	return read_u32(p) | (uint64_t)read_u32(p + 4) << 32;
+}
 
+/** Instrumentation plan of a function. */
+typedef struct profile_function_t {
+	ir_graph      *irg;
+	profile_cfg_t  cfg;
+	unsigned      *counted;       /**< numbers of the counted edges */
+	unsigned       first_counter;
+	uint64_t       name_hash;
+} profile_function_t;
+
+static int cmp_function_hash(void const *const a, void const *const b)
+{
+	profile_function_t const *const fa = *(profile_function_t const**)a;
+	profile_function_t const *const fb = *(profile_function_t const**)b;
+	return fa->name_hash < fb->name_hash ? -1 : fa->name_hash > fb->name_hash;
+}
+
+ir_graph *ir_profile_instrument(const char *filename)
+{
 	/* Don't do anything for modules without code. Else the linker will
 	 * complain. */
-	if (get_irp_n_irgs() == 0)
+	size_t const n_irgs = get_irp_n_irgs();
+	if (n_irgs == 0)
 		return NULL;
 
-	/* count the number of block first */
-	unsigned const n_blocks = get_irp_n_blocks();
+	/* plan the instrumentation of all functions */
+	profile_function_t  *const functions = XMALLOCNZ(profile_function_t, n_irgs);
+	profile_function_t **const sorted    = XMALLOCN(profile_function_t*, n_irgs);
+	unsigned                   n_counters = 0;
+	foreach_irp_irg(i, irg) {
+		profile_function_t *const function = &functions[i];
+		ir_estimate_execfreq(irg);
+		function->irg           = irg;
+		function->name_hash     = get_irg_name_hash(irg);
+		function->first_counter = n_counters;
+		build_cfg(irg, &function->cfg);
+		function->counted = choose_counted_edges(&function->cfg);
+		n_counters += ARR_LEN(function->counted);
+		sorted[i] = function;
+		DB((dbg, LEVEL_1, "%+F: %zu of %zu edges counted\n", irg,
+		    ARR_LEN(function->counted), ARR_LEN(function->cfg.edges)));
+	}
+	qsort(sorted, n_irgs, sizeof(*sorted), cmp_function_hash);
+
+	/* the constant part of the profile file */
+	unsigned char *blob = NEW_ARR_F(unsigned char, 0);
+	for (size_t i = 0; i < sizeof(PROFILE_MAGIC) - 1; ++i)
+		ARR_APP1(unsigned char, blob, PROFILE_MAGIC[i]);
+	append_u32(&blob, PROFILE_VERSION);
+	append_u32(&blob, n_irgs);
+	append_u32(&blob, n_counters);
+	append_u32(&blob, 0);
+	for (size_t i = 0; i < n_irgs; ++i) {
+		profile_function_t const *const function = sorted[i];
+		append_u64(&blob, function->name_hash);
+		append_u64(&blob, function->cfg.hash);
+		append_u32(&blob, ARR_LEN(function->cfg.edges));
+		append_u32(&blob, ARR_LEN(function->counted));
+		append_u32(&blob, function->first_counter);
+		append_u32(&blob, 0);
+	}
+	for (size_t i = 0; i < n_irgs; ++i) {
+		profile_function_t const *const function = &functions[i];
+		for (size_t c = 0, n = ARR_LEN(function->counted); c < n; ++c)
+			append_u32(&blob, function->counted[c]);
+	}
+	if (n_counters % 2 != 0)
+		append_u32(&blob, 0);
 
 	/* create all the necessary types and entities. Note that the
 	 * types must have a fixed layout, because we are already running in the
 	 * backend */
-	ir_entity *const bblock_counts = new_array_entity("__FIRMPROF__BLOCK_COUNTS", mode_Iu, n_blocks, IR_LINKAGE_DEFAULT);
-
-	ir_entity *const ent_filename = new_static_string_entity("__FIRMPROF__FILE_NAME", filename);
-
-	/* initialize block id array and instrument blocks */
-	block_id_walker_data_t wd = { .id = 0 };
-	foreach_irp_irg_r(i, irg) {
-		instrument_irg(irg, bblock_counts, &wd);
+	ir_mode   *const mode_ctr     = find_unsigned_mode(get_reference_offset_mode(mode_P));
+	ir_entity *const counters     = new_array_entity("__FIRMPROF__EDGE_COUNTS", mode_ctr, MAX(n_counters, 1), IR_LINKAGE_DEFAULT);
+	set_entity_initializer(counters, get_initializer_null());
+	ir_entity *const ent_data     = new_static_bytes_entity("__FIRMPROF__DATA", mode_Bu, blob, ARR_LEN(blob));
+	ir_entity *const ent_filename = new_static_bytes_entity("__FIRMPROF__FILE_NAME", mode_Bs, (unsigned char const*)filename, strlen(filename) + 1);
+
+	/* The backend already attached its information to the reachable nodes,
+	 * the new nodes must not be merged with dead ones lacking it. */
+	int const saved_cse = get_opt_cse();
+	set_opt_cse(0);
+	for (size_t i = 0; i < n_irgs; ++i) {
+		profile_function_t *const function = &functions[i];
+		instrument_irg(function->irg, counters, &function->cfg,
+		               function->counted, function->first_counter);
+		free_cfg(&function->cfg);
+		DEL_ARR_F(function->counted);
 	}
+	set_opt_cse(saved_cse);
 
-	return gen_initializer_irg(ent_filename, bblock_counts, n_blocks);
+	ir_graph *const res = gen_initializer_irg(ent_filename, ent_data, ARR_LEN(blob), counters, n_counters);
+	DEL_ARR_F(blob);
+	free(sorted);
+	free(functions);
+	return res;
 }
 
-static unsigned int *parse_profile(const char *filename, unsigned int num_blocks)
+/** A profile file mapped into memory. */
+typedef struct profile_file_t {
+	unsigned char const *data;
+	size_t               size;
+	unsigned             n_functions;
+	unsigned             n_counters;
+} profile_file_t;
+
+static bool map_profile(const char *filename, profile_file_t *const file)
 {
+#ifdef _WIN32
 	FILE *const f = fopen(filename, "rb");
-	if (!f) {
-		DBG((dbg, LEVEL_2, "Failed to open profile file (%s)\n", filename));
-		return NULL;
+	if (f == NULL)
+		return false;
+	fseek(f, 0, SEEK_END);
+	long const size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (size <= 0) {
+		fclose(f);
+		return false;
 	}
-
-	/* check header */
-	uint32_t *result = NULL;
-	char      buf[8];
-	size_t    ret = fread(buf, 8, 1, f);
-	if (ret == 0 || strncmp(buf, "firmprof", 8) != 0) {
-		DBG((dbg, LEVEL_2, "Broken fileheader in profile\n"));
-		goto end;
+	unsigned char *const data = XMALLOCN(unsigned char, size);
+	bool const ok = fread(data, 1, size, f) == (size_t)size;
+	fclose(f);
+	if (!ok) {
+		free(data);
+		return false;
 	}
+#else
+	int const fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+	off_t const size = st.st_size;
+	void *const data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+#endif
+	file->data = (unsigned char const*)data;
+	file->size = size;
+	return true;
+}
 
-	result = XMALLOCN(unsigned int, num_blocks);
-
-	/* The profiling output format is defined to be a sequence of integer
-	 * values stored little endian format. */
-	for (unsigned i = 0; i < num_blocks; ++i) {
-		unsigned char bytes[4];
-		if ((ret = fread(bytes, 1, 4, f)) < 1)
-			break;
+static void unmap_profile(profile_file_t *const file)
+{
+#ifdef _WIN32
+	free((void*)file->data);
+#else
+	munmap((void*)file->data, file->size);
+#endif
+	file->data = NULL;
+}
 
-		result[i] = (bytes[0] <<  0) | (bytes[1] <<  8)
-		          | (bytes[2] << 16) | (bytes[3] << 24);
+/**
+ * Checks the header of a profile file and that its size fits the header.
+ */
+static bool check_profile(profile_file_t *const file)
+{
+	unsigned char const *const data = file->data;
+	if (file->size < PROFILE_HEADER_SIZE
+	 || memcmp(data, PROFILE_MAGIC, sizeof(PROFILE_MAGIC) - 1) != 0) {
+		DBG((dbg, LEVEL_2, "Broken fileheader in profile\n"));
+		return false;
 	}
-
-	if (ret < 1) {
-		DBG((dbg, LEVEL_4, "Failed to read counters... (size: %u)\n",
-			sizeof(unsigned int) * num_blocks));
-		free(result);
-		result = NULL;
+	if (read_u32(data + 8) != PROFILE_VERSION) {
+		DBG((dbg, LEVEL_2, "Unsupported profile version %u\n", read_u32(data + 8)));
+		return false;
 	}
+	file->n_functions = read_u32(data + 12);
+	file->n_counters  = read_u32(data + 16);
+	uint64_t const size = PROFILE_HEADER_SIZE
+		+ (uint64_t)file->n_functions * PROFILE_RECORD_SIZE
+		+ (uint64_t)(file->n_counters + file->n_counters % 2) * 4
+		+ (uint64_t)file->n_counters * 8;
+	if (size != file->size) {
+		DBG((dbg, LEVEL_2, "Profile size does not match its header\n"));
+		return false;
+	}
+	return true;
+}
 
-end:
-	fclose(f);
-	return result;
+static unsigned char const *find_record(profile_file_t const *const file,
+                                        uint64_t const name_hash)
+{
+	unsigned char const *const records = file->data + PROFILE_HEADER_SIZE;
+	unsigned lo = 0;
+	unsigned hi = file->n_functions;
+	while (lo < hi) {
+		unsigned             const mid    = lo + (hi - lo) / 2;
+		unsigned char const *const record = records + mid * PROFILE_RECORD_SIZE;
+		uint64_t             const hash   = read_u64(record);
+		if (hash == name_hash)
+			return record;
+		if (hash < name_hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
 }
 
 /**
- * Reads the corresponding profile info file if it exists.
+ * Computes the block and edge counts of @p irg from the profile and
+ * associates them with the blocks.
  */
-static void block_associate_walker(ir_node *bb, void *env)
+static void associate_irg(profile_file_t const *const file, ir_graph *const irg)
 {
-	block_assoc_t *b = (block_assoc_t*)env;
-	execcount_t query;
+	unsigned char const *const record = find_record(file, get_irg_name_hash(irg));
+	if (record == NULL) {
+		DBG((dbg, LEVEL_2, "No profile data for %+F\n", irg));
+		return;
+	}
 
-	query.block = get_irn_node_nr(bb);
-	query.count = b->counters[b->i++];
-	DBG((dbg, LEVEL_4, "execcount(%+F, %u): %u\n", bb, query.block, query.count));
-	(void)set_insert(execcount_t, profile, &query, sizeof(query), query.block);
-}
+	profile_cfg_t cfg;
+	build_cfg(irg, &cfg);
+	size_t   const n_edges       = ARR_LEN(cfg.edges);
+	unsigned const n_counters    = read_u32(record + 20);
+	unsigned const first_counter = read_u32(record + 24);
+	if (read_u64(record + 8) != cfg.hash || read_u32(record + 16) != n_edges
+	 || first_counter > file->n_counters
+	 || n_counters > file->n_counters - first_counter) {
+		DBG((dbg, LEVEL_1, "Profile data for %+F is stale\n", irg));
+		free_cfg(&cfg);
+		return;
+	}
 
-static void irp_associate_blocks(block_assoc_t *env)
-{
-	foreach_irp_irg_r(i, irg) {
-		irg_block_walk_graph(irg, block_associate_walker, NULL, env);
+	unsigned char const *const edge_nums = file->data + PROFILE_HEADER_SIZE
+		+ file->n_functions * PROFILE_RECORD_SIZE;
+	unsigned char const *const values = edge_nums
+		+ (file->n_counters + file->n_counters % 2) * 4;
+	uint64_t *const counts = XMALLOCNZ(uint64_t, n_edges);
+	bool     *const known  = XMALLOCNZ(bool, n_edges);
+	for (unsigned c = first_counter; c < first_counter + n_counters; ++c) {
+		uint32_t const e = read_u32(edge_nums + c * 4);
+		if (e >= n_edges)
+			goto end;
+		counts[e] = read_u64(values + c * 8);
+		known[e]  = true;
 	}
+	solve_edge_counts(&cfg, counts, known);
+
+	unsigned const n_blocks = ARR_LEN(cfg.blocks);
+	for (unsigned b = 0; b < n_blocks; ++b) {
+		ir_node     *const block = cfg.blocks[b];
+		execcount_t        ec    = {
+			.block       = get_irn_node_nr(block),
+			.pred_counts = OALLOCNZ(&profile_obst, uint64_t, get_Block_n_cfgpreds(block)),
+		};
+		set_insert(execcount_t, profile, &ec, sizeof(ec), ec.block);
+	}
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t const *const edge = &cfg.edges[e];
+		if (edge->dst == n_blocks)
+			continue;
+		execcount_t *const ec = find_execcount(cfg.blocks[edge->dst]);
+		ec->count += counts[e];
+		if (edge->pos >= 0)
+			ec->pred_counts[edge->pos] = counts[e];
+	}
+
+end:
+	free(known);
+	free(counts);
+	free_cfg(&cfg);
 }
 
 void ir_profile_free(void)
@@ -483,6 +1082,7 @@ void ir_profile_free(void)
 	if (profile) {
 		del_set(profile);
 		profile = NULL;
+		obstack_free(&profile_obst, NULL);
 	}
 
 	if (hook != NULL) {
@@ -493,34 +1093,33 @@ void ir_profile_free(void)
 
 bool ir_profile_read(const char *filename)
 {
-	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
-
-	unsigned n_blocks = get_irp_n_blocks();
-	block_assoc_t env = {
-		.i        = 0,
-		.counters = parse_profile(filename, n_blocks)
-	};
-	if (!env.counters)
+	profile_file_t file;
+	if (!map_profile(filename, &file)) {
+		DBG((dbg, LEVEL_2, "Failed to open profile file (%s)\n", filename));
+		return false;
+	}
+	if (!check_profile(&file)) {
+		unmap_profile(&file);
 		return false;
+	}
 
 	ir_profile_free();
 	profile = new_set(cmp_execcount, 16);
+	obstack_init(&profile_obst);
 
-	irp_associate_blocks(&env);
-	free(env.counters);
+	foreach_irp_irg(i, irg) {
+		associate_irg(&file, irg);
+	}
+	unmap_profile(&file);
 
 	/* register the vcg hook */
 	hook = dump_add_node_info_callback(dump_profile_node_info, NULL);
-	return 1;
+	return true;
 }
 
-typedef struct initialize_execfreq_env_t {
-	double freq_factor;
-} initialize_execfreq_env_t;
-
 static void initialize_execfreq(ir_node *block, void *data)
 {
-	const initialize_execfreq_env_t *env = (const initialize_execfreq_env_t*)data;
+	double const freq_factor = *(double const*)data;
 
 	double          freq;
 	ir_graph *const irg = get_irn_irg(block);
@@ -528,27 +1127,40 @@ static void initialize_execfreq(ir_node *block, void *data)
 		freq = 1.0;
 	} else {
 		freq = ir_profile_get_block_execcount(block);
-		freq *= env->freq_factor;
+		freq *= freq_factor;
 		if (freq < MIN_EXECFREQ)
 			freq = MIN_EXECFREQ;
 	}
-
 	set_block_execfreq(block, freq);
+
+	execcount_t const *const ec = find_execcount(block);
+	if (ec == NULL)
+		return;
+	int     const n_preds = get_Block_n_cfgpreds(block);
+	double *const freqs   = ALLOCAN(double, n_preds);
+	for (int i = 0; i < n_preds; ++i)
+		freqs[i] = ec->pred_counts[i] * freq_factor;
+	set_block_cfgpred_execfreqs(block, freqs);
 }
 
 static void ir_set_execfreqs_from_profile(ir_graph *irg)
 {
 	/* Find the first block containing instructions */
-	ir_node *const start_block = get_irg_start_block(irg);
-	unsigned const count       = ir_profile_get_block_execcount(start_block);
+	ir_node  *const start_block = get_irg_start_block(irg);
+	uint64_t  const count       = ir_profile_get_block_execcount(start_block);
 	if (count == 0) {
 		/* the function was never executed, so fallback to estimated freqs */
 		ir_estimate_execfreq(irg);
 		return;
 	}
 
-	initialize_execfreq_env_t env = { .freq_factor = 1.0 / count };
-	irg_block_walk_graph(irg, initialize_execfreq, NULL, &env);
+	double freq_factor = 1.0 / count;
+	irg_block_walk_graph(irg, initialize_execfreq, NULL, &freq_factor);
+}
+
+void firm_init_profile(void)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
 }
 
 void ir_create_execfreqs_from_profile(void)
@@ -0,0 +1,33 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Code instrumentation and execution count profiling.
+ * @author      Adam M. Szalkowski
+ * @date        06.04.2006
+ */
+#ifndef FIRM_IR_IRPROFILE_T_H
+#define FIRM_IR_IRPROFILE_T_H
+
+#include "irprofile.h"
+
+/**
+ * Returns whether the profile contains an execution count for @p block.
+ * Blocks of graphs without matching profile data and blocks created after
+ * the profile was read have none.
+ */
+bool ir_profile_has_block_execcount(const ir_node *block);
+
+/** Initializes the profiling module. */
+void firm_init_profile(void);
+
+/**
+ * Initializes block and edge execution frequencies of all irgs based on
+ * profile data
+ */
+void ir_create_execfreqs_from_profile(void);
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief     Hash table for global value numbering (CSE).
+ */
+#include "irvaluetable.h"
+
+#include "bitfiddle.h"
+#include "hashptr.h"
+#include "irnode_t.h"
+#include "statev_t.h"
+#include "xmalloc.h"
+#include <string.h>
+
+/** Smallest number of slots of a value table. */
+#define MIN_SLOTS 64
+
+typedef struct valuetable_slot_t {
+	ir_node  *node; /**< the node or NULL if the slot is empty */
+	unsigned  hash; /**< hash of node */
+	unsigned  tag;  /**< compact opcode/arity/mode summary of node */
+} valuetable_slot_t;
+
+struct ir_valuetable_t {
+	valuetable_slot_t     *slots;
+	size_t                 n_slots;     /**< always a power of two */
+	size_t                 n_elements;
+	ir_valuetable_cmp_func cmp;
+	/* statistics */
+	unsigned long long     n_lookups;
+	unsigned long long     n_probes;
+	unsigned long long     n_cmp_calls;
+	size_t                 max_probes;
+};
+
+/**
+ * Summarizes the properties every compare function checks first.  Nodes with
+ * different tags are never congruent.
+ */
+static unsigned node_tag(ir_node const *const node)
+{
+	unsigned const opcode = get_irn_opcode(node);
+	unsigned const arity  = (unsigned)get_irn_arity(node);
+	unsigned const mode   = hash_ptr(get_irn_mode(node));
+	return (opcode & 0xFFF) | (arity & 0xFF) << 12 | mode << 20;
+}
+
+ir_valuetable_t *ir_valuetable_new(ir_valuetable_cmp_func const cmp,
+                                   size_t const expected_elements)
+{
+	size_t n_slots = ceil_po2(expected_elements * 2);
+	if (n_slots < MIN_SLOTS)
+		n_slots = MIN_SLOTS;
+
+	ir_valuetable_t *const table = XMALLOCZ(ir_valuetable_t);
+	table->slots   = XMALLOCNZ(valuetable_slot_t, n_slots);
+	table->n_slots = n_slots;
+	table->cmp     = cmp;
+	return table;
+}
+
+void ir_valuetable_free(ir_valuetable_t *const table)
+{
+	if (stat_ev_enabled && table->n_lookups > 0) {
+		stat_ev_ull("cse_table_lookups",    table->n_lookups);
+		stat_ev_ull("cse_table_probes",     table->n_probes);
+		stat_ev_ull("cse_table_cmp_calls",  table->n_cmp_calls);
+		stat_ev_ull("cse_table_max_probes", table->max_probes);
+	}
+	free(table->slots);
+	free(table);
+}
+
+/**
+ * Inserts a node which is known not to be in the table into a table with
+ * enough free slots.
+ */
+static void insert_new(valuetable_slot_t *const slots, size_t const n_slots,
+                       valuetable_slot_t const *const slot)
+{
+	size_t const mask = n_slots - 1;
+	size_t       pos  = slot->hash & mask;
+	for (size_t n_probes = 0; slots[pos].node != NULL;) {
+		++n_probes;
+		pos = (pos + n_probes) & mask;
+	}
+	slots[pos] = *slot;
+}
+
+static void grow(ir_valuetable_t *const table)
+{
+	valuetable_slot_t *const old_slots   = table->slots;
+	size_t             const old_n_slots = table->n_slots;
+	size_t             const n_slots     = old_n_slots * 2;
+	valuetable_slot_t *const slots       = XMALLOCNZ(valuetable_slot_t, n_slots);
+
+	for (size_t i = 0; i < old_n_slots; ++i) {
+		if (old_slots[i].node != NULL)
+			insert_new(slots, n_slots, &old_slots[i]);
+	}
+
+	free(old_slots);
+	table->slots   = slots;
+	table->n_slots = n_slots;
+}
+
+static void count_probes(ir_valuetable_t *const table, size_t const n_probes)
+{
+	table->n_lookups += 1;
+	table->n_probes  += n_probes;
+	if (n_probes > table->max_probes)
+		table->max_probes = n_probes;
+}
+
+ir_node *ir_valuetable_insert(ir_valuetable_t *const table, ir_node *const node,
+                              unsigned const hash)
+{
+	/* keep the load factor below 1/2 */
+	if (table->n_elements + 1 > table->n_slots / 2)
+		grow(table);
+
+	unsigned           const tag      = node_tag(node);
+	valuetable_slot_t *const slots    = table->slots;
+	size_t             const mask     = table->n_slots - 1;
+	size_t                   pos      = hash & mask;
+	size_t                   n_probes = 0;
+	for (;;) {
+		valuetable_slot_t *const slot  = &slots[pos];
+		ir_node           *const other = slot->node;
+		if (other == NULL) {
+			slot->node = node;
+			slot->hash = hash;
+			slot->tag  = tag;
+			++table->n_elements;
+			count_probes(table, n_probes);
+			return node;
+		}
+		/* only look at the node itself if hash and tag match */
+		if (slot->hash == hash && slot->tag == tag) {
+			++table->n_cmp_calls;
+			if (table->cmp(other, node) == 0) {
+				count_probes(table, n_probes);
+				return other;
+			}
+		}
+
+		++n_probes;
+		pos = (pos + n_probes) & mask;
+	}
+}
+
+void ir_valuetable_visit(ir_valuetable_t const *const table,
+                         irg_walk_func *const visit, void *const env)
+{
+	valuetable_slot_t const *const slots = table->slots;
+	for (size_t i = 0, n = table->n_slots; i < n; ++i) {
+		ir_node *const node = slots[i].node;
+		if (node != NULL)
+			visit(node, env);
+	}
+}
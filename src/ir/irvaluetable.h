@@ -0,0 +1,64 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief     Hash table for global value numbering (CSE).
+ *
+ * An open addressing hash table specialized for identify_remember().  Each
+ * slot stores the node hash and a compact (opcode, arity, mode) tag next to
+ * the node pointer, so probing rejects almost all non-matching slots without
+ * touching the node itself.
+ */
+#ifndef FIRM_IR_IRVALUETABLE_H
+#define FIRM_IR_IRVALUETABLE_H
+
+#include <stddef.h>
+#include "firm_types.h"
+#include "irgwalk.h"
+
+typedef struct ir_valuetable_t ir_valuetable_t;
+
+/**
+ * Compares two nodes of the value table.  Returns 0 if the nodes are
+ * congruent.  Nodes with different opcode, mode or arity must never be
+ * reported as congruent, as the table filters them before calling this.
+ */
+typedef int (*ir_valuetable_cmp_func)(void const *elt, void const *key);
+
+/**
+ * Creates a new value table.
+ *
+ * @param cmp                the compare function
+ * @param expected_elements  number of nodes expected in the table (roughly)
+ */
+ir_valuetable_t *ir_valuetable_new(ir_valuetable_cmp_func cmp,
+                                   size_t expected_elements);
+
+/**
+ * Frees a value table.  Reports probe statistics if statistic events are
+ * enabled.
+ */
+void ir_valuetable_free(ir_valuetable_t *table);
+
+/**
+ * Looks up a node congruent to @p node.  If there is none, @p node is
+ * inserted.
+ *
+ * @param table  the value table
+ * @param node   the node to look up
+ * @param hash   the hash of @p node
+ * @return the congruent node in the table or @p node itself
+ */
+ir_node *ir_valuetable_insert(ir_valuetable_t *table, ir_node *node,
+                              unsigned hash);
+
+/**
+ * Calls @p visit for every node in the table.
+ */
+void ir_valuetable_visit(ir_valuetable_t const *table, irg_walk_func *visit,
+                         void *env);
+
+#endif
@@ -475,6 +475,23 @@ void lc_opt_print_help_for_entry(lc_opt_entry_t *ent, char separator, FILE *f)
 	lc_opt_print_help_rec(ent, separator, ent, f);
 }
 
+void lc_opt_walk_values(const lc_opt_entry_t *grp, lc_opt_value_func_t *func,
+                        void *env)
+{
+	const lc_grp_special_t *s = lc_get_grp_special(grp);
+	char value[256];
+
+	list_for_each_entry(lc_opt_entry_t, e, &s->opts, list) {
+		value[0] = '\0';
+		lc_opt_value_to_string(value, sizeof(value), e);
+		func(e->name, value, env);
+	}
+
+	list_for_each_entry(lc_opt_entry_t, e, &s->grps, list) {
+		lc_opt_walk_values(e, func, env);
+	}
+}
+
 int lc_opt_from_single_arg(const lc_opt_entry_t *root, const char *arg)
 {
 	const lc_opt_entry_t *grp = root;
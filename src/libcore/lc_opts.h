@@ -196,4 +196,17 @@ bool lc_opt_add_table(lc_opt_entry_t *grp, const lc_opt_table_entry_t *table);
  */
 int lc_opt_from_single_arg(const lc_opt_entry_t *grp, const char *arg);
 
+typedef void (lc_opt_value_func_t)(const char *name, const char *value,
+                                   void *env);
+
+/**
+ * Call a function with the current value of every option in a group and its
+ * subgroups. The options of a group are visited before its subgroups.
+ * @param grp   The group to walk.
+ * @param func  The function called for each option.
+ * @param env   Passed to @p func.
+ */
+void lc_opt_walk_values(const lc_opt_entry_t *grp, lc_opt_value_func_t *func,
+                        void *env);
+
 #endif
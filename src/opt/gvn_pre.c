@@ -100,8 +100,8 @@ typedef struct pre_env {
 	char            first_iter;   /* non-zero for first fixed point iteration */
 	int             iteration;    /* iteration counter */
 #if OPTIMIZE_NODES
-	pset           *value_table;   /* standard value table*/
-	pset           *gvnpre_values; /* GVN-PRE value table */
+	ir_valuetable_t *value_table;   /* standard value table*/
+	ir_valuetable_t *gvnpre_values; /* GVN-PRE value table */
 #endif
 } pre_env;
 
@@ -1838,9 +1838,9 @@ void do_gvn_pre(ir_graph *irg)
 	set_opt_global_cse(1);
 	/* new_identities() */
 	if (irg->value_table != NULL)
-		del_pset(irg->value_table);
-	/* initially assumed nodes in pset are 512 */
-	irg->value_table = new_pset(compare_gvn_identities, 512);
+		ir_valuetable_free(irg->value_table);
+	irg->value_table = ir_valuetable_new(compare_gvn_identities,
+	                                     get_irg_last_idx(irg));
 #if OPTIMIZE_NODES
 	env.gvnpre_values = irg->value_table;
 #endif
@@ -1867,7 +1867,7 @@ void do_gvn_pre(ir_graph *irg)
 
 #if OPTIMIZE_NODES
 	irg->value_table = env.value_table;
-	del_pset(irg->value_table);
+	ir_valuetable_free(irg->value_table);
 	irg->value_table = env.gvnpre_values;
 #endif
 
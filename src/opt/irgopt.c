@@ -22,8 +22,12 @@
 #include "iropt_t.h"
 #include "iroptimize.h"
 #include "irtools.h"
-#include "pdeq.h"
+#include "pqueue.h"
+#include "raw_bitset.h"
+#include "util.h"
+#include "xmalloc.h"
 #include <assert.h>
+#include <string.h>
 
 /**
  * A wrapper around optimize_inplace_2() to be called from a walker.
@@ -54,26 +58,90 @@ void local_optimize_node(ir_node *n)
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 }
 
-static void enqueue_node(ir_node *node, deq_t *waitq)
+/**
+ * Worklist of optimize_graph_df().  Nodes are processed in the order of an
+ * initial postorder walk, so operands are usually optimized before their
+ * users.  Nodes created later are ordered after all existing nodes.
+ */
+typedef struct worklist_t {
+	pqueue_t *queue;
+	unsigned *order;      /**< position of each node index, 0 if none yet */
+	unsigned *queued;     /**< raw bitset of node indices in the queue */
+	unsigned  n_nodes;    /**< number of node indices covered by the arrays */
+	unsigned  next_order;
+	bool      cf_changed; /**< control flow changed since the last dominance
+	                           computation */
+} worklist_t;
+
+static void worklist_init(worklist_t *const wl, ir_graph *const irg)
+{
+	unsigned const n_nodes = get_irg_last_idx(irg);
+	wl->queue      = new_pqueue();
+	wl->order      = XMALLOCNZ(unsigned, n_nodes);
+	wl->queued     = rbitset_malloc(n_nodes);
+	wl->n_nodes    = n_nodes;
+	wl->next_order = 1;
+	wl->cf_changed = true;
+}
+
+static void worklist_free(worklist_t *const wl)
+{
+	del_pqueue(wl->queue);
+	free(wl->order);
+	free(wl->queued);
+}
+
+/** Makes sure the arrays of @p wl cover the node index @p idx. */
+static void worklist_grow(worklist_t *const wl, unsigned const idx)
 {
-	if (get_irn_link(node) == waitq)
+	if (idx < wl->n_nodes)
 		return;
-	deq_push_pointer_right(waitq, node);
-	set_irn_link(node, waitq);
+
+	unsigned const n_nodes = MAX(idx + 1, wl->n_nodes * 2);
+	wl->order = XREALLOC(wl->order, unsigned, n_nodes);
+	memset(wl->order + wl->n_nodes, 0,
+	       (n_nodes - wl->n_nodes) * sizeof(*wl->order));
+	wl->queued = XREALLOC(wl->queued, unsigned, BITSET_SIZE_ELEMS(n_nodes));
+	memset(wl->queued + BITSET_SIZE_ELEMS(wl->n_nodes), 0,
+	       (BITSET_SIZE_ELEMS(n_nodes) - BITSET_SIZE_ELEMS(wl->n_nodes))
+	       * sizeof(*wl->queued));
+	wl->n_nodes = n_nodes;
+}
+
+static void enqueue_node(ir_node *node, worklist_t *wl)
+{
+	unsigned const idx = get_irn_idx(node);
+	worklist_grow(wl, idx);
+	if (rbitset_is_set(wl->queued, idx))
+		return;
+	rbitset_set(wl->queued, idx);
+
+	unsigned order = wl->order[idx];
+	if (order == 0) {
+		order = wl->next_order++;
+		wl->order[idx] = order;
+	}
+	/* pqueue returns the highest priority first */
+	pqueue_put(wl->queue, node, -(int)order);
+}
+
+static ir_node *dequeue_node(worklist_t *const wl)
+{
+	ir_node *const node = (ir_node *)pqueue_pop_front(wl->queue);
+	rbitset_clear(wl->queued, get_irn_idx(node));
+	return node;
 }
 
 static void enqueue_node_init(ir_node *node, void *env)
 {
-	deq_t *waitq = (deq_t *)env;
-	deq_push_pointer_right(waitq, node);
-	set_irn_link(node, waitq);
+	enqueue_node(node, (worklist_t *)env);
 }
 
 /**
  * Enqueue all users of a node to a wait queue.
  * Handles mode_T nodes.
  */
-static void enqueue_users(ir_node *n, deq_t *waitq)
+static void enqueue_users(ir_node *n, worklist_t *waitq)
 {
 	foreach_out_edge(n, edge) {
 		ir_node *succ = get_edge_src_irn(edge);
@@ -105,7 +173,7 @@ static void find_unreachable_blocks(ir_node *block, void *env)
 	if (get_Block_dom_depth(block) >= 0)
 		return;
 
-	deq_t *waitq = (deq_t *)env;
+	worklist_t *waitq = (worklist_t *)env;
 	foreach_block_succ(block, edge) {
 		ir_node *succ_block = get_edge_src_irn(edge);
 		enqueue_node(succ_block, waitq);
@@ -126,13 +194,29 @@ void local_optimize_graph(ir_graph *irg)
 	local_optimize_node(get_irg_end(irg));
 }
 
+/** Counts the control flow predecessors of @p block which are not Bad. */
+static int count_live_cfgpreds(ir_node const *const block)
+{
+	int n_live = 0;
+	foreach_irn_in(block, i, pred) {
+		if (!is_Bad(pred))
+			++n_live;
+	}
+	return n_live;
+}
+
 /**
  * Data flow optimization walker.
  * Optimizes all nodes and enqueue its users
  * if done.
  */
-static void opt_walker(ir_node *n, deq_t *waitq)
+static void opt_walker(ir_node *n, worklist_t *waitq)
 {
+	/* Blocks drop dead predecessors in place, which may make other blocks
+	 * unreachable. */
+	bool const is_block = is_Block(n);
+	int  const n_live   = is_block ? count_live_cfgpreds(n) : 0;
+
 	/* If CSE occurs during the optimization,
 	 * our operands have fewer users than before.
 	 * Thus, we may be able to apply a rule that
@@ -145,10 +229,16 @@ static void opt_walker(ir_node *n, deq_t *waitq)
 		optimized = optimize_in_place_2(last);
 
 		if (optimized != last) {
+			ir_mode *const mode = get_irn_mode(last);
+			if (is_Block(last) || mode == mode_X || mode == mode_T)
+				waitq->cf_changed = true;
 			enqueue_users(last, waitq);
 			exchange(last, optimized);
 		}
 	} while (optimized != last);
+
+	if (is_block && optimized == n && count_live_cfgpreds(n) != n_live)
+		waitq->cf_changed = true;
 }
 
 void optimize_graph_df(ir_graph *irg)
@@ -170,36 +260,37 @@ void optimize_graph_df(ir_graph *irg)
 
 	new_identities(irg);
 
-	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-
 	constbits_analyze(irg);
 
-	deq_t waitq;
-	deq_init(&waitq);
+	worklist_t waitq;
+	worklist_init(&waitq, irg);
 	irg_walk_graph(irg, NULL, enqueue_node_init, &waitq);
 
 	/* any optimized nodes are stored in the wait queue,
 	 * so if it's not empty, the graph has been changed */
-	while (!deq_empty(&waitq)) {
+	while (!pqueue_empty(waitq.queue)) {
 		assure_irg_properties(irg, props);
 
 		/* finish the wait queue */
-		while (!deq_empty(&waitq)) {
-			ir_node *n = deq_pop_pointer_left(ir_node, &waitq);
-			set_irn_link(n, NULL);
+		while (!pqueue_empty(waitq.queue)) {
+			ir_node *n = dequeue_node(&waitq);
 			opt_walker(n, &waitq);
 		}
-		if (irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_OPTIMIZE_UNREACHABLE_CODE)) {
+		/* Blocks only become unreachable if the control flow changed, so the
+		 * dominance information of the last round is still good otherwise
+		 * and all blocks it found unreachable are gone by now. */
+		if (irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_OPTIMIZE_UNREACHABLE_CODE)
+		 && waitq.cf_changed) {
 			/* Calculate dominance so we can kill unreachable code
 			 * We want this intertwined with localopts for better optimization
 			 * (phase coupling) */
 			compute_doms(irg);
+			waitq.cf_changed = false;
 			assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 			irg_block_walk_graph(irg, NULL, find_unreachable_blocks, &waitq);
 		}
 	}
-	deq_free(&waitq);
-	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	worklist_free(&waitq);
 
 	constbits_clear(irg);
 
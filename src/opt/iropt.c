@@ -7637,11 +7637,14 @@ restart:;
 			goto restart;
 	}
 
-	/* Some more constant expression evaluation. */
+	/* Some more constant expression evaluation. The transformations work on
+	 * scalar values only and would construct invalid constants for vector
+	 * modes. */
 	if (get_opt_algebraic_simplification() ||
 		(iro == iro_Cond) ||
 		(iro == iro_Proj)) {    /* Flags tested local. */
-		if (n->op->ops.transform_node != NULL) {
+		if (n->op->ops.transform_node != NULL
+		 && !mode_is_vector(get_irn_mode(n))) {
 			n = n->op->ops.transform_node(n);
 			if (n != old_n)
 				goto restart;
@@ -7737,8 +7740,8 @@ void ir_register_opt_node_ops(void)
 	set_op_transform_node_proj(op_Store,   transform_node_Proj_Store);
 }
 
-/** The size of the hash table used, should estimate the number of nodes
- * in a graph. */
+/** The minimum size of the hash table used, should estimate the number of
+ * nodes in a small graph. */
 #define N_IR_NODES 512
 
 static int identities_cmp(const void *elt, const void *key)
@@ -7814,13 +7817,17 @@ unsigned ir_node_hash(const ir_node *node)
 void new_identities(ir_graph *irg)
 {
 	del_identities(irg);
-	irg->value_table = new_pset(identities_cmp, N_IR_NODES);
+	/* most non-Block nodes of the graph end up in the table */
+	size_t const n_nodes = MAX(get_irg_last_idx(irg), N_IR_NODES);
+	irg->value_table = ir_valuetable_new(identities_cmp, n_nodes);
 }
 
 void del_identities(ir_graph *irg)
 {
-	if (irg->value_table != NULL)
-		del_pset(irg->value_table);
+	if (irg->value_table != NULL) {
+		ir_valuetable_free(irg->value_table);
+		irg->value_table = NULL;
+	}
 }
 
 static int cmp_node_nr(const void *a, const void *b)
@@ -7874,15 +7881,15 @@ void ir_normalize_node(ir_node *n)
 
 ir_node *identify_remember(ir_node *n)
 {
-	ir_graph *irg         = get_irn_irg(n);
-	pset     *value_table = irg->value_table;
+	ir_graph        *irg         = get_irn_irg(n);
+	ir_valuetable_t *value_table = irg->value_table;
 
 	if (value_table == NULL)
 		return n;
 
 	ir_normalize_node(n);
 	/* lookup or insert in hash table with given hash key. */
-	ir_node *nn = (ir_node *)pset_insert(value_table, n, ir_node_hash(n));
+	ir_node *nn = ir_valuetable_insert(value_table, n, ir_node_hash(n));
 
 	/* nn is reachable again */
 	if (nn != n)
@@ -7922,9 +7929,7 @@ void add_identities(ir_node *node)
 
 void visit_all_identities(ir_graph *irg, irg_walk_func visit, void *env)
 {
-	foreach_pset(irg->value_table, ir_node, node) {
-		visit(node, env);
-	}
+	ir_valuetable_visit(irg->value_table, visit, env);
 }
 
 ir_node *optimize_node(ir_node *n)
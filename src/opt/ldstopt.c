@@ -28,6 +28,7 @@
 #include "iropt_t.h"
 #include "iroptimize.h"
 #include "irtools.h"
+#include "ldstopt_t.h"
 #include "panic.h"
 #include "set.h"
 #include "target_t.h"
@@ -66,11 +67,6 @@ typedef struct ldst_info_t {
 	unsigned visited;            /**< visited counter for breaking loops */
 } ldst_info_t;
 
-typedef struct base_offset_t {
-	ir_node *base;
-	long     offset;
-} base_offset_t;
-
 typedef struct track_load_env_t {
 	ir_node      *load;
 	base_offset_t base_offset;
@@ -304,7 +300,7 @@ static void kill_and_reduce_usage(ir_node *node)
 	}
 }
 
-static void get_base_and_offset(ir_node *ptr, base_offset_t *base_offset)
+void get_base_and_offset(ir_node *ptr, base_offset_t *base_offset)
 {
 	/* TODO: long might not be enough, we should probably use some tarval
 	 * thingy, or at least detect long overflows and abort */
@@ -0,0 +1,27 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Load/Store optimizations -- private header.
+ */
+#ifndef FIRM_OPT_LDSTOPT_T_H
+#define FIRM_OPT_LDSTOPT_T_H
+
+#include "firm_types.h"
+
+/** An address split into a base pointer and a constant offset. */
+typedef struct base_offset_t {
+	ir_node *base;
+	long     offset;
+} base_offset_t;
+
+/**
+ * Splits the address @p ptr into a base pointer and a constant byte offset by
+ * walking through Adds with constant operands and Members of fixed layout.
+ */
+void get_base_and_offset(ir_node *ptr, base_offset_t *base_offset);
+
+#endif
@@ -0,0 +1,921 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Vectorization of counted innermost loops.
+ *
+ * A loop consisting of a header block, which compares an induction variable
+ * with a loop invariant bound, and a body block, which accesses arrays with
+ * unit stride, is transformed into
+ *
+ *   check:    if (bound does not overflow && accesses do not overlap)
+ *   vector:     for (; i <= bound - VF; i += VF) widened body
+ *   scalar:   for (; i < bound; ++i) original body
+ *
+ * The original loop remains as the remainder loop. It executes the iterations
+ * left over by the vector loop, or all of them if the runtime checks fail.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "irnodehashmap.h"
+#include "iroptimize.h"
+#include "irouts_t.h"
+#include "irtools.h"
+#include "lcssa_t.h"
+#include "target_t.h"
+#include "tv.h"
+#include "type_t.h"
+#include "util.h"
+#include "vectorize_t.h"
+
+#include <limits.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** The maximum number of nodes in a loop that is vectorized. */
+#define MAX_LOOP_NODES 256
+
+typedef enum node_class_t {
+	CLS_NONE,      /**< not classified yet */
+	CLS_INVARIANT, /**< defined outside of the loop */
+	CLS_SCALAR,    /**< scalar value depending on the induction variable */
+	CLS_VECTOR,    /**< value which gets a vector mode */
+	CLS_MEMORY,    /**< memory operation or memory value */
+	CLS_CONTROL,   /**< loop control flow */
+	CLS_BAD,       /**< prevents vectorization */
+} node_class_t;
+
+/** An address of the form root + stride * iv + offset. */
+typedef struct affine_t {
+	ir_node *root;
+	long     stride;
+	long     offset;
+} affine_t;
+
+typedef struct vloop_t {
+	ir_node          *header;
+	ir_node          *body;
+	int               entry_idx;  /**< header input coming from outside */
+	int               back_idx;   /**< header input coming from the body */
+	ir_node          *iv;         /**< the induction variable Phi */
+	ir_node          *iv_next;    /**< iv + 1 */
+	ir_node          *mem_phi;
+	ir_node          *cmp;
+	ir_node          *bound;      /**< loop invariant bound of iv */
+	ir_relation       relation;   /**< loop continues while iv relation bound */
+	ir_node         **memops;     /**< Loads and Stores of the loop */
+	unsigned          elem_size;  /**< size of a lane in bytes */
+	unsigned          vf;         /**< vectorization factor */
+	ir_nodehashmap_t  classes;
+	ir_nodehashmap_t  map;        /**< scalar node to vector loop node */
+	ir_nodehashmap_t  splats;     /**< invariant node to vector of it */
+	ir_nodehashmap_t  entry_map;  /**< scalar node to its value for iv = i0 */
+	/* nodes of the vector loop under construction */
+	ir_node          *check_block;
+	ir_node          *pre_block;  /**< vector loop preheader */
+	ir_node          *pre_mem;    /**< memory at the end of pre_block */
+	ir_node          *vbody;
+	ir_node          *vi;
+	ir_node          *vmem;
+} vloop_t;
+
+static bool is_loop_block(vloop_t const *const vl, ir_node const *const block)
+{
+	return block == vl->header || block == vl->body;
+}
+
+static bool is_invariant(vloop_t const *const vl, ir_node const *const node)
+{
+	return !is_loop_block(vl, get_nodes_block(node));
+}
+
+/**
+ * Returns the mode with a lane of @p mode or NULL if it does not fit the
+ * vectorization factor of the loop.
+ */
+static ir_mode *get_lane_vector_mode(vloop_t const *const vl,
+                                     ir_mode *const mode)
+{
+	if (get_mode_size_bytes(mode) != vl->elem_size)
+		return NULL;
+	unsigned       n_lanes;
+	ir_mode *const vmode = get_vector_mode(mode, &n_lanes);
+	if (vmode == NULL || n_lanes != vl->vf)
+		return NULL;
+	return vmode;
+}
+
+/** Decomposes the address @p node into root + stride * iv + offset. */
+static bool get_affine(vloop_t const *const vl, ir_node *const node,
+                       affine_t *const res)
+{
+	res->root   = NULL;
+	res->stride = 0;
+	res->offset = 0;
+	if (node == vl->iv) {
+		res->stride = 1;
+		return true;
+	} else if (node == vl->iv_next) {
+		res->stride = 1;
+		res->offset = 1;
+		return true;
+	} else if (is_Const(node)) {
+		ir_tarval *const tv = get_Const_tarval(node);
+		if (!tarval_is_long(tv))
+			return false;
+		res->offset = get_tarval_long(tv);
+		return true;
+	} else if (is_invariant(vl, node)) {
+		/* Fold constant offsets, so p and p + 8 share their root. */
+		if (is_Add(node) || is_Sub(node)) {
+			ir_node *const right = get_binop_right(node);
+			if (is_Const(right) && tarval_is_long(get_Const_tarval(right))
+			 && get_affine(vl, get_binop_left(node), res)) {
+				long const offset = get_tarval_long(get_Const_tarval(right));
+				res->offset += is_Add(node) ? offset : -offset;
+				return true;
+			}
+		}
+		res->root = node;
+		return true;
+	}
+
+	affine_t l;
+	affine_t r;
+	switch (get_irn_opcode(node)) {
+	case iro_Add:
+		if (!get_affine(vl, get_Add_left(node), &l)
+		 || !get_affine(vl, get_Add_right(node), &r)
+		 || (l.root != NULL && r.root != NULL))
+			return false;
+		res->root   = l.root != NULL ? l.root : r.root;
+		res->stride = l.stride + r.stride;
+		res->offset = l.offset + r.offset;
+		return true;
+
+	case iro_Sub:
+		if (!get_affine(vl, get_Sub_left(node), &l)
+		 || !get_affine(vl, get_Sub_right(node), &r) || r.root != NULL)
+			return false;
+		res->root   = l.root;
+		res->stride = l.stride - r.stride;
+		res->offset = l.offset - r.offset;
+		return true;
+
+	case iro_Mul: {
+		ir_node *const right = get_Mul_right(node);
+		if (!is_Const(right) || !tarval_is_long(get_Const_tarval(right))
+		 || !get_affine(vl, get_Mul_left(node), &l) || l.root != NULL)
+			return false;
+		long const factor = get_tarval_long(get_Const_tarval(right));
+		res->stride = l.stride * factor;
+		res->offset = l.offset * factor;
+		return true;
+	}
+
+	case iro_Shl: {
+		ir_node *const right = get_Shl_right(node);
+		if (!is_Const(right) || !tarval_is_long(get_Const_tarval(right))
+		 || !get_affine(vl, get_Shl_left(node), &l) || l.root != NULL)
+			return false;
+		long const shift = get_tarval_long(get_Const_tarval(right));
+		if (shift < 0 || shift >= 16)
+			return false;
+		res->stride = l.stride << shift;
+		res->offset = l.offset << shift;
+		return true;
+	}
+
+	case iro_Conv: {
+		/* Widening the induction variable does not change its value, as the
+		 * loop condition keeps it in range. */
+		ir_node *const op      = get_Conv_op(node);
+		ir_mode *const op_mode = get_irn_mode(op);
+		ir_mode *const mode    = get_irn_mode(node);
+		if (!mode_is_int(op_mode) || !mode_is_int(mode)
+		 || get_mode_size_bits(mode) < get_mode_size_bits(op_mode))
+			return false;
+		return get_affine(vl, op, res) && res->root == NULL;
+	}
+
+	default:
+		return false;
+	}
+}
+
+/** Checks whether @p ptr advances by one lane per iteration. */
+static bool is_unit_stride(vloop_t const *const vl, ir_node *const ptr,
+                           affine_t *const affine)
+{
+	return get_affine(vl, ptr, affine) && affine->root != NULL
+	    && mode_is_reference(get_irn_mode(affine->root))
+	    && affine->stride == (long)vl->elem_size;
+}
+
+static node_class_t classify(vloop_t *vl, ir_node *node);
+
+static node_class_t classify_memop(vloop_t *const vl, ir_node *const node)
+{
+	ir_node *ptr;
+	ir_mode *mode;
+	if (is_Load(node)) {
+		if (get_Load_volatility(node) == volatility_is_volatile)
+			return CLS_BAD;
+		ptr  = get_Load_ptr(node);
+		mode = get_Load_mode(node);
+	} else {
+		if (get_Store_volatility(node) == volatility_is_volatile)
+			return CLS_BAD;
+		ir_node     *const value = get_Store_value(node);
+		node_class_t const cls   = classify(vl, value);
+		if (cls != CLS_VECTOR && cls != CLS_INVARIANT)
+			return CLS_BAD;
+		ptr  = get_Store_ptr(node);
+		mode = get_irn_mode(value);
+	}
+	affine_t affine;
+	if (ir_throws_exception(node) || get_nodes_block(node) != vl->body
+	 || get_lane_vector_mode(vl, mode) == NULL
+	 || !is_unit_stride(vl, ptr, &affine)
+	 || classify(vl, get_memop_mem(node)) != CLS_MEMORY)
+		return CLS_BAD;
+	ARR_APP1(ir_node*, vl->memops, node);
+	return CLS_MEMORY;
+}
+
+static node_class_t classify_arith(vloop_t *const vl, ir_node *const node)
+{
+	bool has_vector = false;
+	foreach_irn_in(node, i, op) {
+		node_class_t const cls = classify(vl, op);
+		if (cls == CLS_VECTOR)
+			has_vector = true;
+		else if (cls != CLS_INVARIANT && cls != CLS_SCALAR)
+			return CLS_BAD;
+	}
+	ir_mode *const mode = get_irn_mode(node);
+	if (!has_vector) {
+		return mode_is_int(mode) || mode_is_reference(mode)
+		     ? CLS_SCALAR : CLS_BAD;
+	}
+
+	/* all other operands must be available as vectors */
+	foreach_irn_in(node, i, op) {
+		if (classify(vl, op) == CLS_SCALAR)
+			return CLS_BAD;
+	}
+	if (!is_binop(node) || get_lane_vector_mode(vl, mode) == NULL
+	 || !is_vector_op_supported(node, mode))
+		return CLS_BAD;
+	return CLS_VECTOR;
+}
+
+static node_class_t classify_(vloop_t *const vl, ir_node *const node)
+{
+	if (is_invariant(vl, node))
+		return CLS_INVARIANT;
+	if (node == vl->iv)
+		return CLS_SCALAR;
+	if (node == vl->mem_phi)
+		return CLS_MEMORY;
+
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+	case iro_Store:
+		return classify_memop(vl, node);
+
+	case iro_Proj: {
+		ir_node *const pred = get_Proj_pred(node);
+		if (is_Cond(pred))
+			return CLS_CONTROL;
+		if (!is_Load(pred) && !is_Store(pred))
+			return CLS_BAD;
+		if (classify(vl, pred) != CLS_MEMORY)
+			return CLS_BAD;
+		if (get_irn_mode(node) == mode_M)
+			return CLS_MEMORY;
+		return is_Load(pred) && get_Proj_num(node) == pn_Load_res
+		     ? CLS_VECTOR : CLS_BAD;
+	}
+
+	case iro_Sync:
+		foreach_irn_in(node, i, pred) {
+			if (classify(vl, pred) != CLS_MEMORY)
+				return CLS_BAD;
+		}
+		return CLS_MEMORY;
+
+	case iro_Add:
+	case iro_Sub:
+	case iro_Mul:
+	case iro_And:
+	case iro_Or:
+	case iro_Eor:
+	case iro_Shl:
+	case iro_Conv:
+		return classify_arith(vl, node);
+
+	case iro_Member:
+		return classify(vl, get_Member_ptr(node)) == CLS_BAD
+		     ? CLS_BAD : CLS_SCALAR;
+
+	case iro_Cmp:
+		return node == vl->cmp ? CLS_CONTROL : CLS_BAD;
+
+	case iro_Cond:
+	case iro_Jmp:
+		return CLS_CONTROL;
+
+	default:
+		return CLS_BAD;
+	}
+}
+
+static node_class_t classify(vloop_t *const vl, ir_node *const node)
+{
+	node_class_t cls = (node_class_t)(uintptr_t)
+		ir_nodehashmap_get(void, &vl->classes, node);
+	if (cls == CLS_NONE) {
+		/* guard against cycles not going through the loop Phis */
+		ir_nodehashmap_insert(&vl->classes, node, (void*)(uintptr_t)CLS_BAD);
+		cls = classify_(vl, node);
+		ir_nodehashmap_insert(&vl->classes, node, (void*)(uintptr_t)cls);
+	}
+	return cls;
+}
+
+/**
+ * Finds the induction variable, the memory Phi and the loop condition.
+ */
+static bool analyze_header(vloop_t *const vl)
+{
+	ir_node *const header = vl->header;
+	ir_node *const body   = vl->body;
+	if (get_Block_n_cfgpreds(header) != 2 || get_Block_n_cfgpreds(body) != 1)
+		return false;
+	ir_node *const back = get_Block_cfgpred(header, 0);
+	vl->back_idx  = is_Jmp(back) && get_nodes_block(back) == body ? 0 : 1;
+	vl->entry_idx = 1 - vl->back_idx;
+	ir_node *const back_jmp = get_Block_cfgpred(header, vl->back_idx);
+	if (!is_Jmp(back_jmp) || get_nodes_block(back_jmp) != body)
+		return false;
+
+	ir_node *const body_proj = get_Block_cfgpred(body, 0);
+	if (!is_Proj(body_proj) || get_nodes_block(body_proj) != header)
+		return false;
+	ir_node *const cond = get_Proj_pred(body_proj);
+	if (!is_Cond(cond))
+		return false;
+	ir_node *const cmp = get_Cond_selector(cond);
+	if (!is_Cmp(cmp) || get_nodes_block(cmp) != header)
+		return false;
+	vl->cmp = cmp;
+
+	for (unsigned i = 0, n = get_irn_n_outs(header); i < n; ++i) {
+		ir_node *const node = get_irn_out(header, i);
+		if (!is_Phi(node) || get_nodes_block(node) != header)
+			continue;
+		ir_mode *const mode = get_irn_mode(node);
+		if (mode == mode_M && vl->mem_phi == NULL) {
+			vl->mem_phi = node;
+		} else if (mode_is_int(mode) && vl->iv == NULL) {
+			vl->iv = node;
+		} else {
+			/* reductions and other recurrences are not supported */
+			return false;
+		}
+	}
+	if (vl->iv == NULL || vl->mem_phi == NULL)
+		return false;
+
+	ir_node *const next = get_Phi_pred(vl->iv, vl->back_idx);
+	if (!is_Add(next) || get_Add_left(next) != vl->iv
+	 || !is_Const(get_Add_right(next))
+	 || !tarval_is_one(get_Const_tarval(get_Add_right(next)))
+	 || !is_loop_block(vl, get_nodes_block(next)))
+		return false;
+	vl->iv_next = next;
+
+	/* normalize the condition to iv relation bound */
+	ir_relation relation = get_Cmp_relation(cmp);
+	ir_node    *bound;
+	if (get_Cmp_left(cmp) == vl->iv) {
+		bound = get_Cmp_right(cmp);
+	} else if (get_Cmp_right(cmp) == vl->iv) {
+		bound    = get_Cmp_left(cmp);
+		relation = get_inversed_relation(relation);
+	} else {
+		return false;
+	}
+	if (get_Proj_num(body_proj) == pn_Cond_false)
+		relation = get_negated_relation(relation);
+	if (!is_invariant(vl, bound)
+	 || (relation != ir_relation_less && relation != ir_relation_less_equal))
+		return false;
+	vl->bound    = bound;
+	vl->relation = relation;
+	return true;
+}
+
+/** Collects the nodes of @p block into the flexible array @p nodes. */
+static void collect_block_nodes(ir_node ***const nodes, ir_node *const block)
+{
+	for (unsigned i = 0, n = get_irn_n_outs(block); i < n; ++i) {
+		ir_node *const node = get_irn_out(block, i);
+		if (!is_Block(node) && get_nodes_block(node) == block)
+			ARR_APP1(ir_node*, *nodes, node);
+	}
+}
+
+/** Checks whether all nodes of the loop can be vectorized. */
+static bool analyze_body(vloop_t *const vl)
+{
+	ir_node **nodes = NEW_ARR_F(ir_node*, 0);
+	collect_block_nodes(&nodes, vl->header);
+	collect_block_nodes(&nodes, vl->body);
+
+	bool ok = ARR_LEN(nodes) <= MAX_LOOP_NODES;
+	/* Determine the lane size from the stored values. */
+	for (size_t i = 0, n = ARR_LEN(nodes); ok && i < n; ++i) {
+		ir_node *const node = nodes[i];
+		if (is_Store(node)) {
+			ir_mode *const mode = get_irn_mode(get_Store_value(node));
+			vl->elem_size = get_mode_size_bytes(mode);
+			unsigned n_lanes;
+			if (get_vector_mode(mode, &n_lanes) == NULL) {
+				ok = false;
+			} else {
+				vl->vf = n_lanes;
+			}
+			break;
+		}
+	}
+	if (vl->vf == 0)
+		ok = false;
+
+	for (size_t i = 0, n = ARR_LEN(nodes); ok && i < n; ++i) {
+		ir_node     *const node = nodes[i];
+		node_class_t const cls  = is_Phi(node) ? CLS_CONTROL
+		                                       : classify(vl, node);
+		if (cls == CLS_BAD) {
+			DB((dbg, LEVEL_2, "\t%+F prevents vectorization\n", node));
+			ok = false;
+			break;
+		}
+		/* Only the body may access memory, so the header runs exactly as
+		 * often as the loop condition is evaluated. */
+		if (cls == CLS_MEMORY && get_nodes_block(node) == vl->header) {
+			ok = false;
+			break;
+		}
+		if (cls != CLS_VECTOR)
+			continue;
+		/* lane values are not available as scalars */
+		for (unsigned j = 0, n_outs = get_irn_n_outs(node); j < n_outs; ++j) {
+			int            pos;
+			ir_node *const user = get_irn_out_ex(node, j, &pos);
+			if (is_Store(user) && pos == n_Store_value)
+				continue;
+			if (is_invariant(vl, user) || classify(vl, user) != CLS_VECTOR) {
+				ok = false;
+				break;
+			}
+		}
+	}
+	DEL_ARR_F(nodes);
+	return ok && ARR_LEN(vl->memops) > 0;
+}
+
+static ir_type *get_memop_type(ir_node const *const node)
+{
+	return is_Load(node) ? get_Load_type(node) : get_Store_type(node);
+}
+
+static ir_node *get_memop_ptr_(ir_node const *const node)
+{
+	return is_Load(node) ? get_Load_ptr(node) : get_Store_ptr(node);
+}
+
+typedef enum dependence_t {
+	DEP_NONE,    /**< the accesses never overlap within a vector */
+	DEP_RUNTIME, /**< the accesses have to be checked at runtime */
+	DEP_BAD,     /**< the accesses overlap */
+} dependence_t;
+
+/**
+ * Returns the entity whose address is @p root or NULL if @p root may point
+ * anywhere.
+ */
+static ir_entity *get_root_entity(ir_node const *const root)
+{
+	ir_entity *entity;
+	if (is_Address(root)) {
+		entity = get_Address_entity(root);
+	} else if (is_Member(root)
+	        && get_Member_ptr(root) == get_irg_frame(get_irn_irg(root))) {
+		entity = get_Member_entity(root);
+	} else {
+		return NULL;
+	}
+	return is_alias_entity(entity) ? NULL : entity;
+}
+
+/**
+ * Checks whether the accesses @p a and @p b of one iteration may touch the
+ * memory accessed by the other one in a different iteration of the same
+ * vector.
+ */
+static dependence_t get_dependence(vloop_t const *const vl,
+                                   ir_node const *const a,
+                                   ir_node const *const b)
+{
+	affine_t aa;
+	affine_t ab;
+	get_affine(vl, get_memop_ptr_(a), &aa);
+	get_affine(vl, get_memop_ptr_(b), &ab);
+	long const width = (long)(vl->vf * vl->elem_size);
+	if (aa.root == ab.root) {
+		long const distance = aa.offset - ab.offset;
+		return distance == 0 || distance >= width || distance <= -width
+		     ? DEP_NONE : DEP_BAD;
+	}
+	/* The accesses walk over the whole range of the loop, so comparing single
+	 * elements at the roots is not enough.  Distinct objects stay apart, and
+	 * so does anything the alias analysis separates without looking at the
+	 * size of the accessed range. */
+	ir_entity *const ea = get_root_entity(aa.root);
+	ir_entity *const eb = get_root_entity(ab.root);
+	if (ea != NULL && eb != NULL && ea != eb)
+		return DEP_NONE;
+	ir_alias_relation const rel
+		= get_alias_relation(aa.root, get_memop_type(a), UINT_MAX,
+		                     ab.root, get_memop_type(b), UINT_MAX);
+	return rel == ir_no_alias ? DEP_NONE : DEP_RUNTIME;
+}
+
+/** Returns the value of the scalar @p node in the first iteration. */
+static ir_node *get_entry_value(vloop_t *const vl, ir_node *const node)
+{
+	if (is_invariant(vl, node))
+		return node;
+	ir_node *res = ir_nodehashmap_get(ir_node, &vl->entry_map, node);
+	if (res != NULL)
+		return res;
+
+	ir_node *const block = vl->check_block;
+	ir_node *const i0    = get_Phi_pred(vl->iv, vl->entry_idx);
+	if (node == vl->iv) {
+		res = i0;
+	} else if (node == vl->iv_next) {
+		res = new_r_Add(block, i0, get_Add_right(node));
+	} else {
+		res = exact_copy(node);
+		set_nodes_block(res, block);
+		foreach_irn_in(node, i, op) {
+			set_irn_n(res, i, get_entry_value(vl, op));
+		}
+	}
+	ir_nodehashmap_insert(&vl->entry_map, node, res);
+	return res;
+}
+
+/**
+ * Creates the check whether the accesses @p a and @p b are at least a vector
+ * apart or at the same address.
+ */
+static ir_node *create_alias_check(vloop_t *const vl, ir_node const *const a,
+                                   ir_node const *const b)
+{
+	ir_node  *const block  = vl->check_block;
+	ir_graph *const irg    = get_irn_irg(block);
+	ir_node  *const ptr_a  = get_entry_value(vl, get_memop_ptr_(a));
+	ir_node  *const ptr_b  = get_entry_value(vl, get_memop_ptr_(b));
+	ir_node  *const diff   = new_r_Sub(block, ptr_a, ptr_b);
+	ir_mode  *const mode   = get_irn_mode(diff);
+	ir_mode  *const umode  = find_unsigned_mode(mode);
+	long      const width  = (long)(vl->vf * vl->elem_size);
+	ir_node  *const zero   = new_r_Const_null(irg, mode);
+	ir_node  *const same   = new_r_Cmp(block, diff, zero, ir_relation_equal);
+	/* diff + width - 1 >= 2 * width - 1 (unsigned) iff |diff| >= width */
+	ir_node  *const bias   = new_r_Const_long(irg, mode, width - 1);
+	ir_node  *const biased = new_r_Conv(block, new_r_Add(block, diff, bias),
+	                                    umode);
+	ir_node  *const limit  = new_r_Const_long(irg, umode, 2 * width - 1);
+	ir_node  *const apart  = new_r_Cmp(block, biased, limit,
+	                                   ir_relation_greater_equal);
+	return new_r_Or(block, same, apart);
+}
+
+/** Returns a vector holding @p node in all lanes. */
+static ir_node *get_splat(vloop_t *const vl, ir_node *const node)
+{
+	ir_node *res = ir_nodehashmap_get(ir_node, &vl->splats, node);
+	if (res != NULL)
+		return res;
+
+	/* Store the value into each element of a frame array and load it as a
+	 * whole. This happens once before the vector loop. */
+	ir_node  *const block  = vl->pre_block;
+	ir_graph *const irg    = get_irn_irg(block);
+	ir_mode  *const mode   = get_irn_mode(node);
+	ir_type  *const type   = get_type_for_mode(mode);
+	ir_type  *const array  = new_type_array(type, vl->vf);
+	ir_entity *const ent   = new_entity(get_irg_frame_type(irg),
+	                                    id_unique("vsplat"), array);
+	ir_node  *const base   = new_r_Member(block, get_irg_frame(irg), ent);
+	ir_mode  *const offset_mode = get_reference_offset_mode(get_irn_mode(base));
+	ir_node        *mem    = vl->pre_mem;
+	for (unsigned i = 0; i < vl->vf; ++i) {
+		ir_node *const offset = new_r_Const_long(irg, offset_mode,
+		                                         i * vl->elem_size);
+		ir_node *const ptr    = new_r_Add(block, base, offset);
+		ir_node *const store  = new_r_Store(block, mem, ptr, node, type,
+		                                    cons_none);
+		mem = new_r_Proj(store, mode_M, pn_Store_M);
+	}
+	ir_mode *const vmode = get_lane_vector_mode(vl, mode);
+	ir_node *const load  = new_r_Load(block, mem, base, vmode,
+	                                  get_type_for_mode(vmode), cons_unaligned);
+	vl->pre_mem = new_r_Proj(load, mode_M, pn_Load_M);
+	res = new_r_Proj(load, vmode, pn_Load_res);
+	ir_nodehashmap_insert(&vl->splats, node, res);
+	return res;
+}
+
+static ir_node *get_vector_node(vloop_t *vl, ir_node *node);
+
+static ir_node *get_vector_operand(vloop_t *const vl, ir_node *const node)
+{
+	if (is_invariant(vl, node))
+		return get_splat(vl, node);
+	return get_vector_node(vl, node);
+}
+
+/** Creates the node of the vector loop body corresponding to @p node. */
+static ir_node *get_vector_node_(vloop_t *const vl, ir_node *const node)
+{
+	ir_node  *const block = vl->vbody;
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	if (node == vl->iv)
+		return vl->vi;
+	if (node == vl->mem_phi)
+		return vl->vmem;
+	if (node == vl->iv_next)
+		return new_rd_Add(dbgi, block, vl->vi, get_Add_right(node));
+
+	switch (get_irn_opcode(node)) {
+	case iro_Load: {
+		ir_node *const mem   = get_vector_node(vl, get_Load_mem(node));
+		ir_node *const ptr   = get_vector_node(vl, get_Load_ptr(node));
+		ir_mode *const vmode = get_lane_vector_mode(vl, get_Load_mode(node));
+		return new_rd_Load(dbgi, block, mem, ptr, vmode,
+		                   get_type_for_mode(vmode), cons_unaligned);
+	}
+
+	case iro_Store: {
+		ir_node *const mem   = get_vector_node(vl, get_Store_mem(node));
+		ir_node *const ptr   = get_vector_node(vl, get_Store_ptr(node));
+		ir_node *const value = get_vector_operand(vl, get_Store_value(node));
+		return new_rd_Store(dbgi, block, mem, ptr, value,
+		                    get_type_for_mode(get_irn_mode(value)),
+		                    cons_unaligned);
+	}
+
+	case iro_Proj: {
+		ir_node *const pred     = get_Proj_pred(node);
+		ir_node *const new_pred = get_vector_node(vl, pred);
+		ir_mode       *mode     = get_irn_mode(node);
+		if (mode != mode_M)
+			mode = get_Load_mode(new_pred);
+		return new_r_Proj(new_pred, mode, get_Proj_num(node));
+	}
+
+	case iro_Sync: {
+		int       const arity = get_Sync_n_preds(node);
+		ir_node **const in    = ALLOCAN(ir_node*, arity);
+		for (int i = 0; i < arity; ++i)
+			in[i] = get_vector_node(vl, get_Sync_pred(node, i));
+		return new_r_Sync(block, arity, in);
+	}
+
+	default:
+		break;
+	}
+
+	if (classify(vl, node) == CLS_VECTOR) {
+		ir_node *const l = get_vector_operand(vl, get_binop_left(node));
+		ir_node *const r = get_vector_operand(vl, get_binop_right(node));
+		switch (get_irn_opcode(node)) {
+		case iro_Add: return new_rd_Add(dbgi, block, l, r);
+		case iro_Sub: return new_rd_Sub(dbgi, block, l, r);
+		case iro_Mul: return new_rd_Mul(dbgi, block, l, r);
+		case iro_And: return new_rd_And(dbgi, block, l, r);
+		case iro_Or:  return new_rd_Or(dbgi, block, l, r);
+		case iro_Eor: return new_rd_Eor(dbgi, block, l, r);
+		default:      panic("cannot vectorize %+F", node);
+		}
+	}
+
+	/* scalar address arithmetic is evaluated for the first lane */
+	ir_node *const copy = exact_copy(node);
+	set_nodes_block(copy, block);
+	foreach_irn_in(node, i, op) {
+		set_irn_n(copy, i, get_vector_node(vl, op));
+	}
+	return copy;
+}
+
+static ir_node *get_vector_node(vloop_t *const vl, ir_node *const node)
+{
+	if (is_invariant(vl, node))
+		return node;
+	ir_node *res = ir_nodehashmap_get(ir_node, &vl->map, node);
+	if (res == NULL) {
+		res = get_vector_node_(vl, node);
+		ir_nodehashmap_insert(&vl->map, node, res);
+	}
+	return res;
+}
+
+/** Creates the runtime checks, the vector loop and the join block. */
+static void vectorize_loop(vloop_t *const vl)
+{
+	ir_node  *const header    = vl->header;
+	ir_graph *const irg       = get_irn_irg(header);
+	ir_node  *const entry     = get_Block_cfgpred(header, vl->entry_idx);
+	ir_node  *const i0        = get_Phi_pred(vl->iv, vl->entry_idx);
+	ir_node  *const mem0      = get_Phi_pred(vl->mem_phi, vl->entry_idx);
+	ir_node  *const bound     = vl->bound;
+	ir_mode  *const iv_mode   = get_irn_mode(vl->iv);
+	int       const opt       = get_optimize();
+	set_optimize(0);
+
+	/* check block: bound - VF must not overflow and the accesses must not
+	 * overlap. The vector loop runs while i <= bound - VF, so neither
+	 * i + VF nor the last lane can exceed the bound. */
+	ir_node *const check = new_r_Block(irg, 1, &entry);
+	vl->check_block = check;
+	ir_node *const vstep  = new_r_Const_long(irg, iv_mode, vl->vf);
+	ir_node *const vbound = new_r_Sub(check, bound, vstep);
+	ir_node *ok = new_r_Cmp(check, vbound, bound, ir_relation_less);
+	for (size_t i = 0, n = ARR_LEN(vl->memops); i < n; ++i) {
+		ir_node *const a = vl->memops[i];
+		if (!is_Store(a))
+			continue;
+		for (size_t j = 0; j < n; ++j) {
+			ir_node *const b = vl->memops[j];
+			if (a == b || (is_Store(b) && j < i))
+				continue;
+			if (get_dependence(vl, a, b) == DEP_RUNTIME)
+				ok = new_r_And(check, ok, create_alias_check(vl, a, b));
+		}
+	}
+	ir_node *const check_cond  = new_r_Cond(check, ok);
+	ir_node *const check_true  = new_r_Proj(check_cond, mode_X, pn_Cond_true);
+	ir_node *const check_false = new_r_Proj(check_cond, mode_X, pn_Cond_false);
+
+	/* vector loop */
+	ir_node *const bad_x = new_r_Bad(irg, mode_X);
+	vl->pre_block = new_r_Block(irg, 1, &check_true);
+	vl->pre_mem   = mem0;
+	ir_node *const pre_jmp = new_r_Jmp(vl->pre_block);
+	ir_node *const vheader_in[] = { pre_jmp, bad_x };
+	ir_node *const vheader = new_r_Block(irg, ARRAY_SIZE(vheader_in), vheader_in);
+	ir_node *const vi_in[] = { i0, new_r_Bad(irg, iv_mode) };
+	vl->vi = new_r_Phi(vheader, ARRAY_SIZE(vi_in), vi_in, iv_mode);
+	ir_node *const vmem_in[] = { mem0, new_r_Bad(irg, mode_M) };
+	vl->vmem = new_r_Phi(vheader, ARRAY_SIZE(vmem_in), vmem_in, mode_M);
+	ir_node *const vcmp  = new_r_Cmp(vheader, vl->vi, vbound,
+	                                 ir_relation_less_equal);
+	ir_node *const vcond = new_r_Cond(vheader, vcmp);
+	ir_node *const vtrue = new_r_Proj(vcond, mode_X, pn_Cond_true);
+	ir_node *const vexit = new_r_Proj(vcond, mode_X, pn_Cond_false);
+	vl->vbody = new_r_Block(irg, 1, &vtrue);
+
+	ir_node *const back_mem = get_Phi_pred(vl->mem_phi, vl->back_idx);
+	ir_node *const vback_mem = get_vector_node(vl, back_mem);
+	ir_node *const vi_next  = new_r_Add(vl->vbody, vl->vi, vstep);
+	set_irn_n(vheader, 1, new_r_Jmp(vl->vbody));
+	set_Phi_pred(vl->vi, 1, vi_next);
+	set_Phi_pred(vl->vmem, 0, vl->pre_mem);
+	set_Phi_pred(vl->vmem, 1, vback_mem);
+
+	/* join block: continue with the scalar loop */
+	ir_node *const join_in[] = { check_false, vexit };
+	ir_node *const join      = new_r_Block(irg, ARRAY_SIZE(join_in), join_in);
+	ir_node *const iv_in[]   = { i0, vl->vi };
+	ir_node *const join_iv   = new_r_Phi(join, ARRAY_SIZE(iv_in), iv_in,
+	                                     iv_mode);
+	ir_node *const mem_in[]  = { mem0, vl->vmem };
+	ir_node *const join_mem  = new_r_Phi(join, ARRAY_SIZE(mem_in), mem_in,
+	                                     mode_M);
+	set_irn_n(header, vl->entry_idx, new_r_Jmp(join));
+	set_Phi_pred(vl->iv, vl->entry_idx, join_iv);
+	set_Phi_pred(vl->mem_phi, vl->entry_idx, join_mem);
+
+	set_optimize(opt);
+}
+
+static void try_vectorize_loop(ir_loop *const loop, bool *const changed)
+{
+	if (get_loop_n_elements(loop) != 2)
+		return;
+	loop_element const e0 = get_loop_element(loop, 0);
+	loop_element const e1 = get_loop_element(loop, 1);
+	if (*e0.kind != k_ir_node || *e1.kind != k_ir_node)
+		return;
+
+	vloop_t vl;
+	memset(&vl, 0, sizeof(vl));
+	/* the header is the block with a predecessor outside of the loop */
+	ir_node *const b0 = e0.node;
+	ir_node *const b1 = e1.node;
+	bool b0_is_header = false;
+	for (int i = 0, n = get_Block_n_cfgpreds(b0); i < n; ++i) {
+		ir_node *const pred = get_Block_cfgpred_block(b0, i);
+		if (pred != b1)
+			b0_is_header = true;
+	}
+	vl.header = b0_is_header ? b0 : b1;
+	vl.body   = b0_is_header ? b1 : b0;
+	vl.memops = NEW_ARR_F(ir_node*, 0);
+	ir_nodehashmap_init(&vl.classes);
+
+	DB((dbg, LEVEL_2, "inspect %+F with header %+F\n", loop, vl.header));
+	bool ok = analyze_header(&vl) && analyze_body(&vl);
+	for (size_t i = 0, n = ARR_LEN(vl.memops); ok && i < n; ++i) {
+		for (size_t j = i + 1; j < n; ++j) {
+			ir_node *const a = vl.memops[i];
+			ir_node *const b = vl.memops[j];
+			if ((is_Store(a) || is_Store(b))
+			 && get_dependence(&vl, a, b) == DEP_BAD) {
+				DB((dbg, LEVEL_2, "\t%+F and %+F overlap\n", a, b));
+				ok = false;
+				break;
+			}
+		}
+	}
+
+	if (ok) {
+		DB((dbg, LEVEL_1, "vectorize %+F by %u\n", loop, vl.vf));
+		ir_nodehashmap_init(&vl.map);
+		ir_nodehashmap_init(&vl.splats);
+		ir_nodehashmap_init(&vl.entry_map);
+		vectorize_loop(&vl);
+		ir_nodehashmap_destroy(&vl.entry_map);
+		ir_nodehashmap_destroy(&vl.splats);
+		ir_nodehashmap_destroy(&vl.map);
+		*changed = true;
+	}
+	ir_nodehashmap_destroy(&vl.classes);
+	DEL_ARR_F(vl.memops);
+}
+
+static void collect_innermost_loops(ir_loop *const loop, ir_loop ***const loops)
+{
+	bool innermost = true;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			collect_innermost_loops(element.son, loops);
+			innermost = false;
+		}
+	}
+	if (innermost && get_loop_depth(loop) > 0)
+		ARR_APP1(ir_loop*, *loops, loop);
+}
+
+void opt_vectorize_loops(ir_graph *const irg)
+{
+	if (ir_target.vector_size == 0)
+		return;
+
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop-vectorize");
+	assure_lcssa(irg);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **loops = NEW_ARR_F(ir_loop*, 0);
+	collect_innermost_loops(get_irg_loop(irg), &loops);
+	bool changed = false;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		/* Vectorizing a loop only adds blocks in front of its header, so the
+		 * outs of the other loops stay valid. */
+		try_vectorize_loop(loops[i], &changed);
+	}
+	DEL_ARR_F(loops);
+
+	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_NONE
+	                                    : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -30,6 +30,7 @@
 #include "iropt_t.h"
 #include "iroptimize.h"
 #include "irouts_t.h"
+#include "irprofile_t.h"
 #include "irprog_t.h"
 #include "irtools.h"
 #include "list.h"
@@ -39,6 +40,7 @@
 #include "xmalloc.h"
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
@@ -623,6 +625,17 @@ static bool inline_method(ir_node *const call, ir_graph *called_graph)
 
 static struct obstack  temp_obst;
 
+/** Calls executed less often than the hottest call divided by this are cold. */
+#define PROFILE_COLD_RATIO     1000
+/**
+ * Growth of the program in percent allowed for inlining hot calls. Small
+ * programs may grow by the maximal graph size instead.
+ */
+#define PROFILE_GROWTH_PERCENT 30
+
+/** Remaining number of nodes hot calls may add to the program. */
+static long profile_budget;
+
 /** Represents a possible inlinable call in a graph. */
 typedef struct call_entry {
 	ir_node    *call;       /**< The Call node. */
@@ -631,6 +644,9 @@ typedef struct call_entry {
 	int        loop_depth;  /**< The loop depth of this call. */
 	int        benefice;    /**< The calculated benefice of this call. */
 	bool       all_const:1; /**< Set if this call has only constant parameters. */
+	bool       profiled:1;  /**< Set if count is known from a profile. */
+	bool       hot:1;       /**< Set if the growth budget was assigned to this call. */
+	double     count;       /**< The profiled execution count of this call. */
 } call_entry;
 
 /**
@@ -648,6 +664,8 @@ typedef struct {
 	unsigned  n_callers_orig;    /**< for statistics */
 	unsigned  got_inline:1;      /**< Set, if at least one call inside this graph was inlined. */
 	unsigned  recursive:1;       /**< Set, if this function is self recursive. */
+	unsigned  profiled:1;        /**< Set, if entry_count is known from a profile. */
+	uint64_t  entry_count;       /**< Profiled number of invocations. */
 } inline_irg_env;
 
 /**
@@ -667,6 +685,8 @@ static inline_irg_env *alloc_inline_irg_env(void)
 	env->n_callers_orig    = 0;
 	env->got_inline        = 0;
 	env->recursive         = 0;
+	env->profiled          = 0;
+	env->entry_count       = 0;
 	return env;
 }
 
@@ -749,6 +769,12 @@ static void collect_calls2(ir_node *node, void *ctx)
 		entry->benefice   = 0;
 		entry->all_const  = false;
 
+		ir_node *const block = get_nodes_block(node);
+		entry->profiled = ir_profile_has_block_execcount(block);
+		entry->hot      = false;
+		entry->count    = entry->profiled
+		                ? ir_profile_get_block_execcount(block) : 0;
+
 		list_add_tail(&entry->list, &x->calls);
 	}
 }
@@ -770,6 +796,9 @@ static call_entry *duplicate_call_entry(const call_entry *entry,
 	nentry->benefice   = entry->benefice;
 	nentry->loop_depth = entry->loop_depth + loop_depth_delta;
 	nentry->all_const  = entry->all_const;
+	nentry->profiled   = entry->profiled;
+	nentry->hot        = entry->hot;
+	nentry->count      = entry->count;
 
 	return nentry;
 }
@@ -1011,6 +1040,75 @@ static ir_graph **create_irg_list(void)
 	return env.irgs;
 }
 
+/**
+ * Sets the count of a call copied from @p callee_env by inlining
+ * @p inlined_call: It is executed as often per execution of the inlined call
+ * as per invocation of the callee.
+ */
+static void scale_call_count(call_entry *const entry,
+                             call_entry const *const inlined_call,
+                             inline_irg_env const *const callee_env)
+{
+	if (!entry->profiled || !inlined_call->profiled || !callee_env->profiled
+	    || callee_env->entry_count == 0) {
+		entry->profiled = false;
+		entry->hot      = false;
+		return;
+	}
+	entry->count = entry->count * inlined_call->count
+	             / callee_env->entry_count;
+	if (entry->count == 0)
+		entry->hot = false;
+}
+
+static int cmp_call_count(void const *const a, void const *const b)
+{
+	call_entry const *const ca = *(call_entry const *const*)a;
+	call_entry const *const cb = *(call_entry const *const*)b;
+	return ca->count < cb->count ? 1 : ca->count > cb->count ? -1 : 0;
+}
+
+/**
+ * Assigns the growth budget to the profiled calls, the hottest first. Calls
+ * with a count below the hottest count divided by PROFILE_COLD_RATIO are
+ * cold and get nothing.
+ */
+static void assign_profile_budget(ir_graph **const irgs, size_t const n_irgs,
+                                  unsigned const maxsize)
+{
+	call_entry **calls   = NEW_ARR_F(call_entry*, 0);
+	long         n_nodes = 0;
+	for (size_t i = 0; i < n_irgs; ++i) {
+		inline_irg_env *env = (inline_irg_env*)get_irg_link(irgs[i]);
+		n_nodes += env->n_nodes;
+		list_for_each_entry(call_entry, entry, &env->calls, list) {
+			if (entry->profiled)
+				ARR_APP1(call_entry*, calls, entry);
+		}
+	}
+
+	profile_budget = MAX(n_nodes * PROFILE_GROWTH_PERCENT / 100, (long)maxsize);
+	size_t const n_calls = ARR_LEN(calls);
+	if (n_calls > 0) {
+		QSORT_ARR(calls, cmp_call_count);
+		double const cold  = calls[0]->count / PROFILE_COLD_RATIO;
+		long         spent = 0;
+		for (size_t i = 0; i < n_calls; ++i) {
+			call_entry *const entry = calls[i];
+			if (entry->count == 0 || entry->count < cold)
+				break;
+			inline_irg_env const *const callee_env
+				= (inline_irg_env const*)get_irg_link(entry->callee);
+			if (spent + (long)callee_env->n_nodes > profile_budget)
+				continue;
+			spent     += callee_env->n_nodes;
+			entry->hot = true;
+			DB((dbg, LEVEL_2, "%+F is hot (%.0f)\n", entry->call, entry->count));
+		}
+	}
+	DEL_ARR_F(calls);
+}
+
 /**
  * Push a call onto the priority list if its benefice is big enough.
  *
@@ -1045,6 +1143,18 @@ static void maybe_push_call(pqueue_t *pqueue, call_entry *call,
 	DB((dbg, LEVEL_2, "In %+F Call %+F to %+F has benefice %d\n",
 	    get_irn_irg(call->call), call->call, callee, benefice));
 
+	/* With a profile, only the calls which got a share of the growth budget
+	 * are inlined, the hottest first. */
+	if (call->profiled && !(callee_props & mtp_property_always_inline)) {
+		if (!call->hot || benefice == INT_MIN) {
+			DB((dbg, LEVEL_2, "In %+F Call %+F to %+F is not hot\n",
+			    caller, call->call, callee));
+			return;
+		}
+		pqueue_put(pqueue, call, (int)(log2(call->count + 1.0) * 1024));
+		return;
+	}
+
 	if (!(callee_props & mtp_property_always_inline) && benefice < inline_threshold) {
 		return;
 	}
@@ -1101,6 +1211,13 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			    env->n_nodes, callee, callee_env->n_nodes));
 			continue;
 		}
+		bool const spend_budget
+			= curr_call->hot && !(props & mtp_property_always_inline);
+		if (spend_budget && callee_env->n_nodes > profile_budget) {
+			DB((dbg, LEVEL_2, "%+F: budget exhausted for %+F (%d)\n", irg,
+			    callee, callee_env->n_nodes));
+			continue;
+		}
 
 		ir_graph *calleee = pmap_get(ir_graph, copied_graphs, callee);
 		if (calleee != NULL) {
@@ -1194,6 +1311,8 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 		/* callee was inline. Append its call list. */
 		env->got_inline = 1;
 		--env->n_call_nodes;
+		if (spend_budget)
+			profile_budget -= callee_env->n_nodes;
 
 		/* we just generate a bunch of new calls */
 		int loop_depth = curr_call->loop_depth;
@@ -1219,6 +1338,7 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 
 			call_entry *new_entry
 				= duplicate_call_entry(centry, new_call, loop_depth);
+			scale_call_count(new_entry, curr_call, callee_env);
 			list_add_tail(&new_entry->list, &env->calls);
 			maybe_push_call(pqueue, new_entry, inline_threshold);
 		}
@@ -1263,7 +1383,13 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 		wenv.x = (inline_irg_env*)get_irg_link(irg);
 		assure_loopinfo(irg);
 		irg_walk_graph(irg, NULL, collect_calls2, &wenv);
+
+		ir_node *start_block = get_irg_start_block(irg);
+		wenv.x->profiled    = ir_profile_has_block_execcount(start_block);
+		wenv.x->entry_count = wenv.x->profiled
+		                    ? ir_profile_get_block_execcount(start_block) : 0;
 	}
+	assign_profile_budget(irgs, n_irgs, maxsize);
 
 	/* -- and now inline. -- */
 	for (size_t i = 0; i < n_irgs; ++i) {
@@ -0,0 +1,284 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Splitting of entry guards for partial inlining.
+ *
+ * A function whose start block ends in a cheap test without side effects,
+ * where one branch is a small early exit and the other one a large body,
+ *
+ *   f(x)   { if (guard(x)) return fast(x); body }
+ *
+ * is split into the guard and a copy of the whole function:
+ *
+ *   f(x)   { if (guard(x)) return fast(x); return f.N(x); }
+ *   f.N(x) { body }
+ *
+ * The copy is never inlined, but the remainder of f is small enough for the
+ * inliner, so callers execute the guard and the early exit without a call.
+ * As the guard has no side effects and its outcome is known in the copy, the
+ * copy skips the test and starts with the body.
+ */
+#include "array.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "ircons.h"
+#include "irgmod.h"
+#include "irgopt.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irouts_t.h"
+#include "irprog_t.h"
+#include "proc_cloning_t.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/**
+ * Returns the Cond node ending the start block of @p irg if the start block
+ * is free of side effects, NULL otherwise.
+ */
+static ir_node *find_entry_guard(ir_graph *irg)
+{
+	assure_irg_outs(irg);
+
+	ir_node *const start_block = get_irg_start_block(irg);
+	ir_node *const args        = get_irg_args(irg);
+	ir_node *const initial_mem = get_irg_initial_mem(irg);
+	ir_node       *cond        = NULL;
+	foreach_irn_out_r(start_block, i, node) {
+		if (is_Block(node) || get_nodes_block(node) != start_block)
+			continue;
+
+		ir_mode *const mode = get_irn_mode(node);
+		if (is_Cond(node)) {
+			cond = node;
+		} else if (mode == mode_X) {
+			if (!is_Proj(node) || !is_Cond(get_Proj_pred(node)))
+				return NULL;
+		} else if (mode == mode_M) {
+			if (node != initial_mem)
+				return NULL;
+		} else if (mode == mode_T) {
+			if (!is_Start(node) && node != args)
+				return NULL;
+		}
+	}
+	return cond;
+}
+
+/**
+ * Post-walker: Counts the nodes of a graph.
+ */
+static void count_node(ir_node *node, void *env)
+{
+	unsigned *const n_nodes = (unsigned*)env;
+	++*n_nodes;
+}
+
+/**
+ * Post-walker: Counts the nodes in blocks marked by the last block walk.
+ * Constants are not counted, as they are placed in the start block.
+ */
+static void count_marked_node(ir_node *node, void *env)
+{
+	unsigned *const n_nodes = (unsigned*)env;
+	if (is_Block(node) || is_End(node) || is_irn_constlike(node))
+		return;
+	if (Block_block_visited(get_nodes_block(node)))
+		++*n_nodes;
+}
+
+/**
+ * Returns the number of nodes of the start block and all blocks reachable
+ * from the guard projection @p proj.
+ */
+static unsigned get_branch_size(ir_node *proj)
+{
+	ir_graph *const irg = get_irn_irg(proj);
+	irg_out_block_walk(proj, NULL, NULL, NULL);
+	mark_Block_block_visited(get_irg_start_block(irg));
+
+	unsigned n_nodes = 0;
+	irg_walk_graph(irg, NULL, count_marked_node, &n_nodes);
+	return n_nodes;
+}
+
+static ir_node *get_guard_proj(ir_node *cond, unsigned pn)
+{
+	foreach_irn_out_r(cond, i, proj) {
+		if (get_Proj_num(proj) == pn)
+			return proj;
+	}
+	return NULL;
+}
+
+/**
+ * Removes the test of the guard from the graph @p irg and continues with the
+ * branch @p pn.
+ */
+static void take_guard_branch(ir_graph *irg, unsigned pn)
+{
+	ir_node *const cond = find_entry_guard(irg);
+	ir_node *const taken = get_guard_proj(cond, pn);
+	ir_node *const other = get_guard_proj(cond, pn == pn_Cond_true ? pn_Cond_false : pn_Cond_true);
+	exchange(taken, new_r_Jmp(get_nodes_block(cond)));
+	if (other != NULL)
+		exchange(other, new_r_Bad(irg, mode_X));
+
+	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
+	remove_unreachable_code(irg);
+	remove_bads(irg);
+}
+
+/**
+ * Replaces the branch @p pn of the guard @p cond by a call of @p outlined,
+ * passing the arguments of the graph.
+ */
+static void call_outlined(ir_node *cond, unsigned pn, ir_entity *outlined)
+{
+	ir_graph *const irg  = get_irn_irg(cond);
+	ir_node  *const proj = get_guard_proj(cond, pn);
+
+	/* detach the old branch, it becomes unreachable */
+	int            pos;
+	ir_node *const succ = get_irn_out_ex(proj, 0, &pos);
+	set_Block_cfgpred(succ, pos, new_r_Bad(irg, mode_X));
+
+	ir_type  *const mtp      = get_entity_type(outlined);
+	size_t    const n_params = get_method_n_params(mtp);
+	size_t    const n_ress   = get_method_n_ress(mtp);
+	ir_node **const in       = ALLOCAN(ir_node*, n_params);
+	ir_node  *const args     = get_irg_args(irg);
+	for (size_t i = 0; i < n_params; ++i) {
+		ir_mode *const mode = get_type_mode(get_method_param_type(mtp, i));
+		in[i] = new_r_Proj(args, mode, i);
+	}
+
+	ir_node *const block   = new_r_Block(irg, 1, &proj);
+	ir_node *const mem     = get_irg_initial_mem(irg);
+	ir_node *const callee  = new_r_Address(irg, outlined);
+	ir_node *const call    = new_r_Call(block, mem, callee, n_params, in, mtp);
+	ir_node *const res_mem = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node *const results = new_r_Proj(call, mode_T, pn_Call_T_result);
+
+	ir_node **const res = ALLOCAN(ir_node*, n_ress);
+	for (size_t i = 0; i < n_ress; ++i) {
+		ir_mode *const mode = get_type_mode(get_method_res_type(mtp, i));
+		res[i] = new_r_Proj(results, mode, i);
+	}
+	ir_node *const ret = new_r_Return(block, res_mem, n_ress, res);
+
+	ir_node  *const end_block = get_irg_end_block(irg);
+	int       const arity     = get_Block_n_cfgpreds(end_block);
+	ir_node **const end_in    = ALLOCAN(ir_node*, arity + 1);
+	for (int i = 0; i < arity; ++i)
+		end_in[i] = get_Block_cfgpred(end_block, i);
+	end_in[arity] = ret;
+	set_irn_in(end_block, arity + 1, end_in);
+
+	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
+	remove_unreachable_code(irg);
+	remove_bads(irg);
+}
+
+/**
+ * Checks whether the parameters and results of the method type @p mtp can be
+ * passed on to the outlined copy.
+ */
+static bool is_splittable_type(ir_type *mtp)
+{
+	if (is_method_variadic(mtp))
+		return false;
+	for (size_t i = 0, n = get_method_n_params(mtp); i < n; ++i) {
+		if (get_type_mode(get_method_param_type(mtp, i)) == NULL)
+			return false;
+	}
+	for (size_t i = 0, n = get_method_n_ress(mtp); i < n; ++i) {
+		if (get_type_mode(get_method_res_type(mtp, i)) == NULL)
+			return false;
+	}
+	return true;
+}
+
+static void split_irg(ir_graph *irg, unsigned min_size,
+                      unsigned max_guard_size)
+{
+	ir_entity *const ent = get_irg_entity(irg);
+	mtp_additional_properties const props
+		= get_entity_additional_properties(ent);
+	if (props & (mtp_property_noinline | mtp_property_always_inline))
+		return;
+	if (!is_splittable_type(get_entity_type(ent)))
+		return;
+
+	ir_node *const cond = find_entry_guard(irg);
+	if (cond == NULL)
+		return;
+
+	unsigned n_nodes = 0;
+	irg_walk_graph(irg, NULL, count_node, &n_nodes);
+	if (n_nodes <= min_size)
+		return;
+
+	ir_node *const proj_true  = get_guard_proj(cond, pn_Cond_true);
+	ir_node *const proj_false = get_guard_proj(cond, pn_Cond_false);
+	if (proj_true == NULL || proj_false == NULL)
+		return;
+	unsigned const size_true  = get_branch_size(proj_true);
+	unsigned const size_false = get_branch_size(proj_false);
+	unsigned const fast_pn    = size_true <= size_false ? pn_Cond_true : pn_Cond_false;
+	unsigned const fast_size  = MIN(size_true, size_false);
+	if (fast_size > max_guard_size)
+		return;
+
+	ir_entity *const outlined = duplicate_method(ent);
+	add_entity_additional_properties(outlined, mtp_property_noinline);
+	unsigned const cold_pn = fast_pn == pn_Cond_true ? pn_Cond_false : pn_Cond_true;
+	take_guard_branch(get_entity_irg(outlined), cold_pn);
+	call_outlined(cond, cold_pn, outlined);
+
+	DB((dbg, LEVEL_1, "split guard of %+F (%u of %u nodes) into %+F\n",
+	    irg, fast_size, n_nodes, outlined));
+}
+
+/**
+ * Walker: Marks the entities of directly called methods.
+ */
+static void mark_callees(ir_node *node, void *env)
+{
+	(void)env;
+	if (!is_Call(node))
+		return;
+	ir_entity *const callee = get_Call_callee(node);
+	if (callee != NULL)
+		set_entity_link(callee, callee);
+}
+
+void split_entry_guards(unsigned min_size, unsigned max_guard_size)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.partial_inline");
+
+	/* only functions with direct calls profit from splitting */
+	irp_reserve_resources(irp, IRP_RESOURCE_ENTITY_LINK);
+	foreach_irp_irg(i, irg) {
+		set_entity_link(get_irg_entity(irg), NULL);
+	}
+	all_irg_walk(mark_callees, NULL, NULL);
+	ir_graph **irgs = NEW_ARR_F(ir_graph*, 0);
+	foreach_irp_irg(i, irg) {
+		if (get_entity_link(get_irg_entity(irg)) != NULL)
+			ARR_APP1(ir_graph*, irgs, irg);
+	}
+	irp_free_resources(irp, IRP_RESOURCE_ENTITY_LINK);
+
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i)
+		split_irg(irgs[i], min_size, max_guard_size);
+	DEL_ARR_F(irgs);
+}
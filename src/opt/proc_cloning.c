@@ -30,6 +30,7 @@
 #include "irprog_t.h"
 #include "irtools.h"
 #include "panic.h"
+#include "proc_cloning_t.h"
 #include "set.h"
 #include "tv.h"
 
@@ -256,7 +257,7 @@ static inline ir_node *get_irn_copy(ir_node *const irn)
 /**
  * Pre-Walker: Copies blocks and nodes from the original method graph
  * to the cloned graph. Fixes the argument projection numbers for
- * all arguments behind the removed one.
+ * all arguments behind the removed one, if any.
  *
  * @param irn  A node from the original method graph.
  * @param env  The clone graph.
@@ -265,13 +266,15 @@ static void copy_nodes(ir_node *irn, void *env)
 {
 	ir_graph *const clone_irg = (ir_graph*)env;
 	ir_node  *const arg       = (ir_node*)get_irg_link(clone_irg);
-	ir_node  *const irg_args  = get_Proj_pred(arg);
 
 	/* Copy all nodes except the arg. */
 	if (irn != arg)
 		copy_irn_to_irg(irn, clone_irg);
+	if (arg == NULL)
+		return;
 
 	/* Fix argument numbers */
+	ir_node *const irg_args = get_Proj_pred(arg);
 	ir_node *const irn_copy = get_irn_copy(irn);
 	if (is_Proj(irn) && get_Proj_pred(irn) == irg_args) {
 		unsigned const proj_nr = get_Proj_num(irn);
@@ -377,7 +380,7 @@ static void clone_frame(ir_graph *const src_irg, ir_graph *const dst_irg, size_t
  * that we want to clone.
  *
  * @param ent The entity of the method that must be cloned.
- * @param q   Our quadruplet.
+ * @param q   Our quadruplet or NULL to copy the graph unchanged.
  */
 static void create_clone_proc_irg(ir_entity *ent, const quadruple_t *q)
 {
@@ -386,14 +389,18 @@ static void create_clone_proc_irg(ir_entity *ent, const quadruple_t *q)
 
 	/* We create the skeleton of the clone irg.*/
 	ir_graph *const clone_irg  = new_ir_graph(ent, 0);
-	clone_frame(method_irg, clone_irg, q->pos);
+	clone_frame(method_irg, clone_irg, q != NULL ? q->pos : (size_t)-1);
 
-	ir_node *const arg        = get_irg_arg(get_entity_irg(q->ent), q->pos);
-	/* we will replace the argument in position "q->pos" by this constant. */
-	ir_node *const const_arg  = new_r_Const(clone_irg, q->tv);
+	ir_node *arg = NULL;
+	if (q != NULL) {
+		arg = get_irg_arg(get_entity_irg(q->ent), q->pos);
+		/* we will replace the argument in position "q->pos" by this
+		 * constant. */
+		ir_node *const const_arg = new_r_Const(clone_irg, q->tv);
 
-	/* args copy in the cloned graph will be the const. */
-	set_irn_link(arg, const_arg);
+		/* args copy in the cloned graph will be the const. */
+		set_irn_link(arg, const_arg);
+	}
 
 	/* Store the arg that will be replaced here, so we can easily detect it. */
 	set_irg_link(clone_irg, arg);
@@ -466,6 +473,18 @@ static ir_entity *clone_method(const quadruple_t *q)
 	return new_entity;
 }
 
+ir_entity *duplicate_method(ir_entity *ent)
+{
+	ident     *const clone_ident = id_unique(get_entity_ident(ent));
+	ir_type   *const owner       = get_entity_owner(ent);
+	ir_entity *const new_entity  = clone_entity(ent, clone_ident, owner);
+
+	set_entity_visibility(new_entity, ir_visibility_local);
+	create_clone_proc_irg(new_entity, NULL);
+
+	return new_entity;
+}
+
 /**
  * Creates a new "cloned" Call node and return it.
  *
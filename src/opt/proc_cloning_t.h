@@ -0,0 +1,21 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Helpers shared by the procedure cloning optimizations.
+ */
+#ifndef FIRM_OPT_PROC_CLONING_T_H
+#define FIRM_OPT_PROC_CLONING_T_H
+
+#include "firm_types.h"
+
+/**
+ * Creates a local method entity of the same type as @p ent together with an
+ * unchanged copy of the graph of @p ent.
+ */
+ir_entity *duplicate_method(ir_entity *ent);
+
+#endif
@@ -0,0 +1,406 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Superword level parallelism: packs isomorphic scalar operations
+ *          into vector operations.
+ *
+ * The pass starts at groups of Stores to adjacent addresses which are
+ * synchronized by the same Sync and follows their values upwards. If the
+ * values of all lanes are computed by the same operations from Loads of
+ * adjacent addresses, the whole expression is replaced by one using a vector
+ * mode.
+ */
+#include "array.h"
+#include "bitfiddle.h"
+#include "debug.h"
+#include "heights.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "irop_t.h"
+#include "iroptimize.h"
+#include "ldstopt_t.h"
+#include "target_t.h"
+#include "util.h"
+#include "vectorize_t.h"
+#include <stdio.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** The maximum number of lanes of a vector. */
+#define MAX_LANES 16
+
+/** The maximum depth of an expression tree that is packed. */
+#define MAX_DEPTH 32
+
+typedef struct slp_env_t {
+	ir_heights_t *heights;
+	ir_node     **syncs;   /**< all Sync nodes of the graph */
+	bool          changed;
+} slp_env_t;
+
+/** A Store synchronized by a Sync and the Sync input it is reached by. */
+typedef struct store_cand_t {
+	ir_node      *store;
+	int           sync_pos;
+	base_offset_t base_offset;
+} store_cand_t;
+
+static int cmp_store_cand(const void *p0, const void *p1)
+{
+	store_cand_t const *const c0 = (store_cand_t const*)p0;
+	store_cand_t const *const c1 = (store_cand_t const*)p1;
+	long const base0 = get_irn_node_nr(c0->base_offset.base);
+	long const base1 = get_irn_node_nr(c1->base_offset.base);
+	if (base0 != base1)
+		return (base0 > base1) - (base0 < base1);
+	long const off0 = c0->base_offset.offset;
+	long const off1 = c1->base_offset.offset;
+	return (off0 > off1) - (off0 < off1);
+}
+
+static bool is_simple_load(ir_node const *const load)
+{
+	return is_Load(load)
+	    && get_Load_volatility(load) == volatility_non_volatile
+	    && !ir_throws_exception(load);
+}
+
+static bool is_simple_store(ir_node const *const store)
+{
+	return is_Store(store)
+	    && get_Store_volatility(store) == volatility_non_volatile
+	    && !ir_throws_exception(store);
+}
+
+ir_mode *get_vector_mode(ir_mode *const mode, unsigned *const n_lanes)
+{
+	if (!mode_is_int(mode) && !mode_is_float(mode))
+		return NULL;
+	unsigned const size = get_mode_size_bytes(mode);
+	if (size == 0 || !is_po2_or_zero(size) || size > ir_target.vector_size / 2)
+		return NULL;
+	unsigned const lanes = ir_target.vector_size / size;
+	if (lanes > MAX_LANES)
+		return NULL;
+
+	char name[32];
+	snprintf(name, sizeof(name), "V%u%s", lanes, get_mode_name(mode));
+	*n_lanes = lanes;
+	return new_vector_mode(name, mode, lanes);
+}
+
+/** Checks whether @p a and @p b may be in the same pack. */
+static bool is_isomorphic(ir_node const *const a, ir_node const *const b)
+{
+	if (get_irn_op(a) != get_irn_op(b) || get_irn_mode(a) != get_irn_mode(b))
+		return false;
+	if (is_Proj(a)) {
+		ir_node *const load_a = get_Proj_pred(a);
+		ir_node *const load_b = get_Proj_pred(b);
+		if (!is_Load(load_a) || !is_Load(load_b))
+			return false;
+		base_offset_t bo_a;
+		base_offset_t bo_b;
+		get_base_and_offset(get_Load_ptr(load_a), &bo_a);
+		get_base_and_offset(get_Load_ptr(load_b), &bo_b);
+		return bo_a.base == bo_b.base;
+	}
+	return true;
+}
+
+/**
+ * Collects the operands of the binops in @p lanes. The operands of
+ * commutative operations are swapped where this makes the lanes isomorphic.
+ */
+static void get_pack_operands(ir_node *const *const lanes, unsigned n_lanes,
+                              ir_node **const left, ir_node **const right)
+{
+	bool const commutative = is_op_commutative(get_irn_op(lanes[0]));
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		ir_node *l = get_binop_left(lanes[i]);
+		ir_node *r = get_binop_right(lanes[i]);
+		if (i > 0 && commutative && !is_isomorphic(l, left[0])
+		 && is_isomorphic(r, left[0])) {
+			ir_node *const t = l;
+			l = r;
+			r = t;
+		}
+		left[i]  = l;
+		right[i] = r;
+	}
+}
+
+bool is_vector_op_supported(ir_node const *const node, ir_mode *const mode)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Add:
+	case iro_Sub:
+		return true;
+	/* SSE2 has no full width integer vector multiplication. */
+	case iro_Mul:
+		return mode_is_float(mode);
+	case iro_And:
+	case iro_Or:
+	case iro_Eor:
+		return mode_is_int(mode);
+	default:
+		return false;
+	}
+}
+
+/**
+ * Checks whether the scalar expressions @p lanes can be replaced by a single
+ * vector expression.
+ */
+static bool can_pack(ir_node *const *const lanes, unsigned const n_lanes,
+                     ir_node *const block, unsigned const depth)
+{
+	if (depth > MAX_DEPTH)
+		return false;
+
+	ir_node *const first = lanes[0];
+	ir_mode *const mode  = get_irn_mode(first);
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		ir_node *const lane = lanes[i];
+		/* The scalar nodes die after packing, so they must not have users
+		 * outside of the pack. */
+		if (!is_isomorphic(lane, first) || get_nodes_block(lane) != block
+		 || get_irn_n_edges(lane) != 1)
+			return false;
+		for (unsigned j = 0; j < i; ++j) {
+			if (lanes[j] == lane)
+				return false;
+		}
+	}
+
+	if (is_Proj(first)) {
+		if (get_Proj_num(first) != pn_Load_res)
+			return false;
+		ir_node *const load0 = get_Proj_pred(first);
+		ir_node *const mem   = get_Load_mem(load0);
+		unsigned const size  = get_mode_size_bytes(mode);
+		base_offset_t  bo0;
+		get_base_and_offset(get_Load_ptr(load0), &bo0);
+		for (unsigned i = 0; i < n_lanes; ++i) {
+			ir_node *const load = get_Proj_pred(lanes[i]);
+			if (!is_simple_load(load) || get_Load_mem(load) != mem)
+				return false;
+			base_offset_t bo;
+			get_base_and_offset(get_Load_ptr(load), &bo);
+			if (bo.base != bo0.base
+			 || bo.offset != bo0.offset + (long)(i * size))
+				return false;
+		}
+		return true;
+	}
+
+	if (!is_vector_op_supported(first, mode))
+		return false;
+	ir_node *left[MAX_LANES];
+	ir_node *right[MAX_LANES];
+	get_pack_operands(lanes, n_lanes, left, right);
+	return can_pack(left, n_lanes, block, depth + 1)
+	    && can_pack(right, n_lanes, block, depth + 1);
+}
+
+/** Builds the vector expression for the scalar expressions @p lanes. */
+static ir_node *build_pack(ir_node *const *const lanes, unsigned const n_lanes,
+                           ir_mode *const vmode)
+{
+	ir_node  *const first = lanes[0];
+	ir_node  *const block = get_nodes_block(first);
+	dbg_info *const dbgi  = get_irn_dbg_info(first);
+
+	if (is_Proj(first)) {
+		ir_node      *const load0 = get_Proj_pred(first);
+		ir_node      *const mem   = get_Load_mem(load0);
+		ir_node      *const ptr   = get_Load_ptr(load0);
+		ir_type      *const type  = get_type_for_mode(vmode);
+		ir_cons_flags       flags = cons_unaligned | cons_floats;
+		for (unsigned i = 0; i < n_lanes; ++i) {
+			if (get_irn_pinned(get_Proj_pred(lanes[i])))
+				flags &= ~cons_floats;
+		}
+		ir_node *const vload = new_rd_Load(get_irn_dbg_info(load0), block, mem,
+		                                   ptr, vmode, type, flags);
+		ir_node *const vmem  = new_r_Proj(vload, mode_M, pn_Load_M);
+		for (unsigned i = 0; i < n_lanes; ++i) {
+			ir_node *const load   = get_Proj_pred(lanes[i]);
+			ir_node *const proj_m = get_Proj_for_pn(load, pn_Load_M);
+			if (proj_m != NULL)
+				exchange(proj_m, vmem);
+		}
+		return new_r_Proj(vload, vmode, pn_Load_res);
+	}
+
+	ir_node *left[MAX_LANES];
+	ir_node *right[MAX_LANES];
+	get_pack_operands(lanes, n_lanes, left, right);
+	ir_node *const l = build_pack(left, n_lanes, vmode);
+	ir_node *const r = build_pack(right, n_lanes, vmode);
+	switch (get_irn_opcode(first)) {
+	case iro_Add: return new_rd_Add(dbgi, block, l, r);
+	case iro_Sub: return new_rd_Sub(dbgi, block, l, r);
+	case iro_Mul: return new_rd_Mul(dbgi, block, l, r);
+	case iro_And: return new_rd_And(dbgi, block, l, r);
+	case iro_Or:  return new_rd_Or(dbgi, block, l, r);
+	case iro_Eor: return new_rd_Eor(dbgi, block, l, r);
+	default:      break;
+	}
+	panic("cannot pack %+F", first);
+}
+
+/**
+ * Tries to replace the Stores @p cands by a single vector Store.
+ */
+static bool pack_stores(slp_env_t *const env, store_cand_t const *const cands,
+                        unsigned const n_lanes, ir_mode *const vmode)
+{
+	ir_node *const store0 = cands[0].store;
+	ir_node *const block  = get_nodes_block(store0);
+	ir_node *const mem    = get_Store_mem(store0);
+	ir_mode *const mode   = get_irn_mode(get_Store_value(store0));
+	unsigned const size   = get_mode_size_bytes(mode);
+
+	ir_node *values[MAX_LANES];
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		ir_node *const store = cands[i].store;
+		ir_node *const value = get_Store_value(store);
+		if (get_nodes_block(store) != block || get_Store_mem(store) != mem
+		 || get_irn_mode(value) != mode
+		 || cands[i].base_offset.base != cands[0].base_offset.base
+		 || cands[i].base_offset.offset
+		    != cands[0].base_offset.offset + (long)(i * size))
+			return false;
+		values[i] = value;
+	}
+
+	if (!can_pack(values, n_lanes, block, 0))
+		return false;
+
+	/* The vector Store depends on the values of all lanes, so none of them may
+	 * depend on one of the Stores. */
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		for (unsigned j = 0; j < n_lanes; ++j) {
+			if (heights_reachable_in_block(env->heights, values[i],
+			                               cands[j].store))
+				return false;
+		}
+	}
+
+	DB((dbg, LEVEL_1, "packing %u Stores starting at %+F\n", n_lanes, store0));
+	ir_node      *const vvalue = build_pack(values, n_lanes, vmode);
+	ir_node      *const ptr    = get_Store_ptr(store0);
+	ir_type      *const type   = get_type_for_mode(vmode);
+	ir_cons_flags       flags  = cons_unaligned | cons_floats;
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		if (get_irn_pinned(cands[i].store))
+			flags &= ~cons_floats;
+	}
+	ir_node *const vstore = new_rd_Store(get_irn_dbg_info(store0), block, mem,
+	                                     ptr, vvalue, type, flags);
+	for (unsigned i = 0; i < n_lanes; ++i)
+		exchange(cands[i].store, vstore);
+
+	heights_recompute_block(env->heights, block);
+	return true;
+}
+
+static void slp_sync(slp_env_t *const env, ir_node *const sync)
+{
+	int const     n_preds = get_Sync_n_preds(sync);
+	store_cand_t *cands   = NEW_ARR_F(store_cand_t, 0);
+	for (int i = 0; i < n_preds; ++i) {
+		ir_node *const store = skip_Proj(get_Sync_pred(sync, i));
+		if (!is_simple_store(store))
+			continue;
+		store_cand_t cand = { .store = store, .sync_pos = i };
+		get_base_and_offset(get_Store_ptr(store), &cand.base_offset);
+		ARR_APP1(store_cand_t, cands, cand);
+	}
+
+	size_t const n_cands = ARR_LEN(cands);
+	QSORT_ARR(cands, cmp_store_cand);
+
+	bool *const removed = ALLOCANZ(bool, n_preds);
+	bool        changed = false;
+	for (size_t i = 0; i < n_cands;) {
+		ir_mode *const mode  = get_irn_mode(get_Store_value(cands[i].store));
+		unsigned       n_lanes;
+		ir_mode *const vmode = get_vector_mode(mode, &n_lanes);
+		if (vmode == NULL || i + n_lanes > n_cands
+		 || !pack_stores(env, &cands[i], n_lanes, vmode)) {
+			++i;
+			continue;
+		}
+
+		/* all lanes are now reached through the Sync input of the first */
+		for (unsigned l = 1; l < n_lanes; ++l)
+			removed[cands[i + l].sync_pos] = true;
+		i      += n_lanes;
+		changed = true;
+	}
+	DEL_ARR_F(cands);
+
+	if (changed) {
+		/* Remove the inputs of the packed Stores and duplicates resulting
+		 * from the memory Projs of packed Loads. */
+		ir_node **const new_in    = ALLOCAN(ir_node*, n_preds);
+		int             new_arity = 0;
+		inc_irg_visited(get_irn_irg(sync));
+		for (int i = 0; i < n_preds; ++i) {
+			ir_node *const in = get_Sync_pred(sync, i);
+			if (!removed[i] && !irn_visited_else_mark(in))
+				new_in[new_arity++] = in;
+		}
+
+		if (new_arity == 1)
+			exchange(sync, new_in[0]);
+		else
+			set_irn_in(sync, new_arity, new_in);
+		env->changed = true;
+	}
+}
+
+static void collect_syncs(ir_node *const node, void *const data)
+{
+	slp_env_t *const env = (slp_env_t*)data;
+	if (is_Sync(node))
+		ARR_APP1(ir_node*, env->syncs, node);
+}
+
+void opt_vectorize_slp(ir_graph *const irg)
+{
+	if (ir_target.vector_size == 0)
+		return;
+
+	FIRM_DBG_REGISTER(dbg, "firm.opt.slp");
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+
+	slp_env_t env = {
+		.heights = heights_new(irg),
+		.syncs   = NEW_ARR_F(ir_node*, 0),
+		.changed = false,
+	};
+	irg_walk_graph(irg, NULL, collect_syncs, &env);
+	for (size_t i = 0, n = ARR_LEN(env.syncs); i < n; ++i) {
+		ir_node *const sync = env.syncs[i];
+		/* an earlier Sync may have been merged into this one */
+		if (is_Sync(sync))
+			slp_sync(&env, sync);
+	}
+	DEL_ARR_F(env.syncs);
+	heights_free(env.heights);
+
+	confirm_irg_properties(irg, env.changed
+		? IR_GRAPH_PROPERTIES_CONTROL_FLOW : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -0,0 +1,29 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Helpers shared by the vectorizers.
+ */
+#ifndef FIRM_OPT_VECTORIZE_T_H
+#define FIRM_OPT_VECTORIZE_T_H
+
+#include <stdbool.h>
+#include "firm_types.h"
+
+/**
+ * Returns the vector mode filling a vector register of the target with values
+ * of @p mode and stores its number of lanes in @p n_lanes. Returns NULL if the
+ * target cannot hold values of @p mode in vectors.
+ */
+ir_mode *get_vector_mode(ir_mode *mode, unsigned *n_lanes);
+
+/**
+ * Checks whether the operation of @p node is available for vectors with lanes
+ * of mode @p mode.
+ */
+bool is_vector_op_supported(ir_node const *node, ir_mode *mode);
+
+#endif
@@ -29,6 +29,10 @@ static char *output_buffer = NULL;  /**< buffer for output */
 static unsigned bit_pattern_size;   /**< maximum number of bits */
 static unsigned calc_buffer_size;   /**< size of internally stored values */
 static unsigned max_value_size;     /**< maximum size of values */
+static bool     word_fast_path;     /**< values have room for 2 machine words */
+
+/** Number of digits forming a 64bit machine word. */
+#define SC_WORD_DIGITS (64 / SC_BITS)
 
 void sc_zero(sc_word *buffer)
 {
@@ -50,6 +54,64 @@ static sc_word min_digit(unsigned x)
 	return SC_MASK - max_digit(x);
 }
 
+static uint64_t load_uint64(const sc_word *val)
+{
+	uint64_t res = 0;
+	for (unsigned i = SC_WORD_DIGITS; i-- > 0; )
+		res = (res << SC_BITS) | val[i];
+	return res;
+}
+
+/**
+ * Check whether @p val is the sign extension of its lowest 64 bits and
+ * store them in @p res if so. Most values seen by the optimizer are small,
+ * so this allows operating on machine words instead of single digits.
+ */
+static bool load_int64(const sc_word *val, int64_t *res)
+{
+	if (!word_fast_path)
+		return false;
+	sc_word const fill = val[SC_WORD_DIGITS-1] >> (SC_BITS-1) ? SC_MASK : 0;
+	for (unsigned i = SC_WORD_DIGITS; i < calc_buffer_size; ++i) {
+		if (val[i] != fill)
+			return false;
+	}
+	*res = (int64_t)load_uint64(val);
+	return true;
+}
+
+/**
+ * Store the 128bit two's complement value high:low into @p buffer and sign
+ * extend it to the full buffer size.
+ */
+static void store_words(uint64_t low, uint64_t high, sc_word *buffer)
+{
+	assert(word_fast_path);
+	for (unsigned i = 0; i < SC_WORD_DIGITS; ++i) {
+		buffer[i]                  = SC_RESULT(low);
+		buffer[i + SC_WORD_DIGITS] = SC_RESULT(high);
+		low  >>= SC_BITS;
+		high >>= SC_BITS;
+	}
+	sc_word const fill = buffer[2*SC_WORD_DIGITS-1] >> (SC_BITS-1) ? SC_MASK : 0;
+	assert(SC_BITS <= CHAR_BIT);
+	memset(&buffer[2*SC_WORD_DIGITS], fill,
+	       calc_buffer_size - 2*SC_WORD_DIGITS);
+}
+
+static void store_int64(int64_t value, sc_word *buffer)
+{
+	store_words((uint64_t)value, value < 0 ? UINT64_MAX : 0, buffer);
+}
+
+/** Arithmetic right shift without relying on implementation defined
+ * behaviour. */
+static int64_t shrs_int64(int64_t value, unsigned shift_count)
+{
+	assert(shift_count < 64);
+	return value < 0 ? ~(~value >> shift_count) : value >> shift_count;
+}
+
 void sc_not(const sc_word *val, sc_word *buffer)
 {
 	for (unsigned counter = 0; counter<calc_buffer_size; counter++)
@@ -106,6 +168,17 @@ void sc_neg(const sc_word *val, sc_word *buffer)
 
 void sc_add(const sc_word *val1, const sc_word *val2, sc_word *buffer)
 {
+	int64_t a;
+	int64_t b;
+	if (load_int64(val1, &a) && load_int64(val2, &b)) {
+		uint64_t const sum   = (uint64_t)a + (uint64_t)b;
+		uint64_t const carry = sum < (uint64_t)a;
+		uint64_t const high  = (a < 0 ? UINT64_MAX : 0)
+		                     + (b < 0 ? UINT64_MAX : 0) + carry;
+		store_words(sum, high, buffer);
+		return;
+	}
+
 	sc_word carry = 0;
 	for (unsigned counter = 0; counter < calc_buffer_size; ++counter) {
 		unsigned const sum = val1[counter] + val2[counter] + carry;
@@ -116,6 +189,17 @@ void sc_add(const sc_word *val1, const sc_word *val2, sc_word *buffer)
 
 void sc_sub(const sc_word *val1, const sc_word *val2, sc_word *buffer)
 {
+	int64_t a;
+	int64_t b;
+	if (load_int64(val1, &a) && load_int64(val2, &b)) {
+		uint64_t const diff   = (uint64_t)a - (uint64_t)b;
+		uint64_t const borrow = (uint64_t)a < (uint64_t)b;
+		uint64_t const high   = (a < 0 ? UINT64_MAX : 0)
+		                      - (b < 0 ? UINT64_MAX : 0) - borrow;
+		store_words(diff, high, buffer);
+		return;
+	}
+
 	/* intermediate buffer to hold -val2 */
 	sc_word *temp_buffer = ALLOCAN(sc_word, calc_buffer_size);
 
@@ -125,6 +209,22 @@ void sc_sub(const sc_word *val1, const sc_word *val2, sc_word *buffer)
 
 void sc_mul(const sc_word *val1, const sc_word *val2, sc_word *buffer)
 {
+	int64_t a;
+	int64_t b;
+	if (load_int64(val1, &a) && load_int64(val2, &b)) {
+#ifdef __SIZEOF_INT128__
+		__int128 const prod = (__int128)a * b;
+		store_words((uint64_t)prod, (uint64_t)(prod >> 64), buffer);
+		return;
+#else
+		if (a >= INT32_MIN && a <= INT32_MAX
+		 && b >= INT32_MIN && b <= INT32_MAX) {
+			store_int64(a * b, buffer);
+			return;
+		}
+#endif
+	}
+
 	sc_word *temp_buffer = ALLOCANZ(sc_word, calc_buffer_size);
 	sc_word *neg_val1    = ALLOCAN(sc_word, calc_buffer_size);
 	sc_word *neg_val2    = ALLOCAN(sc_word, calc_buffer_size);
@@ -214,6 +314,17 @@ bool sc_divmod(const sc_word *dividend, const sc_word *divisor,
 	if (sc_is_zero(dividend, calc_buffer_size*SC_BITS))
 		return false;
 
+	int64_t a;
+	int64_t b;
+	if (load_int64(dividend, &a) && load_int64(divisor, &b)
+	 && (a != INT64_MIN || b != -1)) {
+		/* C division truncates towards zero like the code below */
+		int64_t const r = a % b;
+		store_int64(a / b, quot);
+		store_int64(r, rem);
+		return r != 0;
+	}
+
 	bool     div_sign = false;
 	bool     rem_sign = false;
 	sc_word *neg_val1 = ALLOCAN(sc_word, calc_buffer_size);
@@ -775,6 +886,7 @@ void init_strcalc(unsigned precision)
 		bit_pattern_size = precision;
 		calc_buffer_size = precision / (SC_BITS/2);
 		max_value_size   = precision / SC_BITS;
+		word_fast_path   = calc_buffer_size*SC_BITS >= 128;
 
 		output_buffer = XMALLOCN(char, bit_pattern_size + 1);
 	}
@@ -805,6 +917,15 @@ void sc_mod(const sc_word *value1, const sc_word *value2, sc_word *buffer)
 
 void sc_shlI(const sc_word *value, unsigned shift_count, sc_word *buffer)
 {
+	int64_t v;
+	if (shift_count < 64 && load_int64(value, &v)) {
+		uint64_t const low  = (uint64_t)v << shift_count;
+		uint64_t const high = shift_count == 0 ? (v < 0 ? UINT64_MAX : 0)
+		                    : (uint64_t)shrs_int64(v, 64 - shift_count);
+		store_words(low, high, buffer);
+		return;
+	}
+
 	if (shift_count >= calc_buffer_size * SC_BITS) {
 		sc_zero(buffer);
 		return;
@@ -841,6 +962,12 @@ void sc_shl(const sc_word *val1, const sc_word *val2, sc_word *buffer)
 
 bool sc_shrI(const sc_word *value, unsigned shift_count, sc_word *buffer)
 {
+	int64_t v;
+	if (shift_count < 64 && load_int64(value, &v) && v >= 0) {
+		store_int64(v >> shift_count, buffer);
+		return (v & ((UINT64_C(1) << shift_count) - 1)) != 0;
+	}
+
 	if (shift_count >= calc_buffer_size*SC_BITS) {
 		bool carry_flag = !sc_is_zero(value, calc_buffer_size*SC_BITS);
 		sc_zero(buffer);
@@ -892,6 +1019,17 @@ bool sc_shr(const sc_word *val1, const sc_word *val2, sc_word *buffer)
 bool sc_shrsI(const sc_word *value, unsigned shift_count, unsigned bitsize,
               sc_word *buffer)
 {
+	if (word_fast_path && bitsize <= 64 && shift_count < bitsize) {
+		/* only the lower bitsize bits matter, sign extend them */
+		uint64_t       v    = load_uint64(value);
+		uint64_t const sbit = UINT64_C(1) << (bitsize - 1);
+		if (bitsize < 64)
+			v &= (sbit << 1) - 1;
+		int64_t const sv = (int64_t)((v ^ sbit) - sbit);
+		store_int64(shrs_int64(sv, shift_count), buffer);
+		return (v & ((UINT64_C(1) << shift_count) - 1)) != 0;
+	}
+
 	sc_word sign = sc_get_bit_at(value, bitsize-1) ? SC_MASK : 0;
 
 	/* if shifting far enough the result is either 0 or -1 */
@@ -3,41 +3,53 @@
  * This file is a supplement to libFirm. It is public domain.
  *  @author Matthias Braun, Steven Schaefer
  */
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 /* Prevent the compiler from mangling the name of this function. */
-void __init_firmprof(const char*, unsigned int*, size_t)
-     asm("__init_firmprof");
+void __firmprof_register(const char*, const unsigned char*, unsigned,
+                         const void*, unsigned, unsigned)
+     asm("__firmprof_register");
 
 typedef struct _profile_counter_t {
-	const char *filename;
-	unsigned   *counters;
-	unsigned    len;
+	const char          *filename;
+	const unsigned char *data;
+	unsigned             data_size;
+	const void          *counters;
+	unsigned             len;
+	unsigned             counter_size;
 	struct _profile_counter_t *next;
 } profile_counter_t;
 
 static profile_counter_t *counters = NULL;
 
+static uint64_t get_counter(const profile_counter_t *counter, unsigned i)
+{
+	if (counter->counter_size == 8)
+		return ((const uint64_t*)counter->counters)[i];
+	else
+		return ((const uint32_t*)counter->counters)[i];
+}
+
 /**
  * Write counter values to profiling output file.
- * We define our output format to be a sequence of 32-bit unsigned integer
- * values stored in little endian format.
+ * The counters are stored as 64-bit unsigned integer values in little endian
+ * format after the data describing them.
  */
-void write_little_endian(unsigned *counter, unsigned len, FILE *f)
+static void write_little_endian(const profile_counter_t *counter, FILE *f)
 {
 	unsigned i;
 
-	for (i = 0; i < len; ++i) {
-		unsigned      v = counter[i];
-		unsigned char bytes[4];
+	for (i = 0; i < counter->len; ++i) {
+		uint64_t      v = get_counter(counter, i);
+		unsigned char bytes[8];
+		unsigned      b;
 
-		bytes[0] = ((v >>  0) & 0xff);
-		bytes[1] = ((v >>  8) & 0xff);
-		bytes[2] = ((v >> 16) & 0xff);
-		bytes[3] = ((v >> 24) & 0xff);
+		for (b = 0; b < 8; ++b)
+			bytes[b] = (v >> (b * 8)) & 0xff;
 
-		fwrite(bytes, 1, 4, f);
+		fwrite(bytes, 1, 8, f);
 	}
 }
 
@@ -50,8 +62,8 @@ static void write_profiles(void)
 		if (f == NULL) {
 			perror("Warning: couldn't open file for writing profiling data");
 		} else {
-			fputs("firmprof", f);
-			write_little_endian(counter->counters, counter->len, f);
+			fwrite(counter->data, 1, counter->data_size, f);
+			write_little_endian(counter, f);
 			fclose(f);
 		}
 		free(counter);
@@ -60,12 +72,13 @@ static void write_profiles(void)
 }
 
 /**
- * Register a new profile counter. This is called by separate constructors
- * for each translation unit. Incidentally, referring to this function as
- * "__init_firmprof" is perfectly linker friendly.
+ * Register the counters of a translation unit. This is called by separate
+ * constructors for each translation unit. The data describes the counters
+ * and forms the beginning of the profile file.
  */
-void __init_firmprof(const char *filename,
-                      unsigned int *counts, size_t len)
+void __firmprof_register(const char *filename, const unsigned char *data,
+                         unsigned data_size, const void *counts, unsigned len,
+                         unsigned counter_size)
 {
 	static int initialized = 0;
 	profile_counter_t *counter;
@@ -79,10 +92,13 @@ void __init_firmprof(const char *filename,
 	if (counter == NULL)
 		return;
 
-	counter->filename = filename;
-	counter->counters = counts;
-	counter->next     = counters;
-	counter->len      = len;
+	counter->filename     = filename;
+	counter->data         = data;
+	counter->data_size    = data_size;
+	counter->counters     = counts;
+	counter->len          = len;
+	counter->counter_size = counter_size;
+	counter->next         = counters;
 
 	counters = counter;
 }
@@ -0,0 +1,291 @@
+#include "firm.h"
+#include "jit.h"
+#include "util.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+static char profile[] = "/tmp/inline_profile_XXXXXX";
+
+static ir_type *int_method;
+
+static ir_entity *new_function(char const *const name)
+{
+	return new_global_entity(get_glob_type(), new_id_from_str(name),
+	                         int_method, ir_visibility_external,
+	                         IR_LINKAGE_DEFAULT);
+}
+
+static ir_entity *find_entity(char const *const name)
+{
+	ir_type *const glob = get_glob_type();
+	for (size_t i = 0, n = get_compound_n_members(glob); i < n; ++i) {
+		ir_entity *const entity = get_compound_member(glob, i);
+		if (streq(get_entity_name(entity), name))
+			return entity;
+	}
+	return NULL;
+}
+
+/* a function body too big for the static heuristic at threshold 5000 */
+static void build_body(ir_entity *const entity, long const k)
+{
+	ir_graph *const irg = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+	ir_node *value = new_Proj(get_irg_args(irg), mode_Is, 0);
+	for (long i = 0; i < 12; ++i) {
+		ir_node *const mul = new_Mul(value, new_Const_long(mode_Is, k + 2 * i + 1));
+		ir_node *const shr = new_Shr(value, new_Const_long(mode_Iu, i % 5 + 1));
+		value = new_Add(new_Eor(mul, shr), new_Const_long(mode_Is, i * k));
+	}
+	ir_node *const ret = new_Return(get_store(), 1, &value);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+}
+
+static ir_node *call(ir_entity *const callee, ir_node *const arg)
+{
+	ir_node *const in[] = { arg };
+	ir_node *const call = new_Call(get_store(), new_Address(callee),
+	                               ARRAY_SIZE(in), in, int_method);
+	set_store(new_Proj(call, mode_M, pn_Call_M));
+	ir_node *const result = new_Proj(call, mode_T, pn_Call_T_result);
+	return new_Proj(result, mode_Is, 0);
+}
+
+/* int driver(int n) { int s = 0;
+ *   for (int i = 0; i < n; ++i) { s += hot(i); if (i == 12345) s += cold(i); }
+ *   return s; } */
+static void build_driver(ir_entity *const entity, ir_entity *const hot,
+                         ir_entity *const cold)
+{
+	ir_graph *const irg = new_ir_graph(entity, 2);
+	set_current_ir_graph(irg);
+	ir_node *const n = new_Proj(get_irg_args(irg), mode_Is, 0);
+	set_value(0, new_Const_long(mode_Is, 0));
+	set_value(1, new_Const_long(mode_Is, 0));
+
+	ir_node *const header = new_immBlock();
+	add_immBlock_pred(header, new_Jmp());
+	set_cur_block(header);
+	ir_node *const cmp  = new_Cmp(get_value(0, mode_Is), n, ir_relation_less);
+	ir_node *const cond = new_Cond(cmp);
+	ir_node *const exit = new_immBlock();
+	add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+	mature_immBlock(exit);
+
+	ir_node *const body = new_immBlock();
+	add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+	mature_immBlock(body);
+	set_cur_block(body);
+	ir_node *const i = get_value(0, mode_Is);
+	set_value(1, new_Add(get_value(1, mode_Is), call(hot, i)));
+	ir_node *const is_rare   = new_Cmp(i, new_Const_long(mode_Is, 12345),
+	                                   ir_relation_equal);
+	ir_node *const rare_cond = new_Cond(is_rare);
+	ir_node *const latch     = new_immBlock();
+	add_immBlock_pred(latch, new_Proj(rare_cond, mode_X, pn_Cond_false));
+
+	ir_node *const rare = new_immBlock();
+	add_immBlock_pred(rare, new_Proj(rare_cond, mode_X, pn_Cond_true));
+	mature_immBlock(rare);
+	set_cur_block(rare);
+	set_value(1, new_Add(get_value(1, mode_Is), call(cold, i)));
+	add_immBlock_pred(latch, new_Jmp());
+	mature_immBlock(latch);
+
+	set_cur_block(latch);
+	set_value(0, new_Add(get_value(0, mode_Is), new_Const_long(mode_Is, 1)));
+	add_immBlock_pred(header, new_Jmp());
+	mature_immBlock(header);
+
+	set_cur_block(exit);
+	ir_node *const res = get_value(1, mode_Is);
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+}
+
+/** Builds the program the same way for instrumentation and for inlining. */
+static void build_program(void)
+{
+	ir_target_set("x86_64-linux-gnu");
+	ir_target_init();
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	int_method = new_type_method(1, 1, false, cc_cdecl_set, mtp_no_property);
+	set_method_param_type(int_method, 0, int_type);
+	set_method_res_type(int_method, 0, int_type);
+
+	ir_entity *const hot    = new_function("hot");
+	ir_entity *const cold   = new_function("cold");
+	ir_entity *const driver = new_function("driver");
+	build_body(hot, 3);
+	build_body(cold, 7);
+	build_driver(driver, hot, cold);
+	for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i)
+		optimize_graph_df(get_irp_irg(i));
+}
+
+/** Returns the contents of the byte array @p entity. */
+static unsigned char *get_bytes(ir_entity *const entity, size_t *const size)
+{
+	ir_initializer_t const *const init = get_entity_initializer(entity);
+	*size = get_initializer_compound_n_entries(init);
+	unsigned char *const bytes = (unsigned char*)malloc(*size);
+	for (size_t i = 0; i < *size; ++i) {
+		ir_initializer_t const *const value
+			= get_initializer_compound_value(init, i);
+		bytes[i] = get_tarval_long(get_initializer_tarval_value(value));
+	}
+	return bytes;
+}
+
+/**
+ * Instruments the program, runs driver(1000) as jit compiled code and writes
+ * the profile like the profiling runtime does at exit: the data prepared by
+ * the instrumentation followed by the counters.
+ */
+static void train(void)
+{
+	build_program();
+	ir_profile_instrument(profile);
+
+	ir_entity *const counters_entity = find_entity("__FIRMPROF__EDGE_COUNTS");
+	size_t     const n_counters
+		= get_type_size(get_entity_type(counters_entity)) / sizeof(uint64_t);
+	uint64_t  *const counters = (uint64_t*)calloc(n_counters, sizeof(uint64_t));
+	be_jit_set_entity_addr(counters_entity, counters);
+
+	ir_entity *const entities[] = {
+		find_entity("hot"), find_entity("cold"), find_entity("driver")
+	};
+	be_lower_for_target();
+	ir_jit_segment_t  *const segment = be_new_jit_segment();
+	ir_jit_function_t *functions[ARRAY_SIZE(entities)];
+	for (size_t i = 0; i < ARRAY_SIZE(entities); ++i) {
+		functions[i] = be_jit_compile(segment, get_entity_irg(entities[i]));
+		assert(functions[i] != NULL);
+	}
+	void *addresses[ARRAY_SIZE(entities)];
+	void *const code = be_jit_emit_executable(segment, ARRAY_SIZE(functions),
+	                                          functions, entities, addresses);
+	assert(code != NULL);
+	(void)code;
+	int (*const driver)(int) = (int (*)(int))addresses[2];
+	driver(1000);
+
+	size_t               size;
+	unsigned char *const data = get_bytes(find_entity("__FIRMPROF__DATA"), &size);
+	FILE          *const file = fopen(profile, "wb");
+	assert(file != NULL);
+	fwrite(data, 1, size, file);
+	fwrite(counters, sizeof(*counters), n_counters, file);
+	fclose(file);
+	free(data);
+	free(counters);
+	be_destroy_jit_segment(segment);
+}
+
+static void count_calls(ir_node *const node, void *const env)
+{
+	unsigned *const n_calls = (unsigned*)env;
+	if (!is_Call(node))
+		return;
+	ir_entity *const callee = get_Call_callee(node);
+	if (streq(get_entity_name(callee), "hot"))
+		++n_calls[0];
+	else if (streq(get_entity_name(callee), "cold"))
+		++n_calls[1];
+}
+
+static bool with_profile;
+static int  threshold;
+static bool expect_hot_inlined;
+static bool expect_cold_inlined;
+
+static void check_inlining(void)
+{
+	build_program();
+	if (with_profile) {
+		bool const read = ir_profile_read(profile);
+		assert(read);
+		(void)read;
+	}
+	inline_functions(1000, threshold, NULL);
+	ir_profile_free();
+
+	unsigned n_calls[2] = { 0, 0 };
+	irg_walk_graph(get_entity_irg(find_entity("driver")), count_calls, NULL,
+	               n_calls);
+	/* report through the exit status, which run_stage() checks */
+	if ((n_calls[0] == 0) != expect_hot_inlined
+	    || (n_calls[1] == 0) != expect_cold_inlined)
+		exit(1);
+}
+
+/** Runs @p stage in a child process with a freshly initialized libFirm. */
+static bool run_stage(void (*stage)(void))
+{
+	fflush(NULL);
+	pid_t const pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		ir_init();
+		stage();
+		ir_finish();
+		exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool inlines(bool const profiled, int const thres, bool const hot,
+                    bool const cold)
+{
+	with_profile        = profiled;
+	threshold           = thres;
+	expect_hot_inlined  = hot;
+	expect_cold_inlined = cold;
+	return run_stage(check_inlining);
+}
+
+int main(void)
+{
+	close(mkstemp(profile));
+	bool const trained = run_stage(train);
+	assert(trained);
+	(void)trained;
+
+	/* both callees are too big for the static heuristic at threshold 5000 */
+	bool const static_big   = inlines(false, 5000, false, false);
+	bool const static_small = inlines(false, 0,    true,  true);
+	/* with the profile only the hot callee is inlined */
+	bool const profiled_big   = inlines(true, 5000, true, false);
+	bool const profiled_small = inlines(true, 0,    true, false);
+	assert(static_big && static_small);
+	assert(profiled_big && profiled_small);
+	(void)static_big;
+	(void)static_small;
+	(void)profiled_big;
+	(void)profiled_small;
+
+	remove(profile);
+	return 0;
+}
+
+#else
+
+int main(void)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,367 @@
+#include "firm.h"
+#include "util.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+static ir_entity *new_function(char const *const name, ir_type *const type)
+{
+	return new_global_entity(get_glob_type(), new_id_from_str(name), type,
+	                         ir_visibility_external, IR_LINKAGE_DEFAULT);
+}
+
+static ir_type *new_int_method(void)
+{
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const mtp      = new_type_method(1, 1, false, cc_cdecl_set,
+	                                          mtp_no_property);
+	set_method_param_type(mtp, 0, int_type);
+	set_method_res_type(mtp, 0, int_type);
+	return mtp;
+}
+
+/* int scale(int x) { return x * 3 + 7; } */
+static ir_entity *build_scale(void)
+{
+	ir_entity *const entity = new_function("scale", new_int_method());
+	ir_graph  *const irg    = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *const x   = new_Proj(get_irg_args(irg), mode_Is, 0);
+	ir_node *const mul = new_Mul(x, new_Const_long(mode_Is, 3));
+	ir_node *const res = new_Add(mul, new_Const_long(mode_Is, 7));
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return entity;
+}
+
+/* int sum(int n) { int s = total; for (; n > 0; --n) s += scale(n);
+ *                  total = s; return s; } */
+static void build_sum(ir_entity *const scale, ir_entity *const total)
+{
+	ir_type   *const int_type = get_type_for_mode(mode_Is);
+	ir_entity *const entity   = new_function("sum", new_int_method());
+	ir_graph  *const irg      = new_ir_graph(entity, 2);
+	set_current_ir_graph(irg);
+
+	ir_node *const load = new_Load(get_store(), new_Address(total), mode_Is,
+	                               int_type, cons_none);
+	set_store(new_Proj(load, mode_M, pn_Load_M));
+	set_value(0, new_Proj(get_irg_args(irg), mode_Is, 0));
+	set_value(1, new_Proj(load, mode_Is, pn_Load_res));
+	ir_node *const entry = new_Jmp();
+
+	ir_node *const header = new_immBlock();
+	add_immBlock_pred(header, entry);
+	set_cur_block(header);
+	ir_node *const cmp  = new_Cmp(get_value(0, mode_Is),
+	                              new_Const_long(mode_Is, 0), ir_relation_greater);
+	ir_node *const cond = new_Cond(cmp);
+
+	ir_node *const body = new_immBlock();
+	add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+	mature_immBlock(body);
+	set_cur_block(body);
+	ir_node *const in[] = { get_value(0, mode_Is) };
+	ir_node *const call = new_Call(get_store(), new_Address(scale),
+	                               ARRAY_SIZE(in), in, get_entity_type(scale));
+	set_store(new_Proj(call, mode_M, pn_Call_M));
+	ir_node *const result = new_Proj(call, mode_T, pn_Call_T_result);
+	set_value(1, new_Add(get_value(1, mode_Is), new_Proj(result, mode_Is, 0)));
+	set_value(0, new_Sub(get_value(0, mode_Is), new_Const_long(mode_Is, 1)));
+	add_immBlock_pred(header, new_Jmp());
+	mature_immBlock(header);
+
+	ir_node *const exit = new_immBlock();
+	add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+	mature_immBlock(exit);
+	set_cur_block(exit);
+	ir_node *const res   = get_value(1, mode_Is);
+	ir_node *const store = new_Store(get_store(), new_Address(total), res,
+	                                 int_type, cons_none);
+	set_store(new_Proj(store, mode_M, pn_Store_M));
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+}
+
+static void build_program(void)
+{
+	ir_type   *const int_type = get_type_for_mode(mode_Is);
+	ir_entity *const total    = new_global_entity(get_glob_type(),
+		new_id_from_str("total"), int_type, ir_visibility_external,
+		IR_LINKAGE_DEFAULT);
+	set_entity_initializer(total,
+		create_initializer_tarval(new_tarval_from_long(42, mode_Is)));
+	build_sum(build_scale(), total);
+}
+
+static char *temp_file(void)
+{
+	char *const name = strdup("/tmp/irio_binary_XXXXXX");
+	int   const fd   = mkstemp(name);
+	assert(fd >= 0);
+	close(fd);
+	return name;
+}
+
+static char *read_all(char const *const filename, size_t *const size)
+{
+	FILE *const file = fopen(filename, "rb");
+	assert(file != NULL);
+	fseek(file, 0, SEEK_END);
+	long const length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char *const data = (char*)malloc(length + 1);
+	size_t const n = fread(data, 1, length, file);
+	assert(n == (size_t)length);
+	(void)n;
+	data[length] = '\0';
+	fclose(file);
+	*size = (size_t)length;
+	return data;
+}
+
+static void write_all(char const *const filename, char const *const data,
+                      size_t const size)
+{
+	FILE *const file = fopen(filename, "wb");
+	assert(file != NULL);
+	size_t const n = fwrite(data, 1, size, file);
+	assert(n == size);
+	(void)n;
+	fclose(file);
+}
+
+static ir_entity *find_function(char const *const name)
+{
+	ir_type *const glob = get_glob_type();
+	for (size_t i = 0, n = get_compound_n_members(glob); i < n; ++i) {
+		ir_entity *const entity = get_compound_member(glob, i);
+		if (streq(get_entity_name(entity), name))
+			return entity;
+	}
+	return NULL;
+}
+
+static uint64_t get_le(unsigned char const *const p, unsigned const size)
+{
+	uint64_t value = 0;
+	for (unsigned i = size; i-- > 0;)
+		value = value << 8 | p[i];
+	return value;
+}
+
+/**
+ * Returns offset and size of the section of the graph of "sum", which is
+ * bigger than the one of "scale".
+ */
+static void find_sum_section(unsigned char const *const data, size_t const size,
+                             size_t *const offset, size_t *const section_size)
+{
+	/* the trailer starts with offset and size of the global section followed
+	 * by offset and length of the graph table */
+	unsigned char const *const trailer = data + size - 56;
+	uint64_t             const irgs    = get_le(trailer + 16, 8);
+	assert(get_le(trailer + 24, 8) == 2);
+	/* graph table entries: entity number, offset, size, number of nodes */
+	*section_size = 0;
+	for (unsigned i = 0; i < 2; ++i) {
+		unsigned char const *const entry = data + irgs + i * 32;
+		if (get_le(entry + 16, 8) > *section_size) {
+			*offset       = get_le(entry + 8, 8);
+			*section_size = get_le(entry + 16, 8);
+		}
+	}
+}
+
+static char *text;
+static char *text2;
+static char *text3;
+static char *binary;
+static char *corrupt;
+
+/**
+ * Runs @p stage in a child process with a freshly initialized libFirm, as
+ * every stage imports into an empty program. If @p quiet is set, the errors
+ * reported by the stage are not shown.
+ */
+static bool run_stage(void (*stage)(void), bool quiet)
+{
+	fflush(NULL);
+	pid_t const pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		if (quiet)
+			freopen("/dev/null", "w", stderr);
+		ir_init();
+		stage();
+		ir_finish();
+		exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void export_program(void)
+{
+	build_program();
+	int const res = ir_export(text);
+	assert(res == 0);
+	(void)res;
+}
+
+static void text_to_binary(void)
+{
+	int const res_import = ir_import(text);
+	assert(res_import == 0);
+	(void)res_import;
+	int const res_text   = ir_export(text2);
+	assert(res_text == 0);
+	(void)res_text;
+	int const res_binary = ir_export_binary(binary);
+	assert(res_binary == 0);
+	(void)res_binary;
+}
+
+static void binary_to_text(void)
+{
+	int const res_import = ir_import(binary);
+	assert(res_import == 0);
+	(void)res_import;
+	assert(get_irp_n_irgs() == 2);
+	int const res_export = ir_export(text3);
+	assert(res_export == 0);
+	(void)res_export;
+}
+
+static void import_lazily(void)
+{
+	ir_lazy_import *const import = ir_import_lazy(binary);
+	assert(import != NULL);
+	assert(get_irp_n_irgs() == 0);
+	ir_entity *const scale = find_function("scale");
+	assert(scale != NULL);
+	ir_graph *const irg = ir_import_lazy_irg(import, scale);
+	assert(irg != NULL && get_entity_irg(scale) == irg);
+	assert(get_irp_n_irgs() == 1);
+	int const valid = irg_verify(irg);
+	assert(valid);
+	(void)valid;
+	ir_graph *const again = ir_import_lazy_irg(import, scale);
+	assert(again == irg);
+	(void)again;
+	ir_import_lazy_free(import);
+}
+
+static void import_truncated_file(void)
+{
+	ir_lazy_import *const import = ir_import_lazy(corrupt);
+	assert(import == NULL);
+	(void)import;
+	int const res = ir_import(corrupt);
+	assert(res != 0);
+	(void)res;
+}
+
+static void import_truncated_section(void)
+{
+	ir_lazy_import *const import = ir_import_lazy(corrupt);
+	assert(import != NULL);
+	ir_graph *const sum = ir_import_lazy_irg(import, find_function("sum"));
+	assert(sum == NULL);
+	(void)sum;
+	assert(get_irp_n_irgs() == 0);
+	ir_graph *const irg = ir_import_lazy_irg(import, find_function("scale"));
+	assert(irg != NULL);
+	int const valid = irg_verify(irg);
+	assert(valid);
+	(void)valid;
+	ir_import_lazy_free(import);
+}
+
+int main(void)
+{
+	text    = temp_file();
+	text2   = temp_file();
+	text3   = temp_file();
+	binary  = temp_file();
+	corrupt = temp_file();
+
+	/* text -> binary -> text reproduces the text */
+	bool const exported  = run_stage(export_program, false);
+	assert(exported);
+	(void)exported;
+	bool const converted = run_stage(text_to_binary, false);
+	assert(converted);
+	(void)converted;
+	bool const restored  = run_stage(binary_to_text, false);
+	assert(restored);
+	(void)restored;
+	size_t      size2, size3;
+	char *const data2 = read_all(text2, &size2);
+	char *const data3 = read_all(text3, &size3);
+	assert(size2 == size3 && memcmp(data2, data3, size2) == 0);
+	free(data2);
+	free(data3);
+
+	bool const lazy = run_stage(import_lazily, false);
+	assert(lazy);
+	(void)lazy;
+
+	/* a truncated file is rejected */
+	size_t               size;
+	unsigned char *const data = (unsigned char*)read_all(binary, &size);
+	write_all(corrupt, (char const*)data, size / 2);
+	bool const rejected = run_stage(import_truncated_file, true);
+	assert(rejected);
+	(void)rejected;
+
+	/* a truncated graph section makes only that graph fail; the section is
+	 * cut by overwriting its end with line ends, which the reader skips */
+	unsigned char *const copy = (unsigned char*)malloc(size);
+	size_t offset = 0, section_size;
+	find_sum_section(data, size, &offset, &section_size);
+	size_t last = offset + section_size;
+	while (data[last - 1] == 7)
+		--last;
+	for (size_t cut = offset; cut < last; ++cut) {
+		memcpy(copy, data, size);
+		memset(copy + cut, 7, offset + section_size - cut);
+		write_all(corrupt, (char const*)copy, size);
+		bool const partial = run_stage(import_truncated_section, true);
+		assert(partial);
+		(void)partial;
+	}
+	free(copy);
+	free(data);
+
+	remove(text);
+	remove(text2);
+	remove(text3);
+	remove(binary);
+	remove(corrupt);
+	free(text);
+	free(text2);
+	free(text3);
+	free(binary);
+	free(corrupt);
+	return 0;
+}
+
+#else
+
+int main(void)
+{
+	return 0;
+}
+
+#endif
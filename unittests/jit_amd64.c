@@ -0,0 +1,193 @@
+#include "firm.h"
+#include "jit.h"
+#include "util.h"
+#include <assert.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+/* defined in the executable, which is usually more than 2GiB away from the
+ * memory mapped for jit code */
+static long host_counter = 7;
+
+static long host_add(long const a, long const b)
+{
+	return a + b;
+}
+
+static ir_entity *new_function(char const *const name, ir_type *const type)
+{
+	return new_global_entity(get_glob_type(), new_id_from_str(name), type,
+	                         ir_visibility_external, IR_LINKAGE_DEFAULT);
+}
+
+static void finish_function(ir_graph *const irg, ir_node *const res)
+{
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+}
+
+/* long count(long x) { return host_counter += host_add(x, 3); } */
+static ir_entity *build_count(ir_entity *const add, ir_entity *const counter)
+{
+	ir_type *const long_type = get_type_for_mode(mode_Ls);
+	ir_type *const mtp       = new_type_method(1, 1, false, cc_cdecl_set,
+	                                           mtp_no_property);
+	set_method_param_type(mtp, 0, long_type);
+	set_method_res_type(mtp, 0, long_type);
+	ir_entity *const entity = new_function("count", mtp);
+	ir_graph  *const irg    = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *const x      = new_Proj(get_irg_args(irg), mode_Ls, 0);
+	ir_node *const in[]   = { x, new_Const_long(mode_Ls, 3) };
+	ir_node *const call   = new_Call(get_store(), new_Address(add),
+	                                 ARRAY_SIZE(in), in, get_entity_type(add));
+	set_store(new_Proj(call, mode_M, pn_Call_M));
+	ir_node *const result = new_Proj(call, mode_T, pn_Call_T_result);
+	ir_node *const sum    = new_Proj(result, mode_Ls, 0);
+	ir_node *const load   = new_Load(get_store(), new_Address(counter),
+	                                 mode_Ls, long_type, cons_none);
+	set_store(new_Proj(load, mode_M, pn_Load_M));
+	ir_node *const value  = new_Add(sum, new_Proj(load, mode_Ls, pn_Load_res));
+	ir_node *const store  = new_Store(get_store(), new_Address(counter),
+	                                  value, long_type, cons_none);
+	set_store(new_Proj(store, mode_M, pn_Store_M));
+	finish_function(irg, value);
+	return entity;
+}
+
+/* double scale(double x) { return x * 1.5 + 0.25; } */
+static ir_entity *build_scale(void)
+{
+	ir_type *const double_type = get_type_for_mode(mode_D);
+	ir_type *const mtp         = new_type_method(1, 1, false, cc_cdecl_set,
+	                                             mtp_no_property);
+	set_method_param_type(mtp, 0, double_type);
+	set_method_res_type(mtp, 0, double_type);
+	ir_entity *const entity = new_function("scale", mtp);
+	ir_graph  *const irg    = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *const x      = new_Proj(get_irg_args(irg), mode_D, 0);
+	ir_node *const factor = new_Const(new_tarval_from_double(1.5, mode_D));
+	ir_node *const bias   = new_Const(new_tarval_from_double(0.25, mode_D));
+	finish_function(irg, new_Add(new_Mul(x, factor), bias));
+	return entity;
+}
+
+static long const pick_values[] = { 3, 14, 15, 92, 65, 35 };
+
+/* long pick(long x) { switch (x) { case 0..5: return pick_values[x]; }
+ *                     return -1; } */
+static ir_entity *build_pick(void)
+{
+	ir_type *const long_type = get_type_for_mode(mode_Ls);
+	ir_type *const mtp       = new_type_method(1, 1, false, cc_cdecl_set,
+	                                           mtp_no_property);
+	set_method_param_type(mtp, 0, long_type);
+	set_method_res_type(mtp, 0, long_type);
+	ir_entity *const entity = new_function("pick", mtp);
+	ir_graph  *const irg    = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+
+	ir_node         *const x     = new_Proj(get_irg_args(irg), mode_Ls, 0);
+	unsigned         const n     = ARRAY_SIZE(pick_values);
+	ir_switch_table *const table = ir_new_switch_table(irg, n);
+	for (unsigned i = 0; i < n; ++i) {
+		ir_tarval *const value = new_tarval_from_long(i, mode_Ls);
+		ir_switch_table_set(table, i, value, value, i + 1);
+	}
+	ir_node *const swtch = new_Switch(x, n + 1, table);
+	ir_node *const end   = get_irg_end_block(irg);
+	for (unsigned pn = 0; pn <= n; ++pn) {
+		ir_node *const block = new_immBlock();
+		add_immBlock_pred(block, new_Proj(swtch, mode_X, pn));
+		mature_immBlock(block);
+		set_cur_block(block);
+		long     const value = pn == 0 ? -1 : pick_values[pn - 1];
+		ir_node *const res   = new_Const_long(mode_Ls, value);
+		add_immBlock_pred(end, new_Return(get_store(), 1, &res));
+	}
+	irg_finalize_cons(irg);
+	return entity;
+}
+
+int main(void)
+{
+	ir_init();
+	ir_target_set("x86_64-linux-gnu");
+	ir_target_init();
+
+	ir_type *const long_type = get_type_for_mode(mode_Ls);
+	ir_type *const add_type  = new_type_method(2, 1, false, cc_cdecl_set,
+	                                           mtp_no_property);
+	set_method_param_type(add_type, 0, long_type);
+	set_method_param_type(add_type, 1, long_type);
+	set_method_res_type(add_type, 0, long_type);
+	ir_entity *const add     = new_function("host_add", add_type);
+	ir_entity *const counter
+		= new_global_entity(get_glob_type(), new_id_from_str("host_counter"),
+		                    long_type, ir_visibility_external,
+		                    IR_LINKAGE_DEFAULT);
+	be_jit_set_entity_addr(add, (void const*)host_add);
+	be_jit_set_entity_addr(counter, &host_counter);
+
+	ir_entity *const entities[] = {
+		build_count(add, counter), build_scale(), build_pick()
+	};
+	/* turns the switch into a jump table */
+	be_lower_for_target();
+	ir_jit_segment_t  *const segment     = be_new_jit_segment();
+	ir_jit_function_t *const functions[] = {
+		be_jit_compile(segment, get_entity_irg(entities[0])),
+		be_jit_compile(segment, get_entity_irg(entities[1])),
+		be_jit_compile(segment, get_entity_irg(entities[2])),
+	};
+	for (size_t i = 0; i < ARRAY_SIZE(functions); ++i)
+		assert(functions[i] != NULL);
+	void *addresses[ARRAY_SIZE(functions)];
+	void *const code = be_jit_emit_executable(segment, ARRAY_SIZE(functions),
+	                                          functions, entities, addresses);
+	assert(code != NULL);
+	(void)code;
+
+	long (*const count)(long) = (long (*)(long))addresses[0];
+	long const counted = count(10);
+	assert(counted == 20);
+	assert(host_counter == 20);
+	long const recounted = count(-3);
+	assert(recounted == 20);
+	(void)counted;
+	(void)recounted;
+
+	double (*const scale)(double) = (double (*)(double))addresses[1];
+	double const scaled_pos = scale(2.0);
+	double const scaled_neg = scale(-1.0);
+	assert(scaled_pos == 3.25);
+	assert(scaled_neg == -1.25);
+	(void)scaled_pos;
+	(void)scaled_neg;
+
+	long (*const pick)(long) = (long (*)(long))addresses[2];
+	for (long i = -2; i < (long)ARRAY_SIZE(pick_values) + 2; ++i) {
+		bool const in_table = 0 <= i && i < (long)ARRAY_SIZE(pick_values);
+		long const picked   = pick(i);
+		assert(picked == (in_table ? pick_values[i] : -1));
+		(void)in_table;
+		(void)picked;
+	}
+
+	be_destroy_jit_segment(segment);
+	ir_finish();
+	return 0;
+}
+
+#else
+
+int main(void)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "firm.h"
+#include <assert.h>
+
+/* Constructs
+ *   void name(int *p, int *q, int n)
+ *   {
+ *       for (int i = 0; i < n; ++i)
+ *           (dst + dst_offset)[i] = (src + src_offset)[i] + 1;
+ *   }
+ * where src and dst are p or q.  If @p other_type is set, the stores use a
+ * type of their own, which type based alias analysis keeps apart from int. */
+static ir_graph *build_loop(char const *const name, bool const dst_is_q,
+                            long const dst_offset, long const src_offset,
+                            bool const other_type)
+{
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const dst_type
+		= other_type ? new_type_primitive(mode_Is) : int_type;
+	ir_type *const ptr_type = new_type_pointer(int_type);
+	ir_type *const mtp      = new_type_method(3, 0, false, cc_cdecl_set,
+	                                          mtp_no_property);
+	set_method_param_type(mtp, 0, ptr_type);
+	set_method_param_type(mtp, 1, ptr_type);
+	set_method_param_type(mtp, 2, int_type);
+	ir_entity *const entity
+		= new_global_entity(get_glob_type(), new_id_from_str(name), mtp,
+		                    ir_visibility_external, IR_LINKAGE_DEFAULT);
+	ir_graph *const irg = new_ir_graph(entity, 1);
+	set_current_ir_graph(irg);
+	if (other_type)
+		set_irg_memory_disambiguator_options(irg, aa_opt_type_based);
+
+	ir_node *const args = get_irg_args(irg);
+	ir_node *const p    = new_Proj(args, mode_P, 0);
+	ir_node *const q    = new_Proj(args, mode_P, 1);
+	ir_node *const n    = new_Proj(args, mode_Is, 2);
+	ir_node *const dst  = new_Add(dst_is_q ? q : p,
+	                              new_Const_long(mode_Ls, dst_offset));
+	ir_node *const src  = new_Add(p, new_Const_long(mode_Ls, src_offset));
+	set_value(0, new_Const_long(mode_Is, 0));
+	ir_node *const entry = new_Jmp();
+
+	ir_node *const header = new_immBlock();
+	add_immBlock_pred(header, entry);
+	set_cur_block(header);
+	ir_node *const cmp  = new_Cmp(get_value(0, mode_Is), n, ir_relation_less);
+	ir_node *const cond = new_Cond(cmp);
+	ir_node *const body = new_immBlock();
+	add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+	mature_immBlock(body);
+	ir_node *const exit = new_immBlock();
+	add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+	mature_immBlock(exit);
+
+	set_cur_block(body);
+	ir_node *const i      = get_value(0, mode_Is);
+	ir_node *const offset = new_Mul(new_Conv(i, mode_Ls),
+	                                new_Const_long(mode_Ls, 4));
+	ir_node *const load   = new_Load(get_store(), new_Add(src, offset),
+	                                 mode_Is, int_type, cons_none);
+	set_store(new_Proj(load, mode_M, pn_Load_M));
+	ir_node *const value  = new_Add(new_Proj(load, mode_Is, pn_Load_res),
+	                                new_Const_long(mode_Is, 1));
+	ir_node *const store  = new_Store(get_store(), new_Add(dst, offset),
+	                                  value, dst_type, cons_none);
+	set_store(new_Proj(store, mode_M, pn_Store_M));
+	set_value(0, new_Add(i, new_Const_long(mode_Is, 1)));
+	add_immBlock_pred(header, new_Jmp());
+	mature_immBlock(header);
+
+	set_cur_block(exit);
+	ir_node *const ret = new_Return(get_store(), 0, NULL);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return irg;
+}
+
+static void count_vector_store(ir_node *const node, void *const env)
+{
+	if (is_Store(node) && mode_is_vector(get_irn_mode(get_Store_value(node))))
+		++*(unsigned*)env;
+}
+
+static void count_pointer_sub(ir_node *const node, void *const env)
+{
+	if (is_Sub(node) && mode_is_reference(get_irn_mode(get_Sub_left(node))))
+		++*(unsigned*)env;
+}
+
+static bool is_vectorized(ir_graph *const irg)
+{
+	opt_vectorize_loops(irg);
+	irg_verify(irg);
+	unsigned n_vector_stores = 0;
+	irg_walk_graph(irg, count_vector_store, NULL, &n_vector_stores);
+	return n_vector_stores > 0;
+}
+
+/** Returns whether the vectorized @p irg compares its pointers at runtime. */
+static bool has_alias_check(ir_graph *const irg)
+{
+	unsigned n_pointer_subs = 0;
+	irg_walk_graph(irg, count_pointer_sub, NULL, &n_pointer_subs);
+	return n_pointer_subs > 0;
+}
+
+int main(void)
+{
+	ir_init();
+	ir_target_set("x86_64-linux-gnu");
+	ir_target_init();
+
+	/* different objects are checked at runtime */
+	ir_graph *const copy_other  = build_loop("copy_other", true, 0, 0, false);
+	bool      const other       = is_vectorized(copy_other);
+	bool      const other_check = has_alias_check(copy_other);
+	/* type based alias analysis makes the runtime check unnecessary */
+	ir_graph *const copy_typed  = build_loop("copy_typed", true, 0, 0, true);
+	bool      const typed       = is_vectorized(copy_typed);
+	bool      const typed_check = has_alias_check(copy_typed);
+	/* a whole vector apart */
+	bool const apart
+		= is_vectorized(build_loop("copy_vector_apart", false, 16, 0, false));
+	bool const before
+		= is_vectorized(build_loop("copy_vector_before", false, 0, 16, false));
+	/* the same element is read before it is written */
+	bool const inplace
+		= is_vectorized(build_loop("copy_inplace", false, 8, 8, false));
+	/* each iteration reads an element written two iterations before */
+	bool const overlap
+		= is_vectorized(build_loop("copy_overlap", false, 8, 0, false));
+	bool const overlap_other
+		= is_vectorized(build_loop("copy_overlap_other", false, 4, 0, false));
+	assert(other && other_check && typed && !typed_check);
+	assert(apart && before && inplace);
+	assert(!overlap && !overlap_other);
+	(void)other;
+	(void)other_check;
+	(void)typed;
+	(void)typed_check;
+	(void)apart;
+	(void)before;
+	(void)inplace;
+	(void)overlap;
+	(void)overlap_other;
+
+	ir_finish();
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include "firm.h"
+#include "jit.h"
+#include "util.h"
+#include <assert.h>
+
+#define N_LANES 4
+
+typedef enum group_kind_t {
+	GROUP_PACKED,      /**< all lanes may be packed */
+	GROUP_EXTRA_USER,  /**< the sum of one lane is returned as well */
+	GROUP_OFFSETS,     /**< two lanes load each other's elements */
+	GROUP_DEPENDENT,   /**< one lane loads after the Store of another */
+	N_GROUPS
+} group_kind_t;
+
+/* Constructs
+ *   int name(int *dst, int *a, int *b)
+ *   {
+ *       dst[0] = a[0] + b[0];
+ *       ...
+ *       dst[3] = a[3] + b[3];
+ *       return 0;
+ *   }
+ * with the Stores synchronized by a single Sync and variations according to
+ * @p kind. */
+static ir_entity *build_group(char const *const name, group_kind_t const kind)
+{
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const ptr_type = new_type_pointer(int_type);
+	ir_type *const mtp      = new_type_method(3, 1, false, cc_cdecl_set,
+	                                          mtp_no_property);
+	set_method_param_type(mtp, 0, ptr_type);
+	set_method_param_type(mtp, 1, ptr_type);
+	set_method_param_type(mtp, 2, ptr_type);
+	set_method_res_type(mtp, 0, int_type);
+	ir_entity *const entity
+		= new_global_entity(get_glob_type(), new_id_from_str(name), mtp,
+		                    ir_visibility_external, IR_LINKAGE_DEFAULT);
+	ir_graph *const irg = new_ir_graph(entity, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *const args = get_irg_args(irg);
+	ir_node *const dst  = new_Proj(args, mode_P, 0);
+	ir_node *const a    = new_Proj(args, mode_P, 1);
+	ir_node *const b    = new_Proj(args, mode_P, 2);
+	ir_node *const mem  = get_store();
+	ir_node *sums[N_LANES];
+	ir_node *stores[N_LANES];
+	ir_node *syncs[N_LANES];
+	for (unsigned i = 0; i < N_LANES; ++i) {
+		unsigned const a_index = kind == GROUP_OFFSETS && i >= 2 ? 5 - i : i;
+		ir_node *const a_mem   = kind == GROUP_DEPENDENT && i == N_LANES - 1
+			? syncs[0] : mem;
+		ir_node *const a_ptr   = new_Add(a, new_Const_long(mode_Ls, 4 * a_index));
+		ir_node *const b_ptr   = new_Add(b, new_Const_long(mode_Ls, 4 * i));
+		ir_node *const d_ptr   = new_Add(dst, new_Const_long(mode_Ls, 4 * i));
+		ir_node *const load_a  = new_Load(a_mem, a_ptr, mode_Is, int_type,
+		                                  cons_none);
+		ir_node *const load_b  = new_Load(mem, b_ptr, mode_Is, int_type,
+		                                  cons_none);
+		sums[i]   = new_Add(new_Proj(load_a, mode_Is, pn_Load_res),
+		                    new_Proj(load_b, mode_Is, pn_Load_res));
+		stores[i] = new_Store(mem, d_ptr, sums[i], int_type, cons_none);
+		syncs[i]  = new_Proj(stores[i], mode_M, pn_Store_M);
+	}
+	set_store(new_Sync(N_LANES, syncs));
+	ir_node *const res = kind == GROUP_EXTRA_USER
+		? sums[1] : new_Const_long(mode_Is, 0);
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return entity;
+}
+
+static void count_vector_store(ir_node *const node, void *const env)
+{
+	if (is_Store(node) && mode_is_vector(get_irn_mode(get_Store_value(node))))
+		++*(unsigned*)env;
+}
+
+static bool is_packed(ir_entity *const entity)
+{
+	ir_graph *const irg = get_entity_irg(entity);
+	opt_vectorize_slp(irg);
+	irg_verify(irg);
+	unsigned n_vector_stores = 0;
+	irg_walk_graph(irg, count_vector_store, NULL, &n_vector_stores);
+	return n_vector_stores > 0;
+}
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+typedef int (*group_func_t)(int *dst, int *a, int *b);
+
+/** Checks that @p func computes the same as the unpacked group @p kind. */
+static bool computes_group(group_func_t const func, group_kind_t const kind)
+{
+	int a[N_LANES + 2] = { 3, 14, 15, 92, 65, 35 };
+	int b[N_LANES]     = { -1, 20, 300, 4000 };
+	int dst[N_LANES + 1];
+	for (unsigned i = 0; i < ARRAY_SIZE(dst); ++i)
+		dst[i] = 42;
+
+	int const res = func(dst, a, b);
+	if (res != (kind == GROUP_EXTRA_USER ? a[1] + b[1] : 0))
+		return false;
+	for (unsigned i = 0; i < N_LANES; ++i) {
+		unsigned const a_index = kind == GROUP_OFFSETS && i >= 2 ? 5 - i : i;
+		if (dst[i] != a[a_index] + b[i])
+			return false;
+	}
+	/* nothing is written behind the group */
+	return dst[N_LANES] == 42;
+}
+
+/** Compiles the groups @p entities, indexed by their kind, and runs them. */
+static bool run_groups(ir_entity *const *const entities)
+{
+	be_lower_for_target();
+	ir_jit_segment_t  *const segment = be_new_jit_segment();
+	ir_jit_function_t *functions[N_GROUPS];
+	for (size_t i = 0; i < N_GROUPS; ++i) {
+		functions[i] = be_jit_compile(segment, get_entity_irg(entities[i]));
+		if (functions[i] == NULL)
+			return false;
+	}
+	void       *addresses[N_GROUPS];
+	void *const code = be_jit_emit_executable(segment, N_GROUPS, functions,
+	                                          entities, addresses);
+	bool ok = code != NULL;
+	for (size_t i = 0; ok && i < N_GROUPS; ++i)
+		ok = computes_group((group_func_t)addresses[i], (group_kind_t)i);
+	be_destroy_jit_segment(segment);
+	return ok;
+}
+
+#else
+
+static bool run_groups(ir_entity *const *const entities)
+{
+	(void)entities;
+	return true;
+}
+
+#endif
+
+int main(void)
+{
+	ir_init();
+	ir_target_set("x86_64-linux-gnu");
+	ir_target_init();
+
+	ir_entity *const entities[N_GROUPS] = {
+		build_group("add_packed", GROUP_PACKED),
+		/* the scalar sum would have to stay alive */
+		build_group("add_extra_user", GROUP_EXTRA_USER),
+		/* the Loads are not adjacent in lane order */
+		build_group("add_offsets", GROUP_OFFSETS),
+		/* the vector Store would have to wait for a Load after itself */
+		build_group("add_dependent", GROUP_DEPENDENT),
+	};
+	bool const packed     = is_packed(entities[GROUP_PACKED]);
+	bool const extra_user = is_packed(entities[GROUP_EXTRA_USER]);
+	bool const offsets    = is_packed(entities[GROUP_OFFSETS]);
+	bool const dependent  = is_packed(entities[GROUP_DEPENDENT]);
+	assert(packed);
+	assert(!extra_user && !offsets && !dependent);
+	(void)packed;
+	(void)extra_user;
+	(void)offsets;
+	(void)dependent;
+
+	bool const correct = run_groups(entities);
+	assert(correct);
+	(void)correct;
+
+	ir_finish();
+	return 0;
+}
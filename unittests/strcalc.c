@@ -100,6 +100,78 @@ static bool is_zero(const sc_word *val)
 	return sc_is_zero(val, precision);
 }
 
+static bool equal_hex(const sc_word *val, bool negative, const char *hex)
+{
+	sc_word *temp = XMALLOCN(sc_word, buflen);
+	sc_val_from_str(negative, 16, hex, strlen(hex), temp);
+	bool res = memcmp(val, temp, buflen) == 0;
+	free(temp);
+	return res;
+}
+
+/* results leaving the range of a machine word */
+static void test_word_boundary(void)
+{
+	sc_word *max64 = XMALLOCN(sc_word, buflen);
+	sc_word *min64 = XMALLOCN(sc_word, buflen);
+	sc_word *one   = XMALLOCN(sc_word, buflen);
+	sc_word *mone  = XMALLOCN(sc_word, buflen);
+	sc_word *temp  = XMALLOCN(sc_word, buflen);
+	sc_word *temp1 = XMALLOCN(sc_word, buflen);
+	sc_max_from_bits(64, true, max64);
+	sc_min_from_bits(64, true, min64);
+	sc_val_from_long(1, one);
+	sc_val_from_long(-1, mone);
+
+	sc_add(max64, one, temp);
+	assert(equal_hex(temp, false, "8000000000000000"));
+	sc_add(max64, max64, temp);
+	assert(equal_hex(temp, false, "FFFFFFFFFFFFFFFE"));
+	sc_sub(min64, one, temp);
+	assert(equal_hex(temp, true, "8000000000000001"));
+	sc_add(min64, min64, temp);
+	assert(equal_hex(temp, true, "10000000000000000"));
+
+	sc_val_from_long(16, temp1);
+	sc_mul(max64, temp1, temp);
+	assert(equal_hex(temp, false, "7FFFFFFFFFFFFFFF0"));
+	sc_mul(min64, mone, temp);
+	assert(equal_hex(temp, false, "8000000000000000"));
+	sc_mul(min64, temp1, temp);
+	assert(equal_hex(temp, true, "80000000000000000"));
+
+	assert(!sc_divmod(min64, mone, temp, temp1));
+	assert(equal_hex(temp, false, "8000000000000000"));
+	sc_val_from_long(-7, temp1);
+	sc_val_from_long(2, temp);
+	sc_word *quot = XMALLOCN(sc_word, buflen);
+	sc_word *rem  = XMALLOCN(sc_word, buflen);
+	assert(sc_divmod(temp1, temp, quot, rem));
+	assert(equal_hex(quot, true, "3"));
+	assert(equal_hex(rem, true, "1"));
+
+	sc_shlI(min64, 1, temp);
+	assert(equal_hex(temp, true, "10000000000000000"));
+	sc_shlI(max64, 4, temp);
+	assert(equal_hex(temp, false, "7FFFFFFFFFFFFFFF0"));
+	assert(sc_shrI(max64, 62, temp));
+	assert(equal_hex(temp, false, "1"));
+	assert(!sc_shrsI(min64, 63, 64, temp));
+	assert(equal_hex(temp, true, "1"));
+	sc_val_from_long(0xF0, temp1);
+	assert(!sc_shrsI(temp1, 4, 8, temp));
+	assert(equal_hex(temp, true, "1"));
+
+	free(quot);
+	free(rem);
+	free(temp1);
+	free(temp);
+	free(mone);
+	free(one);
+	free(min64);
+	free(max64);
+}
+
 int main(void)
 {
 	init_strcalc(precision);
@@ -333,6 +405,8 @@ int main(void)
 		}
 	}
 
+	test_word_boundary();
+
 	/* test printing/conversion */
 	test_conv_print(1, SC_HEX, "1");
 	test_conv_print(1, SC_DEC, "1");